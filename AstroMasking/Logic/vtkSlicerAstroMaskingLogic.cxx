@@ -185,6 +185,13 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
     return false;
     }
 
+  if (!this->GetAstroVolumeLogic())
+    {
+    vtkErrorMacro("vtkSlicerAstroMaskingLogic::ApplyBlank :"
+                  " AstroVolume logic not found.");
+    return false;
+    }
+
   vtkMRMLAstroVolumeNode *inputVolume =
     vtkMRMLAstroVolumeNode::SafeDownCast
       (this->GetMRMLScene()->GetNodeByID(pnode->GetInputVolumeNodeID()));
@@ -241,8 +248,8 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
-  const int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1] * numComponents;
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   float *inFPixel = nullptr;
   float *outFPixel = nullptr;
@@ -280,7 +287,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
   if(segmentationActive)
     {
     maskPixel = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
-    for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+    for (vtkIdType elementCnt = 0; elementCnt < numElements; elementCnt++)
       {
       if (pnode->GetStatus() == -1)
         {
@@ -346,11 +353,11 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
     double roiBounds[6];
     this->GetAstroVolumeLogic()->CalculateROICropVolumeBounds(roiNode, inputVolume, roiBounds);
 
-    int firstElement = (roiBounds[0] + roiBounds[2] * dims[0] +
-                       roiBounds[4] * numSlice);
+    vtkIdType firstElement = (roiBounds[0] + roiBounds[2] * dims[0] +
+                             roiBounds[4] * numSlice);
 
-    int lastElement = (roiBounds[1] + roiBounds[3] * dims[0] +
-                      roiBounds[5] * numSlice) + 1;
+    vtkIdType lastElement = (roiBounds[1] + roiBounds[3] * dims[0] +
+                            roiBounds[5] * numSlice) + 1;
 
     if (firstElement == 0 && lastElement == numElements &&
         (BlankString.find("NaN") != std::string::npos ||
@@ -375,7 +382,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
       return false;
       }
 
-    for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+    for (vtkIdType elementCnt = 0; elementCnt < numElements; elementCnt++)
       {
       if (pnode->GetStatus() == -1)
         {
@@ -383,13 +390,13 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
         break;
         }
 
-      int ref  = (int) floor(elementCnt / dims[0]);
+      vtkIdType ref = elementCnt / dims[0];
       ref *= dims[0];
-      int x = elementCnt - ref;
-      ref = (int) floor(elementCnt / numSlice);
+      int x = static_cast<int>(elementCnt - ref);
+      ref = elementCnt / numSlice;
       ref *= numSlice;
       ref = elementCnt - ref;
-      int y = (int) floor(ref / dims[0]);
+      int y = static_cast<int>(ref / dims[0]);
       bool eleOutside = (elementCnt < firstElement || elementCnt >= lastElement ||
                         x < roiBounds[0] ||  x > roiBounds[1] ||
                         y < roiBounds[2] ||  y > roiBounds[3]);
@@ -426,6 +433,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
         }
       }
     }
+  outputVolume->GetImageData()->Modified();
 
   gettimeofday(&end, nullptr);
 
@@ -456,10 +464,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyBlank(vtkMRMLAstroMaskingParametersNode *p
 
   gettimeofday(&start, nullptr);
 
-  int wasModifying = outputVolume->StartModify();
-  outputVolume->UpdateRangeAttributes();
-  outputVolume->UpdateDisplayThresholdAttributes();
-  outputVolume->EndModify(wasModifying);
+  this->GetAstroVolumeLogic()->UpdateStatisticsAttributes(outputVolume);
 
   pnode->SetStatus(100);
 
@@ -492,6 +497,13 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
     return false;
     }
 
+  if (!this->GetAstroVolumeLogic())
+    {
+    vtkErrorMacro("vtkSlicerAstroMaskingLogic::ApplyCrop :"
+                  " AstroVolume logic not found.");
+    return false;
+    }
+
   vtkMRMLAstroVolumeNode *inputVolume =
     vtkMRMLAstroVolumeNode::SafeDownCast
       (this->GetMRMLScene()->GetNodeByID(pnode->GetInputVolumeNodeID()));
@@ -527,11 +539,11 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1] * numComponents;
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   // Crop outputVolume by voxels bounds
-  int firstElement = 0, lastElement = 0;
+  vtkIdType firstElement = 0, lastElement = 0;
   double cropBounds[6] = {0.};
 
   float *inFPixel = nullptr;
@@ -649,9 +661,9 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
 
   pnode->SetStatus(1);
 
-  int outElementCnt = 0;
+  vtkIdType outElementCnt = 0;
 
-  for (int elementCnt = firstElement; elementCnt < lastElement; elementCnt++)
+  for (vtkIdType elementCnt = firstElement; elementCnt < lastElement; elementCnt++)
     {
     if (pnode->GetStatus() == -1)
       {
@@ -659,13 +671,13 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
       break;
       }
 
-    int ref  = (int) floor(elementCnt / dims[0]);
+    vtkIdType ref = elementCnt / dims[0];
     ref *= dims[0];
-    int x = elementCnt - ref;
-    ref = (int) floor(elementCnt / numSlice);
+    int x = static_cast<int>(elementCnt - ref);
+    ref = elementCnt / numSlice;
     ref *= numSlice;
     ref = elementCnt - ref;
-    int y = (int) floor(ref / dims[0]);
+    int y = static_cast<int>(ref / dims[0]);
 
     if (x < cropBounds[0] || x > cropBounds[1] ||
         y < cropBounds[2] || y > cropBounds[3])
@@ -690,6 +702,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
       pnode->SetStatus(status);
       }
     }
+  outputVolume->GetImageData()->Modified();
 
   gettimeofday(&end, nullptr);
 
@@ -721,8 +734,7 @@ bool vtkSlicerAstroMaskingLogic::ApplyCrop(vtkMRMLAstroMaskingParametersNode *pn
 
   gettimeofday(&start, nullptr);
 
-  outputVolume->UpdateRangeAttributes();
-  outputVolume->UpdateDisplayThresholdAttributes();
+  this->Internal->AstroVolumeLogic->UpdateStatisticsAttributes(outputVolume);
 
   // center the volume
   this->Internal->AstroVolumeLogic->CenterVolume(outputVolume);
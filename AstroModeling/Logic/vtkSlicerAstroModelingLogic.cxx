@@ -21,6 +21,7 @@
 #include "vtkSlicerAstroVolumeLogic.h"
 #include "vtkSlicerAstroModelingLogic.h"
 #include "vtkSlicerAstroConfigure.h"
+#include "vtkSlicerAstroTemplateMacro.h"
 #include "vtkSlicerMarkupsLogic.h"
 
 //3DBarolo includes
@@ -421,6 +422,13 @@ int vtkSlicerAstroModelingLogic::OperateModel(vtkMRMLAstroModelingParametersNode
     return 0;
     }
 
+  if (!vtkSlicerAstroIsFloatingTemplateType(dataArray->GetDataType()))
+    {
+    vtkErrorMacro("vtkSlicerAstroModelingLogic::OperateModel :"
+                  " the input must be a float or double datacube.");
+    return 0;
+    }
+
   vtkMRMLAstroVolumeDisplayNode* inputVolumeDisplay =
     inputVolume->GetAstroVolumeDisplayNode();
   if (!inputVolumeDisplay)
@@ -794,7 +802,7 @@ int vtkSlicerAstroModelingLogic::OperateModel(vtkMRMLAstroModelingParametersNode
 
   int *dims = inputVolume->GetImageData()->GetDimensions();
   int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   switch (DataType)
     {
@@ -1918,6 +1926,13 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
     return 0;
     }
 
+  if (!vtkSlicerAstroIsFloatingTemplateType(dataArray->GetDataType()))
+    {
+    vtkErrorMacro("vtkSlicerAstroModelingLogic::UpdateModelFromTable :"
+                  " the input must be a float or double datacube.");
+    return 0;
+    }
+
   vtkMRMLAstroVolumeDisplayNode* inputVolumeDisplay =
     inputVolume->GetAstroVolumeDisplayNode();
   if (!inputVolumeDisplay)
@@ -1950,7 +1965,7 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
 
   int *dims = inputVolume->GetImageData()->GetDimensions();
   int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
 
   if (!this->Internal->fitF && !this->Internal->fitD)
     {
@@ -2920,5 +2935,8 @@ int vtkSlicerAstroModelingLogic::UpdateModelFromTable(vtkMRMLAstroModelingParame
       }
     }
 
+  outputVolume->GetImageData()->Modified();
+  residualVolume->GetImageData()->Modified();
+
   return 1;
 }
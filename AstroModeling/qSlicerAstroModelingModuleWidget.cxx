@@ -4425,6 +4425,10 @@ void qSlicerAstroModelingModuleWidget::onWorkFinished()
 
   if (d->parametersNode->GetFitSuccess())
     {
+    // the fit has written the voxels in the worker thread
+    outputVolume->GetImageData()->Modified();
+    residualVolume->GetImageData()->Modified();
+
     int wasModifying = outputVolume->StartModify();
     outputVolume->UpdateRangeAttributes();
     outputVolume->UpdateDisplayThresholdAttributes();
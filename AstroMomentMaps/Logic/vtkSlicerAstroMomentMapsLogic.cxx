@@ -21,6 +21,7 @@
 #include "vtkSlicerAstroVolumeLogic.h"
 #include "vtkSlicerAstroMomentMapsLogic.h"
 #include "vtkSlicerAstroConfigure.h"
+#include "vtkSlicerAstroTemplateMacro.h"
 
 // MRML includes
 #include <vtkMRMLAstroLabelMapVolumeDisplayNode.h>
@@ -42,8 +43,12 @@
 #include <vtkVersion.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <vector>
 #include <sys/time.h>
 
 // OpenMP includes
@@ -56,36 +61,148 @@
 namespace
 {
 //----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
+// Zero, first and second moments along the spectral axis, between the
+// planes zMin and zMax, of the voxels selected by the mask (above zero)
+// when maskPtr is set, otherwise of those with an intensity strictly
+// between intensityMin and intensityMax. velocities holds the velocity of
+// each plane. zeroPtr, firstPtr and secondPtr are null for the maps not
+// requested (the second moment needs the first one). The spectra of a row
+// of pixels are accumulated together in double precision, so that the
+// innermost loops run over contiguous voxels.
+template <typename T>
+bool CalculateMoments(const T *inPtr, const short *maskPtr, T *zeroPtr, T *firstPtr, T *secondPtr,
+                      const int dims[3], int zMin, int zMax, const std::vector<double>& velocities,
+                      double intensityMin, double intensityMax, double dV,
+                      vtkMRMLAstroMomentMapsParametersNode *pnode)
 {
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1];
+  const double NaN = std::numeric_limits<double>::quiet_NaN();
+  bool cancel = false;
 
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  {
+  std::vector<double> zero(dims[0]);
+  std::vector<double> first(dims[0]);
+  std::vector<double> second(dims[0]);
+  std::vector<double> values(dims[0]);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int j = 0; j < dims[1]; j++)
+    {
+    if (cancel)
+      {
+      continue;
+      }
+    if (pnode->GetStatus() == -1)
+      {
+      cancel = true;
+      continue;
+      }
 
-//----------------------------------------------------------------------------
-template <typename T> bool isNaN(T value)
-{
-  return value != value;
-}
+    const vtkIdType row = static_cast<vtkIdType>(j) * dims[0];
+    std::fill(zero.begin(), zero.end(), 0.);
+    std::fill(first.begin(), first.end(), 0.);
+    std::fill(second.begin(), second.end(), 0.);
 
-//----------------------------------------------------------------------------
-bool DoubleIsNaN(double Value)
-{
-  return isNaN<double>(Value);
+    for (int pass = 0; pass < (secondPtr ? 2 : 1); pass++)
+      {
+      for (int kk = zMin; kk <= zMax; kk++)
+        {
+        const T *in = inPtr + kk * numSlice + row;
+        if (maskPtr)
+          {
+          const short *mask = maskPtr + kk * numSlice + row;
+          for (int i = 0; i < dims[0]; i++)
+            {
+            values[i] = mask[i] > 0.001 && in[i] == in[i] ? in[i] : 0.;
+            }
+          }
+        else
+          {
+          for (int i = 0; i < dims[0]; i++)
+            {
+            values[i] = in[i] > intensityMin && in[i] < intensityMax ? in[i] : 0.;
+            }
+          }
+
+        if (pass == 0)
+          {
+          const double velocity = firstPtr ? velocities[kk] : 0.;
+          for (int i = 0; i < dims[0]; i++)
+            {
+            zero[i] += values[i];
+            first[i] += values[i] * velocity;
+            }
+          }
+        else
+          {
+          const double velocity = velocities[kk];
+          for (int i = 0; i < dims[0]; i++)
+            {
+            second[i] += values[i] * (velocity - first[i]) * (velocity - first[i]);
+            }
+          }
+        }
+
+      if (pass == 0 && firstPtr)
+        {
+        for (int i = 0; i < dims[0]; i++)
+          {
+          first[i] = fabs(zero[i]) < DOUBLEPRECISION || fabs(first[i]) < DOUBLEPRECISION ?
+            NaN : first[i] / zero[i];
+          }
+        }
+      }
+
+    for (int i = 0; i < dims[0]; i++)
+      {
+      if (zeroPtr)
+        {
+        zeroPtr[row + i] = fabs(zero[i]) < DOUBLEPRECISION ?
+          std::numeric_limits<T>::quiet_NaN() : static_cast<T>(zero[i] * dV);
+        }
+      if (firstPtr)
+        {
+        firstPtr[row + i] = first[i] != first[i] ?
+          std::numeric_limits<T>::quiet_NaN() : static_cast<T>(first[i]);
+        }
+      if (secondPtr)
+        {
+        secondPtr[row + i] = fabs(zero[i]) < DOUBLEPRECISION || fabs(second[i]) < DOUBLEPRECISION ||
+                             second[i] != second[i] ?
+          std::numeric_limits<T>::quiet_NaN() : static_cast<T>(sqrt(second[i] / zero[i]));
+        }
+      }
+
+    // the first thread reports the progress of its (first) block of rows
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (omp_get_thread_num() == 0)
+      {
+      pnode->SetStatus(std::min(99, 1 + static_cast<int>(98. * (j + 1) * omp_get_num_threads() / dims[1])));
+      }
+    #else
+    pnode->SetStatus(1 + static_cast<int>(98. * (j + 1) / dims[1]));
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    }
+  }
+
+  return !cancel;
 }
 
 //----------------------------------------------------------------------------
-bool FloatIsNaN(float Value)
+// Range and noise attributes of a moment map, stored in the statistics
+// cache of the AstroVolume logic for the other modules.
+bool UpdateStatisticsAttributes(vtkSlicerAstroVolumeLogic *astroVolumeLogic,
+                                vtkMRMLAstroVolumeNode *volume)
 {
-  return isNaN<float>(Value);
+  if (!astroVolumeLogic)
+    {
+    return volume->UpdateRangeAttributes() && volume->UpdateDisplayThresholdAttributes();
+    }
+  return astroVolumeLogic->UpdateStatisticsAttributes(volume);
 }
 
 }// end namespace
@@ -237,59 +354,62 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
-
-  float *inFPixel = nullptr;
-  float *outZeroFPixel = nullptr;
-  float *outFirstFPixel = nullptr;
-  float *outSecondFPixel = nullptr;
-  short *maskPixel = nullptr;
-  double *inDPixel = nullptr;
-  double *outZeroDPixel = nullptr;
-  double *outFirstDPixel = nullptr;
-  double *outSecondDPixel = nullptr;
+  if (numComponents > 1)
+    {
+    vtkErrorMacro("vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps :"
+                  " imageData with more than one components.");
+    return false;
+    }
 
-  bool forceGenerateFirst = false;
+  const bool generateFirst = pnode->GetGenerateFirst() || pnode->GetGenerateSecond();
 
-  if (pnode->GetGenerateFirst() || pnode->GetGenerateSecond())
+  // the scaled int16 cubes are integrated on their float physical values,
+  // and their moment maps (cloned from the cube) are converted to float
+  vtkSmartPointer<vtkImageData> inputImageData =
+    vtkSlicerAstroVolumeLogic::GetPhysicalImageData(inputVolume);
+  if (!inputImageData)
     {
-    forceGenerateFirst = true ;
+    vtkErrorMacro("Attempt to allocate scalars of type not allowed");
+    return false;
     }
-
-  const int DataType = ZeroMomentVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  switch (DataType)
+  void *inPtr = inputImageData->GetScalarPointer(0,0,0);
+  void *outZeroPtr = nullptr;
+  void *outFirstPtr = nullptr;
+  void *outSecondPtr = nullptr;
+  short *maskPixel = nullptr;
+  const int DataType = inputImageData->GetScalarType();
+  if (pnode->GetGenerateZero())
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-        outZeroFPixel = static_cast<float*> (ZeroMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-      if (forceGenerateFirst)
-        {
-        outFirstFPixel = static_cast<float*> (FirstMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-        }
-      if (pnode->GetGenerateSecond())
-        {
-        outSecondFPixel = static_cast<float*> (SecondMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-        }
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-        outZeroDPixel = static_cast<double*> (ZeroMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-      if (forceGenerateFirst)
-        {
-        outFirstDPixel = static_cast<double*> (FirstMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-        }
-      if (pnode->GetGenerateSecond())
-        {
-        outSecondDPixel = static_cast<double*> (SecondMomentVolume->GetImageData()->GetScalarPointer(0,0,0));
-        };
-      break;
-    default:
-      vtkErrorMacro("Attempt to allocate scalars of type not allowed");
-      return 0;
+    if (!vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(ZeroMomentVolume, DataType))
+      {
+      vtkErrorMacro("vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps :"
+                    " ZeroMomentVolume data type differs from the input one!");
+      return false;
+      }
+    outZeroPtr = ZeroMomentVolume->GetImageData()->GetScalarPointer(0,0,0);
+    }
+  if (generateFirst)
+    {
+    if (!vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(FirstMomentVolume, DataType))
+      {
+      vtkErrorMacro("vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps :"
+                    " FirstMomentVolume not found or with a data type different from the input one!");
+      return false;
+      }
+    outFirstPtr = FirstMomentVolume->GetImageData()->GetScalarPointer(0,0,0);
+    }
+  if (pnode->GetGenerateSecond())
+    {
+    if (!vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(SecondMomentVolume, DataType))
+      {
+      vtkErrorMacro("vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps :"
+                    " SecondMomentVolume data type differs from the input one!");
+      return false;
+      }
+    outSecondPtr = SecondMomentVolume->GetImageData()->GetScalarPointer(0,0,0);
     }
 
   bool cancel = false;
-  int status = 0;
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   int numProcs = 0;
@@ -313,8 +433,6 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
 
   pnode->SetStatus(1);
 
-  const double NaN = sqrt(-1);
-
   vtkMRMLAstroVolumeDisplayNode* astroDisplay = inputVolume->GetAstroVolumeDisplayNode();
   if (!astroDisplay)
     {
@@ -323,8 +441,8 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
     return false;
     }
   double ijk[3], world[3];
-  ijk[0] = StringToDouble(inputVolume->GetAttribute("SlicerAstro.NAXIS1")) * 0.5;
-  ijk[1] = StringToDouble(inputVolume->GetAttribute("SlicerAstro.NAXIS2")) * 0.5;
+  ijk[0] = inputVolume->GetAxisLength(0) * 0.5;
+  ijk[1] = inputVolume->GetAxisLength(1) * 0.5;
   double VelFactor = 1.;
 
   struct wcsprm* WCS = astroDisplay->GetWCSStruct();
@@ -339,240 +457,29 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
     VelFactor = 0.001;
     }
 
-  if(pnode->GetMaskActive())
+  // velocity of each plane (at the centre of the field), computed once
+  // here since the WCS calls are not thread safe
+  std::vector<double> velocities;
+  if (generateFirst)
     {
-    double dV = fabs((pnode->GetVelocityMax() - pnode->GetVelocityMin()) / dims[2]);
-    maskPixel = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
-
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outZeroFPixel, outZeroDPixel, outFirstFPixel, outFirstDPixel, outSecondFPixel, outSecondDPixel, ijk, world, maskPixel, cancel, status, forceGenerateFirst, VelFactor, dV)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < numSlice; elemCnt++)
+    velocities.resize(dims[2]);
+    double ijkCoordinates[3] = {ijk[0], ijk[1], 0.};
+    double SpaceCoordinates[3];
+    for (int kk = 0; kk < dims[2]; kk++)
       {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-              *(outZeroFPixel + elemCnt) = 0.;
-            if (forceGenerateFirst)
-              {
-              *(outFirstFPixel + elemCnt) = 0.;
-              }
-            if (pnode->GetGenerateSecond())
-              {
-              *(outSecondFPixel + elemCnt) = 0.;
-              }
-            break;
-          case VTK_DOUBLE:
-              *(outZeroDPixel + elemCnt) = 0.;
-            if (forceGenerateFirst)
-              {
-              *(outFirstDPixel + elemCnt) = 0.;
-              }
-            if (pnode->GetGenerateSecond())
-              {
-              *(outSecondDPixel + elemCnt) = 0.;
-              }
-            break;
-          }
-
-        double SpaceCoordinates[3];
-        double ijkCoordinates[3];
-        ijkCoordinates[0] = ijk[0];
-        ijkCoordinates[1] = ijk[1];
-        for (int kk = 0; kk < dims[2]; kk++)
-          {
-          int posData = elemCnt + kk * numSlice;
-          if (forceGenerateFirst)
-            {
-            ijkCoordinates[2] = kk;
-            astroDisplay->GetReferenceSpace(ijkCoordinates, SpaceCoordinates);
-            SpaceCoordinates[2] *= VelFactor;
-            }
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (*(maskPixel + posData) > 0.001)
-                {
-                if (FloatIsNaN(*(inFPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outZeroFPixel + elemCnt) += *(inFPixel + posData);
-                if (forceGenerateFirst)
-                  {
-                  *(outFirstFPixel + elemCnt) += *(inFPixel + posData) * SpaceCoordinates[2];
-                  }
-                }
-              break;
-            case VTK_DOUBLE:
-              if (*(maskPixel + posData) > 0.001)
-                {
-                if (DoubleIsNaN(*(inDPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outZeroDPixel + elemCnt) += *(inDPixel + posData);
-                if (forceGenerateFirst)
-                  {
-                  *(outFirstDPixel + elemCnt) += *(inDPixel + posData) * SpaceCoordinates[2];
-                  }
-                }
-              break;
-            }
-          }
-
-        if (forceGenerateFirst)
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outFirstFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outFirstFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outFirstFPixel + elemCnt) /= *(outZeroFPixel + elemCnt);
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outFirstFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outFirstDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outFirstDPixel + elemCnt) /= *(outZeroDPixel + elemCnt);
-                }
-              break;
-            }
-          }
-
-        if (pnode->GetGenerateSecond())
-          {
-          for (int kk = 0; kk < dims[2]; kk++)
-            {
-            int posData = elemCnt + kk * numSlice;
-            ijkCoordinates[2] = kk;
-            astroDisplay->GetReferenceSpace(ijkCoordinates, SpaceCoordinates);
-            SpaceCoordinates[2] *= VelFactor;
-            switch (DataType)
-              {
-              case VTK_FLOAT:
-                if (*(maskPixel + posData) > 0.001)
-                  {
-                  if (FloatIsNaN(*(inFPixel + posData)))
-                    {
-                    continue;
-                    }
-                  *(outSecondFPixel + elemCnt) += *(inFPixel + posData) * (SpaceCoordinates[2] - *(outFirstFPixel + elemCnt))
-                                                                        * (SpaceCoordinates[2] - *(outFirstFPixel + elemCnt));
-                  }
-                break;
-              case VTK_DOUBLE:
-                if (*(maskPixel + posData) > 0.001)
-                  {
-                  if (DoubleIsNaN(*(inDPixel + posData)))
-                    {
-                    continue;
-                    }
-                  *(outSecondDPixel + elemCnt) += *(inDPixel + posData) * (SpaceCoordinates[2] - *(outFirstDPixel + elemCnt))
-                                                                        * (SpaceCoordinates[2] - *(outFirstDPixel + elemCnt));
-                  }
-                break;
-              }
-            }
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outSecondFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outSecondFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outSecondFPixel + elemCnt) = sqrt(*(outSecondFPixel + elemCnt) / *(outZeroFPixel + elemCnt));
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outSecondFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outSecondDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outSecondDPixel + elemCnt) = sqrt(*(outSecondDPixel + elemCnt) / *(outZeroDPixel + elemCnt));
-                }
-              break;
-            }
-          }
-
-        if (pnode->GetGenerateZero())
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outZeroFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outZeroFPixel + elemCnt) *= dV;
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outZeroDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outZeroDPixel + elemCnt) *= dV;
-                }
-              break;
-            }
-          }
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(elemCnt / (numSlice / (numProcs * 100.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(elemCnt / (numSlice / 100.) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
+      ijkCoordinates[2] = kk;
+      astroDisplay->GetReferenceSpace(ijkCoordinates, SpaceCoordinates);
+      velocities[kk] = SpaceCoordinates[2] * VelFactor;
       }
     }
+
+  int Zmin = 0, Zmax = dims[2] - 1;
+  double dV = 0.;
+  if(pnode->GetMaskActive())
+    {
+    dV = fabs((pnode->GetVelocityMax() - pnode->GetVelocityMin()) / dims[2]);
+    maskPixel = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
+    }
   else
     {
     ijk[2] = 0.;
@@ -581,7 +488,6 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
     VelMin /= VelFactor;
     world[2] = VelMin;
     astroDisplay->GetIJKSpace(world, ijk);
-    int Zmin;
     if (ijk[2] < 0)
       {
       Zmin = 0;
@@ -599,7 +505,6 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
     VelMax /= VelFactor;
     world[2] = VelMax;
     astroDisplay->GetIJKSpace(world, ijk);
-    int Zmax;
     if (ijk[2] < 0)
       {
       Zmax = 0;
@@ -615,245 +520,44 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
 
     if (Zmin > Zmax)
       {
-      double temp = Zmin;
-      Zmin = Zmax;
-      Zmax = temp;
+      std::swap(Zmin, Zmax);
       }
 
-    double dV = fabs((pnode->GetVelocityMax() - pnode->GetVelocityMin()) / (Zmax - Zmin));
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outZeroFPixel, outZeroDPixel, outFirstFPixel, outFirstDPixel, outSecondFPixel, outSecondDPixel, ijk, world, maskPixel, cancel, status, forceGenerateFirst, VelFactor, Zmin, Zmax, dV)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < numSlice; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-              *(outZeroFPixel + elemCnt) = 0.;
-            if (forceGenerateFirst)
-              {
-              *(outFirstFPixel + elemCnt) = 0.;
-              }
-            if (pnode->GetGenerateSecond())
-              {
-              *(outSecondFPixel + elemCnt) = 0.;
-              }
-            break;
-          case VTK_DOUBLE:
-              *(outZeroDPixel + elemCnt) = 0.;
-            if (forceGenerateFirst)
-              {
-              *(outFirstDPixel + elemCnt) = 0.;
-              }
-            if (pnode->GetGenerateSecond())
-              {
-              *(outSecondDPixel + elemCnt) = 0.;
-              }
-            break;
-          }
-
-        double SpaceCoordinates[3];
-        double ijkCoordinates[3];
-        ijkCoordinates[0] = ijk[0];
-        ijkCoordinates[1] = ijk[1];
-        for (int kk = Zmin; kk <= Zmax; kk++)
-          {
-          int posData = elemCnt + kk * numSlice;
-          if (forceGenerateFirst)
-            {
-            ijkCoordinates[2] = kk;
-            astroDisplay->GetReferenceSpace(ijkCoordinates, SpaceCoordinates);
-            SpaceCoordinates[2] *= VelFactor;
-            }
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (*(inFPixel + posData) > pnode->GetIntensityMin() &&
-                  *(inFPixel + posData) < pnode->GetIntensityMax())
-                {
-                if (FloatIsNaN(*(inFPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outZeroFPixel + elemCnt) += *(inFPixel + posData);
-                if (forceGenerateFirst)
-                  {
-                  *(outFirstFPixel + elemCnt) += *(inFPixel + posData) * SpaceCoordinates[2];
-                  }
-                }
-              break;
-            case VTK_DOUBLE:
-              if (*(inDPixel + posData) > pnode->GetIntensityMin() &&
-                  *(inDPixel + posData) < pnode->GetIntensityMax())
-                {
-                if (DoubleIsNaN(*(inDPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outZeroDPixel + elemCnt) += *(inDPixel + posData);
-                if (forceGenerateFirst)
-                  {
-                  *(outFirstDPixel + elemCnt) += *(inDPixel + posData) * SpaceCoordinates[2];
-                  }
-                }
-              break;
-            }
-          }
-
-        if (forceGenerateFirst)
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outFirstFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outFirstFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outFirstFPixel + elemCnt) /= *(outZeroFPixel + elemCnt);
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outFirstFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outFirstDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outFirstDPixel + elemCnt) /= *(outZeroDPixel + elemCnt);
-                }
-              break;
-            }
-          }
+    dV = fabs((pnode->GetVelocityMax() - pnode->GetVelocityMin()) / (Zmax - Zmin));
+    }
 
-        if (pnode->GetGenerateSecond())
-          {
-          for (int kk = Zmin; kk <= Zmax; kk++)
-            {
-            int posData = elemCnt + kk * numSlice;
-            ijkCoordinates[2] = kk;
-            astroDisplay->GetReferenceSpace(ijkCoordinates, SpaceCoordinates);
-            SpaceCoordinates[2] *= VelFactor;
-
-            switch (DataType)
-              {
-              case VTK_FLOAT:
-                if (*(inFPixel + posData) > pnode->GetIntensityMin() &&
-                    *(inFPixel + posData) < pnode->GetIntensityMax())
-                  {
-                  if (FloatIsNaN(*(inFPixel + posData)))
-                    {
-                    continue;
-                    }
-                  *(outSecondFPixel + elemCnt) += *(inFPixel + posData) * (SpaceCoordinates[2] - *(outFirstFPixel + elemCnt))
-                                                                        * (SpaceCoordinates[2] - *(outFirstFPixel + elemCnt));
-                  }
-                break;
-              case VTK_DOUBLE:
-                if (*(inDPixel + posData) > pnode->GetIntensityMin() &&
-                    *(inDPixel + posData) < pnode->GetIntensityMax())
-                  {
-                  if (DoubleIsNaN(*(inDPixel + posData)))
-                    {
-                    continue;
-                    }
-                  *(outSecondDPixel + elemCnt) += *(inDPixel + posData) * (SpaceCoordinates[2] - *(outFirstDPixel + elemCnt))
-                                                                        * (SpaceCoordinates[2] - *(outFirstDPixel + elemCnt));
-                  }
-                break;
-              }
-            }
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outSecondFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outSecondFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outSecondFPixel + elemCnt) = sqrt(*(outSecondFPixel + elemCnt) / *(outZeroFPixel + elemCnt));
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION ||
-                  fabs(*(outSecondDPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outSecondDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outSecondDPixel + elemCnt) = sqrt(*(outSecondDPixel + elemCnt) / *(outZeroDPixel + elemCnt));
-                }
-              break;
-            }
-          }
+  // the intensity range is in the stored units of the input
+  double bscale = 1., bzero = 0.;
+  vtkSlicerAstroVolumeLogic::GetPhysicalScaling(inputVolume, bscale, bzero);
+  double intensityMin = bscale * pnode->GetIntensityMin() + bzero;
+  double intensityMax = bscale * pnode->GetIntensityMax() + bzero;
+  if (intensityMin > intensityMax)
+    {
+    std::swap(intensityMin, intensityMax);
+    }
 
-        if (pnode->GetGenerateZero())
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (fabs(*(outZeroFPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outZeroFPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outZeroFPixel + elemCnt) *= dV;
-                }
-              break;
-            case VTK_DOUBLE:
-              if (fabs(*(outZeroDPixel + elemCnt)) < DOUBLEPRECISION)
-                {
-                *(outZeroDPixel + elemCnt) = NaN;
-                }
-              else
-                {
-                *(outZeroDPixel + elemCnt) *= dV;
-                }
-              break;
-            }
-          }
+  switch (DataType)
+    {
+    vtkSlicerAstroFloatingTemplateMacro(
+      cancel = !CalculateMoments(static_cast<VTK_TT*>(inPtr), maskPixel,
+                                 static_cast<VTK_TT*>(outZeroPtr),
+                                 static_cast<VTK_TT*>(outFirstPtr),
+                                 static_cast<VTK_TT*>(outSecondPtr),
+                                 dims, Zmin, Zmax, velocities,
+                                 intensityMin, intensityMax, dV, pnode));
+    }
 
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(elemCnt / (numSlice / (numProcs * 100.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(elemCnt / (numSlice / 100.) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
+  if (outZeroPtr)
+    {
+    ZeroMomentVolume->GetImageData()->Modified();
+    }
+  if (outFirstPtr)
+    {
+    FirstMomentVolume->GetImageData()->Modified();
+    }
+  if (outSecondPtr)
+    {
+    SecondMomentVolume->GetImageData()->Modified();
     }
 
   gettimeofday(&end, nullptr);
@@ -865,32 +569,6 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
 
   vtkDebugMacro("Moment Maps Kernel Time : "<<mtime<<" ms.");
 
-  inFPixel = nullptr;
-  inDPixel = nullptr;
-
-  delete inFPixel;
-  delete inDPixel;
-
-  outZeroFPixel = nullptr;
-  outFirstFPixel = nullptr;
-  outSecondFPixel = nullptr;
-  outZeroDPixel = nullptr;
-  outFirstDPixel = nullptr;
-  outSecondDPixel = nullptr;
-
-  delete outZeroFPixel;
-  delete outFirstFPixel;
-  delete outSecondFPixel;
-  delete outZeroDPixel;
-  delete outFirstDPixel;
-  delete outSecondDPixel;
-
-  if (pnode->GetMaskActive())
-    {
-    maskPixel = nullptr;
-    delete maskPixel;
-    }
-
   if (cancel)
     {
     pnode->SetStatus(100);
@@ -902,13 +580,12 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
   if (pnode->GetGenerateZero())
     {
     int wasModifying = ZeroMomentVolume->StartModify();
-    ZeroMomentVolume->UpdateRangeAttributes();
-    ZeroMomentVolume->UpdateDisplayThresholdAttributes();
+    UpdateStatisticsAttributes(this->GetAstroVolumeLogic(), ZeroMomentVolume);
     int disabledModify = ZeroMomentVolume->GetAstroVolumeDisplayNode()->StartModify();
     ZeroMomentVolume->GetAstroVolumeDisplayNode()->ResetWindowLevelPresets();
     ZeroMomentVolume->GetAstroVolumeDisplayNode()->SetAutoWindowLevel(0);
-    double min = StringToDouble(ZeroMomentVolume->GetAttribute("SlicerAstro.DATAMIN"));
-    double max = StringToDouble(ZeroMomentVolume->GetAttribute("SlicerAstro.DATAMAX"));
+    double min = ZeroMomentVolume->GetDataMin();
+    double max = ZeroMomentVolume->GetDataMax();
     double window = max-min;
     double level = 0.5*(max+min);
     ZeroMomentVolume->GetAstroVolumeDisplayNode()->SetWindowLevel(window, level);
@@ -919,13 +596,12 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
   if (pnode->GetGenerateFirst())
     {
     int wasModifying = FirstMomentVolume->StartModify();
-    FirstMomentVolume->UpdateRangeAttributes();
-    FirstMomentVolume->UpdateDisplayThresholdAttributes();
+    UpdateStatisticsAttributes(this->GetAstroVolumeLogic(), FirstMomentVolume);
     int disabledModify = FirstMomentVolume->GetAstroVolumeDisplayNode()->StartModify();
     FirstMomentVolume->GetAstroVolumeDisplayNode()->ResetWindowLevelPresets();
     FirstMomentVolume->GetAstroVolumeDisplayNode()->SetAutoWindowLevel(0);
-    double min = StringToDouble(FirstMomentVolume->GetAttribute("SlicerAstro.DATAMIN"));
-    double max = StringToDouble(FirstMomentVolume->GetAttribute("SlicerAstro.DATAMAX"));
+    double min = FirstMomentVolume->GetDataMin();
+    double max = FirstMomentVolume->GetDataMax();
     double window = max-min;
     double level = 0.5*(max+min);
     FirstMomentVolume->GetAstroVolumeDisplayNode()->SetWindowLevel(window, level);
@@ -936,13 +612,12 @@ bool vtkSlicerAstroMomentMapsLogic::CalculateMomentMaps(vtkMRMLAstroMomentMapsPa
   if (pnode->GetGenerateSecond())
     {
     int wasModifying = SecondMomentVolume->StartModify();
-    SecondMomentVolume->UpdateRangeAttributes();
-    SecondMomentVolume->UpdateDisplayThresholdAttributes();
+    UpdateStatisticsAttributes(this->GetAstroVolumeLogic(), SecondMomentVolume);
     int disabledModify = SecondMomentVolume->GetAstroVolumeDisplayNode()->StartModify();
     SecondMomentVolume->GetAstroVolumeDisplayNode()->ResetWindowLevelPresets();
     SecondMomentVolume->GetAstroVolumeDisplayNode()->SetAutoWindowLevel(0);
-    double min = StringToDouble(SecondMomentVolume->GetAttribute("SlicerAstro.DATAMIN"));
-    double max = StringToDouble(SecondMomentVolume->GetAttribute("SlicerAstro.DATAMAX"));
+    double min = SecondMomentVolume->GetDataMin();
+    double max = SecondMomentVolume->GetDataMax();
     double window = max-min;
     double level = 0.5*(max+min);
     SecondMomentVolume->GetAstroVolumeDisplayNode()->SetWindowLevel(window, level);
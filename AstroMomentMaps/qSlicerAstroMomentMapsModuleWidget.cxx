@@ -268,27 +268,6 @@ void qSlicerAstroMomentMapsModuleWidget::exit()
 
 namespace
 {
-//----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
-
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
-
-//----------------------------------------------------------------------------
-int StringToInt(const char* str)
-{
-  return StringToNumber<int>(str);
-}
-
 //----------------------------------------------------------------------------
 template <typename T> std::string NumberToString(T V)
 {
@@ -753,8 +732,8 @@ void qSlicerAstroMomentMapsModuleWidget::onInputVolumeModified()
     }
 
   double ijk[3], worldOne[3], worldTwo[3];
-  ijk[0] = StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.NAXIS1")) * 0.5;
-  ijk[1] = StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.NAXIS2")) * 0.5;
+  ijk[0] = astroMrmlNode->GetAxisLength(0) * 0.5;
+  ijk[1] = astroMrmlNode->GetAxisLength(1) * 0.5;
   ijk[2] = 0.;
   astroMrmlDisplayNode->GetReferenceSpace(ijk, worldOne);
   struct wcsprm* WCS = astroMrmlDisplayNode->GetWCSStruct();
@@ -768,7 +747,7 @@ void qSlicerAstroMomentMapsModuleWidget::onInputVolumeModified()
     {
     worldOne[2] /= 1000.;
     }
-  ijk[2] = StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.NAXIS3"));
+  ijk[2] = astroMrmlNode->GetAxisLength(2);
   if (ijk[2] < 2)
     {
     ijk[2] += 1;
@@ -798,8 +777,8 @@ void qSlicerAstroMomentMapsModuleWidget::onInputVolumeModified()
   d->VelocityRangeWidget->setSingleStep((Vmax - Vmin) / 200.);
   d->VelocityRangeWidget->blockSignals(wasBlocked);
 
-  double min = StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.DATAMIN"));
-  double max = StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.DATAMAX"));
+  double min = astroMrmlNode->GetDataMin();
+  double max = astroMrmlNode->GetDataMax();
 
   d->ThresholdRangeWidget->reset();
   wasBlocked = d->ThresholdRangeWidget->blockSignals(true);
@@ -811,13 +790,13 @@ void qSlicerAstroMomentMapsModuleWidget::onInputVolumeModified()
   d->parametersNode->SetVelocityMin(Vmin);
   d->parametersNode->SetVelocityMax(Vmax);
 
-  d->parametersNode->SetIntensityMin(StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.DATAMIN")));
-  d->parametersNode->SetIntensityMax(StringToDouble(astroMrmlNode->GetAttribute("SlicerAstro.DATAMAX")));
+  d->parametersNode->SetIntensityMin(astroMrmlNode->GetDataMin());
+  d->parametersNode->SetIntensityMax(astroMrmlNode->GetDataMax());
 
   d->parametersNode->EndModify(wasModifying);
 
   d->VelocityUnitLabel->setText("km/s");
-  d->ThresholdUnitLabel->setText(astroMrmlNode->GetAttribute("SlicerAstro.BUNIT"));
+  d->ThresholdUnitLabel->setText(astroMrmlNode->GetDataUnit());
 }
 
 //-----------------------------------------------------------------------------
@@ -1045,7 +1024,7 @@ void qSlicerAstroMomentMapsModuleWidget::onCalculate()
     }
 
   // Check Input volume
-  int n = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS"));
+  int n = inputVolume->GetNumberOfAxes();
   if (n != 3)
     {
     QString message = QString("It is possible to create Moment Maps only"
@@ -1108,8 +1087,8 @@ void qSlicerAstroMomentMapsModuleWidget::onCalculate()
       }
 
     // Get dimensions
-    int N1 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS1"));
-    int N2 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS2"));
+    int N1 = inputVolume->GetAxisLength(0);
+    int N2 = inputVolume->GetAxisLength(1);
 
     // Create an empty 2D image
     vtkNew<vtkImageData> imageDataTemp;
@@ -1125,7 +1104,7 @@ void qSlicerAstroMomentMapsModuleWidget::onCalculate()
     ZeroMomentVolume->SetAttribute("SlicerAstro.NAXIS", "2");
     ZeroMomentVolume->GetAstroVolumeDisplayNode()->SetAttribute("SlicerAstro.NAXIS", "2");
     ZeroMomentVolume->GetAstroVolumeDisplayNode()->CopyWCS(inputVolume->GetAstroVolumeDisplayNode());
-    std::string Bunit = ZeroMomentVolume->GetAttribute("SlicerAstro.BUNIT");
+    std::string Bunit = ZeroMomentVolume->GetDataUnit();
     Bunit += " km/s";
     ZeroMomentVolume->SetAttribute("SlicerAstro.BUNIT", Bunit.c_str());
     std::string Btype = "";
@@ -1210,8 +1189,8 @@ void qSlicerAstroMomentMapsModuleWidget::onCalculate()
       }
 
     // Get dimensions
-    int N1 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS1"));
-    int N2 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS2"));
+    int N1 = inputVolume->GetAxisLength(0);
+    int N2 = inputVolume->GetAxisLength(1);
 
     // Create an empty 2D image
     vtkNew<vtkImageData> imageDataTemp;
@@ -1320,8 +1299,8 @@ void qSlicerAstroMomentMapsModuleWidget::onCalculate()
       }
 
     // Get dimensions
-    int N1 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS1"));
-    int N2 = StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS2"));
+    int N1 = inputVolume->GetAxisLength(0);
+    int N2 = inputVolume->GetAxisLength(1);
 
     // Create an empty 2D image
     vtkNew<vtkImageData> imageDataTemp;
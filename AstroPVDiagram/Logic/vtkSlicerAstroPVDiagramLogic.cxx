@@ -863,7 +863,7 @@ bool vtkSlicerAstroPVDiagramLogic::GenerateAndSetPVDiagram(vtkMRMLAstroPVDiagram
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1] * numComponents;
 
   // 2D nearest-neighbour interpolation.
   // Fiducials are restrained on the Moment Map,
@@ -926,6 +926,7 @@ bool vtkSlicerAstroPVDiagramLogic::GenerateAndSetPVDiagram(vtkMRMLAstroPVDiagram
   delete inDPixel;
   delete PVDiagramDPixel;
 
+  PVDiagramVolume->GetImageData()->Modified();
   PVDiagramVolume->UpdateRangeAttributes();
 
   int HistoryIndex = 0;
@@ -21,6 +21,7 @@
 #include "vtkSlicerAstroVolumeLogic.h"
 #include "vtkSlicerAstroProfilesLogic.h"
 #include "vtkSlicerAstroConfigure.h"
+#include "vtkSlicerAstroTemplateMacro.h"
 
 // MRML includes
 #include <vtkMRMLAstroLabelMapVolumeDisplayNode.h>
@@ -42,8 +43,11 @@
 #include <vtkVersion.h>
 
 // STD includes
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <sys/time.h>
 
 // OpenMP includes
@@ -77,15 +81,91 @@ template <typename T> bool isNaN(T value)
 }
 
 //----------------------------------------------------------------------------
-bool DoubleIsNaN(double Value)
+template <typename T> bool SumPlanes(const T *inPtr, const short *maskPtr, T *profilePtr,
+                                    int numberOfPlanes, vtkIdType numSlice,
+                                    double intensityMin, double intensityMax,
+                                    double unitBeamConv,
+                                    vtkMRMLAstroProfilesParametersNode *pnode)
 {
-  return isNaN<double>(Value);
-}
+  bool cancel = false;
+  int status = 0;
 
-//----------------------------------------------------------------------------
-bool FloatIsNaN(float Value)
-{
-  return isNaN<float>(Value);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(cancel, status)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int elemCnt = 0; elemCnt < numberOfPlanes; elemCnt++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+    if (cancel)
+      {
+      continue;
+      }
+
+    const T *plane = inPtr + elemCnt * numSlice;
+    const short *maskPlane = maskPtr ? maskPtr + elemCnt * numSlice : nullptr;
+    double sum = 0.;
+    for (vtkIdType kk = 0; kk < numSlice; kk++)
+      {
+      const T value = plane[kk];
+      if (maskPlane)
+        {
+        if (maskPlane[kk] > 0.001 && !isNaN(value))
+          {
+          sum += value;
+          }
+        }
+      else if (value > intensityMin && value < intensityMax)
+        {
+        sum += value;
+        }
+      }
+
+    sum *= unitBeamConv;
+    if (fabs(sum) < DOUBLEPRECISION)
+      {
+      profilePtr[elemCnt] = std::numeric_limits<T>::quiet_NaN();
+      }
+    else
+      {
+      profilePtr[elemCnt] = static_cast<T>(sum);
+      }
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (omp_get_thread_num() == 0)
+      {
+      int percentage = 1 + static_cast<int>(98. * (elemCnt + 1) * omp_get_num_threads() / numberOfPlanes);
+      if (percentage > 99)
+        {
+        percentage = 99;
+        }
+      if (percentage > status)
+        {
+        status = percentage;
+        pnode->SetStatus(status);
+        }
+      }
+    #else
+    int percentage = 1 + static_cast<int>(98. * (elemCnt + 1) / numberOfPlanes);
+    if (percentage > status)
+      {
+      status = percentage;
+      pnode->SetStatus(status);
+      }
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    }
+
+  return !cancel;
 }
 
 }// end namespace
@@ -237,32 +317,44 @@ bool vtkSlicerAstroProfilesLogic::CalculateProfile(vtkMRMLAstroProfilesParameter
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1] * numComponents;
 
-  float *inFPixel = nullptr;
-  float *outProfileFPixel = nullptr;
-  short *maskPixel = nullptr;
-  double *inDPixel = nullptr;
-  double *outProfileDPixel = nullptr;
+  // the scaled int16 cubes are integrated on their float physical values,
+  // and their profile (cloned from the cube) is converted to float
+  vtkSmartPointer<vtkImageData> inputImageData =
+    vtkSlicerAstroVolumeLogic::GetPhysicalImageData(inputVolume);
+  if (!inputImageData)
+    {
+    vtkErrorMacro("vtkSlicerAstroProfilesLogic::CalculateProfile :"
+                  " attempt to allocate scalars of type not allowed");
+    return false;
+    }
+  const int DataType = inputImageData->GetScalarType();
 
-  const int DataType = ProfileVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  switch (DataType)
+  if (!vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(ProfileVolume, DataType))
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outProfileFPixel = static_cast<float*> (ProfileVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outProfileDPixel = static_cast<double*> (ProfileVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("Attempt to allocate scalars of type not allowed");
-      return 0;
+    vtkErrorMacro("vtkSlicerAstroProfilesLogic::CalculateProfile :"
+                  " ProfileVolume and inputVolume have different data types!");
+    return false;
     }
 
-  bool cancel = false;
-  int status = 0;
+  void *inPtr = inputImageData->GetScalarPointer(0,0,0);
+  void *outProfilePtr = ProfileVolume->GetImageData()->GetScalarPointer(0,0,0);
+  short *maskPtr = nullptr;
+  if (maskActive)
+    {
+    maskPtr = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
+    }
+
+  // the intensity range is in the stored units of the input
+  double bscale = 1., bzero = 0.;
+  vtkSlicerAstroVolumeLogic::GetPhysicalScaling(inputVolume, bscale, bzero);
+  double IntensityMin = bscale * pnode->GetIntensityMin() + bzero;
+  double IntensityMax = bscale * pnode->GetIntensityMax() + bzero;
+  if (IntensityMin > IntensityMax)
+    {
+    std::swap(IntensityMin, IntensityMax);
+    }
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   int numProcs = 0;
@@ -286,276 +378,13 @@ bool vtkSlicerAstroProfilesLogic::CalculateProfile(vtkMRMLAstroProfilesParameter
 
   pnode->SetStatus(1);
 
-  const double NaN = sqrt(-1);
-
-  vtkMRMLAstroVolumeDisplayNode* astroDisplay = inputVolume->GetAstroVolumeDisplayNode();
-  if (!astroDisplay)
-    {
-    vtkErrorMacro("vtkSlicerAstroProfilesLogic::CalculateProfile :"
-                  " astroDisplay not found!");
-    return false;
-    }
-  double ijk[3], world[3];
-  ijk[0] = StringToDouble(inputVolume->GetAttribute("SlicerAstro.NAXIS1")) * 0.5;
-  ijk[1] = StringToDouble(inputVolume->GetAttribute("SlicerAstro.NAXIS2")) * 0.5;
-  double VelFactor = 1.;
-
-  struct wcsprm* WCS = astroDisplay->GetWCSStruct();
-  if (!WCS)
-    {
-    vtkErrorMacro("vtkSlicerAstroProfilesLogic::CalculateProfile :"
-                  " WCS not found!");
-    return false;
-    }
-  if (!strcmp(WCS->cunit[2], "m/s"))
-    {
-    VelFactor = 0.001;
-    }
-
-  if(pnode->GetMaskActive())
-    {
-    maskPixel = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
-
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outProfileFPixel, outProfileDPixel, maskPixel, cancel, status)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < dims[2]; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-              *(outProfileFPixel + elemCnt) = 0.;
-            break;
-          case VTK_DOUBLE:
-              *(outProfileDPixel + elemCnt) = 0.;
-            break;
-          }
-
-        for (int kk = 0; kk < numSlice; kk++)
-          {
-          int posData = elemCnt * numSlice + kk;
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (*(maskPixel + posData) > 0.001)
-                {
-                if (FloatIsNaN(*(inFPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outProfileFPixel + elemCnt) += *(inFPixel + posData);
-                }
-              break;
-            case VTK_DOUBLE:
-              if (*(maskPixel + posData) > 0.001)
-                {
-                if (DoubleIsNaN(*(inDPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outProfileDPixel + elemCnt) += *(inDPixel + posData);
-                }
-              break;
-            }
-          }
-
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-            *(outProfileFPixel + elemCnt) *= unitBeamConv;
-            if (fabs(*(outProfileFPixel + elemCnt)) < DOUBLEPRECISION)
-              {
-              *(outProfileFPixel + elemCnt) = NaN;
-              }
-            break;
-          case VTK_DOUBLE:
-            *(outProfileDPixel + elemCnt) *= unitBeamConv;
-            if (fabs(*(outProfileDPixel + elemCnt)) < DOUBLEPRECISION)
-              {
-              *(outProfileDPixel + elemCnt) = NaN;
-              }
-            break;
-          }
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(elemCnt / (numSlice / (numProcs * 100.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(elemCnt / (numSlice / 100.) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
-    }
-  else
+  bool cancel = false;
+  switch (DataType)
     {
-    ijk[2] = 0.;
-    astroDisplay->GetReferenceSpace(ijk, world);
-    double VelMin = pnode->GetVelocityMin();
-    VelMin /= VelFactor;
-    world[2] = VelMin;
-    astroDisplay->GetIJKSpace(world, ijk);
-    int Zmin;
-    if (ijk[2] < 0)
-      {
-      Zmin = 0;
-      }
-    else if (ijk[2] >= dims[2])
-      {
-      Zmin = dims[2] - 1;
-      }
-    else
-      {
-      Zmin = ijk[2];
-      }
-
-    double VelMax = pnode->GetVelocityMax();
-    VelMax /= VelFactor;
-    world[2] = VelMax;
-    astroDisplay->GetIJKSpace(world, ijk);
-    int Zmax;
-    if (ijk[2] < 0)
-      {
-      Zmax = 0;
-      }
-    else if (ijk[2] >= dims[2])
-      {
-      Zmax = dims[2] - 1;
-      }
-    else
-      {
-      Zmax = ijk[2];
-      }
-
-    if (Zmin > Zmax)
-      {
-      double temp = Zmin;
-      Zmin = Zmax;
-      Zmax = temp;
-      }
-
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outProfileFPixel, outProfileDPixel, maskPixel, cancel, status, Zmin, Zmax)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < dims[2]; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-              *(outProfileFPixel + elemCnt) = 0.;
-            break;
-          case VTK_DOUBLE:
-              *(outProfileDPixel + elemCnt) = 0.;
-            break;
-          }
-
-        for (int kk = 0; kk < numSlice; kk++)
-          {
-          int posData = elemCnt * numSlice + kk;
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (*(inFPixel + posData) > pnode->GetIntensityMin() &&
-                  *(inFPixel + posData) < pnode->GetIntensityMax())
-                {
-                if (FloatIsNaN(*(inFPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outProfileFPixel + elemCnt) += *(inFPixel + posData);
-                }
-              break;
-            case VTK_DOUBLE:
-              if (*(inDPixel + posData) > pnode->GetIntensityMin() &&
-                  *(inDPixel + posData) < pnode->GetIntensityMax())
-                {
-                if (DoubleIsNaN(*(inDPixel + posData)))
-                  {
-                  continue;
-                  }
-                *(outProfileDPixel + elemCnt) += *(inDPixel + posData);
-                }
-              break;
-            }
-          }
-
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-            *(outProfileFPixel + elemCnt) *= unitBeamConv;
-            if (fabs(*(outProfileFPixel + elemCnt)) < DOUBLEPRECISION)
-              {
-              *(outProfileFPixel + elemCnt) = NaN;
-              }
-            break;
-          case VTK_DOUBLE:
-            *(outProfileDPixel + elemCnt) *= unitBeamConv;
-            if (fabs(*(outProfileDPixel + elemCnt)) < DOUBLEPRECISION)
-              {
-              *(outProfileDPixel + elemCnt) = NaN;
-              }
-            break;
-          }
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(elemCnt / (numSlice / (numProcs * 100.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(elemCnt / (numSlice / 100.) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
+    vtkSlicerAstroFloatingTemplateMacro(
+      cancel = !SumPlanes(static_cast<VTK_TT*>(inPtr), maskPtr,
+                          static_cast<VTK_TT*>(outProfilePtr), dims[2], numSlice,
+                          IntensityMin, IntensityMax, unitBeamConv, pnode));
     }
 
   gettimeofday(&end, nullptr);
@@ -567,30 +396,14 @@ bool vtkSlicerAstroProfilesLogic::CalculateProfile(vtkMRMLAstroProfilesParameter
 
   vtkDebugMacro("Profile Kernel Time : "<<mtime<<" ms.");
 
-  inFPixel = nullptr;
-  inDPixel = nullptr;
-
-  delete inFPixel;
-  delete inDPixel;
-
-  outProfileFPixel = nullptr;
-  outProfileDPixel = nullptr;
-
-  delete outProfileFPixel;
-  delete outProfileDPixel;
-
-  if (pnode->GetMaskActive())
-    {
-    maskPixel = nullptr;
-    delete maskPixel;
-    }
-
   if (cancel)
     {
     pnode->SetStatus(100);
     return false;
     }
 
+  ProfileVolume->GetImageData()->Modified();
+
   gettimeofday(&start, nullptr);
 
   int wasModifying = ProfileVolume->StartModify();
@@ -22,9 +22,12 @@
 
 // Slicer includes
 #include "vtkSlicerModuleLogic.h"
+class vtkMRMLAstroVolumeNode;
 class vtkMRMLVolumeNode;
 class vtkSlicerAstroVolumeLogic;
 // vtk includes
+class vtkImageData;
+class vtkIntArray;
 class vtkRenderWindow;
 // AstroSmoothings includes
 #include "vtkSlicerAstroSmoothingModuleLogicExport.h"
@@ -50,6 +53,14 @@ class vtkMRMLAstroSmoothingParametersNode;
 /// default parameters, advantages and disadvantages, we refer
 /// to 10.1016/j.ascom.2016.09.002.
 ///
+/// Blanked (NaN) voxels are handled in the same way by every filter, on
+/// CPU and GPU: they stay blanked in the output and they do not contribute
+/// to the other voxels. The box and Gaussian filters give the mean of the
+/// valid voxels under the kernel (normalized convolution), voxels outside
+/// the volume being ignored as well, and blank the voxels without valid
+/// data under the kernel. The gradient filter does not change the voxels
+/// with a blanked neighbour.
+///
 /// \ingroup SlicerAstro_QtModules_AstroSmoothing
 class VTK_SLICERASTRO_ASTROSMOOTHING_MODULE_LOGIC_EXPORT vtkSlicerAstroSmoothingLogic
   : public vtkSlicerModuleLogic
@@ -76,6 +87,35 @@ public:
   /// \return Success flag
   int Apply(vtkMRMLAstroSmoothingParametersNode *pnode, vtkRenderWindow *renderWindow);
 
+  /// Run the filter selected by the parameters, with the method of Apply
+  /// (CPU or GPU, FFT or direct convolution), only on the voxels of each
+  /// extent (one per tuple of extents: IJK min and max along each axis),
+  /// reading the halo of the kernel around it from the input volume. The
+  /// voxels of each extent are written in a preview volume as large as the
+  /// extent. This gives an interactive preview of the filter on the shown
+  /// slices (or on a ROI).
+  /// \param MRML parameter node
+  /// \param extents of the preview
+  /// \param vtkRenderWindow to init the GPU algorithm
+  /// \return Success flag
+  int Preview(vtkMRMLAstroSmoothingParametersNode *pnode, vtkIntArray *extents,
+              vtkRenderWindow *renderWindow);
+
+  /// Number of extents of the last call of Preview
+  int GetNumberOfPreviewVolumes();
+
+  /// Get the transient volume written by Preview for the index-th extent,
+  /// nullptr if the extent is outside the input volume. It covers only the
+  /// extent (its IJKToRAS and CRPIX are shifted), with the attributes and
+  /// the WCS of the input volume, and it is created again when the input
+  /// volume or the filter change. It is not saved with the scene and it is
+  /// never the output volume of Apply. DATAMIN and DATAMAX are the range
+  /// of the previewed voxels.
+  vtkMRMLAstroVolumeNode* GetPreviewVolume(int index);
+
+  /// Remove the preview volumes from the scene
+  void RemovePreviewVolumes();
+
 protected:
   vtkSlicerAstroSmoothingLogic();
   virtual ~vtkSlicerAstroSmoothingLogic();
@@ -106,6 +146,23 @@ protected:
   /// \return Success flag
   int IsotropicGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
 
+  /// Run recursive (IIR) Gaussian filter algorithm on CPU.
+  /// The cost does not depend on the kernel size and NaN voxels are
+  /// handled by normalized convolution. Requires a not rotated kernel
+  /// with sigma of at least one pixel along the smoothed axes.
+  /// \param MRML parameter node
+  /// \return Success flag
+  int RecursiveGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
+
+  /// Run Gaussian filter algorithm on CPU as a FFT convolution with the
+  /// 3D kernel. Used by AnisotropicGaussianCPUFilter when the kernel is
+  /// large enough to make it faster than the direct convolution and its
+  /// buffers fit in the MemoryBudget of the parameters. NaN voxels are
+  /// handled by normalized convolution, as in the direct convolution.
+  /// \param MRML parameter node
+  /// \return Success flag
+  int FFTGaussianCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
+
   /// Run Gaussian filter algorithm on GPU
   /// \param MRML parameter node
   /// \param vtkRenderWindow to init the GPU algorithm
@@ -123,6 +180,42 @@ protected:
   /// \return Success flag
   int GradientGPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode, vtkRenderWindow* renderWindow);
 
+  /// Run the CPU filter selected by the parameters out of core: the FITS
+  /// file of the input volume is read in slabs of spectral planes, with the
+  /// halo of the kernel, each slab is filtered and the result is written
+  /// in OutputFileName. The slabs are as thick as MemoryBudget allows and
+  /// are all filtered with the same method (FFT or direct convolution).
+  /// The noise of the gradient filter is estimated on a stratified sample
+  /// of the planes of the file, with the robust noise estimator of the
+  /// input volume (MAD for the slab estimator).
+  /// \param MRML parameter node
+  /// \return Success flag
+  int OutOfCoreCPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode);
+
+  /// Get the preview volume of the index-th extent, creating it if not
+  /// available, with the image data (blank) and the geometry of extent
+  /// if it covered another extent
+  /// \param MRML parameter node
+  /// \param index of the extent
+  /// \param extent of the preview, within the input volume
+  /// \return preview volume
+  vtkMRMLAstroVolumeNode* UpdatePreviewVolume(vtkMRMLAstroSmoothingParametersNode *pnode,
+                                              int index, const int extent[6]);
+
+  /// Run the GPU filter selected by the parameters on the voxels of extent
+  /// plus halo of inputImageData, and write the voxels of extent in
+  /// outputImageData
+  /// \param MRML parameter node
+  /// \param input image data
+  /// \param output image data, as large as extent
+  /// \param extent of the preview
+  /// \param halo of the kernel
+  /// \param vtkRenderWindow to init the GPU algorithm
+  /// \return Success flag
+  int PreviewGPUFilter(vtkMRMLAstroSmoothingParametersNode *pnode,
+                       vtkImageData *inputImageData, vtkImageData *outputImageData,
+                       const int extent[6], const int halo[3], vtkRenderWindow *renderWindow);
+
 private:
   vtkSlicerAstroSmoothingLogic(const vtkSlicerAstroSmoothingLogic&); // Not implemented
   void operator=(const vtkSlicerAstroSmoothingLogic&);           // Not implemented
@@ -40,6 +40,7 @@ int vtkMRMLAstroSmoothingParametersNodeTest1(int , char * [] )
 
   TEST_SET_GET_BOOLEAN(node1.GetPointer(), Link);
   TEST_SET_GET_BOOLEAN(node1.GetPointer(), AutoRun);
+  TEST_SET_GET_BOOLEAN(node1.GetPointer(), RecursiveGaussian);
 
   TEST_SET_GET_INT(node1.GetPointer(), Accuracy, 20);
 
@@ -56,5 +57,15 @@ int vtkMRMLAstroSmoothingParametersNodeTest1(int , char * [] )
   TEST_SET_GET_INT(node1.GetPointer(), KernelLengthY, 0);
   TEST_SET_GET_INT(node1.GetPointer(), KernelLengthZ, 0);
 
+  // scenes saved before the recursive Gaussian read it as off
+  vtkNew< vtkMRMLAstroSmoothingParametersNode > node2;
+  const char *atts[] = {"id", "vtkMRMLAstroSmoothingParametersNode1", "Filter", "1", nullptr};
+  node2->ReadXMLAttributes(atts);
+  if (node2->GetRecursiveGaussian())
+    {
+    std::cerr << "RecursiveGaussian is on in a scene without it" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,151 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Mean of the voxels of the box inside the cube and not NaN, NaN if the
+// voxel is NaN or the box has no such voxels.
+double BoxMean(const float *pixels, const int dims[3], const int radius[3],
+               int x, int y, int z)
+{
+  if (vtkMath::IsNan(pixels[x + dims[0] * (y + dims[1] * z)]))
+    {
+    return vtkMath::Nan();
+    }
+  double sum = 0.;
+  int count = 0;
+  for (int k = std::max(z - radius[2], 0); k <= std::min(z + radius[2], dims[2] - 1); k++)
+    {
+    for (int j = std::max(y - radius[1], 0); j <= std::min(y + radius[1], dims[1] - 1); j++)
+      {
+      for (int i = std::max(x - radius[0], 0); i <= std::min(x + radius[0], dims[0] - 1); i++)
+        {
+        const float value = pixels[i + dims[0] * (j + dims[1] * k)];
+        if (!vtkMath::IsNan(value))
+          {
+          sum += value;
+          count++;
+          }
+        }
+      }
+    }
+  return count > 0 ? sum / count : vtkMath::Nan();
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The box filter averages the valid voxels of each box: the NaN voxels and
+// the ones outside the cube are not counted, and the NaN voxels stay blanked.
+int vtkSlicerAstroSmoothingLogicBoxTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {17, 11, 13};
+  const int radius[3] = {2, 1, 3};
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims);
+  float *inPixels = static_cast<float*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = elemCnt % 11 == 0 ? vtkMath::Nan() : static_cast<float>((elemCnt * 37) % 23);
+    }
+  // a blanked region larger than the box, with voxels that have no valid
+  // neighbours
+  for (int k = 0; k < 8; k++)
+    {
+    for (int j = 0; j < 4; j++)
+      {
+      for (int i = 0; i < 6; i++)
+        {
+        inPixels[i + dims[0] * (j + dims[1] * k)] = vtkMath::Nan();
+        }
+      }
+    }
+
+  vtkMRMLAstroVolumeNode *outputVolume = AddVolume(scene.GetPointer(), dims);
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetOutputVolumeNodeID(outputVolume->GetID());
+  pnode->SetFilter(0);
+  pnode->SetHardware(0);
+  pnode->SetParameterX(2 * radius[0] + 1);
+  pnode->SetParameterY(2 * radius[1] + 1);
+  pnode->SetParameterZ(2 * radius[2] + 1);
+
+  vtkNew<vtkRenderWindow> renderWindow;
+  if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+    {
+    std::cerr << "The box filter failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const float *outPixels = static_cast<float*>(outputVolume->GetImageData()->GetScalarPointer());
+  for (int k = 0; k < dims[2]; k++)
+    {
+    for (int j = 0; j < dims[1]; j++)
+      {
+      for (int i = 0; i < dims[0]; i++)
+        {
+        const double expected = BoxMean(inPixels, dims, radius, i, j, k);
+        const float value = outPixels[i + dims[0] * (j + dims[1] * k)];
+        if (vtkMath::IsNan(expected) != vtkMath::IsNan(value) ||
+            (!vtkMath::IsNan(expected) && fabs(value - expected) > 1.E-4))
+          {
+          std::cerr << "Wrong box mean at (" << i << ", " << j << ", " << k
+                    << "): expected " << expected << ", got " << value << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
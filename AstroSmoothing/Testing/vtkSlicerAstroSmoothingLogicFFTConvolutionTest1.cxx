@@ -0,0 +1,159 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Gives access to the FFT convolution, which Apply selects only for large
+// kernels.
+class vtkSlicerAstroSmoothingLogicFFTTester : public vtkSlicerAstroSmoothingLogic
+{
+public:
+  static vtkSlicerAstroSmoothingLogicFFTTester *New();
+  vtkTypeMacro(vtkSlicerAstroSmoothingLogicFFTTester, vtkSlicerAstroSmoothingLogic);
+
+  using vtkSlicerAstroSmoothingLogic::FFTGaussianCPUFilter;
+};
+vtkStandardNewMacro(vtkSlicerAstroSmoothingLogicFFTTester);
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The FFT and the direct convolution of the CPU Gaussian filter give the
+// same output, also at the borders of the cube and around NaN voxels
+// (normalized convolution, blanking the NaN voxels and the voxels without
+// valid data under the kernel). A memory budget too small for the FFT buffers selects the
+// direct convolution.
+int vtkSlicerAstroSmoothingLogicFFTConvolutionTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {23, 19, 17};
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogicFFTTester> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims, VTK_DOUBLE);
+  double *inPixels = static_cast<double*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(0., 1.);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = elemCnt % 13 == 0 ? vtkMath::Nan() : gaussian(generator);
+    }
+  // a blanked corner larger than the kernel
+  for (int k = 0; k < 8; k++)
+    {
+    for (int j = 0; j < 8; j++)
+      {
+      for (int i = 0; i < 9; i++)
+        {
+        inPixels[i + dims[0] * (j + dims[1] * k)] = vtkMath::Nan();
+        }
+      }
+    }
+
+  vtkMRMLAstroVolumeNode *fftVolume = AddVolume(scene.GetPointer(), dims, VTK_DOUBLE);
+  vtkMRMLAstroVolumeNode *directVolume = AddVolume(scene.GetPointer(), dims, VTK_DOUBLE);
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetFilter(1);
+  pnode->SetHardware(0);
+  pnode->SetAccuracy(5);
+  pnode->SetParameterX(3.5);
+  pnode->SetParameterY(4.7);
+  pnode->SetParameterZ(2.8);
+  pnode->SetRz(30.);
+  pnode->SetGaussianKernels();
+
+  pnode->SetOutputVolumeNodeID(fftVolume->GetID());
+  if (!logic->FFTGaussianCPUFilter(pnode.GetPointer()))
+    {
+    std::cerr << "The FFT Gaussian filter failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkRenderWindow> renderWindow;
+  pnode->SetStatus(0);
+  pnode->SetMemoryBudget(0);
+  pnode->SetOutputVolumeNodeID(directVolume->GetID());
+  if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+    {
+    std::cerr << "The direct Gaussian filter failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double *fftPixels = static_cast<double*>(fftVolume->GetImageData()->GetScalarPointer());
+  const double *directPixels = static_cast<double*>(directVolume->GetImageData()->GetScalarPointer());
+  int numberOfBlanks = 0;
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    const bool fftBlank = vtkMath::IsNan(fftPixels[elemCnt]);
+    if (fftBlank != vtkMath::IsNan(directPixels[elemCnt]) ||
+        (!fftBlank && fabs(fftPixels[elemCnt] - directPixels[elemCnt]) > 1.E-9))
+      {
+      std::cerr << "The FFT and the direct convolution differ at voxel " << elemCnt
+                << ": " << fftPixels[elemCnt] << " and " << directPixels[elemCnt] << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (vtkMath::IsNan(inPixels[elemCnt]) && !fftBlank)
+      {
+      std::cerr << "The NaN voxel " << elemCnt << " has not been blanked" << std::endl;
+      return EXIT_FAILURE;
+      }
+    numberOfBlanks += fftBlank ? 1 : 0;
+    }
+
+  // the center of the blanked corner has no valid data under the kernel
+  if (numberOfBlanks == 0)
+    {
+    std::cerr << "No voxel without valid data has been blanked" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
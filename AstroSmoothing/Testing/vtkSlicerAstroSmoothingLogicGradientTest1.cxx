@@ -0,0 +1,129 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+//-----------------------------------------------------------------------------
+// The iterations of the CPU gradient filter, run in blocks ping-ponged
+// between the output and the temporary buffer (one core) or in a single
+// block without it (several cores), give the same output as the filter
+// applied once per iteration.
+int vtkSlicerAstroSmoothingLogicGradientTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {300, 37, 35};
+  const int numberOfIterations = 5;
+  const double noise = 1.;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims);
+  float *inPixels = static_cast<float*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(0., noise);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = elemCnt % 97 == 0 ? vtkMath::Nan() : static_cast<float>(gaussian(generator));
+    }
+  inputVolume->SetDisplayThreshold(noise);
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetFilter(2);
+  pnode->SetHardware(0);
+  pnode->SetParameterX(0.3);
+  pnode->SetParameterY(0.3);
+  pnode->SetParameterZ(0.3);
+
+  // reference: one iteration at a time, with the noise of the input
+  pnode->SetAccuracy(1);
+  vtkMRMLAstroVolumeNode *referenceVolume = inputVolume;
+  for (int iterCnt = 0; iterCnt < numberOfIterations; iterCnt++)
+    {
+    vtkMRMLAstroVolumeNode *outputVolume = AddVolume(scene.GetPointer(), dims);
+    pnode->SetStatus(0);
+    pnode->SetInputVolumeNodeID(referenceVolume->GetID());
+    pnode->SetOutputVolumeNodeID(outputVolume->GetID());
+    if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The gradient filter failed at iteration " << iterCnt << std::endl;
+      return EXIT_FAILURE;
+      }
+    outputVolume->SetDisplayThreshold(noise);
+    referenceVolume = outputVolume;
+    }
+  const float *referencePixels = static_cast<float*>(referenceVolume->GetImageData()->GetScalarPointer());
+
+  pnode->SetAccuracy(numberOfIterations);
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  const int cores[2] = {1, 0};
+  for (int coresCnt = 0; coresCnt < 2; coresCnt++)
+    {
+    vtkMRMLAstroVolumeNode *outputVolume = AddVolume(scene.GetPointer(), dims);
+    pnode->SetStatus(0);
+    pnode->SetCores(cores[coresCnt]);
+    pnode->SetOutputVolumeNodeID(outputVolume->GetID());
+    if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The gradient filter failed with " << cores[coresCnt] << " cores" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    const float *outPixels = static_cast<float*>(outputVolume->GetImageData()->GetScalarPointer());
+    for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+      {
+      const bool blank = vtkMath::IsNan(referencePixels[elemCnt]);
+      if (blank != vtkMath::IsNan(outPixels[elemCnt]) ||
+          (!blank && outPixels[elemCnt] != referencePixels[elemCnt]))
+        {
+        std::cerr << "The iterations in blocks differ with " << cores[coresCnt]
+                  << " cores at voxel " << elemCnt << ": " << outPixels[elemCnt]
+                  << " and " << referencePixels[elemCnt] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,223 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// vtkFits includes
+#include <vtkFITSReader.h>
+#include <vtkFITSWriter.h>
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool WriteCube(const std::string& fileName, const float *pixels, const int dims[3])
+{
+  vtkNew<vtkFITSWriter> writer;
+  writer->SetFileName(fileName.c_str());
+  writer->SetAttribute("SlicerAstro.NAXIS", "3");
+  writer->SetAttribute("SlicerAstro.NAXIS1", std::to_string(dims[0]));
+  writer->SetAttribute("SlicerAstro.NAXIS2", std::to_string(dims[1]));
+  writer->SetAttribute("SlicerAstro.NAXIS3", std::to_string(dims[2]));
+  writer->SetAttribute("SlicerAstro.BITPIX", "-32");
+  return writer->BeginSlabWrite(VTK_FLOAT) &&
+         writer->WriteSlab(pixels, 0, dims[2]) &&
+         writer->EndSlabWrite();
+}
+
+//-----------------------------------------------------------------------------
+bool CheckOutput(const char *name, const std::string& fileName,
+                 vtkMRMLAstroVolumeNode *referenceVolume, const int dims[3])
+{
+  vtkNew<vtkFITSReader> reader;
+  reader->SetFileName(fileName.c_str());
+  reader->Update();
+  vtkImageData *imageData = reader->GetOutput();
+  int *outDims = imageData->GetDimensions();
+  if (outDims[0] != dims[0] || outDims[1] != dims[1] || outDims[2] != dims[2] ||
+      imageData->GetScalarType() != VTK_FLOAT)
+    {
+    std::cerr << "The " << name << " output file has a wrong size or type" << std::endl;
+    return false;
+    }
+
+  const float *outPixels = static_cast<float*>(imageData->GetScalarPointer());
+  const float *referencePixels =
+    static_cast<float*>(referenceVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    const bool blank = vtkMath::IsNan(referencePixels[elemCnt]);
+    if (blank != vtkMath::IsNan(outPixels[elemCnt]) ||
+        (!blank && fabs(outPixels[elemCnt] - referencePixels[elemCnt]) >
+                     1.E-4 * (1. + fabs(referencePixels[elemCnt]))))
+      {
+      std::cerr << "The " << name << " filter out of core differs at voxel "
+                << elemCnt << ": " << outPixels[elemCnt] << " and "
+                << referencePixels[elemCnt] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The box, Gaussian and gradient filters run out of core on a FITS file,
+// with a memory budget which splits the cube in several slabs, give the
+// same output as the filters run on the cube loaded in memory.
+int vtkSlicerAstroSmoothingLogicOutOfCoreTest1(int argc, char * argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: vtkSlicerAstroSmoothingLogicOutOfCoreTest1 temporaryDirectory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string directory = std::string(argv[1]) + "/vtkSlicerAstroSmoothingLogicOutOfCoreTest1";
+  vtksys::SystemTools::RemoveADirectory(directory);
+  vtksys::SystemTools::MakeDirectory(directory);
+  const std::string inputFileName = directory + "/input.fits";
+  const std::string outputFileName = directory + "/output.fits";
+
+  // 1 MB of data, against a budget of 1 MB
+  const int dims[3] = {64, 64, 64};
+  const int memoryBudget = 1;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims);
+  float *inPixels = static_cast<float*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(0., 1.);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = elemCnt % 89 == 0 ? vtkMath::Nan() : static_cast<float>(gaussian(generator));
+    }
+  if (!WriteCube(inputFileName, inPixels, dims))
+    {
+    std::cerr << "Could not write " << inputFileName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLAstroVolumeStorageNode> storageNode;
+  storageNode->SetFileName(inputFileName.c_str());
+  scene->AddNode(storageNode.GetPointer());
+  inputVolume->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  // the noise of the gradient filter: the sample of the whole cube in memory
+  // and of its planes in the file are the same
+  inputVolume->SetNoiseEstimator(vtkMRMLAstroVolumeNode::MADNoiseEstimator);
+  inputVolume->SetNoiseSampleSize(numElements);
+  inputVolume->UpdateDisplayThresholdAttributes();
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetHardware(0);
+  pnode->SetCores(1);
+  pnode->SetMemoryBudget(memoryBudget);
+  pnode->SetOutputFileName(outputFileName.c_str());
+
+  const char *names[3] = {"box", "Gaussian", "gradient"};
+  for (int filterCnt = 0; filterCnt < 3; filterCnt++)
+    {
+    pnode->SetFilter(filterCnt);
+    switch (filterCnt)
+      {
+      case 0:
+        pnode->SetParameterX(5.);
+        pnode->SetParameterY(3.);
+        pnode->SetParameterZ(7.);
+        break;
+      case 1:
+        // anisotropic: the direct 3D convolution, since the FFT buffers
+        // do not fit in the budget
+        pnode->SetAccuracy(5);
+        pnode->SetParameterX(4.);
+        pnode->SetParameterY(6.);
+        pnode->SetParameterZ(3.);
+        pnode->SetRz(30.);
+        pnode->SetGaussianKernels();
+        break;
+      case 2:
+        pnode->SetAccuracy(3);
+        pnode->SetParameterX(0.3);
+        pnode->SetParameterY(0.3);
+        pnode->SetParameterZ(0.3);
+        break;
+      }
+
+    vtkMRMLAstroVolumeNode *referenceVolume = AddVolume(scene.GetPointer(), dims);
+    pnode->SetStatus(0);
+    pnode->SetOutOfCore(false);
+    pnode->SetOutputVolumeNodeID(referenceVolume->GetID());
+    if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The " << names[filterCnt] << " filter failed in memory" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    pnode->SetStatus(0);
+    pnode->SetOutOfCore(true);
+    if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The " << names[filterCnt] << " filter failed out of core" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if (!CheckOutput(names[filterCnt], outputFileName, referenceVolume, dims))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  vtksys::SystemTools::RemoveADirectory(directory);
+  return EXIT_SUCCESS;
+}
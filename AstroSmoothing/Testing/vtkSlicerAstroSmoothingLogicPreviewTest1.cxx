@@ -0,0 +1,309 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+#include <vtkSlicerAstroVolumeLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// The preview volume covers extent of the input volume (dimensions, origin
+// and reference pixels), its voxels are the ones of extent of the reference
+// volume and the range attributes are the ones of the previewed voxels.
+bool CheckPreview(const char *name, vtkMRMLAstroVolumeNode *previewVolume,
+                  vtkMRMLAstroVolumeNode *inputVolume, vtkMRMLAstroVolumeNode *referenceVolume,
+                  const int extent[6])
+{
+  int *dims = referenceVolume->GetImageData()->GetDimensions();
+  int *previewDims = previewVolume->GetImageData()->GetDimensions();
+  vtkNew<vtkMatrix4x4> IJKToRASMatrix;
+  inputVolume->GetIJKToRASMatrix(IJKToRASMatrix.GetPointer());
+  const double originIJK[4] = {static_cast<double>(extent[0]), static_cast<double>(extent[2]),
+                               static_cast<double>(extent[4]), 1.};
+  double originRAS[4];
+  IJKToRASMatrix->MultiplyPoint(originIJK, originRAS);
+  for (int axis = 0; axis < 3; axis++)
+    {
+    std::string crpix = "SlicerAstro.CRPIX" + std::to_string(axis + 1);
+    if (previewDims[axis] != extent[2 * axis + 1] - extent[2 * axis] + 1 ||
+        fabs(previewVolume->GetOrigin()[axis] - originRAS[axis]) > 1.E-6 ||
+        fabs(atof(previewVolume->GetAttribute(crpix.c_str())) -
+             atof(inputVolume->GetAttribute(crpix.c_str())) + extent[2 * axis]) > 1.E-6)
+      {
+      std::cerr << "The " << name << " preview volume does not cover its extent" << std::endl;
+      return false;
+      }
+    }
+
+  const float *previewPixels =
+    static_cast<float*>(previewVolume->GetImageData()->GetScalarPointer());
+  const float *referencePixels =
+    static_cast<float*>(referenceVolume->GetImageData()->GetScalarPointer());
+  double range[2] = {std::numeric_limits<double>::max(), -std::numeric_limits<double>::max()};
+  vtkIdType previewCnt = 0;
+  for (int k = extent[4]; k <= extent[5]; k++)
+    {
+    for (int j = extent[2]; j <= extent[3]; j++)
+      {
+      for (int i = extent[0]; i <= extent[1]; i++, previewCnt++)
+        {
+        const vtkIdType elemCnt = i + dims[0] * (j + static_cast<vtkIdType>(dims[1]) * k);
+        const bool blank = vtkMath::IsNan(referencePixels[elemCnt]);
+        if (blank != vtkMath::IsNan(previewPixels[previewCnt]) ||
+            (!blank && fabs(previewPixels[previewCnt] - referencePixels[elemCnt]) >
+                         1.E-4 * (1. + fabs(referencePixels[elemCnt]))))
+          {
+          std::cerr << "The " << name << " preview differs from the whole volume filter at voxel "
+                    << i << " " << j << " " << k << ": " << previewPixels[previewCnt]
+                    << " and " << referencePixels[elemCnt] << std::endl;
+          return false;
+          }
+        if (!blank)
+          {
+          range[0] = std::min(range[0], static_cast<double>(referencePixels[elemCnt]));
+          range[1] = std::max(range[1], static_cast<double>(referencePixels[elemCnt]));
+          }
+        }
+      }
+    }
+
+  const double dataMin = atof(previewVolume->GetAttribute("SlicerAstro.DATAMIN"));
+  const double dataMax = atof(previewVolume->GetAttribute("SlicerAstro.DATAMAX"));
+  if (fabs(dataMin - range[0]) > 1.E-4 * (1. + fabs(range[0])) ||
+      fabs(dataMax - range[1]) > 1.E-4 * (1. + fabs(range[1])))
+    {
+    std::cerr << "Wrong " << name << " preview range attributes: " << dataMin << " "
+              << dataMax << ", expected " << range[0] << " " << range[1] << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool IsTransientVolume(vtkMRMLScene *scene, vtkMRMLAstroVolumeNode *previewVolume,
+                       vtkMRMLAstroVolumeNode *inputVolume, vtkMRMLAstroVolumeNode *outputVolume)
+{
+  return previewVolume && previewVolume != inputVolume && previewVolume != outputVolume &&
+         scene->IsNodePresent(previewVolume) && !previewVolume->GetSaveWithScene();
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The preview of the box, Gaussian and gradient filters on a set of
+// extents (planes, borders of the volume, partly or fully outside it)
+// gives the same voxels of the filters run on the whole volume, in one
+// transient volume as large as each extent, which is reused by the next
+// previews, is created again for a new filter and never modifies the
+// output volume.
+int vtkSlicerAstroSmoothingLogicPreviewTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {61, 47, 33};
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNodeClass;
+  scene->RegisterNodeClass(volumeNodeClass.GetPointer());
+  vtkNew<vtkSlicerAstroVolumeLogic> astroVolumeLogic;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+  logic->SetAstroVolumeLogic(astroVolumeLogic.GetPointer());
+  vtkNew<vtkRenderWindow> renderWindow;
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims);
+  float *inPixels = static_cast<float*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(0., 1.);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = elemCnt % 101 == 0 ? vtkMath::Nan() : static_cast<float>(gaussian(generator));
+    }
+  inputVolume->SetDisplayThreshold(1.);
+  inputVolume->SetOrigin(-30., -23., -16.);
+  inputVolume->SetSpacing(1., 2., 3.);
+  inputVolume->SetAttribute("SlicerAstro.CRPIX1", "31.");
+  inputVolume->SetAttribute("SlicerAstro.CRPIX2", "24.");
+  inputVolume->SetAttribute("SlicerAstro.CRPIX3", "17.");
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetHardware(0);
+
+  // a slice along each axis, an extent partly outside the volume
+  // and one fully outside it
+  vtkNew<vtkIntArray> extents;
+  extents->SetNumberOfComponents(6);
+  const int planeJ[6] = {10, 30, 5, 5, 0, 32};
+  const int planeK[6] = {0, 60, 0, 46, 16, 16};
+  const int corner[6] = {-5, 8, 40, 60, 25, 40};
+  const int outside[6] = {70, 80, 0, 5, 0, 5};
+  extents->InsertNextTypedTuple(planeJ);
+  extents->InsertNextTypedTuple(planeK);
+  extents->InsertNextTypedTuple(corner);
+  extents->InsertNextTypedTuple(outside);
+  const int clampedCorner[6] = {0, 8, 40, 46, 25, 32};
+  const int *clampedExtents[3] = {planeJ, planeK, clampedCorner};
+
+  vtkNew<vtkIntArray> nextExtents;
+  nextExtents->SetNumberOfComponents(6);
+  const int block[6] = {20, 25, 20, 25, 10, 12};
+  nextExtents->InsertNextTypedTuple(block);
+
+  // the Gaussian filter with and without the FFT convolution allowed
+  const char *names[4] = {"box", "Gaussian", "direct Gaussian", "gradient"};
+  const int filters[4] = {0, 1, 1, 2};
+  std::string previousPreviewID;
+  for (int filterCnt = 0; filterCnt < 4; filterCnt++)
+    {
+    pnode->SetFilter(filters[filterCnt]);
+    pnode->SetMemoryBudget(filterCnt == 2 ? 1 : 1024);
+    switch (filters[filterCnt])
+      {
+      case 0:
+        pnode->SetParameterX(5.);
+        pnode->SetParameterY(3.);
+        pnode->SetParameterZ(7.);
+        break;
+      case 1:
+        pnode->SetAccuracy(5);
+        pnode->SetParameterX(4.);
+        pnode->SetParameterY(6.);
+        pnode->SetParameterZ(3.);
+        pnode->SetRz(30.);
+        pnode->SetGaussianKernels();
+        break;
+      case 2:
+        pnode->SetAccuracy(3);
+        pnode->SetParameterX(0.3);
+        pnode->SetParameterY(0.3);
+        pnode->SetParameterZ(0.3);
+        break;
+      }
+
+    vtkMRMLAstroVolumeNode *outputVolume = AddVolume(scene.GetPointer(), dims);
+    pnode->SetStatus(0);
+    pnode->SetOutputVolumeNodeID(outputVolume->GetID());
+    if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The " << names[filterCnt] << " filter failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+    const float *outPixels = static_cast<float*>(outputVolume->GetImageData()->GetScalarPointer());
+    std::vector<float> outputCopy(outPixels, outPixels + numElements);
+
+    pnode->SetStatus(0);
+    if (!logic->Preview(pnode.GetPointer(), extents.GetPointer(), renderWindow.GetPointer()))
+      {
+      std::cerr << "The " << names[filterCnt] << " preview failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if (logic->GetNumberOfPreviewVolumes() != 4 || logic->GetPreviewVolume(3))
+      {
+      std::cerr << "The " << names[filterCnt] << " preview volumes do not match the extents" << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::vector<std::string> previewIDs;
+    for (int extentCnt = 0; extentCnt < 3; extentCnt++)
+      {
+      vtkMRMLAstroVolumeNode *previewVolume = logic->GetPreviewVolume(extentCnt);
+      if (!IsTransientVolume(scene.GetPointer(), previewVolume, inputVolume, outputVolume))
+        {
+        std::cerr << "The " << names[filterCnt] << " preview volume is not a transient volume" << std::endl;
+        return EXIT_FAILURE;
+        }
+      if (!CheckPreview(names[filterCnt], previewVolume, inputVolume, outputVolume,
+                        clampedExtents[extentCnt]))
+        {
+        return EXIT_FAILURE;
+        }
+      previewIDs.push_back(previewVolume->GetID());
+      }
+
+    // a new filter does not reuse the previews of the previous one
+    if (filterCnt > 0 && filters[filterCnt] != filters[filterCnt - 1] &&
+        (previousPreviewID == previewIDs[0] ||
+         scene->GetNodeByID(previousPreviewID.c_str())))
+      {
+      std::cerr << "The preview volume of the previous filter is still in the scene" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // the first preview volume is resized to the new extent,
+    // the ones of the extents not previewed are removed
+    vtkMRMLAstroVolumeNode *previewVolume = logic->GetPreviewVolume(0);
+    if (!logic->Preview(pnode.GetPointer(), nextExtents.GetPointer(), renderWindow.GetPointer()) ||
+        logic->GetNumberOfPreviewVolumes() != 1 || logic->GetPreviewVolume(0) != previewVolume ||
+        scene->GetNodeByID(previewIDs[1].c_str()) || scene->GetNodeByID(previewIDs[2].c_str()) ||
+        !CheckPreview(names[filterCnt], previewVolume, inputVolume, outputVolume, block))
+      {
+      std::cerr << "The second " << names[filterCnt] << " preview failed" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+      {
+      if (outPixels[elemCnt] != outputCopy[elemCnt] &&
+          !(vtkMath::IsNan(outPixels[elemCnt]) && vtkMath::IsNan(outputCopy[elemCnt])))
+        {
+        std::cerr << "The " << names[filterCnt] << " preview modified the output volume" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    previousPreviewID = previewVolume->GetID();
+    }
+
+  logic->RemovePreviewVolumes();
+  if (logic->GetNumberOfPreviewVolumes() || scene->GetNodeByID(previousPreviewID.c_str()))
+    {
+    std::cerr << "The preview volume has not been removed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroSmoothingParametersNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroSmoothingLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkRenderWindow.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// AstroSmoothing testing includes
+#include "vtkSlicerAstroSmoothingTestingUtilities.h"
+
+using namespace vtkSlicerAstroSmoothingTestingUtilities;
+
+//-----------------------------------------------------------------------------
+// The recursive Gaussian approximates the direct convolution with the
+// explicit kernel within 1% of the peak of the smoothed cube, away from
+// the borders (where the recursive filter normalizes by the valid voxels).
+int vtkSlicerAstroSmoothingLogicRecursiveGaussianTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {40, 40, 40};
+  const double fwhm = 5.;
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerAstroSmoothingLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLAstroVolumeNode *inputVolume = AddVolume(scene.GetPointer(), dims);
+  float *inPixels = static_cast<float*>(inputVolume->GetImageData()->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(0., 1.);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    inPixels[elemCnt] = static_cast<float>(gaussian(generator));
+    }
+  // a point source on the noise
+  inPixels[dims[0] / 2 + dims[0] * (dims[1] / 2 + dims[1] * (dims[2] / 2))] += 100.f;
+
+  vtkMRMLAstroVolumeNode *directVolume = AddVolume(scene.GetPointer(), dims);
+  vtkMRMLAstroVolumeNode *recursiveVolume = AddVolume(scene.GetPointer(), dims);
+
+  vtkNew<vtkMRMLAstroSmoothingParametersNode> pnode;
+  scene->AddNode(pnode.GetPointer());
+  pnode->SetInputVolumeNodeID(inputVolume->GetID());
+  pnode->SetFilter(1);
+  pnode->SetHardware(0);
+  pnode->SetAccuracy(8);
+  pnode->SetParameterX(fwhm);
+  pnode->SetParameterY(fwhm);
+  pnode->SetParameterZ(fwhm);
+  pnode->SetGaussianKernels();
+
+  vtkNew<vtkRenderWindow> renderWindow;
+  pnode->SetRecursiveGaussian(false);
+  pnode->SetOutputVolumeNodeID(directVolume->GetID());
+  if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+    {
+    std::cerr << "The direct Gaussian filter failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  pnode->SetStatus(0);
+  pnode->SetRecursiveGaussian(true);
+  pnode->SetOutputVolumeNodeID(recursiveVolume->GetID());
+  if (!logic->Apply(pnode.GetPointer(), renderWindow.GetPointer()))
+    {
+    std::cerr << "The recursive Gaussian filter failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const float *directPixels = static_cast<float*>(directVolume->GetImageData()->GetScalarPointer());
+  const float *recursivePixels = static_cast<float*>(recursiveVolume->GetImageData()->GetScalarPointer());
+  const int margin = (pnode->GetKernelLengthX() + 1) / 2;
+  double peak = 0., maximumDifference = 0.;
+  for (int k = margin; k < dims[2] - margin; k++)
+    {
+    for (int j = margin; j < dims[1] - margin; j++)
+      {
+      for (int i = margin; i < dims[0] - margin; i++)
+        {
+        const vtkIdType pos = i + dims[0] * (j + static_cast<vtkIdType>(dims[1]) * k);
+        peak = std::max(peak, fabs(directPixels[pos]));
+        maximumDifference = std::max(maximumDifference,
+          static_cast<double>(fabs(recursivePixels[pos] - directPixels[pos])));
+        }
+      }
+    }
+
+  if (peak <= 0. || maximumDifference > 0.01 * peak)
+    {
+    std::cerr << "The recursive Gaussian deviates from the direct convolution by "
+              << maximumDifference << " (peak " << peak << ")" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkSlicerAstroSmoothingTestingUtilities_h
+#define __vtkSlicerAstroSmoothingTestingUtilities_h
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+/// Helpers shared by the tests of the AstroSmoothing logic
+namespace vtkSlicerAstroSmoothingTestingUtilities
+{
+
+//-----------------------------------------------------------------------------
+/// Add to the scene an astro volume with a 3D cube of the given
+/// dimensions and scalar type (voxels not initialized).
+inline vtkMRMLAstroVolumeNode* AddVolume(vtkMRMLScene *scene, const int dims[3],
+                                         int scalarType = VTK_FLOAT)
+{
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->AllocateScalars(scalarType, 1);
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(volumeNode.GetPointer());
+  return volumeNode.GetPointer();
+}
+
+}// end namespace vtkSlicerAstroSmoothingTestingUtilities
+
+#endif
@@ -19,6 +19,7 @@
 
 // Qt includes
 #include <QDebug>
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QTimer>
 
@@ -31,6 +32,7 @@
 #include <vtkCamera.h>
 #include <vtkImageCast.h>
 #include <vtkImageData.h>
+#include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMatrixToLinearTransform.h>
 #include <vtkNew.h>
@@ -50,11 +52,13 @@
 #include "ui_qSlicerAstroSmoothingModuleWidget.h"
 
 // Logic includes
+#include <vtkSlicerApplicationLogic.h>
 #include <vtkSlicerAstroVolumeLogic.h>
 #include <vtkSlicerAstroSmoothingLogic.h>
 
 // qMRML includes
 #include <qMRMLSegmentsTableView.h>
+#include <qMRMLSliceWidget.h>
 #include <qSlicerAbstractCoreModule.h>
 #include <qSlicerApplication.h>
 #include <qSlicerAstroVolumeModuleWidget.h>
@@ -79,6 +83,8 @@
 #include <vtkMRMLSelectionNode.h>
 #include <vtkMRMLSegmentationNode.h>
 #include <vtkMRMLSegmentEditorNode.h>
+#include <vtkMRMLSliceCompositeNode.h>
+#include <vtkMRMLSliceNode.h>
 #include <vtkMRMLVolumeNode.h>
 #include <vtkMRMLVolumeRenderingDisplayNode.h>
 
@@ -105,6 +111,7 @@ public:
   vtkSmartPointer<vtkMRMLSelectionNode> selectionNode;
   vtkSmartPointer<vtkMRMLSegmentEditorNode> segmentEditorNode;
   vtkSmartPointer<vtkMRMLCameraNode> cameraNodeOne;
+  vtkSmartPointer<vtkMRMLAnnotationROINode> PreviewROINode;
   vtkSmartPointer<vtkParametricEllipsoid> parametricVTKEllipsoid;
   vtkSmartPointer<vtkParametricFunctionSource> parametricFunctionSource;
   vtkSmartPointer<vtkMatrix4x4> transformationMatrix;
@@ -112,6 +119,8 @@ public:
   vtkSmartPointer<vtkPolyDataMapper> mapper;
   vtkSmartPointer<vtkActor> actor;
   double DegToRad;
+  QTimer* PreviewTimer;
+  QTimer* ApplyTimer;
 
 };
 
@@ -127,6 +136,7 @@ qSlicerAstroSmoothingModuleWidgetPrivate::qSlicerAstroSmoothingModuleWidgetPriva
   this->selectionNode = nullptr;
   this->cameraNodeOne = nullptr;
   this->segmentEditorNode = nullptr;
+  this->PreviewROINode = nullptr;
   this->parametricVTKEllipsoid = vtkSmartPointer<vtkParametricEllipsoid>::New();
   this->parametricFunctionSource = vtkSmartPointer<vtkParametricFunctionSource>::New();
   this->transformationMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -135,6 +145,8 @@ qSlicerAstroSmoothingModuleWidgetPrivate::qSlicerAstroSmoothingModuleWidgetPriva
   this->mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
   this->actor = vtkSmartPointer<vtkActor>::New();
   this->DegToRad = atan(1.) / 45.;
+  this->PreviewTimer = nullptr;
+  this->ApplyTimer = nullptr;
 }
 
 //-----------------------------------------------------------------------------
@@ -176,6 +188,9 @@ void qSlicerAstroSmoothingModuleWidgetPrivate::init()
   QObject::connect(q, SIGNAL(mrmlSceneChanged(vtkMRMLScene*)),
                    this->OutputVolumeNodeSelector, SLOT(setMRMLScene(vtkMRMLScene*)));
 
+  QObject::connect(q, SIGNAL(mrmlSceneChanged(vtkMRMLScene*)),
+                   this->PreviewROINodeComboBox, SLOT(setMRMLScene(vtkMRMLScene*)));
+
   QObject::connect(this->InputVolumeNodeSelector, SIGNAL(currentNodeChanged(bool)),
                    this->FilterCollapsibleButton, SLOT(setEnabled(bool)));
 
@@ -185,6 +200,9 @@ void qSlicerAstroSmoothingModuleWidgetPrivate::init()
   QObject::connect(this->InputVolumeNodeSelector, SIGNAL(currentNodeChanged(bool)),
                    this->AutoRunCheckBox, SLOT(setEnabled(bool)));
 
+  QObject::connect(this->InputVolumeNodeSelector, SIGNAL(currentNodeChanged(bool)),
+                   this->PreviewCheckBox, SLOT(setEnabled(bool)));
+
   QObject::connect(this->ParametersNodeComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
                    q, SLOT(setMRMLAstroSmoothingParametersNode(vtkMRMLNode*)));
 
@@ -251,6 +269,45 @@ void qSlicerAstroSmoothingModuleWidgetPrivate::init()
   QObject::connect(this->AutoRunCheckBox, SIGNAL(toggled(bool)),
                    q, SLOT(onAutoRunChanged(bool)));
 
+  QObject::connect(this->PreviewCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(onPreviewChanged(bool)));
+
+  QObject::connect(this->PreviewROINodeComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
+                   q, SLOT(onPreviewROIChanged(vtkMRMLNode*)));
+
+  QObject::connect(this->PreviewROINodeComboBox, SIGNAL(nodeAddedByUser(vtkMRMLNode*)),
+                   q, SLOT(onPreviewROIAdded(vtkMRMLNode*)));
+
+  QObject::connect(this->RecursiveGaussianCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(onRecursiveGaussianChanged(bool)));
+
+  QObject::connect(this->OutOfCoreCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(onOutOfCoreChanged(bool)));
+
+  QObject::connect(this->MemoryBudgetSpinBox, SIGNAL(valueChanged(int)),
+                   q, SLOT(onMemoryBudgetChanged(int)));
+
+  QObject::connect(this->OutputFileLineEdit, SIGNAL(editingFinished()),
+                   q, SLOT(onOutputFileNameChanged()));
+
+  QObject::connect(this->OutputFileButton, SIGNAL(clicked()),
+                   q, SLOT(onOutputFileBrowse()));
+
+  // the preview is updated once per event loop, whatever the number of
+  // parameter changes, and the whole volume is filtered (AutoRun)
+  // once the parameters are not changed for ApplyTimer interval
+  this->PreviewTimer = new QTimer(q);
+  this->PreviewTimer->setSingleShot(true);
+  this->PreviewTimer->setInterval(0);
+  QObject::connect(this->PreviewTimer, SIGNAL(timeout()),
+                   q, SLOT(onPreview()));
+
+  this->ApplyTimer = new QTimer(q);
+  this->ApplyTimer->setSingleShot(true);
+  this->ApplyTimer->setInterval(500);
+  QObject::connect(this->ApplyTimer, SIGNAL(timeout()),
+                   q, SLOT(onParametersSettled()));
+
   QObject::connect(q, SIGNAL(mrmlSceneChanged(vtkMRMLScene*)),
                    this->SegmentsTableView, SLOT(setMRMLScene(vtkMRMLScene*)));
 
@@ -261,6 +318,11 @@ void qSlicerAstroSmoothingModuleWidgetPrivate::init()
   this->CancelButton->hide();
   this->KLabel->hide();
   this->KSpinBox->hide();
+  this->RecursiveGaussianLabel->hide();
+  this->RecursiveGaussianCheckBox->hide();
+  this->OutputFileLabel->hide();
+  this->OutputFileLineEdit->hide();
+  this->OutputFileButton->hide();
   this->TimeStepLabel->hide();
   this->TimeStepSpinBox->hide();
   this->OldBeamInfoLabel->hide();
@@ -344,6 +406,8 @@ qSlicerAstroSmoothingModuleWidget::~qSlicerAstroSmoothingModuleWidget()
 //----------------------------------------------------------------------------
 void qSlicerAstroSmoothingModuleWidget::enter()
 {
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
   this->Superclass::enter();
 
   qSlicerApplication* app = qSlicerApplication::application();
@@ -358,12 +422,16 @@ void qSlicerAstroSmoothingModuleWidget::enter()
 
   app->layoutManager()->layoutLogic()->GetLayoutNode()->SetViewArrangement
           (vtkMRMLLayoutNode::SlicerLayoutDual3DView);
+
+  this->observeSliceNodes(d->parametersNode && d->parametersNode->GetPreview());
 }
 
 //----------------------------------------------------------------------------
 void qSlicerAstroSmoothingModuleWidget::exit()
 {
   this->Superclass::exit();
+
+  this->observeSliceNodes(false);
 }
 
 namespace
@@ -761,6 +829,12 @@ void qSlicerAstroSmoothingModuleWidget::onInputVolumeChanged(vtkMRMLNode *mrmlNo
     return;
     }
 
+  // the preview of the previous input volume is out of date
+  if (d->logic())
+    {
+    d->logic()->RemovePreviewVolumes();
+    }
+
   if (mrmlNode)
     {
     d->selectionNode->SetReferenceActiveVolumeID(mrmlNode->GetID());
@@ -960,6 +1034,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
     d->TimeStepSpinBox->setEnabled(false);
     d->AccuracyLabel->setEnabled(false);
     d->AccuracySpinBox->setEnabled(false);
+    d->RecursiveGaussianLabel->setEnabled(false);
+    d->RecursiveGaussianCheckBox->setEnabled(false);
     }
   else
     {
@@ -982,6 +1058,9 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
     d->TimeStepSpinBox->setEnabled(true);
     d->AccuracyLabel->setEnabled(true);
     d->AccuracySpinBox->setEnabled(true);
+    // the recursive Gaussian runs only on CPU
+    d->RecursiveGaussianLabel->setEnabled(!d->parametersNode->GetHardware());
+    d->RecursiveGaussianCheckBox->setEnabled(!d->parametersNode->GetHardware());
     }
 
   if (!(strcmp(d->parametersNode->GetMasksCommand(), "Generate")))
@@ -997,7 +1076,26 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
   d->HardwareComboBox->setCurrentIndex(d->parametersNode->GetHardware());
 
   d->AutoRunCheckBox->setChecked(d->parametersNode->GetAutoRun());
+  d->PreviewCheckBox->setChecked(d->parametersNode->GetPreview());
+  d->PreviewROINodeComboBox->setCurrentNode(d->parametersNode->GetPreviewROINode());
   d->LinkCheckBox->setChecked(d->parametersNode->GetLink());
+  d->RecursiveGaussianCheckBox->setChecked(d->parametersNode->GetRecursiveGaussian());
+
+  // out of core: the result is written in the output file, not in the output volume
+  const bool outOfCore = d->parametersNode->GetOutOfCore();
+  d->OutOfCoreCheckBox->setChecked(outOfCore);
+  d->MemoryBudgetSpinBox->setValue(d->parametersNode->GetMemoryBudget());
+  const char *outputFileName = d->parametersNode->GetOutputFileName();
+  const QString outputFile = outputFileName ? QString(outputFileName) : QString();
+  if (d->OutputFileLineEdit->text() != outputFile)
+    {
+    d->OutputFileLineEdit->setText(outputFile);
+    }
+  d->OutputFileLabel->setVisible(outOfCore);
+  d->OutputFileLineEdit->setVisible(outOfCore);
+  d->OutputFileButton->setVisible(outOfCore);
+  d->OutputLabel->setEnabled(!outOfCore);
+  d->OutputVolumeNodeSelector->setEnabled(!outOfCore);
 
   if(status == 0)
     {  
@@ -1018,6 +1116,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->KSpinBox->hide();
         d->TimeStepLabel->hide();
         d->TimeStepSpinBox->hide();
+        d->RecursiveGaussianLabel->hide();
+        d->RecursiveGaussianCheckBox->hide();
         d->GaussianKernelView->hide();
         d->RxLabel->hide();
         d->RxSpinBox->hide();
@@ -1118,6 +1218,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->KSpinBox->hide();
         d->TimeStepLabel->hide();
         d->TimeStepSpinBox->hide();
+        d->RecursiveGaussianLabel->show();
+        d->RecursiveGaussianCheckBox->show();
         d->LinkCheckBox->setToolTip("Click to link/unlink the parameters"
                                     " FWHM<sub>X</sub>, FWHM<sub>Y</sub> and FWHM<sub>Z</sub>.");
         d->CDELT1Label->show();
@@ -1352,6 +1454,8 @@ void qSlicerAstroSmoothingModuleWidget::onMRMLAstroSmoothingParametersNodeModifi
         d->AccuracyValueLabel->hide();
         d->HardwareLabel->show();
         d->HardwareComboBox->show();
+        d->RecursiveGaussianLabel->hide();
+        d->RecursiveGaussianCheckBox->hide();
         d->GaussianKernelView->hide();
         d->RxLabel->hide();
         d->RxSpinBox->hide();
@@ -1633,6 +1737,8 @@ void qSlicerAstroSmoothingModuleWidget::onCurrentFilterChanged(int index)
   d->parametersNode->SetFilter(index);
 
   d->parametersNode->EndModify(wasModifying);
+
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1651,10 +1757,7 @@ void qSlicerAstroSmoothingModuleWidget::onKChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-  }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1713,10 +1816,7 @@ void qSlicerAstroSmoothingModuleWidget::onTimeStepChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1735,10 +1835,7 @@ void qSlicerAstroSmoothingModuleWidget::onRxChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1757,10 +1854,7 @@ void qSlicerAstroSmoothingModuleWidget::onRyChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1779,10 +1873,7 @@ void qSlicerAstroSmoothingModuleWidget::onRzChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1815,10 +1906,7 @@ void qSlicerAstroSmoothingModuleWidget::onParameterXChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1851,10 +1939,7 @@ void qSlicerAstroSmoothingModuleWidget::onParameterYChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1887,11 +1972,7 @@ void qSlicerAstroSmoothingModuleWidget::onParameterZChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
-
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1911,10 +1992,7 @@ void qSlicerAstroSmoothingModuleWidget::onAccuracyChanged(double value)
     }
   d->parametersNode->EndModify(wasModifying);
 
-  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
-    {
-    this->onApply();
-    }
+  this->updateOutput();
 }
 
 //-----------------------------------------------------------------------------
@@ -1971,6 +2049,82 @@ void qSlicerAstroSmoothingModuleWidget::onApply()
     return;
     }
 
+  // out of core: the filtered cube is written in OutputFileName
+  // and no output volume is created
+  if (d->parametersNode->GetOutOfCore())
+    {
+    const char *outputFileName = d->parametersNode->GetOutputFileName();
+    if (!outputFileName || !strcmp(outputFileName, ""))
+      {
+      QString message = QString("Select the output file of the out of core filtering.");
+      qCritical() << Q_FUNC_INFO << ": " << message;
+      QMessageBox::warning(nullptr, tr("Failed to run the filter"), message);
+      d->parametersNode->SetStatus(0);
+      return;
+      }
+    if (!logic->Apply(d->parametersNode, d->GaussianKernelView->renderWindow()))
+      {
+      qCritical() << Q_FUNC_INFO << ": out of core filtering not completed.";
+      }
+    d->parametersNode->SetStatus(0);
+    return;
+    }
+
+  // Create output volume
+  vtkMRMLAstroVolumeNode *outputVolume = this->createOutputVolume(inputVolume);
+  if (!outputVolume)
+    {
+    d->parametersNode->SetStatus(0);
+    return;
+    }
+
+  // Necessary to guarantee that the renderWindow is initialized
+  d->GaussianKernelView->show();
+  d->GaussianKernelView->hide();
+
+  // Run calculation
+  if (logic->Apply(d->parametersNode, d->GaussianKernelView->renderWindow()))
+    {
+    // the whole filtered volume replaces the preview
+    if (logic->GetNumberOfPreviewVolumes() > 0)
+      {
+      logic->RemovePreviewVolumes();
+      this->showForegroundVolume(outputVolume);
+      }
+    if (!strcmp(d->parametersNode->GetMasksCommand(), "Generate"))
+      {
+      d->astroVolumeWidget->setComparative3DViews
+          (inputVolume->GetID(), outputVolume->GetID(), true);
+      d->OutputSegmentCollapsibleButton->setCollapsed(false);
+      }
+    else
+      {
+      d->astroVolumeWidget->setComparative3DViews
+          (inputVolume->GetID(), outputVolume->GetID(), false);
+      }
+    }
+  else
+    {
+    scene->RemoveNode(outputVolume);
+    inputVolume->SetDisplayVisibility(1);
+    }
+
+  d->parametersNode->SetStatus(0);
+}
+
+//-----------------------------------------------------------------------------
+vtkMRMLAstroVolumeNode* qSlicerAstroSmoothingModuleWidget::createOutputVolume(vtkMRMLAstroVolumeNode *inputVolume)
+{
+  Q_D(const qSlicerAstroSmoothingModuleWidget);
+
+  vtkSlicerAstroSmoothingLogic *logic = d->logic();
+  vtkMRMLScene *scene = this->mrmlScene();
+  if (!d->parametersNode || !logic || !scene || !inputVolume)
+    {
+    qCritical() << Q_FUNC_INFO << ": parametersNode, logic, scene or inputVolume not found!";
+    return nullptr;
+    }
+
   std::ostringstream outSS;
   outSS << inputVolume->GetName() << "_Filtered_";
 
@@ -1998,7 +2152,6 @@ void qSlicerAstroSmoothingModuleWidget::onApply()
   serial++;
   d->parametersNode->SetOutputSerial(serial);
 
-  // Create output volume
   vtkMRMLAstroVolumeNode *outputVolume =
     vtkMRMLAstroVolumeNode::SafeDownCast(scene->
       GetNodeByID(d->parametersNode->GetOutputVolumeNodeID()));
@@ -2056,32 +2209,7 @@ void qSlicerAstroSmoothingModuleWidget::onApply()
   outputVolume->SetRASToIJKMatrix(transformationMatrix.GetPointer());
   outputVolume->SetAndObserveTransformNodeID(inputVolume->GetTransformNodeID());
 
-  // Necessary to guarantee that the renderWindow is initialized
-  d->GaussianKernelView->show();
-  d->GaussianKernelView->hide();
-
-  // Run calculation
-  if (logic->Apply(d->parametersNode, d->GaussianKernelView->renderWindow()))
-    {
-    if (!strcmp(d->parametersNode->GetMasksCommand(), "Generate"))
-      {
-      d->astroVolumeWidget->setComparative3DViews
-          (inputVolume->GetID(), outputVolume->GetID(), true);
-      d->OutputSegmentCollapsibleButton->setCollapsed(false);
-      }
-    else
-      {
-      d->astroVolumeWidget->setComparative3DViews
-          (inputVolume->GetID(), outputVolume->GetID(), false);
-      }
-    }
-  else
-    {
-    scene->RemoveNode(outputVolume);
-    inputVolume->SetDisplayVisibility(1);
-    }
-
-  d->parametersNode->SetStatus(0);
+  return outputVolume;
 }
 
 //-----------------------------------------------------------------------------
@@ -2145,6 +2273,442 @@ void qSlicerAstroSmoothingModuleWidget::onAutoRunChanged(bool value)
  d->parametersNode->SetAutoRun(value);
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onPreviewChanged(bool value)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  d->parametersNode->SetPreview(value);
+  this->observeSliceNodes(value);
+  if (value)
+    {
+    d->PreviewTimer->start(0);
+    }
+  else
+    {
+    d->PreviewTimer->stop();
+    d->ApplyTimer->stop();
+    if (d->logic())
+      {
+      d->logic()->RemovePreviewVolumes();
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onRecursiveGaussianChanged(bool value)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  if (!d->parametersNode)
+    {
+    return;
+    }
+  int wasModifying = d->parametersNode->StartModify();
+  d->parametersNode->SetRecursiveGaussian(value);
+  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() > 1)
+    {
+    d->parametersNode->SetStatus(-1);
+    }
+  d->parametersNode->EndModify(wasModifying);
+
+  this->updateOutput();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onOutOfCoreChanged(bool value)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  if (!d->parametersNode)
+    {
+    return;
+    }
+  d->parametersNode->SetOutOfCore(value);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onMemoryBudgetChanged(int value)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  if (!d->parametersNode)
+    {
+    return;
+    }
+  int wasModifying = d->parametersNode->StartModify();
+  d->parametersNode->SetMemoryBudget(value);
+  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() > 1)
+    {
+    d->parametersNode->SetStatus(-1);
+    }
+  d->parametersNode->EndModify(wasModifying);
+
+  this->updateOutput();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onOutputFileNameChanged()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  if (!d->parametersNode)
+    {
+    return;
+    }
+  d->parametersNode->SetOutputFileName(d->OutputFileLineEdit->text().toUtf8().constData());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onOutputFileBrowse()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+  if (!d->parametersNode)
+    {
+    return;
+    }
+  QString fileName = QFileDialog::getSaveFileName(this, tr("Output FITS file"),
+                                                  d->OutputFileLineEdit->text(),
+                                                  tr("FITS files (*.fits *.fit *.fts)"));
+  if (fileName.isEmpty())
+    {
+    return;
+    }
+  d->OutputFileLineEdit->setText(fileName);
+  d->parametersNode->SetOutputFileName(fileName.toUtf8().constData());
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::updateOutput()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  if (!d->parametersNode)
+    {
+    return;
+    }
+
+  // while the parameters are changed only the shown slices are filtered
+  if (d->parametersNode->GetPreview() && !d->parametersNode->GetOutOfCore())
+    {
+    d->PreviewTimer->start(0);
+    if (d->parametersNode->GetAutoRun())
+      {
+      d->ApplyTimer->start();
+      }
+    return;
+    }
+
+  if (d->parametersNode->GetAutoRun() && d->parametersNode->GetStatus() == 0)
+    {
+    this->onApply();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::observeSliceNodes(bool observe)
+{
+  qSlicerApplication* app = qSlicerApplication::application();
+  if (!app || !app->layoutManager())
+    {
+    return;
+    }
+
+  foreach (QString sliceViewName, app->layoutManager()->sliceViewNames())
+    {
+    qMRMLSliceWidget* sliceWidget = app->layoutManager()->sliceWidget(sliceViewName);
+    if (!sliceWidget || !sliceWidget->mrmlSliceNode())
+      {
+      continue;
+      }
+    this->qvtkDisconnect(sliceWidget->mrmlSliceNode(), vtkCommand::ModifiedEvent,
+                         this, SLOT(onMRMLSliceNodeModified()));
+    if (observe)
+      {
+      this->qvtkConnect(sliceWidget->mrmlSliceNode(), vtkCommand::ModifiedEvent,
+                        this, SLOT(onMRMLSliceNodeModified()));
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onMRMLSliceNodeModified()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  // only a shown preview of the slices is updated: after the
+  // filtering of the whole volume the output volume is shown
+  if (d->parametersNode && d->parametersNode->GetPreview() &&
+      !d->parametersNode->GetPreviewROINode() &&
+      d->logic() && d->logic()->GetNumberOfPreviewVolumes() > 0)
+    {
+    d->PreviewTimer->start(0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onPreview()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  vtkMRMLScene *scene = this->mrmlScene();
+  if (!d->parametersNode || !d->parametersNode->GetPreview() ||
+      d->parametersNode->GetOutOfCore() || !scene)
+    {
+    return;
+    }
+
+  // wait for the end (or the cancellation) of the running filter
+  if (d->parametersNode->GetStatus() != 0)
+    {
+    d->PreviewTimer->start(50);
+    return;
+    }
+
+  vtkSlicerAstroSmoothingLogic *logic = d->logic();
+  qSlicerApplication* app = qSlicerApplication::application();
+  if (!logic || !app || !app->layoutManager())
+    {
+    qCritical() << Q_FUNC_INFO << ": logic or layoutManager not found!";
+    return;
+    }
+
+  vtkMRMLAstroVolumeNode *inputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast(scene->
+      GetNodeByID(d->parametersNode->GetInputVolumeNodeID()));
+  if (!inputVolume || !inputVolume->GetImageData() ||
+      StringToInt(inputVolume->GetAttribute("SlicerAstro.NAXIS")) != 3)
+    {
+    return;
+    }
+
+  // the voxels of the preview ROI, if any,
+  // or the ones of the shown slices are filtered
+  vtkNew<vtkIntArray> extents;
+  extents->SetNumberOfComponents(6);
+  QList<vtkMRMLSliceCompositeNode*> sliceCompositeNodes;
+
+  vtkMRMLAnnotationROINode *roiNode = d->parametersNode->GetPreviewROINode();
+  if (roiNode)
+    {
+    double bounds[6];
+    if (!logic->GetAstroVolumeLogic() ||
+        !logic->GetAstroVolumeLogic()->CalculateROICropVolumeBounds(roiNode, inputVolume, bounds))
+      {
+      qCritical() << Q_FUNC_INFO << ": preview ROI bounds not valid.";
+      return;
+      }
+    int extent[6];
+    for (int axis = 0; axis < 3; axis++)
+      {
+      extent[2 * axis] = static_cast<int>(floor(bounds[2 * axis]));
+      extent[2 * axis + 1] = static_cast<int>(ceil(bounds[2 * axis + 1]));
+      }
+    extents->InsertNextTypedTuple(extent);
+    }
+  else
+    {
+    vtkNew<vtkMatrix4x4> RASToIJKMatrix;
+    inputVolume->GetRASToIJKMatrix(RASToIJKMatrix.GetPointer());
+
+    // the voxels interpolated in the field of view of each shown slice
+    foreach (QString sliceViewName, app->layoutManager()->sliceViewNames())
+      {
+      qMRMLSliceWidget* sliceWidget = app->layoutManager()->sliceWidget(sliceViewName);
+      if (!sliceWidget || !sliceWidget->isVisible() || !sliceWidget->mrmlSliceNode())
+        {
+        continue;
+        }
+
+      vtkMRMLSliceNode *sliceNode = sliceWidget->mrmlSliceNode();
+      sliceCompositeNodes << sliceWidget->mrmlSliceCompositeNode();
+      vtkNew<vtkMatrix4x4> XYToIJKMatrix;
+      vtkMatrix4x4::Multiply4x4(RASToIJKMatrix.GetPointer(), sliceNode->GetXYToRAS(),
+                                XYToIJKMatrix.GetPointer());
+      int *viewDimensions = sliceNode->GetDimensions();
+
+      double bounds[6] = {VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX,
+                          -VTK_DOUBLE_MAX, VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX};
+      for (int corner = 0; corner < 4; corner++)
+        {
+        double XY[4] = {static_cast<double>((corner % 2) * viewDimensions[0]),
+                        static_cast<double>((corner / 2) * viewDimensions[1]), 0., 1.};
+        double IJK[4];
+        XYToIJKMatrix->MultiplyPoint(XY, IJK);
+        for (int axis = 0; axis < 3; axis++)
+          {
+          bounds[2 * axis] = std::min(bounds[2 * axis], IJK[axis]);
+          bounds[2 * axis + 1] = std::max(bounds[2 * axis + 1], IJK[axis]);
+          }
+        }
+
+      int extent[6];
+      for (int axis = 0; axis < 3; axis++)
+        {
+        extent[2 * axis] = static_cast<int>(floor(bounds[2 * axis]));
+        extent[2 * axis + 1] = static_cast<int>(ceil(bounds[2 * axis + 1]));
+        }
+      extents->InsertNextTypedTuple(extent);
+      }
+    }
+
+  if (d->parametersNode->GetHardware())
+    {
+    // Necessary to guarantee that the renderWindow is initialized
+    d->GaussianKernelView->show();
+    d->GaussianKernelView->hide();
+    }
+
+  // the preview is written in a transient volume, never in the output
+  // volume, and it is shown over the input volume in the slice views
+  if (!logic->Preview(d->parametersNode, extents.GetPointer(),
+                      d->GaussianKernelView->renderWindow()))
+    {
+    qCritical() << Q_FUNC_INFO << ": preview not completed.";
+    return;
+    }
+
+  // the preview of the ROI is shown in all the slice views,
+  // the one of each shown slice only in its view
+  if (roiNode)
+    {
+    vtkMRMLAstroVolumeNode *previewVolume = logic->GetPreviewVolume(0);
+    if (previewVolume && previewVolume->GetID())
+      {
+      this->showForegroundVolume(previewVolume);
+      }
+    return;
+    }
+
+  for (int sliceCnt = 0; sliceCnt < sliceCompositeNodes.size(); sliceCnt++)
+    {
+    vtkMRMLSliceCompositeNode *sliceCompositeNode = sliceCompositeNodes[sliceCnt];
+    if (!sliceCompositeNode)
+      {
+      continue;
+      }
+    vtkMRMLAstroVolumeNode *previewVolume = logic->GetPreviewVolume(sliceCnt);
+    int wasModifying = sliceCompositeNode->StartModify();
+    sliceCompositeNode->SetForegroundVolumeID(previewVolume ? previewVolume->GetID() : nullptr);
+    sliceCompositeNode->SetForegroundOpacity(1.);
+    sliceCompositeNode->EndModify(wasModifying);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::showForegroundVolume(vtkMRMLAstroVolumeNode *volume)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  vtkMRMLScene *scene = this->mrmlScene();
+  vtkSlicerApplicationLogic *appLogic = this->module()->appLogic();
+  if (!scene || !volume || !appLogic || !d->selectionNode)
+    {
+    return;
+    }
+
+  // the previews of the shown slices are set in each slice view
+  std::vector<vtkMRMLNode*> sliceCompositeNodes;
+  scene->GetNodesByClass("vtkMRMLSliceCompositeNode", sliceCompositeNodes);
+  bool shown = d->selectionNode->GetSecondaryVolumeID() &&
+               !strcmp(d->selectionNode->GetSecondaryVolumeID(), volume->GetID());
+  for (unsigned int ii = 0; ii < sliceCompositeNodes.size() && shown; ii++)
+    {
+    vtkMRMLSliceCompositeNode *sliceCompositeNode =
+      vtkMRMLSliceCompositeNode::SafeDownCast(sliceCompositeNodes[ii]);
+    shown = sliceCompositeNode && sliceCompositeNode->GetForegroundVolumeID() &&
+            !strcmp(sliceCompositeNode->GetForegroundVolumeID(), volume->GetID());
+    }
+  if (shown)
+    {
+    return;
+    }
+
+  d->selectionNode->SetSecondaryVolumeID(volume->GetID());
+  appLogic->PropagateForegroundVolumeSelection(0);
+
+  for (unsigned int ii = 0; ii < sliceCompositeNodes.size(); ii++)
+    {
+    vtkMRMLSliceCompositeNode *sliceCompositeNode =
+      vtkMRMLSliceCompositeNode::SafeDownCast(sliceCompositeNodes[ii]);
+    if (sliceCompositeNode)
+      {
+      sliceCompositeNode->SetForegroundOpacity(1.);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onPreviewROIChanged(vtkMRMLNode *mrmlNode)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  vtkMRMLAnnotationROINode* roiNode = vtkMRMLAnnotationROINode::SafeDownCast(mrmlNode);
+  this->qvtkReconnect(d->PreviewROINode, roiNode, vtkCommand::ModifiedEvent,
+                      this, SLOT(onPreviewROIModified()));
+  d->PreviewROINode = roiNode;
+
+  if (!d->parametersNode || d->parametersNode->GetPreviewROINode() == roiNode)
+    {
+    return;
+    }
+
+  d->parametersNode->SetPreviewROINode(roiNode);
+  this->onPreviewROIModified();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onPreviewROIAdded(vtkMRMLNode *mrmlNode)
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  vtkMRMLAnnotationROINode* roiNode = vtkMRMLAnnotationROINode::SafeDownCast(mrmlNode);
+  if (!d->parametersNode || !roiNode || !d->logic() || !d->logic()->GetAstroVolumeLogic())
+    {
+    return;
+    }
+
+  vtkMRMLAstroVolumeNode *inputVolume =
+    vtkMRMLAstroVolumeNode::SafeDownCast(this->mrmlScene()->
+      GetNodeByID(d->parametersNode->GetInputVolumeNodeID()));
+  if (!inputVolume)
+    {
+    return;
+    }
+
+  // a new ROI starts on the whole input volume
+  int wasModifyingROI = roiNode->StartModify();
+  d->logic()->GetAstroVolumeLogic()->SnapROIToVoxelGrid(roiNode, inputVolume);
+  d->logic()->GetAstroVolumeLogic()->FitROIToInputVolume(roiNode, inputVolume);
+  roiNode->EndModify(wasModifyingROI);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onPreviewROIModified()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  if (d->parametersNode && d->parametersNode->GetPreview())
+    {
+    d->PreviewTimer->start(0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroSmoothingModuleWidget::onParametersSettled()
+{
+  Q_D(qSlicerAstroSmoothingModuleWidget);
+
+  if (!d->parametersNode || !d->parametersNode->GetAutoRun())
+    {
+    return;
+    }
+
+  // wait for the end of the cancelled filter
+  if (d->parametersNode->GetStatus() != 0)
+    {
+    d->ApplyTimer->start();
+    return;
+    }
+
+  this->onApply();
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerAstroSmoothingModuleWidget::onComputationStarted()
 {
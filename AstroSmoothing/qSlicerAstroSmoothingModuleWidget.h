@@ -28,6 +28,7 @@
 class qSlicerAstroSmoothingModuleWidgetPrivate;
 class vtkMRMLNode;
 class vtkMRMLAstroSmoothingParametersNode;
+class vtkMRMLAstroVolumeNode;
 
 /// \ingroup SlicerAstro_QtModules_AstroSmoothing
 class Q_SLICERASTRO_QTMODULES_ASTROSMOOTHING_EXPORT qSlicerAstroSmoothingModuleWidget :
@@ -70,6 +71,20 @@ protected:
   /// Initialization of MRML camera nodes
   void initializeCameras();
 
+  /// Create the output volume (a copy of the input volume)
+  /// replacing the previous filtered one
+  vtkMRMLAstroVolumeNode* createOutputVolume(vtkMRMLAstroVolumeNode* inputVolume);
+
+  /// Run the filter after a change of the parameters:
+  /// preview of the shown slices, or whole volume (AutoRun)
+  void updateOutput();
+
+  /// Observe the slice nodes to preview the filter on the shown slices
+  void observeSliceNodes(bool observe);
+
+  /// Show the volume over the input volume in the slice views
+  void showForegroundVolume(vtkMRMLAstroVolumeNode* volume);
+
 protected slots:
 
   /// Set the MRML input node
@@ -102,10 +117,19 @@ protected slots:
   void onLinkChanged(bool value);
   void onMasksCommandChanged();
   void onModeChanged();
+  void onMemoryBudgetChanged(int value);
   void onMRMLCameraNodeModified();
+  void onOutOfCoreChanged(bool value);
+  void onOutputFileBrowse();
+  void onOutputFileNameChanged();
   void onParameterXChanged(double value);
   void onParameterYChanged(double value);
   void onParameterZChanged(double value);
+  void onPreviewChanged(bool value);
+  void onPreviewROIAdded(vtkMRMLNode* mrmlNode);
+  void onPreviewROIChanged(vtkMRMLNode* mrmlNode);
+  void onPreviewROIModified();
+  void onRecursiveGaussianChanged(bool value);
   void onRxChanged(double value);
   void onRyChanged(double value);
   void onRzChanged(double value);
@@ -114,6 +138,14 @@ protected slots:
   void onMRMLSelectionNodeModified(vtkObject* sender);
   void onMRMLSelectionNodeReferenceAdded(vtkObject* sender);
   void onMRMLSelectionNodeReferenceRemoved(vtkObject* sender);
+  void onMRMLSliceNodeModified();
+
+  /// Filter only the voxels of the preview ROI, or of the shown
+  /// slices, (plus the kernel halo) in the preview volume
+  void onPreview();
+
+  /// Filter the whole volume once the parameters are settled (AutoRun)
+  void onParametersSettled();
 
   void onComputationCancelled();
   void onComputationFinished();
@@ -21,6 +21,7 @@
 #include "vtkSlicerAstroVolumeLogic.h"
 #include "vtkSlicerAstroStatisticsLogic.h"
 #include "vtkSlicerAstroConfigure.h"
+#include "vtkSlicerAstroTemplateMacro.h"
 
 // MRML includes
 #include <vtkMRMLAnnotationROINode.h>
@@ -49,6 +50,7 @@
 // Std includes
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <sys/time.h>
 
@@ -59,21 +61,6 @@
 
 namespace
 {
-//----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
-
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
-
 //----------------------------------------------------------------------------
 template <typename T> std::string NumberToString(T V)
 {
@@ -97,15 +84,216 @@ template <typename T> bool isNaN(T value)
 }
 
 //----------------------------------------------------------------------------
-bool DoubleIsNaN(double Value)
+// Voxels of the input volume selected for the statistics: either the voxels
+// of the segmentation mask (Mask not null) or the voxels inside the ROI
+// bounds, between FirstElement and LastElement.
+struct VoxelSelection
 {
-  return isNaN<double>(Value);
+  const short *Mask;
+  vtkIdType FirstElement;
+  vtkIdType LastElement;
+  int DimX;
+  vtkIdType NumSlice;
+  double Bounds[4];
+
+  bool Contains(vtkIdType elementCnt) const
+  {
+    if (this->Mask)
+      {
+      return this->Mask[elementCnt] >= 1;
+      }
+
+    int x = static_cast<int>(elementCnt % this->DimX);
+    int y = static_cast<int>((elementCnt % this->NumSlice) / this->DimX);
+    return x >= this->Bounds[0] && x <= this->Bounds[1] &&
+           y >= this->Bounds[2] && y <= this->Bounds[3];
+  }
+};
+
+//----------------------------------------------------------------------------
+// Progress of the selection pass between offset and offset + span.
+int SelectionStatus(const VoxelSelection &selection, vtkIdType elementCnt,
+                    int numberOfThreads, double offset, double span)
+{
+  vtkIdType numElements = selection.LastElement - selection.FirstElement;
+  double fraction = (elementCnt - selection.FirstElement + 1.) * numberOfThreads / numElements;
+  if (fraction > 1.)
+    {
+    fraction = 1.;
+    }
+  return static_cast<int>(offset + span * fraction);
+}
+
+//----------------------------------------------------------------------------
+template <typename T> bool CalculateExtrema(const T *inPtr, const VoxelSelection &selection,
+                                           double &Max, double &Min, double &Sum, int &Npixels,
+                                           vtkMRMLAstroStatisticsParametersNode *pnode)
+{
+  bool cancel = false;
+  int status = 1;
+  double max = Max, min = Min, sum = 0.;
+  int npixels = 0;
+  int numberOfThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numberOfThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(cancel, status) reduction(max : max), reduction(min : min), reduction(+:sum), reduction(+:npixels)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elementCnt = selection.FirstElement; elementCnt < selection.LastElement; elementCnt++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+    if (cancel || !selection.Contains(elementCnt))
+      {
+      continue;
+      }
+
+    const T value = inPtr[elementCnt];
+    if (isNaN(value))
+      {
+      continue;
+      }
+    if (value > max)
+      {
+      max = value;
+      }
+    if (value < min)
+      {
+      min = value;
+      }
+    sum += value;
+    npixels += 1;
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (omp_get_thread_num() == 0)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      int percentage = SelectionStatus(selection, elementCnt, numberOfThreads, 1., 32.);
+      if (percentage > status + 5)
+        {
+        status = percentage;
+        pnode->SetStatus(status);
+        }
+      }
+    }
+
+  Max = max;
+  Min = min;
+  Sum = sum;
+  Npixels = npixels;
+
+  return !cancel;
+}
+
+//----------------------------------------------------------------------------
+template <typename T> bool CalculateSquaredDeviations(const T *inPtr, const VoxelSelection &selection,
+                                                      double Mean, double &Std,
+                                                      vtkMRMLAstroStatisticsParametersNode *pnode)
+{
+  bool cancel = false;
+  int status = 33;
+  double squares = 0.;
+  int numberOfThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numberOfThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(cancel, status) reduction(+:squares)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elementCnt = selection.FirstElement; elementCnt < selection.LastElement; elementCnt++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+    if (cancel || !selection.Contains(elementCnt))
+      {
+      continue;
+      }
+
+    const T value = inPtr[elementCnt];
+    if (isNaN(value))
+      {
+      continue;
+      }
+    squares += (value - Mean) * (value - Mean);
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (omp_get_thread_num() == 0)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      int percentage = SelectionStatus(selection, elementCnt, numberOfThreads, 33., 33.);
+      if (percentage > status + 5)
+        {
+        status = percentage;
+        pnode->SetStatus(status);
+        }
+      }
+    }
+
+  Std = squares;
+
+  return !cancel;
 }
 
 //----------------------------------------------------------------------------
-bool FloatIsNaN(float Value)
+template <typename T> bool CollectSelectedValues(const T *inPtr, const VoxelSelection &selection,
+                                                 float *TempPixel, int Npixels,
+                                                 vtkMRMLAstroStatisticsParametersNode *pnode)
 {
-  return isNaN<float>(Value);
+  int status = 66;
+  int TempCnt = 0;
+  for (vtkIdType elementCnt = selection.FirstElement;
+       elementCnt < selection.LastElement && TempCnt < Npixels; elementCnt++)
+    {
+    if (pnode->GetStatus() < 0)
+      {
+      return false;
+      }
+
+    if (!selection.Contains(elementCnt))
+      {
+      continue;
+      }
+
+    const T value = inPtr[elementCnt];
+    if (isNaN(value))
+      {
+      continue;
+      }
+    TempPixel[TempCnt] = value;
+    TempCnt++;
+
+    int percentage = SelectionStatus(selection, elementCnt, 1, 66., 16.);
+    if (percentage > status + 5)
+      {
+      status = percentage;
+      pnode->SetStatus(status);
+      }
+    }
+
+  return true;
 }
 
 }// end namespace
@@ -267,10 +455,12 @@ bool vtkSlicerAstroStatisticsLogic::CalculateStatistics(vtkMRMLAstroStatisticsPa
     return false;
     }
 
-  double BMAJ = StringToDouble(inputVolume->GetAttribute("SlicerAstro.BMAJ"));
-  double BMIN = StringToDouble(inputVolume->GetAttribute("SlicerAstro.BMIN"));
-  double CDELT1 = StringToDouble(inputVolume->GetAttribute("SlicerAstro.CDELT1"));
-  double CDELT2 = StringToDouble(inputVolume->GetAttribute("SlicerAstro.CDELT2"));
+  double beam[3];
+  inputVolume->GetBeam(beam);
+  double BMAJ = beam[0];
+  double BMIN = beam[1];
+  double CDELT1 = inputVolume->GetAxisIncrement(0);
+  double CDELT2 = inputVolume->GetAxisIncrement(1);
 
   double unitBeamConv = 1.;
   if (pnode->GetTotalFlux())
@@ -293,32 +483,65 @@ bool vtkSlicerAstroStatisticsLogic::CalculateStatistics(vtkMRMLAstroStatisticsPa
 
   const int *dims = inputVolume->GetImageData()->GetDimensions();
   const int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
-  const int numSlice = dims[0] * dims[1] * numComponents;
-  int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1] * numComponents;
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
+
+  // the scaled int16 cubes are measured on their float physical values
+  vtkSmartPointer<vtkImageData> inputImageData =
+    vtkSlicerAstroVolumeLogic::GetPhysicalImageData(inputVolume);
+  if (!inputImageData)
+    {
+    vtkErrorMacro("vtkSlicerAstroStatisticsLogic::CalculateStatistics :"
+                  " attempt to allocate scalars of type not allowed");
+    return false;
+    }
+  const int DataType = inputImageData->GetScalarType();
+  void *inPtr = inputImageData->GetScalarPointer(0,0,0);
 
-  float *inFPixel = nullptr;
-  double *inDPixel = nullptr;
-  short *maskPixel = nullptr;
-  double Max = inputVolume->GetImageData()->GetScalarTypeMin(), Min = inputVolume->GetImageData()->GetScalarTypeMax();
+  double Max = inputImageData->GetScalarTypeMin(), Min = inputImageData->GetScalarTypeMax();
   double Mean = 0., Median = 0., Std = 0., Sum = 0., TotalFlux = 0.;
   int Npixels = 0;
 
-  const int DataType = inputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  switch (DataType)
+  // the statistics of a selection are cached by the AstroVolume logic
+  // for the selection region (mask or ROI)
+  vtkSlicerAstroVolumeLogic *astroVolumeLogic = this->GetAstroVolumeLogic();
+  vtkMRMLNode *regionNode = nullptr;
+  vtkNew<vtkDoubleArray> cachedValues;
+
+  VoxelSelection selection;
+  selection.Mask = nullptr;
+  selection.FirstElement = 0;
+  selection.LastElement = numElements;
+  selection.DimX = dims[0];
+  selection.NumSlice = numSlice;
+  if(segmentationActive)
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("Attempt to allocate scalars of type not allowed");
-      return false;
+    selection.Mask = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
+    regionNode = maskVolume;
     }
+  else
+    {
+    vtkMRMLAnnotationROINode *roiNode = pnode->GetROINode();
+    if(!roiNode)
+      {
+      vtkErrorMacro("vtkSlicerAstroStatisticsLogic::CalculateStatistics :"
+                    " roiNode not found!");
+      return false;
+      }
 
-  bool cancel = false;
-  int status = 0;
+    double roiBounds[6];
+    this->GetAstroVolumeLogic()->CalculateROICropVolumeBounds(roiNode, inputVolume, roiBounds);
+
+    selection.FirstElement = (roiBounds[0] + roiBounds[2] * dims[0] +
+                              roiBounds[4] * numSlice);
+    selection.LastElement = (roiBounds[1] + roiBounds[3] * dims[0] +
+                             roiBounds[5] * numSlice) + 1;
+    for (int ii = 0; ii < 4; ii++)
+      {
+      selection.Bounds[ii] = roiBounds[ii];
+      }
+    regionNode = roiNode;
+    }
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   int numProcs = 0;
@@ -342,564 +565,114 @@ bool vtkSlicerAstroStatisticsLogic::CalculateStatistics(vtkMRMLAstroStatisticsPa
 
   pnode->SetStatus(1);
 
-  if(segmentationActive)
-    {
-    maskPixel = static_cast<short*> (maskVolume->GetImageData()->GetScalarPointer(0,0,0));
-
-    // Calculate Max, Min, NPixels, Sum
-    if (pnode->GetMax() || pnode->GetMin() ||
-        pnode->GetNpixels() || pnode->GetSum() ||
-        pnode->GetMean() || pnode->GetStd() ||
-        pnode->GetTotalFlux() || pnode->GetMedian())
-      {
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) shared(pnode, cancel, status) reduction(max : Max), reduction(min : Min), reduction(+:Sum), reduction(+:Npixels)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
-        {
-        int stat = pnode->GetStatus();
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (stat == -1 && omp_get_thread_num() == 0)
-        #else
-        if (stat == -1)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          {
-          cancel = true;
-          }
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        #pragma omp flush (cancel)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-        if (!cancel)
-          {
-          if (*(maskPixel + elementCnt) < 1)
-            {
-            continue;
-            }
-
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (FloatIsNaN(*(inFPixel + elementCnt)))
-                {
-                continue;
-                }
-              if (*(inFPixel + elementCnt) > Max)
-                {
-                Max = *(inFPixel + elementCnt);
-                }
-              if (*(inFPixel + elementCnt) < Min)
-                {
-                Min = *(inFPixel + elementCnt);
-                }
-              Sum += *(inFPixel + elementCnt);
-              break;
-            case VTK_DOUBLE:
-              if (DoubleIsNaN(*(inDPixel + elementCnt)))
-                {
-                continue;
-                }
-              if (*(inDPixel + elementCnt) > Max)
-                {
-                Max = *(inDPixel + elementCnt);
-                }
-              if (*(inDPixel + elementCnt) < Min)
-                {
-                Min = *(inDPixel + elementCnt);
-                }
-              Sum += *(inDPixel + elementCnt);
-              break;
-            }
-
-          Npixels += 1;
-
-          #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          if (omp_get_thread_num() == 0)
-            {
-            if(elementCnt / (numElements / (numProcs * 33.)) > status)
-              {
-              status += 10;
-              pnode->SetStatus(status);
-              }
-            }
-          #else
-          if(elementCnt / (numElements / 33.) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          }
-        }
-
-      if (cancel)
-        {
-        inFPixel = nullptr;
-        inDPixel = nullptr;
-        maskPixel = nullptr;
-
-        delete inFPixel;
-        delete inDPixel;
-        delete maskPixel;
-
-        return false;
-        }
-      }
-
-    // Calculate Mean
-    if (pnode->GetMean())
-      {
-      Mean = Sum / Npixels;
-      }
+  bool cancel = false;
 
-    // Calculate TotalFlux
-    if (pnode->GetTotalFlux())
+  // Calculate Max, Min, NPixels, Sum
+  if (pnode->GetMax() || pnode->GetMin() ||
+      pnode->GetNpixels() || pnode->GetSum() ||
+      pnode->GetMean() || pnode->GetStd() ||
+      pnode->GetTotalFlux() || pnode->GetMedian())
+    {
+    if (astroVolumeLogic &&
+        astroVolumeLogic->GetCachedStatistics(inputVolume, "SelectionExtrema",
+                                              cachedValues.GetPointer(), regionNode) &&
+        cachedValues->GetNumberOfValues() == 4)
       {
-      TotalFlux = Sum * unitBeamConv;
+      Max = cachedValues->GetValue(0);
+      Min = cachedValues->GetValue(1);
+      Sum = cachedValues->GetValue(2);
+      Npixels = static_cast<int>(cachedValues->GetValue(3));
       }
-
-    // Calculate Std
-    if (pnode->GetStd())
+    else
       {
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) shared(pnode, cancel, status) reduction(+:Std)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+      switch (DataType)
         {
-        int stat = pnode->GetStatus();
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (stat == -1 && omp_get_thread_num() == 0)
-        #else
-        if (stat == -1)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          {
-          cancel = true;
-          }
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        #pragma omp flush (cancel)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-        if (!cancel)
-          {
-          if (*(maskPixel + elementCnt) < 1)
-            {
-            continue;
-            }
-
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (FloatIsNaN(*(inFPixel + elementCnt)))
-                {
-                continue;
-                }
-              Std += (*(inFPixel + elementCnt) - Mean) * (*(inFPixel + elementCnt) - Mean);
-              break;
-            case VTK_DOUBLE:
-              if (DoubleIsNaN(*(inDPixel + elementCnt)))
-                {
-                continue;
-                }
-              Std += (*(inDPixel + elementCnt) - Mean) * (*(inDPixel + elementCnt) - Mean);
-              break;
-            }
-
-          #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          if (omp_get_thread_num() == 0)
-            {
-            if(33. + (elementCnt / (numElements / (numProcs * 33.))) > status)
-              {
-              status += 10;
-              pnode->SetStatus(status);
-              }
-            }
-          #else
-          if(33. + (elementCnt / (numElements / 33.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          }
+        vtkSlicerAstroFloatingTemplateMacro(
+          cancel = !CalculateExtrema(static_cast<VTK_TT*>(inPtr), selection,
+                                     Max, Min, Sum, Npixels, pnode));
         }
 
-      if (cancel)
+      if (!cancel && astroVolumeLogic)
         {
-        inFPixel = nullptr;
-        inDPixel = nullptr;
-        maskPixel = nullptr;
-
-        delete inFPixel;
-        delete inDPixel;
-        delete maskPixel;
-
-        return false;
+        cachedValues->SetNumberOfValues(4);
+        cachedValues->SetValue(0, Max);
+        cachedValues->SetValue(1, Min);
+        cachedValues->SetValue(2, Sum);
+        cachedValues->SetValue(3, Npixels);
+        astroVolumeLogic->SetCachedStatistics(inputVolume, "SelectionExtrema",
+                                              cachedValues.GetPointer(), regionNode);
         }
-
-      Std = sqrt(Std / Npixels);
       }
+    }
 
-    // Calculate Median
-    if (pnode->GetMedian())
-      {
-      this->Internal->MedianTempArray->Initialize();
-      this->Internal->MedianTempArray->SetNumberOfValues(Npixels);
-
-      float *TempPixel = static_cast<float*> (this->Internal->MedianTempArray->GetPointer(0));
-      int TempCnt = 0;
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
-        {
-
-        int status = pnode->GetStatus();
-        if (status < 0)
-          {
-          cancel = true;
-          break;
-          }
-
-        if (*(maskPixel + elementCnt) < 1)
-          {
-          continue;
-          }
-
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-            if (FloatIsNaN(*(inFPixel + elementCnt)))
-              {
-              continue;
-              }
-            *(TempPixel + TempCnt) = *(inFPixel + elementCnt);
-            break;
-          case VTK_DOUBLE:
-            if (DoubleIsNaN(*(inDPixel + elementCnt)))
-              {
-              continue;
-              }
-            *(TempPixel + TempCnt) = *(inDPixel + elementCnt);
-            break;
-          }
-
-        TempCnt++;
-
-        if(66. + (elementCnt / (numElements / 16.)) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        }
-
-      std::sort(TempPixel, TempPixel + Npixels);
-
-      pnode->SetStatus(95);
-
-      if((Npixels) % 2 == 0)
-        {
-        Median = (*(TempPixel + (int) (Npixels * 0.5)) + *(TempPixel + (int) ((Npixels * 0.5) - 1))) * 0.5;
-        }
-      else
-        {
-        Median = *(TempPixel + (int) ((Npixels - 1) * 0.5));
-        }
-
-      TempPixel = nullptr;
-
-      delete TempPixel;
+  // Calculate Mean
+  if (pnode->GetMean())
+    {
+    Mean = Sum / Npixels;
+    }
 
-      this->Internal->MedianTempArray->Initialize();
-      }
+  // Calculate TotalFlux
+  if (pnode->GetTotalFlux())
+    {
+    TotalFlux = Sum * unitBeamConv;
     }
-  else
+
+  // Calculate Std
+  if (!cancel && pnode->GetStd())
     {
-    vtkMRMLAnnotationROINode *roiNode = pnode->GetROINode();
-    if(!roiNode)
+    if (astroVolumeLogic &&
+        astroVolumeLogic->GetCachedStatistics(inputVolume, "SelectionStd",
+                                              cachedValues.GetPointer(), regionNode) &&
+        cachedValues->GetNumberOfValues() == 1)
       {
-      vtkErrorMacro("vtkSlicerAstroStatisticsLogic::CalculateStatistics :"
-                    " roiNode not found!");
-      return false;
+      Std = cachedValues->GetValue(0);
       }
-
-    double roiBounds[6];
-    this->GetAstroVolumeLogic()->CalculateROICropVolumeBounds(roiNode, inputVolume, roiBounds);
-
-    int firstElement = (roiBounds[0] + roiBounds[2] * dims[0] +
-                       roiBounds[4] * numSlice);
-
-    int lastElement = (roiBounds[1] + roiBounds[3] * dims[0] +
-                      roiBounds[5] * numSlice) + 1;
-
-    numElements = lastElement - firstElement;
-
-    // Calculate Max, Min, NPixels, Sum
-    if (pnode->GetMax() || pnode->GetMin() ||
-        pnode->GetNpixels() || pnode->GetSum() ||
-        pnode->GetMean() || pnode->GetStd() ||
-        pnode->GetTotalFlux() || pnode->GetMedian())
+    else
       {
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) shared(pnode, cancel, status) reduction(max : Max), reduction(min : Min), reduction(+:Sum), reduction(+:Npixels)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = firstElement; elementCnt < lastElement; elementCnt++)
+      // the deviations from the mean of all the selected voxels
+      double mean = Sum / Npixels;
+      switch (DataType)
         {
-        int stat = pnode->GetStatus();
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (stat == -1 && omp_get_thread_num() == 0)
-        #else
-        if (stat == -1)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          {
-          cancel = true;
-          }
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        #pragma omp flush (cancel)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-        if (!cancel)
-          {
-          int ref  = (int) floor(elementCnt / dims[0]);
-          ref *= dims[0];
-          int x = elementCnt - ref;
-          ref = (int) floor(elementCnt / numSlice);
-          ref *= numSlice;
-          ref = elementCnt - ref;
-          int y = (int) floor(ref / dims[0]);
-          if (x < roiBounds[0] || x > roiBounds[1] ||
-              y < roiBounds[2] || y > roiBounds[3])
-            {
-            continue;
-            }
-
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (FloatIsNaN(*(inFPixel + elementCnt)))
-                {
-                continue;
-                }
-              if (*(inFPixel + elementCnt) > Max)
-                {
-                Max = *(inFPixel + elementCnt);
-                }
-              if (*(inFPixel + elementCnt) < Min)
-                {
-                Min = *(inFPixel + elementCnt);
-                }
-              Sum += *(inFPixel + elementCnt);
-              break;
-            case VTK_DOUBLE:
-              if (DoubleIsNaN(*(inDPixel + elementCnt)))
-                {
-                continue;
-                }
-              if (*(inDPixel + elementCnt) > Max)
-                {
-                Max = *(inDPixel + elementCnt);
-                }
-              if (*(inDPixel + elementCnt) < Min)
-                {
-                Min = *(inDPixel + elementCnt);
-                }
-              Sum += *(inDPixel + elementCnt);
-              break;
-            }
-
-          Npixels += 1;
-
-          #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          if (omp_get_thread_num() == 0)
-            {
-            if((elementCnt - firstElement) / (numElements / (numProcs * 33.)) > status)
-              {
-              status += 10;
-              pnode->SetStatus(status);
-              }
-            }
-          #else
-          if((elementCnt - firstElement) / (numElements / 33.) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          }
+        vtkSlicerAstroFloatingTemplateMacro(
+          cancel = !CalculateSquaredDeviations(static_cast<VTK_TT*>(inPtr), selection,
+                                               mean, Std, pnode));
         }
 
-      if (cancel)
-        {
-        inFPixel = nullptr;
-        inDPixel = nullptr;
-        maskPixel = nullptr;
-
-        delete inFPixel;
-        delete inDPixel;
-        delete maskPixel;
+      Std = sqrt(Std / Npixels);
 
-        return false;
+      if (!cancel && astroVolumeLogic)
+        {
+        cachedValues->SetNumberOfValues(1);
+        cachedValues->SetValue(0, Std);
+        astroVolumeLogic->SetCachedStatistics(inputVolume, "SelectionStd",
+                                              cachedValues.GetPointer(), regionNode);
         }
       }
+    }
 
-    // Calculate Mean
-    if (pnode->GetMean())
-      {
-      Mean = Sum / Npixels;
-      }
-
-    // Calculate TotalFlux
-    if (pnode->GetTotalFlux())
-      {
-      TotalFlux = Sum * unitBeamConv;
-      }
+  // Calculate Median
+  if (!cancel && pnode->GetMedian() && astroVolumeLogic &&
+      astroVolumeLogic->GetCachedStatistics(inputVolume, "SelectionMedian",
+                                            cachedValues.GetPointer(), regionNode) &&
+      cachedValues->GetNumberOfValues() == 1)
+    {
+    Median = cachedValues->GetValue(0);
+    }
+  else if (!cancel && pnode->GetMedian())
+    {
+    this->Internal->MedianTempArray->Initialize();
+    this->Internal->MedianTempArray->SetNumberOfValues(Npixels);
 
-    // Calculate Std
-    if (pnode->GetStd())
+    float *TempPixel = static_cast<float*> (this->Internal->MedianTempArray->GetPointer(0));
+    switch (DataType)
       {
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) shared(pnode, cancel, status) reduction(+:Std)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = firstElement; elementCnt < lastElement; elementCnt++)
-        {
-        int stat = pnode->GetStatus();
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (stat == -1 && omp_get_thread_num() == 0)
-        #else
-        if (stat == -1)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          {
-          cancel = true;
-          }
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        #pragma omp flush (cancel)
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-        if (!cancel)
-          {
-          int ref  = (int) floor(elementCnt / dims[0]);
-          ref *= dims[0];
-          int x = elementCnt - ref;
-          ref = (int) floor(elementCnt / numSlice);
-          ref *= numSlice;
-          ref = elementCnt - ref;
-          int y = (int) floor(ref / dims[0]);
-          if (x < roiBounds[0] || x > roiBounds[1] ||
-              y < roiBounds[2] || y > roiBounds[3])
-            {
-            continue;
-            }
-
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              if (FloatIsNaN(*(inFPixel + elementCnt)))
-                {
-                continue;
-                }
-              Std += (*(inFPixel + elementCnt) - Mean) * (*(inFPixel + elementCnt) - Mean);
-              break;
-            case VTK_DOUBLE:
-              if (DoubleIsNaN(*(inDPixel + elementCnt)))
-                {
-                continue;
-                }
-              Std += (*(inDPixel + elementCnt) - Mean) * (*(inDPixel + elementCnt) - Mean);
-              break;
-            }
-
-          #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          if (omp_get_thread_num() == 0)
-            {
-            if(33. + ((elementCnt - firstElement) / (numElements / (numProcs * 33.))) > status)
-              {
-              status += 10;
-              pnode->SetStatus(status);
-              }
-            }
-          #else
-          if(33. + ((elementCnt - firstElement) / (numElements / 33.)) > status)
-            {
-            status += 10;
-            pnode->SetStatus(status);
-            }
-          #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-          }
-        }
-
-      if (cancel)
-        {
-        inFPixel = nullptr;
-        inDPixel = nullptr;
-        maskPixel = nullptr;
-
-        delete inFPixel;
-        delete inDPixel;
-        delete maskPixel;
-
-        return false;
-        }
-
-      Std = sqrt(Std / Npixels);
+      vtkSlicerAstroFloatingTemplateMacro(
+        cancel = !CollectSelectedValues(static_cast<VTK_TT*>(inPtr), selection,
+                                        TempPixel, Npixels, pnode));
       }
 
-    // Calculate Median
-    if (pnode->GetMedian())
+    if (!cancel)
       {
-      this->Internal->MedianTempArray->Initialize();
-      this->Internal->MedianTempArray->SetNumberOfValues(Npixels);
-
-      float *TempPixel = static_cast<float*> (this->Internal->MedianTempArray->GetPointer(0));
-      int TempCnt = 0;
-      for (int elementCnt = firstElement; elementCnt < lastElement; elementCnt++)
-        {
-        int status = pnode->GetStatus();
-        if (status < 0)
-          {
-          cancel = true;
-          break;
-          }
-
-        int ref  = (int) floor(elementCnt / dims[0]);
-        ref *= dims[0];
-        int x = elementCnt - ref;
-        ref = (int) floor(elementCnt / numSlice);
-        ref *= numSlice;
-        ref = elementCnt - ref;
-        int y = (int) floor(ref / dims[0]);
-        if (x < roiBounds[0] || x > roiBounds[1] ||
-            y < roiBounds[2] || y > roiBounds[3])
-          {
-          continue;
-          }
-
-        switch (DataType)
-          {
-          case VTK_FLOAT:
-            if (FloatIsNaN(*(inFPixel + elementCnt)))
-              {
-              continue;
-              }
-            *(TempPixel + TempCnt) = *(inFPixel + elementCnt);
-            break;
-          case VTK_DOUBLE:
-            if (DoubleIsNaN(*(inDPixel + elementCnt)))
-              {
-              continue;
-              }
-            *(TempPixel + TempCnt) = *(inDPixel + elementCnt);
-            break;
-          }
-
-        TempCnt++;
-
-        if(66. + ((elementCnt - firstElement) / (numElements / 16.)) > status)
-          {
-          status += 10;
-          pnode->SetStatus(status);
-          }
-        }
-
       std::sort(TempPixel, TempPixel + Npixels);
 
       pnode->SetStatus(95);
@@ -913,12 +686,16 @@ bool vtkSlicerAstroStatisticsLogic::CalculateStatistics(vtkMRMLAstroStatisticsPa
         Median = *(TempPixel + (int) ((Npixels - 1) * 0.5));
         }
 
-      TempPixel = nullptr;
-
-      delete TempPixel;
-
-      this->Internal->MedianTempArray->Initialize();
+      if (astroVolumeLogic)
+        {
+        cachedValues->SetNumberOfValues(1);
+        cachedValues->SetValue(0, Median);
+        astroVolumeLogic->SetCachedStatistics(inputVolume, "SelectionMedian",
+                                              cachedValues.GetPointer(), regionNode);
+        }
       }
+
+    this->Internal->MedianTempArray->Initialize();
     }
 
   gettimeofday(&end, nullptr);
@@ -930,14 +707,6 @@ bool vtkSlicerAstroStatisticsLogic::CalculateStatistics(vtkMRMLAstroStatisticsPa
 
   vtkDebugMacro("Statistics Kernel Time : "<<mtime<<" ms.");
 
-  inFPixel = nullptr;
-  inDPixel = nullptr;
-  maskPixel = nullptr;
-
-  delete inFPixel;
-  delete inDPixel;
-  delete maskPixel;
-
   pnode->SetStatus(100);
 
   if (cancel)
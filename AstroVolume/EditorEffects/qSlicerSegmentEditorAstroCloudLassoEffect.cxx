@@ -91,13 +91,18 @@
 // AstroMRML includes
 #include <vtkMRMLAstroVolumeNode.h>
 
+// AstroLogic includes
+#include <vtkSlicerAstroVolumeLogic.h>
+
 // Slicer includes
 #include "qMRMLSliceView.h"
 #include "qMRMLSliceWidget.h"
 #include "qMRMLThreeDView.h"
 #include "qMRMLThreeDWidget.h"
+#include "qSlicerAbstractCoreModule.h"
 #include "qSlicerLayoutManager.h"
 #include "qSlicerApplication.h"
+#include "qSlicerModuleManager.h"
 #include "vtkMRMLSliceLogic.h"
 #include "vtkMRMLSliceLayerLogic.h"
 #include "vtkOrientedImageDataResample.h"
@@ -221,25 +226,6 @@ public:
 };
 
 
-namespace
-{
-//----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
-
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
-
-}// end namespace
-
 //-----------------------------------------------------------------------------
 // qSlicerSegmentEditorAstroCloudLassoEffectPrivate methods
 
@@ -1578,9 +1564,20 @@ void qSlicerSegmentEditorAstroCloudLassoEffect::masterVolumeNodeChanged()
     return;
     }
 
-  double min = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMIN"));
+  // estimate the missing noise of the volume with the statistics cache of
+  // the AstroVolume logic, scanning the voxels only if not already cached
+  qSlicerAbstractCoreModule* astroVolumeModule =
+    qSlicerApplication::application()->moduleManager()->module("AstroVolume");
+  vtkSlicerAstroVolumeLogic* astroVolumeLogic = astroVolumeModule ?
+    vtkSlicerAstroVolumeLogic::SafeDownCast(astroVolumeModule->logic()) : nullptr;
+  if (astroVolumeLogic && astroMasterVolume->GetDisplayThreshold() == 0.)
+    {
+    astroVolumeLogic->UpdateStatisticsAttributes(astroMasterVolume);
+    }
+
+  double min = astroMasterVolume->GetDataMin();
   this->setCommonParameter("ThresholdMinimumValueLimit", min);
-  double max = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMAX"));
+  double max = astroMasterVolume->GetDataMax();
   this->setCommonParameter("ThresholdMaximumValue", max);
   this->setCommonParameter("ThresholdMaximumValueLimit", max);
 
@@ -1594,7 +1591,7 @@ void qSlicerSegmentEditorAstroCloudLassoEffect::masterVolumeNodeChanged()
     ->applicationLogic()->GetSelectionNode()->GetUnitNode("intensity");
   this->setCommonParameter("ThresholdDecimals", unitNodeIntensity->GetPrecision());
 
-  double noise3 = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DisplayThreshold")) * 3.;
+  double noise3 = astroMasterVolume->GetDisplayThreshold() * 3.;
 
   if (noise3 != 0.)
     {
@@ -1776,7 +1773,7 @@ void qSlicerSegmentEditorAstroCloudLassoEffect::onEraseModeChanged(bool mode)
     return;
     }
 
-  double max = StringToDouble(astroMasterVolume->GetAttribute("SlicerAstro.DATAMAX"));
+  double max = astroMasterVolume->GetDataMax();
   this->setCommonParameter("ThresholdMaximumValue", max);
   this->updateGUIFromMRML();
 }
@@ -0,0 +1,77 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// .NAME vtkSlicerAstroTemplateMacro - dispatch of the CPU kernels on the AstroVolume scalar types
+// .SECTION Description
+// The CPU kernels of the SlicerAstro logics are written once as templates
+// over the scalar type and dispatched once per call, so that no type switch
+// is left in the voxel loops.
+
+#ifndef __vtkSlicerAstroTemplateMacro_h
+#define __vtkSlicerAstroTemplateMacro_h
+
+// VTK includes
+#include <vtkSetGet.h>
+#include <vtkType.h>
+
+/// \brief Expand a templated kernel call for the AstroVolume scalar types.
+///
+/// As vtkTemplateMacro, the call is expanded in a case of the switch on the
+/// data type for each type, with VTK_TT defined to the scalar type. The types
+/// are double and float for the data cubes and short for the int16 cubes and
+/// the masks:
+/// \code
+/// switch (DataType)
+///   {
+///   vtkSlicerAstroTemplateMacro(
+///     cancel = !Kernel(static_cast<VTK_TT*>(inPtr), static_cast<VTK_TT*>(outPtr), dims, pnode));
+///   }
+/// \endcode
+/// Only the kernels that read the stored values, as the noise and histogram
+/// calculations, are dispatched on short.
+#define vtkSlicerAstroTemplateMacro(call) \
+  vtkTemplateMacroCase(VTK_DOUBLE, double, call); \
+  vtkTemplateMacroCase(VTK_FLOAT, float, call); \
+  vtkTemplateMacroCase(VTK_SHORT, short, call)
+
+/// Whether vtkSlicerAstroTemplateMacro handles the data type.
+inline bool vtkSlicerAstroIsTemplateType(int dataType)
+{
+  return dataType == VTK_DOUBLE || dataType == VTK_FLOAT || dataType == VTK_SHORT;
+}
+
+/// \brief Expand a templated kernel call for the floating point data cubes.
+///
+/// As vtkSlicerAstroTemplateMacro, for double and float only. The processing
+/// kernels (smoothing, moment maps, profiles, statistics, reprojection) blank
+/// their output with std::numeric_limits<VTK_TT>::quiet_NaN() and work on the
+/// physical values: the scaled int16 cubes are passed to them as the float
+/// copy of vtkSlicerAstroVolumeLogic::GetPhysicalImageData, and their outputs
+/// are float (vtkSlicerAstroVolumeLogic::SetPhysicalScalarType).
+#define vtkSlicerAstroFloatingTemplateMacro(call) \
+  vtkTemplateMacroCase(VTK_DOUBLE, double, call); \
+  vtkTemplateMacroCase(VTK_FLOAT, float, call)
+
+/// Whether vtkSlicerAstroFloatingTemplateMacro handles the data type.
+inline bool vtkSlicerAstroIsFloatingTemplateType(int dataType)
+{
+  return dataType == VTK_DOUBLE || dataType == VTK_FLOAT;
+}
+
+#endif // __vtkSlicerAstroTemplateMacro_h
@@ -19,6 +19,12 @@
 
 // STD includes
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
 
 // Slicer includes
 #include <vtkSlicerVolumesLogic.h>
@@ -26,6 +32,7 @@
 // AstroVolume includes
 #include <vtkSlicerAstroVolumeLogic.h>
 #include <vtkSlicerAstroConfigure.h>
+#include <vtkSlicerAstroTemplateMacro.h>
 
 // MRML nodes includes
 #include <vtkMRMLAnnotationROINode.h>
@@ -60,6 +67,7 @@
 #include <vtkCacheManager.h>
 #include <vtkCollection.h>
 #include <vtkColorTransferFunction.h>
+#include <vtkDoubleArray.h>
 #include <vtkGeneralTransform.h>
 #include <vtkImageData.h>
 #include <vtkIntArray.h>
@@ -70,6 +78,7 @@
 #include <vtkPointData.h>
 #include <vtkSegment.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 // WCS includes
 #include "wcslib.h"
@@ -82,6 +91,31 @@
 #include <iostream>
 #include <sys/time.h>
 
+//----------------------------------------------------------------------------
+class vtkSlicerAstroVolumeLogic::vtkInternal
+{
+public:
+  struct StatisticsEntry
+    {
+    vtkWeakPointer<vtkImageData> ImageData;
+    vtkMTimeType ImageMTime;
+    bool HasRegion;
+    vtkWeakPointer<vtkMRMLNode> RegionNode;
+    vtkMTimeType RegionMTime;
+    std::vector<double> Values;
+    };
+
+  static std::string GetEntryKey(vtkMRMLAstroVolumeNode *volume,
+                                 const char *key,
+                                 vtkMRMLNode *regionNode);
+  static vtkMTimeType GetImageMTime(vtkMRMLAstroVolumeNode *volume);
+  static vtkMTimeType GetRegionMTime(vtkMRMLNode *regionNode);
+  static bool IsStale(const StatisticsEntry& entry, vtkMRMLAstroVolumeNode *volume);
+
+  // entries sorted by volume ID
+  std::map<std::string, StatisticsEntry> StatisticsCache;
+};
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerAstroVolumeLogic);
 
@@ -89,6 +123,7 @@ vtkStandardNewMacro(vtkSlicerAstroVolumeLogic);
 vtkSlicerAstroVolumeLogic::vtkSlicerAstroVolumeLogic()
 {
   this->PresetsScene = nullptr;
+  this->Internal = new vtkInternal;
 }
 
 //----------------------------------------------------------------------------
@@ -98,6 +133,7 @@ vtkSlicerAstroVolumeLogic::~vtkSlicerAstroVolumeLogic()
     {
     this->PresetsScene->Delete();
     }
+  delete this->Internal;
 }
 
 namespace
@@ -117,6 +153,16 @@ double StringToDouble(const char* str)
   return StringToNumber<double>(str);
 }
 
+//----------------------------------------------------------------------------
+std::string DoubleToString(double Value)
+{
+  std::string stringValue;
+  std::stringstream strstream;
+  strstream << Value;
+  strstream >> stringValue;
+  return stringValue;
+}
+
 //----------------------------------------------------------------------------
 template <typename T> bool isNaN(T value)
 {
@@ -124,15 +170,389 @@ template <typename T> bool isNaN(T value)
 }
 
 //----------------------------------------------------------------------------
-bool DoubleIsNaN(double Value)
+// Histograms of the voxels in [minimum, maximum] at several resolutions
+// (numberOfBins[ii] bins for the histogram ii) filled in one pass.
+// Each thread counts in private bins, merged at the end. The positions
+// of the voxels in the range are computed in blocks by a branchless
+// loop, then scattered into the bins of every resolution.
+template <typename T>
+void FillHistograms(const T *ptr, vtkIdType numElements,
+                    double minimum, double maximum, bool logScale,
+                    const std::vector<int>& numberOfBins,
+                    std::vector<vtkIdType>& counts)
+{
+  const int numberOfHistograms = static_cast<int>(numberOfBins.size());
+  std::vector<vtkIdType> offsets(numberOfHistograms + 1, 0);
+  for (int ii = 0; ii < numberOfHistograms; ii++)
+    {
+    offsets[ii + 1] = offsets[ii] + numberOfBins[ii];
+    }
+  const vtkIdType totalBins = offsets[numberOfHistograms];
+
+  // logarithmic bins span six decades above the minimum
+  const double range = maximum - minimum;
+  const double logOffset = range * 1.E-6;
+  const double invRange = range > 0. ? 1. / range : 0.;
+  const double invLogOffset = logOffset > 0. ? 1. / logOffset : 0.;
+  const double logNorm = logOffset > 0. ? 1. / log1p(range * invLogOffset) : 0.;
+
+  int numberOfThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numberOfThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  std::vector<vtkIdType> privateCounts(static_cast<size_t>(numberOfThreads) * totalBins, 0);
+
+  const vtkIdType blockSize = 1024;
+  const vtkIdType numberOfBlocks = (numElements + blockSize - 1) / blockSize;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  {
+  int thread = 0;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  thread = omp_get_thread_num();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  vtkIdType *localCounts = &privateCounts[static_cast<size_t>(thread) * totalBins];
+  double positions[blockSize];
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType blockCnt = 0; blockCnt < numberOfBlocks; blockCnt++)
+    {
+    const T *block = ptr + blockCnt * blockSize;
+    const vtkIdType size = std::min(blockSize, numElements - blockCnt * blockSize);
+
+    // position in [0, 1] of each voxel, -1 for NaN and out of range voxels
+    if (logScale)
+      {
+      for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+        {
+        const double delta = block[elemCnt] - minimum;
+        const double position = log1p(std::max(delta, 0.) * invLogOffset) * logNorm;
+        positions[elemCnt] = delta >= 0. && delta <= range ? position : -1.;
+        }
+      }
+    else
+      {
+      for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+        {
+        const double position = (block[elemCnt] - minimum) * invRange;
+        positions[elemCnt] = position >= 0. && position <= 1. ? position : -1.;
+        }
+      }
+
+    for (int ii = 0; ii < numberOfHistograms; ii++)
+      {
+      vtkIdType *bins = localCounts + offsets[ii];
+      const int lastBin = numberOfBins[ii] - 1;
+      for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+        {
+        if (positions[elemCnt] < 0.)
+          {
+          continue;
+          }
+        bins[std::min(static_cast<int>(positions[elemCnt] * numberOfBins[ii]), lastBin)]++;
+        }
+      }
+    }
+  }
+
+  counts.assign(totalBins, 0);
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType binCnt = 0; binCnt < totalBins; binCnt++)
+    {
+    for (int thread = 0; thread < numberOfThreads; thread++)
+      {
+      counts[binCnt] += privateCounts[static_cast<size_t>(thread) * totalBins + binCnt];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Mean and standard deviation of the voxels inside the ROI bounds, both
+// normalized by the ROI size cont.
+template <typename T>
+double CalculateNoiseInROI(const T *inPtr, const int *dims,
+                           vtkIdType firstElement, vtkIdType lastElement,
+                           const double roiBounds[6], vtkIdType cont)
+{
+  const vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1];
+  double mean = 0., noise = 0.;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) reduction(+:mean)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
+    {
+    int x = static_cast<int>(elemCnt % dims[0]);
+    int y = static_cast<int>((elemCnt % numSlice) / dims[0]);
+    if (x < roiBounds[0] || x > roiBounds[1] ||
+        y < roiBounds[2] || y > roiBounds[3])
+      {
+      continue;
+      }
+    if (isNaN(inPtr[elemCnt]))
+      {
+      continue;
+      }
+    mean += inPtr[elemCnt];
+    }
+  mean /= cont;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) reduction(+:noise)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
+    {
+    int x = static_cast<int>(elemCnt % dims[0]);
+    int y = static_cast<int>((elemCnt % numSlice) / dims[0]);
+    if (x < roiBounds[0] || x > roiBounds[1] ||
+        y < roiBounds[2] || y > roiBounds[3])
+      {
+      continue;
+      }
+    if (isNaN(inPtr[elemCnt]))
+      {
+      continue;
+      }
+    noise += (inPtr[elemCnt] - mean) * (inPtr[elemCnt] - mean);
+    }
+
+  return sqrt(noise / cont);
+}
+
+//----------------------------------------------------------------------------
+// Value of the input slice at (x, y), NaN outside of the input.
+template <typename T>
+double SliceValue(const T *slice, int dimX, int x, bool xInside, int y, bool yInside)
+{
+  if (!xInside || !yInside)
+    {
+    return std::numeric_limits<double>::quiet_NaN();
+    }
+  return slice[static_cast<vtkIdType>(dimX) * y + x];
+}
+
+//----------------------------------------------------------------------------
+struct NearestNeighbourInterpolator
+{
+  template <typename T>
+  static double Interpolate(const T *slice, const int *inputDims, double xGrid, double yGrid)
+  {
+    int x = (int) round(xGrid);
+    bool xInside = x > 0 && x < inputDims[0];
+
+    int y = (int) round(yGrid);
+    bool yInside = y > 0 && y < inputDims[1];
+
+    return SliceValue(slice, inputDims[0], x, xInside, y, yInside);
+  }
+};
+
+//----------------------------------------------------------------------------
+struct BilinearInterpolator
+{
+  template <typename T>
+  static double Interpolate(const T *slice, const int *inputDims, double x, double y)
+  {
+    int x1 = (int) floor(x);
+    bool x1Inside = x1 > 0 && x1 < inputDims[0];
+    int x2 = (int) ceil(x);
+    bool x2Inside = x2 > 0 && x2 < inputDims[0];
+
+    int y1 = (int) floor(y);
+    bool y1Inside = y1 > 0 && y1 < inputDims[1];
+    int y2 = (int) ceil(y);
+    bool y2Inside = y2 > 0 && y2 < inputDims[1];
+
+    if ((!x1Inside && !x2Inside) || (!y1Inside && !y2Inside))
+      {
+      return std::numeric_limits<double>::quiet_NaN();
+      }
+
+    const int dimX = inputDims[0];
+    double F11 = SliceValue(slice, dimX, x1, x1Inside, y1, y1Inside);
+    double F21 = SliceValue(slice, dimX, x2, x2Inside, y1, y1Inside);
+    double F12 = SliceValue(slice, dimX, x1, x1Inside, y2, y2Inside);
+    double F22 = SliceValue(slice, dimX, x2, x2Inside, y2, y2Inside);
+
+    double deltax = 1. / (x2 - x1);
+    double x2x = (x2 - x);
+    double xx1 = (x - x1) ;
+    double x2xdeltax = x2x * deltax;
+    double xx1deltax = xx1 * deltax;
+    double F1 = x2xdeltax * F11 + xx1deltax * F21;
+    double F2 = x2xdeltax * F12 + xx1deltax * F22;
+    double deltay = 1. / (y2 - y1);
+
+    return (y2 - y) * deltay * F1 + (y - y1) * deltay * F2;
+  }
+};
+
+//----------------------------------------------------------------------------
+struct BicubicInterpolator
+{
+  template <typename T>
+  static double Interpolate(const T *slice, const int *inputDims, double x, double y)
+  {
+    int xs[4] = {(int) floor(x) - 1, (int) floor(x), (int) ceil(x), (int) ceil(x) + 1};
+    int ys[4] = {(int) floor(y) - 1, (int) floor(y), (int) ceil(y), (int) ceil(y) + 1};
+    bool xInside[4], yInside[4];
+    for (int ii = 0; ii < 4; ii++)
+      {
+      xInside[ii] = xs[ii] > 0 && xs[ii] < inputDims[0];
+      yInside[ii] = ys[ii] > 0 && ys[ii] < inputDims[1];
+      }
+
+    if ((!xInside[0] && !xInside[3]) || (!yInside[0] && !yInside[3]))
+      {
+      return std::numeric_limits<double>::quiet_NaN();
+      }
+
+    // Catmull-Rom spline along y for each of the four columns, then along x
+    double deltaY = y - ys[1];
+    double F[4];
+    for (int ii = 0; ii < 4; ii++)
+      {
+      double Fi1 = SliceValue(slice, inputDims[0], xs[ii], xInside[ii], ys[0], yInside[0]);
+      double Fi2 = SliceValue(slice, inputDims[0], xs[ii], xInside[ii], ys[1], yInside[1]);
+      double Fi3 = SliceValue(slice, inputDims[0], xs[ii], xInside[ii], ys[2], yInside[2]);
+      double Fi4 = SliceValue(slice, inputDims[0], xs[ii], xInside[ii], ys[3], yInside[3]);
+      F[ii] = Fi2 + 0.5 * deltaY * (Fi3 - Fi1 + deltaY * (2. * Fi1 - 5. * Fi2 + 4. * Fi3 - Fi4 + deltaY * (3. * (Fi2 - Fi3) + Fi4 - Fi1)));
+      }
+
+    double deltaX = x - xs[1];
+    return F[1] + 0.5 * deltaX * (F[2] - F[0] + deltaX * (2. * F[0] - 5. * F[1] + 4. * F[2] - F[3] + deltaX * (3. * (F[1] - F[2]) + F[3] - F[0])));
+  }
+};
+
+//----------------------------------------------------------------------------
+// Reprojection of every spectral plane of the input on the 2D interpolation
+// grid (input IJK coordinates of each output pixel). Output pixels outside
+// of the input are blanked.
+template <typename Interpolator, typename T>
+bool InterpolateOnGrid(const T *inPtr, T *outPtr, const int *inputDims,
+                       int referenceLengthX, int referenceLengthY,
+                       const std::vector<std::vector<std::vector<double> > >& referenceGrid,
+                       vtkMRMLAstroReprojectParametersNode *pnode)
+{
+  const vtkIdType inputSliceDim = static_cast<vtkIdType>(inputDims[0]) * inputDims[1];
+  const int numberOfRows = referenceLengthY * inputDims[2];
+  bool cancel = false;
+  int status = 10;
+  int numberOfThreads = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numberOfThreads = omp_get_max_threads();
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static) shared(cancel, status)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int rowCnt = 0; rowCnt < numberOfRows; rowCnt++)
+    {
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (pnode->GetStatus() == -1 && omp_get_thread_num() == 0)
+    #else
+    if (pnode->GetStatus() == -1)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      cancel = true;
+      }
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp flush (cancel)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+    if (cancel)
+      {
+      continue;
+      }
+
+    const int jj = rowCnt % referenceLengthY;
+    const int kk = rowCnt / referenceLengthY;
+    const T *slice = inPtr + inputSliceDim * kk;
+    T *outRow = outPtr + static_cast<vtkIdType>(rowCnt) * referenceLengthX;
+    for (int ii = 0; ii < referenceLengthX; ii++)
+      {
+      double value = Interpolator::Interpolate(slice, inputDims,
+                                               referenceGrid[ii][jj][0],
+                                               referenceGrid[ii][jj][1]);
+      if (isNaN(value))
+        {
+        outRow[ii] = std::numeric_limits<T>::quiet_NaN();
+        }
+      else
+        {
+        outRow[ii] = static_cast<T>(value);
+        }
+      }
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    if (omp_get_thread_num() == 0)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      {
+      int percentage = 10 + static_cast<int>(89. * (rowCnt + 1) * numberOfThreads / numberOfRows);
+      if (percentage > 99)
+        {
+        percentage = 99;
+        }
+      if (percentage > status)
+        {
+        status = percentage;
+        pnode->SetStatus(status);
+        }
+      }
+    }
+
+  return !cancel;
+}
+
+//----------------------------------------------------------------------------
+template <typename T>
+bool InterpolateOnGrid(const T *inPtr, T *outPtr, const int *inputDims,
+                       int referenceLengthX, int referenceLengthY,
+                       const std::vector<std::vector<std::vector<double> > >& referenceGrid,
+                       int interpolationOrder,
+                       vtkMRMLAstroReprojectParametersNode *pnode)
 {
-  return isNaN<double>(Value);
+  switch (interpolationOrder)
+    {
+    case vtkMRMLAstroReprojectParametersNode::NearestNeighbour:
+      return InterpolateOnGrid<NearestNeighbourInterpolator>
+        (inPtr, outPtr, inputDims, referenceLengthX, referenceLengthY, referenceGrid, pnode);
+    case vtkMRMLAstroReprojectParametersNode::Bilinear:
+      return InterpolateOnGrid<BilinearInterpolator>
+        (inPtr, outPtr, inputDims, referenceLengthX, referenceLengthY, referenceGrid, pnode);
+    case vtkMRMLAstroReprojectParametersNode::Bicubic:
+      return InterpolateOnGrid<BicubicInterpolator>
+        (inPtr, outPtr, inputDims, referenceLengthX, referenceLengthY, referenceGrid, pnode);
+    }
+
+  return true;
 }
 
 //----------------------------------------------------------------------------
-bool FloatIsNaN(float Value)
+// Physical values (BSCALE * value + BZERO) of the stored values of a
+// scaled int16 cube, NaN for the BLANK voxels.
+template <typename T>
+void ScaleStoredValues(const T *inPtr, vtkIdType numElements,
+                       double bscale, double bzero, double blank,
+                       float *outPtr)
 {
-  return isNaN<float>(Value);
+  const bool hasBlank = !isNaN(blank);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    const double value = inPtr[elemCnt];
+    outPtr[elemCnt] = (hasBlank && value == blank) ?
+      nan : static_cast<float>(bscale * value + bzero);
+    }
 }
 
 }// end namespace
@@ -160,6 +580,8 @@ void vtkSlicerAstroVolumeLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
   events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
   events->InsertNextValue(vtkMRMLScene::EndImportEvent);
   this->SetAndObserveMRMLSceneEventsInternal(newScene, events.GetPointer());
+
+  this->ClearStatisticsCache();
 }
 
 //----------------------------------------------------------------------------
@@ -308,13 +730,13 @@ void vtkSlicerAstroVolumeLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
         continue;
         }
 
-      double mint = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMIN"));
+      double mint = astroVolumeNode->GetDataMin();
       if (mint < min)
         {
         min = mint;
         }
 
-      double maxt = StringToDouble(astroVolumeNode->GetAttribute("SlicerAstro.DATAMAX"));
+      double maxt = astroVolumeNode->GetDataMax();
       if (maxt > max)
         {
         max = maxt;
@@ -433,6 +855,11 @@ void vtkSlicerAstroVolumeLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode *node)
     return;
     }
 
+  if (node->IsA("vtkMRMLAstroVolumeNode"))
+    {
+    this->ClearStatisticsCache(vtkMRMLAstroVolumeNode::SafeDownCast(node));
+    }
+
   if (node->IsA("vtkMRMLSegmentEditorNode"))
     {
     vtkSmartPointer<vtkCollection> col = vtkSmartPointer<vtkCollection>::Take(
@@ -1152,6 +1579,13 @@ double vtkSlicerAstroVolumeLogic::CalculateDisplayThresholdInROI(vtkMRMLAnnotati
   // Calculate the noise as the std in a roi.
   // The DisplayThreshold = noise
   // 3D color function starts from 3 times the value of DisplayThreshold.
+  vtkNew<vtkDoubleArray> cachedNoise;
+  if (this->GetCachedStatistics(inputVolume, "DisplayThresholdInROI", cachedNoise.GetPointer(), roiNode) &&
+      cachedNoise->GetNumberOfValues() == 1)
+    {
+    inputVolume->SetDisplayThreshold(cachedNoise->GetValue(0));
+    return cachedNoise->GetValue(0);
+    }
 
   int *dims = inputVolume->GetImageData()->GetDimensions();
   int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
@@ -1161,26 +1595,18 @@ double vtkSlicerAstroVolumeLogic::CalculateDisplayThresholdInROI(vtkMRMLAnnotati
                   "imageData with more than one components.");
     return 0.;
     }
-  int numSlice = dims[0] * dims[1];
-  const int DataType = inputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  float *inFPixel = nullptr;
-  double *inDPixel = nullptr;
-  switch (DataType)
+  vtkIdType numSlice = static_cast<vtkIdType>(dims[0]) * dims[1];
+  const int DataType = inputVolume->GetImageData()->GetScalarType();
+  if (!vtkSlicerAstroIsTemplateType(DataType))
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateRMSinROI : "
-                    "attempt to allocate scalars of type not allowed");
-      return 0.;
+    vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateRMSinROI : "
+                  "attempt to allocate scalars of type not allowed");
+    return 0.;
     }
+  void *inPtr = inputVolume->GetImageData()->GetScalarPointer(0,0,0);
 
-  double noise = 0., mean = 0., roiBounds[6];
-  int cont = 0, firstElement, lastElement;
+  double noise = 0., roiBounds[6];
+  vtkIdType cont = 0, firstElement, lastElement;
 
   this->CalculateROICropVolumeBounds(roiNode, inputVolume, roiBounds);
 
@@ -1200,114 +1626,14 @@ double vtkSlicerAstroVolumeLogic::CalculateDisplayThresholdInROI(vtkMRMLAnnotati
 
   switch (DataType)
     {
-    case VTK_FLOAT:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:mean)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
-        { 
-        int ref  = (int) floor(elemCnt / dims[0]);
-        ref *= dims[0];
-        int x = elemCnt - ref;
-        ref = (int) floor(elemCnt / numSlice);
-        ref *= numSlice;
-        ref = elemCnt - ref;
-        int y = (int) floor(ref / dims[0]);
-        if (x < roiBounds[0] || x > roiBounds[1] ||
-            y < roiBounds[2] || y > roiBounds[3])
-          {
-          continue;
-          }
-        if (FloatIsNaN(*(inFPixel + elemCnt)))
-          {
-          continue;
-          }
-        mean += *(inFPixel + elemCnt);
-        }
-      mean /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
-        {
-        int ref  = (int) floor(elemCnt / dims[0]);
-        ref *= dims[0];
-        int x = elemCnt - ref;
-        ref = (int) floor(elemCnt / numSlice);
-        ref *= numSlice;
-        ref = elemCnt - ref;
-        int y = (int) floor(ref / dims[0]);
-        if (x < roiBounds[0] || x > roiBounds[1] ||
-            y < roiBounds[2] || y > roiBounds[3])
-          {
-          continue;
-          }
-        if (FloatIsNaN(*(inFPixel + elemCnt)))
-          {
-          continue;
-          }
-        noise += (*(inFPixel + elemCnt) - mean) * (*(inFPixel + elemCnt) - mean);
-        }
-      noise = sqrt(noise / cont);
-      break;
-    case VTK_DOUBLE:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:mean)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
-        {
-        int ref  = (int) floor(elemCnt / dims[0]);
-        ref *= dims[0];
-        int x = elemCnt - ref;
-        ref = (int) floor(elemCnt / numSlice);
-        ref *= numSlice;
-        ref = elemCnt - ref;
-        int y = (int) floor(ref / dims[0]);
-        if (x < roiBounds[0] || x > roiBounds[1] ||
-            y < roiBounds[2] || y > roiBounds[3])
-          {
-          continue;
-          }
-        if (DoubleIsNaN(*(inDPixel + elemCnt)))
-          {
-          continue;
-          }
-        mean += *(inDPixel + elemCnt);
-        }
-      mean /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = firstElement; elemCnt < lastElement; elemCnt++)
-        {
-        int ref  = (int) floor(elemCnt / dims[0]);
-        ref *= dims[0];
-        int x = elemCnt - ref;
-        ref = (int) floor(elemCnt / numSlice);
-        ref *= numSlice;
-        ref = elemCnt - ref;
-        int y = (int) floor(ref / dims[0]);
-        if (x < roiBounds[0] || x > roiBounds[1] ||
-            y < roiBounds[2] || y > roiBounds[3])
-          {
-          continue;
-          }
-        if (DoubleIsNaN(*(inDPixel + elemCnt)))
-          {
-          continue;
-          }
-        noise += (*(inDPixel + elemCnt) - mean) * (*(inDPixel + elemCnt) - mean);
-        }
-      noise = sqrt(noise / cont);
-      break;
+    vtkSlicerAstroTemplateMacro(
+      noise = CalculateNoiseInROI(static_cast<VTK_TT*>(inPtr), dims, firstElement,
+                                  lastElement, roiBounds, cont));
     }
 
-  inFPixel = nullptr;
-  inDPixel = nullptr;
-  delete inFPixel;
-  delete inDPixel;
+  cachedNoise->SetNumberOfValues(1);
+  cachedNoise->SetValue(0, noise);
+  this->SetCachedStatistics(inputVolume, "DisplayThresholdInROI", cachedNoise.GetPointer(), roiNode);
 
   inputVolume->SetDisplayThreshold(noise);
 
@@ -1320,76 +1646,511 @@ void vtkSlicerAstroVolumeLogic::CalculateHistogram(vtkMRMLAstroVolumeNode *input
                                                    double binSpacing,
                                                    int numberOfBins)
 {
-  if (!inputVolume || !inputVolume->GetImageData())
+  if (!inputVolume || !histoArray || numberOfBins < 1)
    {
    return;
    }
 
+  histoArray->SetNumberOfValues(numberOfBins);
+  histoArray->FillComponent(0, 0);
+
+  // bins of binSpacing starting from the minimum of the data
+  double DATAMIN = inputVolume->GetDataMin();
+  vtkNew<vtkCollection> histoArrays;
+  histoArrays->AddItem(histoArray);
+  this->CalculateHistograms(inputVolume, histoArrays.GetPointer(), DATAMIN,
+                            DATAMIN + binSpacing * numberOfBins);
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerAstroVolumeLogic::CalculateHistograms(vtkMRMLAstroVolumeNode *inputVolume,
+                                                    vtkCollection *histoArrays,
+                                                    double minimum,
+                                                    double maximum,
+                                                    bool logScale /*= false*/)
+{
+  if (!inputVolume || !inputVolume->GetImageData() || !histoArrays)
+   {
+   return false;
+   }
+
   int *dims = inputVolume->GetImageData()->GetDimensions();
   int numComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
   if (numComponents > 1)
     {
-    vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateHistogram : "
+    vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateHistograms : "
                   "imageData with more than one components.");
-    return;
+    return false;
     }
-  int numElements = dims[0] * dims[1] * dims[2];
-  const int DataType = inputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  float *inFPixel = nullptr;
-  double *inDPixel = nullptr;
-  switch (DataType)
+
+  // the resolutions already in the statistics cache are not computed again
+  std::vector<int> numberOfBins;
+  std::vector<vtkIntArray*> missingArrays;
+  std::vector<std::string> missingKeys;
+  vtkNew<vtkDoubleArray> cachedValues;
+  for (int ii = 0; ii < histoArrays->GetNumberOfItems(); ii++)
     {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateHistogram : "
-                    "attempt to allocate scalars of type not allowed");
-      return;
+    vtkIntArray *histoArray = vtkIntArray::SafeDownCast(histoArrays->GetItemAsObject(ii));
+    if (!histoArray || histoArray->GetNumberOfValues() < 1)
+      {
+      vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateHistograms : "
+                    "the histograms must be vtkIntArray with at least one value.");
+      return false;
+      }
+
+    // one entry for each resolution, replaced when the binning changes
+    std::ostringstream key;
+    key << std::setprecision(17) << "Histogram" << histoArray->GetNumberOfValues()
+        << " " << minimum << " " << maximum << " " << logScale;
+    if (this->GetCachedStatistics(inputVolume, key.str().c_str(), cachedValues.GetPointer()) &&
+        cachedValues->GetNumberOfValues() == histoArray->GetNumberOfValues())
+      {
+      for (vtkIdType binCnt = 0; binCnt < histoArray->GetNumberOfValues(); binCnt++)
+        {
+        histoArray->SetValue(binCnt, static_cast<int>(cachedValues->GetValue(binCnt)));
+        }
+      histoArray->Modified();
+      continue;
+      }
+
+    numberOfBins.push_back(histoArray->GetNumberOfValues());
+    missingArrays.push_back(histoArray);
+    missingKeys.push_back(key.str());
     }
 
-  histoArray->SetNumberOfValues(numberOfBins);
-  for (int histoIndex = 0; histoIndex < histoArray->GetNumberOfValues(); histoIndex++)
+  if (missingArrays.empty())
     {
-    histoArray->SetValue(histoIndex, 0);
+    return true;
     }
 
-  double DATAMIN = StringToDouble(inputVolume->GetAttribute("SlicerAstro.DATAMIN"));
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  const int DataType = inputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
+  void *ptr = inputVolume->GetImageData()->GetScalarPointer();
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   omp_set_num_threads(omp_get_num_procs());
   #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
 
-  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-  #pragma omp parallel for schedule(dynamic)
-  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-  for (int elemCnt = 0; elemCnt < numElements; elemCnt++)
+  if (!vtkSlicerAstroIsTemplateType(DataType))
+    {
+    vtkErrorMacro("vtkSlicerAstroVolumeLogic::CalculateHistograms : "
+                  "attempt to allocate scalars of type not allowed");
+    return false;
+    }
+
+  std::vector<vtkIdType> counts;
+  switch (DataType)
+    {
+    vtkSlicerAstroTemplateMacro(
+      FillHistograms(static_cast<VTK_TT*>(ptr), numElements, minimum, maximum,
+                     logScale, numberOfBins, counts));
+    }
+
+  vtkIdType offset = 0;
+  for (size_t ii = 0; ii < missingArrays.size(); ii++)
     {
-    int histoIndex = 0;
-    switch (DataType)
+    vtkIntArray *histoArray = missingArrays[ii];
+    vtkNew<vtkDoubleArray> values;
+    values->SetNumberOfValues(numberOfBins[ii]);
+    for (int binCnt = 0; binCnt < numberOfBins[ii]; binCnt++)
       {
-      case VTK_FLOAT:
-        if (FloatIsNaN(*(inFPixel + elemCnt)))
-          {
-          continue;
-          }
-        histoIndex = (int) ((*(inFPixel + elemCnt) - DATAMIN) / binSpacing);
-        break;
-      case VTK_DOUBLE:
-        if (DoubleIsNaN(*(inDPixel + elemCnt)))
-          {
-          continue;
-          }
-        histoIndex = (int) ((*(inDPixel + elemCnt) - DATAMIN) / binSpacing);
-        break;
+      histoArray->SetValue(binCnt, static_cast<int>(std::min(counts[offset + binCnt],
+                                                     static_cast<vtkIdType>(VTK_INT_MAX))));
+      values->SetValue(binCnt, histoArray->GetValue(binCnt));
       }
+    offset += numberOfBins[ii];
+    histoArray->Modified();
+    this->SetCachedStatistics(inputVolume, missingKeys[ii].c_str(), values.GetPointer());
+    }
 
-    #pragma omp critical
-    histoArray->SetValue(histoIndex, histoArray->GetValue(histoIndex) + 1);
-  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerAstroVolumeLogic::GetHistogramBinEdge(double minimum, double maximum,
+                                                      int numberOfBins, int bin,
+                                                      bool logScale /*= false*/)
+{
+  if (numberOfBins < 1)
+    {
+    return minimum;
+    }
+
+  // inverse of the bin positions of FillHistograms
+  const double range = maximum - minimum;
+  const double position = static_cast<double>(bin) / numberOfBins;
+  if (!logScale || range <= 0.)
+    {
+    return minimum + position * range;
+    }
+  const double logOffset = range * 1.E-6;
+  return minimum + logOffset * expm1(position * log1p(range / logOffset));
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerAstroVolumeLogic::GetPhysicalScaling(vtkMRMLAstroVolumeNode *volume,
+                                                   double &bscale, double &bzero)
+{
+  bscale = 1.;
+  bzero = 0.;
+  if (!volume || !volume->GetImageData() ||
+      volume->GetImageData()->GetScalarType() != VTK_SHORT)
+    {
+    return;
+    }
+
+  const char *attribute = volume->GetAttribute("SlicerAstro.BSCALE");
+  if (attribute)
+    {
+    bscale = StringToDouble(attribute);
+    }
+  attribute = volume->GetAttribute("SlicerAstro.BZERO");
+  if (attribute)
+    {
+    bzero = StringToDouble(attribute);
+    }
+}
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkSlicerAstroVolumeLogic::GetPhysicalImageData(vtkMRMLAstroVolumeNode *volume)
+{
+  if (!volume || !volume->GetImageData() ||
+      !volume->GetImageData()->GetPointData() ||
+      !volume->GetImageData()->GetPointData()->GetScalars())
+    {
+    return nullptr;
+    }
+
+  vtkImageData *imageData = volume->GetImageData();
+  const int dataType = imageData->GetPointData()->GetScalars()->GetDataType();
+  if (vtkSlicerAstroIsFloatingTemplateType(dataType))
+    {
+    return imageData;
+    }
+  if (dataType != VTK_SHORT)
+    {
+    return nullptr;
+    }
+
+  double bscale = 1., bzero = 0.;
+  vtkSlicerAstroVolumeLogic::GetPhysicalScaling(volume, bscale, bzero);
+  double blank = std::numeric_limits<double>::quiet_NaN();
+  const char *attribute = volume->GetAttribute("SlicerAstro.BLANK");
+  if (attribute && strcmp(attribute, "UNDEFINED"))
+    {
+    blank = StringToDouble(attribute);
+    }
+
+  vtkSmartPointer<vtkImageData> physicalImageData = vtkSmartPointer<vtkImageData>::New();
+  physicalImageData->SetExtent(imageData->GetExtent());
+  physicalImageData->SetOrigin(imageData->GetOrigin());
+  physicalImageData->SetSpacing(imageData->GetSpacing());
+  physicalImageData->AllocateScalars(VTK_FLOAT, 1);
+
+  const vtkIdType numElements = imageData->GetNumberOfPoints();
+  ScaleStoredValues<short>(static_cast<short*>(imageData->GetScalarPointer()), numElements,
+                           bscale, bzero, blank,
+                           static_cast<float*>(physicalImageData->GetScalarPointer()));
+  return physicalImageData;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(vtkMRMLAstroVolumeNode *volume, int dataType)
+{
+  if (!volume || !volume->GetImageData() ||
+      !vtkSlicerAstroIsFloatingTemplateType(dataType))
+    {
+    return false;
+    }
+
+  vtkImageData *imageData = volume->GetImageData();
+  if (!imageData->GetPointData() || !imageData->GetPointData()->GetScalars())
+    {
+    return false;
+    }
+  const int currentDataType = imageData->GetPointData()->GetScalars()->GetDataType();
+  if (currentDataType == VTK_SHORT)
+    {
+    imageData->AllocateScalars(dataType, 1);
+    memset(imageData->GetScalarPointer(), 0,
+           imageData->GetNumberOfPoints() * imageData->GetScalarSize());
+    imageData->Modified();
+    }
+  else if (currentDataType != dataType)
+    {
+    return false;
+    }
+
+  if (currentDataType == dataType)
+    {
+    return true;
+    }
+
+  int wasModifying = volume->StartModify();
+  volume->SetAttribute("SlicerAstro.BITPIX", dataType == VTK_DOUBLE ? "-64" : "-32");
+  volume->SetAttribute("SlicerAstro.BSCALE", "1.");
+  volume->SetAttribute("SlicerAstro.BZERO", "0.");
+  volume->SetAttribute("SlicerAstro.BLANK", "UNDEFINED");
+  volume->EndModify(wasModifying);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+std::string vtkSlicerAstroVolumeLogic::vtkInternal::GetEntryKey(vtkMRMLAstroVolumeNode *volume,
+                                                                const char *key,
+                                                                vtkMRMLNode *regionNode)
+{
+  std::string entryKey = volume->GetID() ? volume->GetID() : "";
+  entryKey += "|";
+  entryKey += key;
+  entryKey += "|";
+  if (regionNode && regionNode->GetID())
+    {
+    entryKey += regionNode->GetID();
+    }
+  return entryKey;
+}
+
+//---------------------------------------------------------------------------
+vtkMTimeType vtkSlicerAstroVolumeLogic::vtkInternal::GetImageMTime(vtkMRMLAstroVolumeNode *volume)
+{
+  vtkImageData *imageData = volume->GetImageData();
+  if (!imageData->GetPointData() || !imageData->GetPointData()->GetScalars())
+    {
+    return imageData->GetMTime();
+    }
+  return std::max(imageData->GetMTime(), imageData->GetPointData()->GetScalars()->GetMTime());
+}
+
+//---------------------------------------------------------------------------
+vtkMTimeType vtkSlicerAstroVolumeLogic::vtkInternal::GetRegionMTime(vtkMRMLNode *regionNode)
+{
+  // the voxels of a mask are painted without modifying the node
+  vtkMRMLVolumeNode *maskVolume = vtkMRMLVolumeNode::SafeDownCast(regionNode);
+  if (!maskVolume || !maskVolume->GetImageData())
+    {
+    return regionNode->GetMTime();
+    }
+  vtkImageData *imageData = maskVolume->GetImageData();
+  vtkMTimeType mTime = std::max(regionNode->GetMTime(), imageData->GetMTime());
+  if (imageData->GetPointData() && imageData->GetPointData()->GetScalars())
+    {
+    mTime = std::max(mTime, imageData->GetPointData()->GetScalars()->GetMTime());
+    }
+  return mTime;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerAstroVolumeLogic::vtkInternal::IsStale(const StatisticsEntry& entry,
+                                                     vtkMRMLAstroVolumeNode *volume)
+{
+  return !volume->GetImageData() ||
+         entry.ImageData != volume->GetImageData() ||
+         entry.ImageMTime != GetImageMTime(volume) ||
+         (entry.HasRegion && (!entry.RegionNode ||
+                              entry.RegionMTime != GetRegionMTime(entry.RegionNode)));
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerAstroVolumeLogic::GetCachedStatistics(vtkMRMLAstroVolumeNode *volume,
+                                                    const char *key,
+                                                    vtkDoubleArray *values,
+                                                    vtkMRMLNode *regionNode /*= nullptr*/)
+{
+  if (!volume || !volume->GetImageData() || !key || !values)
+    {
+    return false;
+    }
+
+  std::map<std::string, vtkInternal::StatisticsEntry>::iterator it =
+    this->Internal->StatisticsCache.find(vtkInternal::GetEntryKey(volume, key, regionNode));
+  if (it == this->Internal->StatisticsCache.end())
+    {
+    return false;
+    }
+
+  // discard the entry if the data, or the region it refers to, changed
+  vtkInternal::StatisticsEntry& entry = it->second;
+  if (entry.RegionNode != regionNode || vtkInternal::IsStale(entry, volume))
+    {
+    this->Internal->StatisticsCache.erase(it);
+    return false;
+    }
+
+  values->SetNumberOfValues(static_cast<vtkIdType>(entry.Values.size()));
+  for (size_t ii = 0; ii < entry.Values.size(); ii++)
+    {
+    values->SetValue(static_cast<vtkIdType>(ii), entry.Values[ii]);
+    }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerAstroVolumeLogic::SetCachedStatistics(vtkMRMLAstroVolumeNode *volume,
+                                                    const char *key,
+                                                    vtkDoubleArray *values,
+                                                    vtkMRMLNode *regionNode /*= nullptr*/)
+{
+  if (!volume || !volume->GetImageData() || !key || !values)
+    {
+    return;
+    }
+
+  // evict the stale entries of the volume and the entries of the same
+  // statistics and region computed with other parameters
+  const std::string entryKey = vtkInternal::GetEntryKey(volume, key, regionNode);
+  const std::string prefix = entryKey.substr(0, entryKey.find('|') + 1);
+  const std::string region = entryKey.substr(entryKey.rfind('|'));
+  const std::string name = std::string(key).substr(0, std::string(key).find(' ')) + " ";
+  std::map<std::string, vtkInternal::StatisticsEntry>::iterator it =
+    this->Internal->StatisticsCache.lower_bound(prefix);
+  while (it != this->Internal->StatisticsCache.end() &&
+         !it->first.compare(0, prefix.size(), prefix))
+    {
+    const std::string& otherKey = it->first;
+    const bool otherParameters = otherKey != entryKey &&
+      !otherKey.compare(prefix.size(), name.size(), name) &&
+      !otherKey.compare(otherKey.rfind('|'), std::string::npos, region);
+    if (otherParameters || vtkInternal::IsStale(it->second, volume))
+      {
+      this->Internal->StatisticsCache.erase(it++);
+      continue;
+      }
+    ++it;
+    }
+
+  vtkInternal::StatisticsEntry& entry = this->Internal->StatisticsCache[entryKey];
+  entry.ImageData = volume->GetImageData();
+  entry.ImageMTime = vtkInternal::GetImageMTime(volume);
+  entry.HasRegion = regionNode != nullptr;
+  entry.RegionNode = regionNode;
+  entry.RegionMTime = regionNode ? vtkInternal::GetRegionMTime(regionNode) : 0;
+  entry.Values.resize(values->GetNumberOfValues());
+  for (vtkIdType ii = 0; ii < values->GetNumberOfValues(); ii++)
+    {
+    entry.Values[ii] = values->GetValue(ii);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerAstroVolumeLogic::ClearStatisticsCache(vtkMRMLAstroVolumeNode *volume /*= nullptr*/)
+{
+  if (!volume)
+    {
+    this->Internal->StatisticsCache.clear();
+    return;
+    }
+
+  std::string prefix = volume->GetID() ? volume->GetID() : "";
+  prefix += "|";
+  std::map<std::string, vtkInternal::StatisticsEntry>::iterator it =
+    this->Internal->StatisticsCache.lower_bound(prefix);
+  while (it != this->Internal->StatisticsCache.end() &&
+         !it->first.compare(0, prefix.size(), prefix))
+    {
+    this->Internal->StatisticsCache.erase(it++);
+    }
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerAstroVolumeLogic::UpdateStatisticsAttributes(vtkMRMLAstroVolumeNode *volume)
+{
+  if (!volume || !volume->GetImageData())
+    {
+    return false;
+    }
+
+  std::ostringstream key;
+  key << "RangeAndNoise " << volume->GetNoiseEstimator() << " " << volume->GetNoiseSampleSize();
+  vtkNew<vtkDoubleArray> values;
+  if (!this->GetCachedStatistics(volume, key.str().c_str(), values.GetPointer()) ||
+      values->GetNumberOfValues() != 3)
+    {
+    int wasModifying = volume->StartModify();
+    bool success = volume->UpdateRangeAttributes() &&
+                   volume->UpdateDisplayThresholdAttributes();
+    volume->EndModify(wasModifying);
+    if (!success)
+      {
+      return false;
+      }
+
+    values->SetNumberOfValues(3);
+    values->SetValue(0, volume->GetDataMin());
+    values->SetValue(1, volume->GetDataMax());
+    values->SetValue(2, volume->GetDisplayThreshold());
+    this->SetCachedStatistics(volume, key.str().c_str(), values.GetPointer());
+    return true;
+    }
+
+  double min_val = values->GetValue(0), max_val = values->GetValue(1);
+
+  int wasModifying = volume->StartModify();
+  volume->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(max_val).c_str());
+  volume->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(min_val).c_str());
+
+  vtkMRMLAstroVolumeDisplayNode* displayNode = volume->GetAstroVolumeDisplayNode();
+  if (displayNode)
+    {
+    int disModify = displayNode->StartModify();
+    displayNode->SetWindowLevel(max_val - min_val, 0.5 * (max_val + min_val));
+    displayNode->SetThreshold(min_val, max_val);
+    displayNode->EndModify(disModify);
+    }
+
+  volume->SetDisplayThreshold(values->GetValue(2));
+  volume->EndModify(wasModifying);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerAstroVolumeLogic::CalculatePercentile(vtkMRMLAstroVolumeNode *inputVolume,
+                                                      double fraction)
+{
+  if (!inputVolume || !inputVolume->GetImageData())
+    {
+    return 0.;
+    }
+
+  const int numberOfBins = 4096;
+  double DATAMIN = inputVolume->GetDataMin();
+  double DATAMAX = inputVolume->GetDataMax();
+
+  vtkNew<vtkIntArray> histoArray;
+  histoArray->SetNumberOfValues(numberOfBins);
+  vtkNew<vtkCollection> histoArrays;
+  histoArrays->AddItem(histoArray.GetPointer());
+  if (!this->CalculateHistograms(inputVolume, histoArrays.GetPointer(), DATAMIN, DATAMAX))
+    {
+    return 0.;
+    }
+
+  double total = 0.;
+  for (int binCnt = 0; binCnt < numberOfBins; binCnt++)
+    {
+    total += histoArray->GetValue(binCnt);
+    }
+  if (total < 1.)
+    {
+    return DATAMIN;
+    }
+
+  // linear interpolation within the bin reaching the fraction
+  const double target = std::min(std::max(fraction, 0.), 1.) * total;
+  const double binSpacing = (DATAMAX - DATAMIN) / numberOfBins;
+  double cumulative = 0.;
+  for (int binCnt = 0; binCnt < numberOfBins; binCnt++)
+    {
+    double counts = histoArray->GetValue(binCnt);
+    if (cumulative + counts >= target && counts > 0.)
+      {
+      return DATAMIN + (binCnt + (target - cumulative) / counts) * binSpacing;
+      }
+    cumulative += counts;
+    }
+
+  return DATAMAX;
 }
 
 //---------------------------------------------------------------------------
@@ -1582,11 +2343,9 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
     }
 
   const int *inputDims = inputVolume->GetImageData()->GetDimensions();
-  const int inputSliceDim = inputDims[0] * inputDims[1];
   const int *referenceDims = referenceVolume->GetImageData()->GetDimensions();
   const int referenceLengthX = referenceDims[0];
   const int referenceLengthY = referenceDims[1];
-  const int referenceSliceDim = referenceDims[0] * referenceDims[1];
   const int inputNumComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
   const int referenceNumComponents = inputVolume->GetImageData()->GetNumberOfScalarComponents();
   if (inputNumComponents > 1 || referenceNumComponents > 1)
@@ -1598,7 +2357,18 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
 
   // Create empty data of spatial dimensions equal to the reference data
   // and of velocity dimension equal to the input volume
-  // (the reprojection takes place only for the spatial axis)
+  // (the reprojection takes place only for the spatial axis).
+  // The scaled int16 cubes are reprojected as float physical values.
+  vtkSmartPointer<vtkImageData> inputImageData =
+    vtkSlicerAstroVolumeLogic::GetPhysicalImageData(inputVolume);
+  if (!inputImageData)
+    {
+    vtkErrorMacro("vtkSlicerAstroVolumeLogic::Reproject : "
+                  "attempt to allocate scalars of type not allowed");
+    return false;
+    }
+  const int DataType = inputImageData->GetScalarType();
+
   vtkNew<vtkImageData> imageDataTemp;
   imageDataTemp->SetDimensions(referenceLengthX, referenceLengthY, inputDims[2]);
   imageDataTemp->SetSpacing(1.,1.,1.);
@@ -1606,30 +2376,13 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
 
   // copy data into the Astro Volume object
   outputVolume->SetAndObserveImageData(imageDataTemp.GetPointer());
+  vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(outputVolume, DataType);
 
-  float *inFPixel = nullptr;
-  float *outFPixel = nullptr;
-  double *inDPixel = nullptr;
-  double *outDPixel = nullptr;
-  const int DataType = inputVolume->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  switch (DataType)
-    {
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outFPixel = static_cast<float*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (inputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      outDPixel = static_cast<double*> (outputVolume->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("Attempt to allocate scalars of type not allowed");
-      return false;
-    }
+  void *inPtr = inputImageData->GetScalarPointer(0,0,0);
+  void *outPtr = outputVolume->GetImageData()->GetScalarPointer(0,0,0);
 
   bool cancel = false;
   int status = 0;
-  const double NaN = sqrt(-1);
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   int numProcs = 0;
@@ -1713,639 +2466,17 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
     return false;
     }
 
-  // Interpolate
-  int numElements = referenceLengthX * referenceLengthY * inputDims[2];
-
-  if (pnode->GetInterpolationOrder() == vtkMRMLAstroReprojectParametersNode::NearestNeighbour)
-    {
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outFPixel, outDPixel, cancel, status)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < numElements; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        int ref  = (int) floor(elemCnt / referenceLengthX);
-        ref *= referenceLengthX;
-        int ii = elemCnt - ref;
-
-        ref = (int) floor(elemCnt / referenceSliceDim);
-        int kk = ref;
-        ref *= referenceSliceDim;
-        ref = elemCnt - ref;
-        int jj = (int) floor(ref / referenceLengthX);
-
-        int x = (int) round(referenceGrid[ii][jj][0]);
-        bool xInside = x > 0 && x < inputDims[0];
-
-        int y = (int) round(referenceGrid[ii][jj][1]);
-        bool yInside = y > 0 && y < inputDims[1];
-
-        if (!xInside || !yInside)
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              *(outFPixel + elemCnt) = NaN;
-              break;
-            case VTK_DOUBLE:
-              *(outDPixel + elemCnt) = NaN;
-              break;
-            }
-          continue;
-          }
-
-        switch (DataType)
-          {
-         case VTK_FLOAT:
-           *(outFPixel + elemCnt) = *(inFPixel + inputSliceDim * kk + inputDims[0] * y + x);
-           break;
-         case VTK_DOUBLE:
-           *(outDPixel + elemCnt) = *(inDPixel + inputSliceDim * kk + inputDims[0] * y + x);
-           break;
-          }
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(10. + (elemCnt / (numElements / (numProcs * 90.))) > status)
-            {
-            status += 10.;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(10. + (elemCnt / (numElements / 90.)) > status)
-          {
-          status += 10.;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
-    }
-  else if (pnode->GetInterpolationOrder() == vtkMRMLAstroReprojectParametersNode::Bilinear)
-    {
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outFPixel, outDPixel, cancel, status)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < numElements; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        int ref  = (int) floor(elemCnt / referenceLengthX);
-        ref *= referenceLengthX;
-        int ii = elemCnt - ref;
-
-        ref = (int) floor(elemCnt / referenceSliceDim);
-        int kk = ref;
-        ref *= referenceSliceDim;
-        ref = elemCnt - ref;
-        int jj = (int) floor(ref / referenceLengthX);
-
-        double x = referenceGrid[ii][jj][0];
-        int x1 = (int) floor(x);
-        bool x1Inside = x1 > 0 && x1 < inputDims[0];
-        int x2 = (int) ceil(x);
-        bool x2Inside = x2 > 0 && x2 < inputDims[0];
-
-        double y = referenceGrid[ii][jj][1];
-        int y1 = (int) floor(y);
-        bool y1Inside = y1 > 0 && y1 < inputDims[1];
-        int y2 = (int) ceil(y);
-        bool y2Inside = y2 > 0 && y2 < inputDims[1];
-
-        if ((!x1Inside && !x2Inside) || (!y1Inside && !y2Inside))
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              *(outFPixel + elemCnt) = NaN;
-              break;
-            case VTK_DOUBLE:
-              *(outDPixel + elemCnt) = NaN;
-              break;
-            }
-          continue;
-          }
-
-        double F11 = 0., F12 = 0., F21 = 0., F22 = 0.;
-
-        if (!x1Inside || !y1Inside)
-          {
-          F11 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F11 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x1);
-              break;
-            case VTK_DOUBLE:
-              F11 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y1Inside)
-          {
-          F21 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F21 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x2);
-              break;
-            case VTK_DOUBLE:
-              F21 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x2);
-              break;
-            }
-          }
-
-        if (!x1Inside || !y2Inside)
-          {
-          F12 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F12 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x1);
-              break;
-            case VTK_DOUBLE:
-              F12 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y2Inside)
-          {
-          F22 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-           case VTK_FLOAT:
-             F22 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x2);
-             break;
-           case VTK_DOUBLE:
-             F22 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x2);
-             break;
-            }
-          }
-
-        double deltax = 1. / (x2 - x1);
-        double x2x = (x2 - x);
-        double xx1 = (x - x1) ;
-        double x2xdeltax = x2x * deltax;
-        double xx1deltax = xx1 * deltax;
-        double F1 = x2xdeltax * F11 + xx1deltax * F21;
-        double F2 = x2xdeltax * F12 + xx1deltax * F22;
-        double deltay = 1. / (y2 - y1);
-
-        switch (DataType)
-          {
-         case VTK_FLOAT:
-           *(outFPixel + elemCnt) =  (y2 - y) * deltay * F1 + (y - y1) * deltay * F2;
-           break;
-         case VTK_DOUBLE:
-           *(outDPixel + elemCnt) =  (y2 - y) * deltay * F1 + (y - y1) * deltay * F2;
-           break;
-          }
+  // Interpolate (the interpolation grid is read-only, the planes can run in parallel)
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(numProcs);
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
 
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(10. + (elemCnt / (numElements / (numProcs * 90.))) > status)
-            {
-            status += 10.;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(10. + (elemCnt / (numElements / 90.)) > status)
-          {
-          status += 10.;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
-    }
-  else if (pnode->GetInterpolationOrder() == vtkMRMLAstroReprojectParametersNode::Bicubic)
+  switch (DataType)
     {
-    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    #pragma omp parallel for schedule(static) shared(pnode, inFPixel, inDPixel, outFPixel, outDPixel, cancel, status)
-    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elemCnt = 0; elemCnt < numElements; elemCnt++)
-      {
-      int stat = pnode->GetStatus();
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      if (stat == -1 && omp_get_thread_num() == 0)
-      #else
-      if (stat == -1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        {
-        cancel = true;
-        }
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp flush (cancel)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-      if (!cancel)
-        {
-        int ref  = (int) floor(elemCnt / referenceLengthX);
-        ref *= referenceLengthX;
-        int ii = elemCnt - ref;
-
-        ref = (int) floor(elemCnt / referenceSliceDim);
-        int kk = ref;
-        ref *= referenceSliceDim;
-        ref = elemCnt - ref;
-        int jj = (int) floor(ref / referenceLengthX);
-
-        double x = referenceGrid[ii][jj][0];
-        int x1 = (int) floor(x) - 1;
-        bool x1Inside = x1 > 0 && x1 < inputDims[0];
-        int x2 = (int) floor(x);
-        bool x2Inside = x2 > 0 && x2 < inputDims[0];
-        int x3 = (int) ceil(x);
-        bool x3Inside = x3 > 0 && x3 < inputDims[0];
-        int x4 = (int) ceil(x) + 1;
-        bool x4Inside = x4 > 0 && x4 < inputDims[0];
-
-        double y = referenceGrid[ii][jj][1];
-        int y1 = (int) floor(y) - 1;
-        bool y1Inside = y1 > 0 && y1 < inputDims[1];
-        int y2 = (int) floor(y);
-        bool y2Inside = y2 > 0 && y2 < inputDims[1];
-        int y3 = (int) ceil(y);
-        bool y3Inside = y3 > 0 && y3 < inputDims[1];
-        int y4 = (int) ceil(y) + 1;
-        bool y4Inside = y4 > 0 && y4 < inputDims[1];
-
-        if ((!x1Inside && !x4Inside) || (!y1Inside && !y4Inside))
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              *(outFPixel + elemCnt) = NaN;
-              break;
-            case VTK_DOUBLE:
-              *(outDPixel + elemCnt) = NaN;
-              break;
-            }
-          continue;
-          }
-
-        double F11 = 0., F12 = 0., F13 = 0., F14 = 0.;
-        double F21 = 0., F22 = 0., F23 = 0., F24 = 0.;
-        double F31 = 0., F32 = 0., F33 = 0., F34 = 0.;
-        double F41 = 0., F42 = 0., F43 = 0., F44 = 0.;
-        if (!x1Inside || !y1Inside)
-          {
-          F11 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F11 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x1);
-              break;
-            case VTK_DOUBLE:
-              F11 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y1Inside)
-          {
-          F21 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F21 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x2);
-              break;
-            case VTK_DOUBLE:
-              F21 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x2);
-              break;
-            }
-          }
-
-        if (!x3Inside || !y1Inside)
-          {
-          F31 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F31 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x3);
-              break;
-            case VTK_DOUBLE:
-              F31 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x3);
-              break;
-            }
-          }
-
-        if (!x4Inside || !y1Inside)
-          {
-          F41 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F41 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y1 + x4);
-              break;
-            case VTK_DOUBLE:
-              F41 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y1 + x4);
-              break;
-            }
-          }
-
-        if (!x1Inside || !y2Inside)
-          {
-          F12 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F12 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x1);
-              break;
-            case VTK_DOUBLE:
-              F12 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y2Inside)
-          {
-          F22 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F22 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x2);
-              break;
-            case VTK_DOUBLE:
-              F22 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x2);
-              break;
-            }
-          }
-
-        if (!x3Inside || !y2Inside)
-          {
-          F32 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F32 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x3);
-              break;
-            case VTK_DOUBLE:
-              F32 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x3);
-              break;
-            }
-          }
-
-        if (!x4Inside || !y2Inside)
-          {
-          F42 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F42 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y2 + x4);
-              break;
-            case VTK_DOUBLE:
-              F42 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y2 + x4);
-              break;
-            }
-          }
-
-        if (!x1Inside || !y3Inside)
-          {
-          F13 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F13 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y3 + x1);
-              break;
-            case VTK_DOUBLE:
-              F13 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y3 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y3Inside)
-          {
-          F23 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F23 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y3 + x2);
-              break;
-            case VTK_DOUBLE:
-              F23 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y3 + x2);
-              break;
-            }
-          }
-
-        if (!x3Inside || !y3Inside)
-          {
-          F33 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F33 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y3 + x3);
-              break;
-            case VTK_DOUBLE:
-              F33 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y3 + x3);
-              break;
-            }
-          }
-
-        if (!x4Inside || !y3Inside)
-          {
-          F43 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F43 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y3 + x4);
-              break;
-            case VTK_DOUBLE:
-              F43 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y3 + x4);
-              break;
-            }
-          }
-
-        if (!x1Inside || !y4Inside)
-          {
-          F14 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F14 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y4 + x1);
-              break;
-            case VTK_DOUBLE:
-              F14 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y4 + x1);
-              break;
-            }
-          }
-
-        if (!x2Inside || !y4Inside)
-          {
-          F24 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F24 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y4 + x2);
-              break;
-            case VTK_DOUBLE:
-              F24 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y4 + x2);
-              break;
-            }
-          }
-
-        if (!x3Inside || !y4Inside)
-          {
-          F34 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F34 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y4 + x3);
-              break;
-            case VTK_DOUBLE:
-              F34 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y4 + x3);
-              break;
-            }
-          }
-
-        if (!x4Inside || !y4Inside)
-          {
-          F44 = NaN;
-          }
-        else
-          {
-          switch (DataType)
-            {
-            case VTK_FLOAT:
-              F44 = *(inFPixel + inputSliceDim * kk + inputDims[0] * y4 + x4);
-              break;
-            case VTK_DOUBLE:
-              F44 = *(inDPixel + inputSliceDim * kk + inputDims[0] * y4 + x4);
-              break;
-            }
-          }
-
-        double deltaY = y - y2;
-
-        double F1 = F12 + 0.5 * deltaY * (F13 - F11 + deltaY * (2. * F11 - 5. * F12 + 4. * F13 - F14 + deltaY * (3. * (F12 - F13) + F14 - F11)));
-        double F2 = F22 + 0.5 * deltaY * (F23 - F21 + deltaY * (2. * F21 - 5. * F22 + 4. * F23 - F24 + deltaY * (3. * (F22 - F23) + F24 - F21)));
-        double F3 = F32 + 0.5 * deltaY * (F33 - F31 + deltaY * (2. * F31 - 5. * F32 + 4. * F33 - F34 + deltaY * (3. * (F32 - F33) + F34 - F31)));
-        double F4 = F42 + 0.5 * deltaY * (F43 - F41 + deltaY * (2. * F41 - 5. * F42 + 4. * F43 - F44 + deltaY * (3. * (F42 - F43) + F44 - F41)));
-
-        double deltaX = x - x2;
-        double F = F2 + 0.5 * deltaX * (F3 - F1 + deltaX * (2. * F1 - 5. * F2 + 4. * F3 - F4 + deltaX * (3. * (F2 - F3) + F4 - F1)));
-
-        switch (DataType)
-          {
-         case VTK_FLOAT:
-           *(outFPixel + elemCnt) = F;
-           break;
-         case VTK_DOUBLE:
-           *(outDPixel + elemCnt) = F;
-           break;
-          }
-
-        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        if (omp_get_thread_num() == 0)
-          {
-          if(10. + (elemCnt / (numElements / (numProcs * 90.))) > status)
-            {
-            status += 10.;
-            pnode->SetStatus(status);
-            }
-          }
-        #else
-        if(10. + (elemCnt / (numElements / 90.)) > status)
-          {
-          status += 10.;
-          pnode->SetStatus(status);
-          }
-        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-        }
-      }
+    vtkSlicerAstroFloatingTemplateMacro(
+      cancel = !InterpolateOnGrid(static_cast<VTK_TT*>(inPtr), static_cast<VTK_TT*>(outPtr),
+                                  inputDims, referenceLengthX, referenceLengthY, referenceGrid,
+                                  pnode->GetInterpolationOrder(), pnode));
     }
 
   gettimeofday(&end, nullptr);
@@ -2356,16 +2487,6 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
   mtime = ((seconds) * 1000 + useconds/1000.0) + 0.5;
   vtkDebugMacro("Reprojection Time : "<<mtime<<" ms.");
 
-  inFPixel = nullptr;
-  outFPixel = nullptr;
-  inDPixel = nullptr;
-  outDPixel = nullptr;
-
-  delete inFPixel;
-  delete outFPixel;
-  delete inDPixel;
-  delete outDPixel;
-
   referenceGrid.clear();
   referenceGrid.shrink_to_fit();
 
@@ -2375,6 +2496,8 @@ bool vtkSlicerAstroVolumeLogic::Reproject(vtkMRMLAstroReprojectParametersNode *p
     return false;
     }
 
+  outputVolume->GetImageData()->Modified();
+
   gettimeofday(&start, nullptr);
 
   int wasModifying = outputVolume->StartModify();
@@ -2411,7 +2534,7 @@ bool vtkSlicerAstroVolumeLogic::synchronizePresetsToVolumeNode(vtkMRMLNode *node
   double min = StringToDouble(node->GetAttribute("SlicerAstro.DATAMIN")) * 2.;
   double noise = StringToDouble(node->GetAttribute("SlicerAstro.DisplayThreshold"));
 
-  if (noise < 0.000000001 || DoubleIsNaN(noise))
+  if (noise < 0.000000001 || isNaN(noise))
     {
     noise = (max - min) / 1000.;
     }
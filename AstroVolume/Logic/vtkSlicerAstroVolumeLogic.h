@@ -29,6 +29,9 @@
 // Slicer includes
 #include <vtkSlicerVolumesLogic.h>
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
 // STD includes
 #include <cstdlib>
 
@@ -41,7 +44,11 @@ class vtkMRMLAstroVolumeNode;
 class vtkMRMLSegmentationNode;
 class vtkMRMLVolumeNode;
 class vtkSegment;
+class vtkCollection;
+class vtkDoubleArray;
+class vtkImageData;
 class vtkIntArray;
+class vtkMRMLNode;
 
 /// \class vtkSlicerAstroVolumeLogic
 /// \brief I/O and color funtions handling for AstroVolumes (FITS files).
@@ -136,6 +143,78 @@ public:
                                   double binSpacing,
                                   int numberOfBins);
 
+  /// Calculate in a single pass several histograms of a astroVolumeNode
+  /// over [minimum, maximum]. histoArrays holds vtkIntArray, each one
+  /// already sized to its number of bins. With logScale the bins are
+  /// spaced logarithmically in (value - minimum) over six decades.
+  /// \return Success flag
+  virtual bool CalculateHistograms(vtkMRMLAstroVolumeNode *Volume,
+                                   vtkCollection *histoArrays,
+                                   double minimum,
+                                   double maximum,
+                                   bool logScale = false);
+
+  /// Lower edge of the bin of a histogram of numberOfBins bins over
+  /// [minimum, maximum] computed by CalculateHistograms
+  static double GetHistogramBinEdge(double minimum, double maximum,
+                                    int numberOfBins, int bin,
+                                    bool logScale = false);
+
+  /// Linear scaling (physical value = bscale * value + bzero) of the
+  /// voxels of a volume: BSCALE and BZERO for the scaled int16 cubes,
+  /// identity for the floating point ones. The display range, threshold
+  /// and noise of a scaled int16 cube are in stored units.
+  static void GetPhysicalScaling(vtkMRMLAstroVolumeNode *volume,
+                                 double &bscale, double &bzero);
+
+  /// Image data of the physical values of a volume, for the processing
+  /// kernels: the image data itself for float and double, a float copy
+  /// (BSCALE * value + BZERO, NaN for BLANK) for the scaled int16 cubes.
+  /// \return nullptr for the other scalar types
+  static vtkSmartPointer<vtkImageData> GetPhysicalImageData(vtkMRMLAstroVolumeNode *volume);
+
+  /// Reallocate the voxels of an output volume cloned from a scaled int16
+  /// cube with the floating point dataType of the physical values, and
+  /// reset its SlicerAstro.BITPIX, BSCALE, BZERO and BLANK attributes.
+  /// Nothing is done if the volume already has dataType.
+  /// \return false if the volume has another floating point type
+  static bool SetPhysicalScalarType(vtkMRMLAstroVolumeNode *volume, int dataType);
+
+  /// Value below which the given fraction (0 to 1) of the voxels lies,
+  /// interpolated in a (cached) histogram of 4096 bins over the data range
+  virtual double CalculatePercentile(vtkMRMLAstroVolumeNode *inputVolume,
+                                     double fraction);
+
+  /// Update the DATAMIN, DATAMAX and DisplayThreshold attributes (and the
+  /// display window) of a volume from the statistics cache. The voxels are
+  /// scanned only if the image data has been modified since the last
+  /// update: the logics writing the voxels through the scalar pointer
+  /// must call Modified on the image data first.
+  bool UpdateStatisticsAttributes(vtkMRMLAstroVolumeNode *volume);
+
+  /// Cache of the statistics derived from the voxels of a volume (noise,
+  /// histograms, percentiles, ...) shared by the modules. An entry is
+  /// identified by the volume, a key and optionally the ROI or mask node
+  /// it refers to. The key is the name of the statistics, followed by its
+  /// parameters after a space: storing an entry evicts the entries of the
+  /// same volume, name and region with other parameters.
+  /// Entries are filled on first request and dropped once the image data,
+  /// or the region node, has been modified or the volume is removed.
+  /// \return true if an up to date entry was found and copied in values
+  bool GetCachedStatistics(vtkMRMLAstroVolumeNode *volume,
+                           const char *key,
+                           vtkDoubleArray *values,
+                           vtkMRMLNode *regionNode = nullptr);
+
+  /// Store an entry of the statistics cache
+  void SetCachedStatistics(vtkMRMLAstroVolumeNode *volume,
+                           const char *key,
+                           vtkDoubleArray *values,
+                           vtkMRMLNode *regionNode = nullptr);
+
+  /// Drop the cached statistics of a volume, or of all the volumes
+  void ClearStatisticsCache(vtkMRMLAstroVolumeNode *volume = nullptr);
+
   /// Reproject an astroVolumeNode over another
   bool Reproject(vtkMRMLAstroReprojectParametersNode *pnode);
 
@@ -164,6 +243,9 @@ protected:
   vtkMRMLScene* PresetsScene;
   bool Init;
 
+  class vtkInternal;
+  vtkInternal* Internal;
+
 private:
 
   vtkSlicerAstroVolumeLogic(const vtkSlicerAstroVolumeLogic&); // Not implemented
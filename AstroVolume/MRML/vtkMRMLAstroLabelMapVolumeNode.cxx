@@ -171,7 +171,7 @@ bool vtkMRMLAstroLabelMapVolumeNode::UpdateRangeAttributes()
 
   this->GetImageData()->Modified();
   int *dims = this->GetImageData()->GetDimensions();
-  int numElements = dims[0] * dims[1] * dims[2];
+  vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
   const int DataType = this->GetImageData()->GetPointData()->GetScalars()->GetDataType();
   double max_val = this->GetImageData()->GetScalarTypeMin(), min_val = this->GetImageData()->GetScalarTypeMax();
   short *inSPixel = nullptr;
@@ -187,7 +187,7 @@ bool vtkMRMLAstroLabelMapVolumeNode::UpdateRangeAttributes()
     #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
     #pragma omp parallel for schedule(static) reduction(max : max_val), reduction(min : min_val)
     #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-    for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
+    for (vtkIdType elementCnt = 0; elementCnt < numElements; elementCnt++)
       {
       if (ShortIsNaN(*(inSPixel + elementCnt)))
         {
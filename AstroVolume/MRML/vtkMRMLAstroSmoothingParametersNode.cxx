@@ -23,6 +23,7 @@
 #include <vtkObjectFactory.h>
 
 // MRML includes
+#include <vtkMRMLAnnotationROINode.h>
 #include <vtkMRMLVolumeNode.h>
 
 // CropModuleMRML includes
@@ -33,6 +34,9 @@
 
 #define SigmatoFWHM 2.3548200450309493
 
+//----------------------------------------------------------------------------
+const char* vtkMRMLAstroSmoothingParametersNode::PREVIEWROI_REFERENCE_ROLE = "PreviewROI";
+
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLAstroSmoothingParametersNode);
 
@@ -54,6 +58,7 @@ vtkMRMLAstroSmoothingParametersNode::vtkMRMLAstroSmoothingParametersNode()
   this->Cores = 0;
   this->Link = false;
   this->AutoRun = false;
+  this->Preview = false;
   this->Accuracy = 20;
   this->TimeStep = 0.0325;
   this->K = 2.;
@@ -63,6 +68,10 @@ vtkMRMLAstroSmoothingParametersNode::vtkMRMLAstroSmoothingParametersNode()
   this->Rx = 0.;
   this->Ry = 0.;
   this->Rz = 0.;
+  this->RecursiveGaussian = false;
+  this->OutOfCore = false;
+  this->MemoryBudget = 4096;
+  this->OutputFileName = NULL;
   this->gaussianKernel3D = vtkSmartPointer<vtkDoubleArray>::New();
   this->gaussianKernel3D->SetNumberOfComponents(1);
   this->gaussianKernel1D = vtkSmartPointer<vtkDoubleArray>::New();
@@ -99,6 +108,35 @@ vtkMRMLAstroSmoothingParametersNode::~vtkMRMLAstroSmoothingParametersNode()
     delete [] this->MasksCommand;
     this->MasksCommand = NULL;
     }
+
+  if (this->OutputFileName)
+    {
+    delete [] this->OutputFileName;
+    this->OutputFileName = NULL;
+    }
+}
+
+//----------------------------------------------------------------------------
+const char *vtkMRMLAstroSmoothingParametersNode::GetPreviewROINodeReferenceRole()
+{
+  return vtkMRMLAstroSmoothingParametersNode::PREVIEWROI_REFERENCE_ROLE;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroSmoothingParametersNode::SetPreviewROINode(vtkMRMLAnnotationROINode* node)
+{
+  this->SetNodeReferenceID(this->GetPreviewROINodeReferenceRole(), (node ? node->GetID() : nullptr));
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLAnnotationROINode *vtkMRMLAstroSmoothingParametersNode::GetPreviewROINode()
+{
+  if (!this->Scene)
+    {
+    return nullptr;
+    }
+
+  return vtkMRMLAnnotationROINode::SafeDownCast(this->GetNodeReference(this->GetPreviewROINodeReferenceRole()));
 }
 
 namespace
@@ -197,6 +235,12 @@ void vtkMRMLAstroSmoothingParametersNode::ReadXMLAttributes(const char** atts)
       continue;
       }
 
+    if (!strcmp(attName, "Preview"))
+      {
+      this->Preview = StringToInt(attValue);
+      continue;
+      }
+
     if (!strcmp(attName, "Rx"))
       {
       this->Rx = StringToInt(attValue);
@@ -215,6 +259,30 @@ void vtkMRMLAstroSmoothingParametersNode::ReadXMLAttributes(const char** atts)
       continue;
       }
 
+    if (!strcmp(attName, "RecursiveGaussian"))
+      {
+      this->RecursiveGaussian = StringToInt(attValue);
+      continue;
+      }
+
+    if (!strcmp(attName, "OutOfCore"))
+      {
+      this->OutOfCore = StringToInt(attValue);
+      continue;
+      }
+
+    if (!strcmp(attName, "MemoryBudget"))
+      {
+      this->MemoryBudget = StringToInt(attValue);
+      continue;
+      }
+
+    if (!strcmp(attName, "OutputFileName"))
+      {
+      this->SetOutputFileName(attValue);
+      continue;
+      }
+
     if (!strcmp(attName, "Status"))
       {
       this->Status = StringToInt(attValue);
@@ -311,9 +379,17 @@ void vtkMRMLAstroSmoothingParametersNode::WriteXML(ostream& of, int nIndent)
   of << indent << " Cores=\"" << this->Cores << "\"";
   of << indent << " Link=\"" << this->Link << "\"";
   of << indent << " AutoRun=\"" << this->AutoRun << "\"";
+  of << indent << " Preview=\"" << this->Preview << "\"";
   of << indent << " Rx=\"" << this->Rx << "\"";
   of << indent << " Ry=\"" << this->Ry << "\"";
   of << indent << " Rz=\"" << this->Rz << "\"";
+  of << indent << " RecursiveGaussian=\"" << this->RecursiveGaussian << "\"";
+  of << indent << " OutOfCore=\"" << this->OutOfCore << "\"";
+  of << indent << " MemoryBudget=\"" << this->MemoryBudget << "\"";
+  if (this->OutputFileName != NULL)
+    {
+    of << indent << " OutputFileName=\"" << this->OutputFileName << "\"";
+    }
   of << indent << " Status=\"" << this->Status << "\"";
   of << indent << " Accuracy=\"" << this->Accuracy << "\"";
   of << indent << " TimeStep=\"" << this->TimeStep << "\"";
@@ -346,9 +422,14 @@ void vtkMRMLAstroSmoothingParametersNode::Copy(vtkMRMLNode *anode)
   this->SetCores(node->GetCores());
   this->SetLink(node->GetLink());
   this->SetAutoRun(node->GetAutoRun());
+  this->SetPreview(node->GetPreview());
   this->SetRx(node->GetRx());
   this->SetRy(node->GetRy());
   this->SetRz(node->GetRz());
+  this->SetRecursiveGaussian(node->GetRecursiveGaussian());
+  this->SetOutOfCore(node->GetOutOfCore());
+  this->SetMemoryBudget(node->GetMemoryBudget());
+  this->SetOutputFileName(node->GetOutputFileName());
   this->SetStatus(node->GetStatus());
   this->SetAccuracy(node->GetAccuracy());
   this->SetK(node->GetK());
@@ -628,6 +709,15 @@ void vtkMRMLAstroSmoothingParametersNode::PrintSelf(ostream& os, vtkIndent inden
     os << indent << "AutoRun: Inactive\n";
     }
 
+  if(this->Preview)
+    {
+    os << indent << "Preview: Active\n";
+    }
+  else
+    {
+    os << indent << "Preview: Inactive\n";
+    }
+
   if(this->Link)
     {
     os << indent << "Link: Active\n";
@@ -637,6 +727,13 @@ void vtkMRMLAstroSmoothingParametersNode::PrintSelf(ostream& os, vtkIndent inden
     os << indent << "Link: Inactive\n";
     }
 
+  if (this->OutOfCore)
+    {
+    os << indent << "OutOfCore: Active\n";
+    os << indent << "MemoryBudget: " << this->MemoryBudget << " MB\n";
+    os << indent << "OutputFileName: " << ( (this->OutputFileName) ? this->OutputFileName : "None" ) << "\n";
+    }
+
   os << indent << "ParameterX: " << this->ParameterX << "\n";
   os << indent << "ParameterY: " << this->ParameterY << "\n";
   os << indent << "ParameterZ: " << this->ParameterZ << "\n";
@@ -653,6 +750,7 @@ void vtkMRMLAstroSmoothingParametersNode::PrintSelf(ostream& os, vtkIndent inden
     os << indent << "Kernel rotation with respect to X: " << this->Rx << "\n";
     os << indent << "Kernel rotation with respect to Y: " << this->Ry << "\n";
     os << indent << "Kernel rotation with respect to Z: " << this->Rz << "\n";
+    os << indent << "RecursiveGaussian: " << (this->RecursiveGaussian ? "Active" : "Inactive") << "\n";
     }
 
   if (this->Filter != 0)
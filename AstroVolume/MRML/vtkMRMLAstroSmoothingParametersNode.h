@@ -27,6 +27,7 @@
 #include <vtkSlicerAstroVolumeModuleMRMLExport.h>
 
 class vtkDoubleArray;
+class vtkMRMLAnnotationROINode;
 
 /// \brief MRML parameter node for the AstroMSmoothing module.
 ///
@@ -112,6 +113,23 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroSmoothingParametersNode : public vtkMRML
   vtkGetMacro(AutoRun,bool);
   vtkBooleanMacro(AutoRun,bool);
 
+  /// Set/Get the Preview.
+  /// If true, the parameter changes are previewed by filtering only
+  /// the voxels of the slices shown in the views, or of the PreviewROINode
+  /// if set (plus the kernel halo), and, with AutoRun, the whole volume
+  /// is filtered once the parameters are settled.
+  /// Default is false
+  /// \sa SetPreview(), GetPreview()
+  vtkSetMacro(Preview,bool);
+  vtkGetMacro(Preview,bool);
+  vtkBooleanMacro(Preview,bool);
+
+  /// Get MRML ROI node of the preview
+  vtkMRMLAnnotationROINode* GetPreviewROINode();
+
+  /// Set MRML ROI node of the preview
+  void SetPreviewROINode(vtkMRMLAnnotationROINode* node);
+
   /// Set/Get the ParameterX.
   /// Default is 5
   /// \sa SetParameterX(), GetParameterX()
@@ -154,6 +172,43 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroSmoothingParametersNode : public vtkMRML
   vtkSetMacro(Rz,double);
   vtkGetMacro(Rz,double);
 
+  /// Set/Get the RecursiveGaussian.
+  /// If true, the CPU Gaussian filters use a recursive (IIR) approximation
+  /// of the Gaussian, whose cost does not depend on the kernel size,
+  /// when the kernel is not rotated and sigma is at least one pixel
+  /// along the smoothed axes. It approximates the kernel: off by default,
+  /// also for the scenes saved without it.
+  /// Default is false
+  /// \sa SetRecursiveGaussian(), GetRecursiveGaussian()
+  vtkSetMacro(RecursiveGaussian,bool);
+  vtkGetMacro(RecursiveGaussian,bool);
+  vtkBooleanMacro(RecursiveGaussian,bool);
+
+  /// Set/Get the OutOfCore.
+  /// If true, Apply smooths the FITS file of the input volume (which can
+  /// be only a preview, or a sub-cube, of the file) slab by slab along the
+  /// spectral axis and writes the result in OutputFileName, without loading
+  /// the whole cube. Only the CPU filters are available.
+  /// Default is false
+  /// \sa SetOutOfCore(), GetOutOfCore()
+  vtkSetMacro(OutOfCore,bool);
+  vtkGetMacro(OutOfCore,bool);
+  vtkBooleanMacro(OutOfCore,bool);
+
+  /// Set/Get the MemoryBudget (MB) of the out of core filtering:
+  /// the slabs are as thick as the budget allows. It also bounds the
+  /// buffers of the FFT convolution of the CPU Gaussian filter, which
+  /// otherwise runs as a direct convolution.
+  /// Default is 4096
+  /// \sa SetMemoryBudget(), GetMemoryBudget()
+  vtkSetMacro(MemoryBudget,int);
+  vtkGetMacro(MemoryBudget,int);
+
+  /// Set/Get the OutputFileName of the out of core filtering.
+  /// \sa SetOutputFileName(), GetOutputFileName()
+  vtkSetStringMacro(OutputFileName);
+  vtkGetStringMacro(OutputFileName);
+
   /// Set/Get the Status.
   /// \sa SetStatus(), GetStatus()
   vtkSetMacro(Status,int);
@@ -208,6 +263,9 @@ protected:
   vtkMRMLAstroSmoothingParametersNode(const vtkMRMLAstroSmoothingParametersNode&);
   void operator=(const vtkMRMLAstroSmoothingParametersNode&);
 
+  static const char* PREVIEWROI_REFERENCE_ROLE;
+  const char *GetPreviewROINodeReferenceRole();
+
   char *InputVolumeNodeID;
   char *OutputVolumeNodeID;
   char *Mode;
@@ -226,6 +284,7 @@ protected:
 
   bool Link;
   bool AutoRun;
+  bool Preview;
 
   int Accuracy;
   int Status;
@@ -234,6 +293,12 @@ protected:
   double Ry;
   double Rz;
 
+  bool RecursiveGaussian;
+
+  bool OutOfCore;
+  int MemoryBudget;
+  char *OutputFileName;
+
   double K;
   double TimeStep;
 
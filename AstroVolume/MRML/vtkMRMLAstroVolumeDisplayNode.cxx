@@ -26,6 +26,7 @@
 // MRML includes
 #include <vtkMRMLAstroLabelMapVolumeDisplayNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
 #include <vtkMRMLColorNode.h>
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
@@ -1161,6 +1162,15 @@ std::string vtkMRMLAstroVolumeDisplayNode::GetPixelString(double *ijk)
     return s.c_str();
     }
 
+  // the typed BUNIT of the astro volume avoids a lookup per component
+  vtkMRMLAstroVolumeNode* astroVolumeNode = vtkMRMLAstroVolumeNode::SafeDownCast(this->GetVolumeNode());
+  const char* bunit = astroVolumeNode ? astroVolumeNode->GetDataUnit() :
+                                        this->GetVolumeNode()->GetAttribute("SlicerAstro.BUNIT");
+  if (!bunit)
+    {
+    bunit = "";
+    }
+
   std::string pixel;
   std::string type = this->GetVolumeNode()->GetAttribute("SlicerAstro.DATAMODEL");
   size_t found = type.find("MOMENTMAP");
@@ -1169,7 +1179,7 @@ std::string vtkMRMLAstroVolumeDisplayNode::GetPixelString(double *ijk)
     double component = this->GetVolumeNode()->GetImageData()->
         GetScalarComponentAsDouble(ijk[0],ijk[1],ijk[2],0);
 
-    pixel = DoubleToString(component) + " " + this->GetVolumeNode()->GetAttribute("SlicerAstro.BUNIT") +
+    pixel = DoubleToString(component) + " " + bunit +
             " " + this->GetVolumeNode()->GetAttribute("SlicerAstro.BTYPE");
     }
   else
@@ -1179,7 +1189,7 @@ std::string vtkMRMLAstroVolumeDisplayNode::GetPixelString(double *ijk)
       double component = this->GetVolumeNode()->GetImageData()->
           GetScalarComponentAsDouble(ijk[0], ijk[1], ijk[2], ii);
 
-      pixel += DoubleToString(component) + "  " + this->GetVolumeNode()->GetAttribute("SlicerAstro.BUNIT");
+      pixel += DoubleToString(component) + "  " + bunit;
       pixel += ",";
       }
 
@@ -18,9 +18,13 @@
 ==============================================================================*/
 
 // STD includes
+#include <algorithm>
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <math.h>
+#include <vector>
 
 // VTK includes
 #include <vtkImageData.h>
@@ -59,6 +63,28 @@ vtkMRMLNodeNewMacro(vtkMRMLAstroVolumeNode);
 //----------------------------------------------------------------------------
 vtkMRMLAstroVolumeNode::vtkMRMLAstroVolumeNode()
 {
+  this->StatisticsRange[0] = 0.;
+  this->StatisticsRange[1] = 0.;
+  this->StatisticsMean = 0.;
+  this->StatisticsStandardDeviation = 0.;
+  this->StatisticsNaNCount = 0;
+  this->StatisticsNoise = 0.;
+  this->StatisticsMTime = 0;
+  this->StatisticsNoiseOnly = false;
+  this->NoiseEstimator = vtkMRMLAstroVolumeNode::SlabNoiseEstimator;
+  this->NoiseSampleSize = 1 << 18;
+  this->AstroMetadataMTime = 0;
+  this->AstroMetadataValid = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::SetAttribute(const char *name, const char *value)
+{
+  this->Superclass::SetAttribute(name, value);
+  if (name && !strncmp(name, "SlicerAstro.", 12))
+    {
+    this->InvalidateAstroMetadata();
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -117,6 +143,14 @@ template <typename T> T StringToNumber(const char* num)
   return ss >> result ? result : 0;
 }
 
+//----------------------------------------------------------------------------
+// 0 for missing or UNDEFINED keywords
+template <typename T> T AttributeToNumber(vtkMRMLNode* node, const char* key)
+{
+  const char* value = node->GetAttribute(key);
+  return value ? StringToNumber<T>(value) : 0;
+}
+
 //----------------------------------------------------------------------------
 int StringToInt(const char* str)
 {
@@ -130,27 +164,245 @@ double StringToDouble(const char* str)
 }
 
 //----------------------------------------------------------------------------
-template <typename T> bool isNaN(T value)
+// Running statistics of a set of voxels. Partial results are merged
+// with the pairwise update of Chan et al.
+struct VoxelStatistics
+{
+  double Min;
+  double Max;
+  double Mean;
+  double M2;
+  vtkIdType Count;
+  vtkIdType NaNCount;
+
+  VoxelStatistics()
+    {
+    this->Min = std::numeric_limits<double>::infinity();
+    this->Max = -std::numeric_limits<double>::infinity();
+    this->Mean = 0.;
+    this->M2 = 0.;
+    this->Count = 0;
+    this->NaNCount = 0;
+    }
+
+  void Merge(const VoxelStatistics& other)
+    {
+    this->NaNCount += other.NaNCount;
+    if (other.Count == 0)
+      {
+      return;
+      }
+    this->Min = std::min(this->Min, other.Min);
+    this->Max = std::max(this->Max, other.Max);
+    const vtkIdType count = this->Count + other.Count;
+    const double delta = other.Mean - this->Mean;
+    this->Mean += delta * other.Count / count;
+    this->M2 += other.M2 + delta * delta * this->Count / count * other.Count;
+    this->Count = count;
+    }
+
+  double StandardDeviation() const
+    {
+    return this->Count > 0 ? sqrt(this->M2 / this->Count) : 0.;
+    }
+};
+
+//----------------------------------------------------------------------------
+// Statistics of the voxels [begin, end). The voxels are processed in
+// blocks small enough to stay in cache: the two passes over a block
+// (sum then squared deviations) are branchless and vectorize, and the
+// blocks are merged pairwise. NaN and blank voxels are not counted.
+template <typename T>
+VoxelStatistics AccumulateStatistics(const T *ptr, vtkIdType begin, vtkIdType end,
+                                     double blank)
 {
-  return value != value;
+  const vtkIdType blockSize = 4096;
+  const vtkIdType numberOfBlocks = (end - begin + blockSize - 1) / blockSize;
+  VoxelStatistics total;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  {
+  VoxelStatistics local;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType blockCnt = 0; blockCnt < numberOfBlocks; blockCnt++)
+    {
+    const T *block = ptr + begin + blockCnt * blockSize;
+    const vtkIdType size = std::min(blockSize, end - begin - blockCnt * blockSize);
+
+    double sum = 0., min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    vtkIdType count = 0;
+    for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+      {
+      const double value = block[elemCnt];
+      const bool valid = value == value && value != blank;
+      sum += valid ? value : 0.;
+      min = valid && value < min ? value : min;
+      max = valid && value > max ? value : max;
+      count += valid;
+      }
+
+    VoxelStatistics blockStatistics;
+    blockStatistics.NaNCount = size - count;
+    if (count > 0)
+      {
+      const double mean = sum / count;
+      double m2 = 0.;
+      for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+        {
+        const double value = block[elemCnt];
+        const double delta = value == value && value != blank ? value - mean : 0.;
+        m2 += delta * delta;
+        }
+      blockStatistics.Min = min;
+      blockStatistics.Max = max;
+      blockStatistics.Mean = mean;
+      blockStatistics.M2 = m2;
+      blockStatistics.Count = count;
+      }
+    local.Merge(blockStatistics);
+    }
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp critical
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  total.Merge(local);
+  }
+
+  return total;
 }
 
 //----------------------------------------------------------------------------
-bool DoubleIsNaN(double Value)
+// Stored value flagging the undefined voxels of scaled int16 cubes
+// (the floating point cubes use NaN).
+double BlankValue(vtkMRMLAstroVolumeNode *volumeNode, int dataType)
 {
-  return isNaN<double>(Value);
+  const char *blank = volumeNode->GetAttribute("SlicerAstro.BLANK");
+  if (dataType != VTK_SHORT || !blank || !strcmp(blank, "UNDEFINED"))
+    {
+    return std::numeric_limits<double>::quiet_NaN();
+    }
+  return StringToDouble(blank);
 }
 
 //----------------------------------------------------------------------------
-bool FloatIsNaN(float Value)
+// Stateless pseudo-random generator (splitmix64): the sample only
+// depends on the stratum index and is identical for any thread count.
+vtkTypeUInt64 SampleHash(vtkTypeUInt64 value)
 {
-  return isNaN<float>(Value);
+  value += 0x9E3779B97F4A7C15ULL;
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
 }
 
 //----------------------------------------------------------------------------
-bool ShortIsNaN(short Value)
+// One voxel at a random position in each of numberOfStrata equal
+// slices of the cube. NaN and blank voxels are left out of the sample.
+template <typename T>
+void DrawStratifiedSample(const T *ptr, vtkIdType numElements,
+                          vtkIdType numberOfStrata, double blank,
+                          std::vector<double>& sample)
 {
-  return isNaN<short>(Value);
+  std::vector<double> values(numberOfStrata);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType stratum = 0; stratum < numberOfStrata; stratum++)
+    {
+    const vtkIdType begin = static_cast<vtkIdType>(static_cast<double>(stratum) * numElements / numberOfStrata);
+    const vtkIdType end = static_cast<vtkIdType>(static_cast<double>(stratum + 1) * numElements / numberOfStrata);
+    const vtkIdType size = std::max(static_cast<vtkIdType>(1), end - begin);
+    const vtkIdType offset = static_cast<vtkIdType>(SampleHash(stratum) % static_cast<vtkTypeUInt64>(size));
+    values[stratum] = ptr[std::min(begin + offset, numElements - 1)];
+    }
+
+  sample.clear();
+  sample.reserve(numberOfStrata);
+  for (vtkIdType stratum = 0; stratum < numberOfStrata; stratum++)
+    {
+    if (values[stratum] == values[stratum] && values[stratum] != blank)
+      {
+      sample.push_back(values[stratum]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+double Median(std::vector<double> values)
+{
+  if (values.empty())
+    {
+    return 0.;
+    }
+  std::vector<double>::iterator middle = values.begin() + values.size() / 2;
+  std::nth_element(values.begin(), middle, values.end());
+  return *middle;
+}
+
+//----------------------------------------------------------------------------
+// Median absolute deviation, scaled to the standard deviation of a Gaussian
+double MADNoise(const std::vector<double>& sample, double median)
+{
+  std::vector<double> deviations(sample.size());
+  const vtkIdType size = static_cast<vtkIdType>(sample.size());
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp parallel for schedule(static)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+    {
+    deviations[elemCnt] = fabs(sample[elemCnt] - median);
+    }
+
+  return 1.4826 * Median(deviations);
+}
+
+//----------------------------------------------------------------------------
+// rms around the median of the values within 3 sigma, iterated
+// until it converges
+double SigmaClippedNoise(const std::vector<double>& sample, double median, double sigma)
+{
+  const vtkIdType size = static_cast<vtkIdType>(sample.size());
+  for (int iteration = 0; iteration < 20 && sigma > 0.; iteration++)
+    {
+    const double clip = 3. * sigma;
+    double sum = 0.;
+    vtkIdType count = 0;
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp parallel for schedule(static) reduction(+:sum,count)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    for (vtkIdType elemCnt = 0; elemCnt < size; elemCnt++)
+      {
+      const double delta = sample[elemCnt] - median;
+      if (fabs(delta) < clip)
+        {
+        sum += delta * delta;
+        count++;
+        }
+      }
+
+    if (count == 0)
+      {
+      break;
+      }
+    const double newSigma = sqrt(sum / count);
+    const bool converged = fabs(newSigma - sigma) <= 1.E-3 * sigma;
+    sigma = newSigma;
+    if (converged)
+      {
+      break;
+      }
+    }
+
+  return sigma;
 }
 
 }// end namespace
@@ -158,13 +410,44 @@ bool ShortIsNaN(short Value)
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeNode::ReadXMLAttributes(const char** atts)
 {
+  int disabledModify = this->StartModify();
+
   this->Superclass::ReadXMLAttributes(atts);
+
+  const char* attName;
+  const char* attValue;
+
+  while (*atts != nullptr)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+
+    if (!strcmp(attName, "noiseEstimator"))
+      {
+      this->SetNoiseEstimator(StringToInt(attValue));
+      continue;
+      }
+
+    if (!strcmp(attName, "noiseSampleSize"))
+      {
+      this->SetNoiseSampleSize(StringToNumber<vtkIdType>(attValue));
+      continue;
+      }
+    }
+
+  this->InvalidateAstroMetadata();
+  this->EndModify(disabledModify);
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeNode::WriteXML(ostream& of, int nIndent)
 {
   this->Superclass::WriteXML(of, nIndent);
+
+  vtkIndent indent(nIndent);
+
+  of << indent << " noiseEstimator=\"" << this->NoiseEstimator << "\"";
+  of << indent << " noiseSampleSize=\"" << this->NoiseSampleSize << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -177,12 +460,25 @@ void vtkMRMLAstroVolumeNode::Copy(vtkMRMLNode *anode)
     }
 
   this->Superclass::Copy(astroVolumeNode);
+  this->InvalidateAstroMetadata();
+
+  this->SetNoiseEstimator(astroVolumeNode->GetNoiseEstimator());
+  this->SetNoiseSampleSize(astroVolumeNode->GetNoiseSampleSize());
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+
+  os << indent << "StatisticsRange:   " << this->StatisticsRange[0] << " "
+     << this->StatisticsRange[1] << "\n";
+  os << indent << "StatisticsMean:   " << this->StatisticsMean << "\n";
+  os << indent << "StatisticsStandardDeviation:   " << this->StatisticsStandardDeviation << "\n";
+  os << indent << "StatisticsNaNCount:   " << this->StatisticsNaNCount << "\n";
+  os << indent << "StatisticsNoise:   " << this->StatisticsNoise << "\n";
+  os << indent << "NoiseEstimator:   " << this->NoiseEstimator << "\n";
+  os << indent << "NoiseSampleSize:   " << this->NoiseSampleSize << "\n";
 }
 
 //---------------------------------------------------------------------------
@@ -205,90 +501,15 @@ bool vtkMRMLAstroVolumeNode::UpdateRangeAttributes()
    return false;
    }
 
-  this->GetImageData()->Modified();
-  int *dims = this->GetImageData()->GetDimensions();
-  int numElements = dims[0] * dims[1] * dims[2];
-  const int DataType = this->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  double max_val = this->GetImageData()->GetScalarTypeMin(), min_val = this->GetImageData()->GetScalarTypeMax();
-  short *inSPixel = nullptr;
-  float *inFPixel = nullptr;
-  double *inDPixel = nullptr;
-
-  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-  omp_set_num_threads(omp_get_num_procs());
-  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-
-  switch (DataType)
+  // the statistics are cached: the callers writing the voxels through
+  // the scalar pointer mark the image data as modified
+  if (!this->UpdateStatistics())
     {
-    case VTK_SHORT:
-      inSPixel = static_cast<short*> (this->GetImageData()->GetScalarPointer());
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(max : max_val), reduction(min : min_val)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
-        {
-        if (ShortIsNaN(*(inSPixel + elementCnt)))
-          {
-          continue;
-          }
-        if (*(inSPixel + elementCnt) > max_val)
-          {
-          max_val = *(inSPixel + elementCnt);
-          }
-        if (*(inSPixel + elementCnt) < min_val)
-          {
-          min_val = *(inSPixel + elementCnt);
-          }
-        }
-    break;
-    case VTK_FLOAT:
-      inFPixel = static_cast<float*> (this->GetImageData()->GetScalarPointer());
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(max : max_val), reduction(min : min_val)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
-        {
-        if (FloatIsNaN(*(inFPixel + elementCnt)))
-          {
-          continue;
-          }
-        if (*(inFPixel + elementCnt) > max_val)
-          {
-          max_val = *(inFPixel + elementCnt);
-          }
-        if (*(inFPixel + elementCnt) < min_val)
-          {
-          min_val = *(inFPixel + elementCnt);
-          }
-        }
-      break;
-    case VTK_DOUBLE:
-      inDPixel = static_cast<double*> (this->GetImageData()->GetScalarPointer());
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(max : max_val), reduction(min : min_val)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elementCnt = 0; elementCnt < numElements; elementCnt++)
-        {
-        if (DoubleIsNaN(*(inDPixel + elementCnt)))
-          {
-          continue;
-          }
-        if (*(inDPixel + elementCnt) > max_val)
-          {
-          max_val = *(inDPixel + elementCnt);
-          }
-        if (*(inDPixel + elementCnt) < min_val)
-          {
-          min_val = *(inDPixel + elementCnt);
-          }
-        }
-      break;
-    default:
-      vtkErrorMacro("vtkSlicerAstroVolumeLogic::UpdateRangeAttributes : "
-                    "attempt to allocate scalars of type not allowed");
-      return false;
+    return false;
     }
 
+  double min_val = this->StatisticsRange[0], max_val = this->StatisticsRange[1];
+
   int wasModifying = this->StartModify();
   this->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(max_val).c_str());
   this->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(min_val).c_str());
@@ -306,18 +527,17 @@ bool vtkMRMLAstroVolumeNode::UpdateRangeAttributes()
 
   this->EndModify(wasModifying);
 
-  inSPixel = nullptr;
-  inFPixel = nullptr;
-  inDPixel = nullptr;
-  delete inSPixel;
-  delete inFPixel;
-  delete inDPixel;
-
   return true;
 }
 
 //---------------------------------------------------------------------------
 bool vtkMRMLAstroVolumeNode::UpdateDisplayThresholdAttributes()
+{
+  return this->UpdateDisplayThresholdAttributes(this->NoiseEstimator);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::UpdateDisplayThresholdAttributes(int noiseEstimator)
 {
   if (!this->GetImageData())
    {
@@ -327,258 +547,207 @@ bool vtkMRMLAstroVolumeNode::UpdateDisplayThresholdAttributes()
   // Calculate the noise as the std of 6 slices of the datacube.
   // The DisplayThreshold = noise
   // 3D color function starts from 3 times the value of DisplayThreshold.
-  int *dims = this->GetImageData()->GetDimensions();
-  const int DataType = this->GetImageData()->GetPointData()->GetScalars()->GetDataType();
-  short *outSPixel = nullptr;
-  float *outFPixel = nullptr;
-  double *outDPixel = nullptr;
-  switch (DataType)
+  // If the range has just been computed the noise comes for free,
+  // otherwise only the slices used for the noise are visited.
+  // The robust estimators use instead a sample of the whole cube.
+  double noise = 0.;
+  if (noiseEstimator != vtkMRMLAstroVolumeNode::SlabNoiseEstimator)
     {
-    case VTK_SHORT:
-      outSPixel = static_cast<short*> (this->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_FLOAT:
-      outFPixel = static_cast<float*> (this->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    case VTK_DOUBLE:
-      outDPixel = static_cast<double*> (this->GetImageData()->GetScalarPointer(0,0,0));
-      break;
-    default:
-      vtkErrorMacro("vtkMRMLAstroVolumeNode::UpdateDisplayThresholdAttributes : "
-                    "attempt to allocate scalars of type not allowed");
+    if (!this->EstimateRobustNoise(noise, noiseEstimator))
+      {
       return false;
+      }
     }
-  double sum = 0., noise1 = 0., noise2 = 0, noise = 0.;
-  int lowBoundary;
-  int highBoundary;
-
-  if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 3)
+  else if (this->ComputeStatistics(true))
     {
-    lowBoundary = dims[0] * dims[1] * 2;
-    highBoundary = dims[0] * dims[1] * 4;
+    noise = this->StatisticsNoise;
     }
-  else if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 2)
+  else
     {
-    lowBoundary = dims[0] * 2;
-    highBoundary = dims[0] * 4;
+    return false;
     }
-  else
+
+  if (noise < 1.E-6)
     {
-    lowBoundary = 2;
-    highBoundary = 4;
+    double MAX = StringToDouble(this->GetAttribute("SlicerAstro.DATAMAX"));
+    double MIN = StringToDouble(this->GetAttribute("SlicerAstro.DATAMIN"));
+    noise = (MAX - MIN) * 0.01;
     }
 
-  int cont = highBoundary - lowBoundary;
+  this->SetDisplayThreshold(noise);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::EstimateRobustNoise(double& noise, int noiseEstimator)
+{
+  vtkImageData *imageData = this->GetImageData();
+  if (!imageData || !imageData->GetPointData() || !imageData->GetPointData()->GetScalars())
+    {
+    return false;
+    }
+
+  int *dims = imageData->GetDimensions();
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  if (numElements < 1)
+    {
+    return false;
+    }
+  const vtkIdType numberOfStrata =
+    std::min(numElements, std::max(static_cast<vtkIdType>(1), this->NoiseSampleSize));
 
   #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
   omp_set_num_threads(omp_get_num_procs());
   #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
 
+  std::vector<double> sample;
+  void *ptr = imageData->GetScalarPointer();
+  const int DataType = imageData->GetPointData()->GetScalars()->GetDataType();
+  const double blank = BlankValue(this, DataType);
   switch (DataType)
     {
     case VTK_SHORT:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (ShortIsNaN(*(outSPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outSPixel + elemCnt);
-        }
-      sum /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (ShortIsNaN(*(outSPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise1 += (*(outSPixel + elemCnt) - sum) * (*(outSPixel + elemCnt) - sum);
-        }
-      noise1 = sqrt(noise1 / cont);
+      DrawStratifiedSample<short>(static_cast<short*>(ptr), numElements, numberOfStrata, blank, sample);
       break;
     case VTK_FLOAT:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (FloatIsNaN(*(outFPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outFPixel + elemCnt);
-        }
-      sum /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (FloatIsNaN(*(outFPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise1 += (*(outFPixel + elemCnt) - sum) * (*(outFPixel + elemCnt) - sum);
-        }
-      noise1 = sqrt(noise1 / cont);
+      DrawStratifiedSample<float>(static_cast<float*>(ptr), numElements, numberOfStrata, blank, sample);
       break;
     case VTK_DOUBLE:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (DoubleIsNaN(*(outDPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outDPixel + elemCnt);
-        }
-      sum /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise1)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (DoubleIsNaN(*(outDPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise1 += (*(outDPixel + elemCnt) - sum) * (*(outDPixel + elemCnt) - sum);
-        }
-      noise1 = sqrt(noise1 / cont);
+      DrawStratifiedSample<double>(static_cast<double*>(ptr), numElements, numberOfStrata, blank, sample);
       break;
+    default:
+      vtkErrorMacro("vtkMRMLAstroVolumeNode::EstimateRobustNoise : "
+                    "attempt to allocate scalars of type not allowed");
+      return false;
     }
 
-  if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 3)
+  noise = vtkMRMLAstroVolumeNode::GetRobustNoise(sample, noiseEstimator);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetRobustNoise(const std::vector<double>& sample,
+                                              int noiseEstimator)
+{
+  const double median = Median(sample);
+  double noise = MADNoise(sample, median);
+  if (noiseEstimator == vtkMRMLAstroVolumeNode::SigmaClippedNoiseEstimator)
     {
-    lowBoundary = dims[0] * dims[1] * (dims[2] - 4);
-    highBoundary = dims[0] * dims[1] * (dims[2] - 2);
+    noise = SigmaClippedNoise(sample, median, noise);
     }
-  else if (StringToInt(this->GetAttribute("SlicerAstro.NAXIS")) == 2)
+
+  return noise;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::UpdateStatistics()
+{
+  return this->ComputeStatistics(false);
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::ComputeStatistics(bool noiseOnly)
+{
+  vtkImageData *imageData = this->GetImageData();
+  if (!imageData || !imageData->GetPointData() || !imageData->GetPointData()->GetScalars())
     {
-    lowBoundary = dims[0] * (dims[1] - 4);
-    highBoundary = dims[0] * (dims[1] - 2);
+    return false;
     }
-  else
+
+  vtkMTimeType mTime = std::max(imageData->GetMTime(),
+                                imageData->GetPointData()->GetScalars()->GetMTime());
+  if (this->StatisticsImageData == imageData && this->StatisticsMTime == mTime &&
+      (noiseOnly || !this->StatisticsNoiseOnly))
     {
-    lowBoundary = dims[0] - 4;
-    highBoundary = dims[0] - 2;
+    return true;
     }
 
-  sum = 0.;
-
-  switch (DataType)
+  int *dims = imageData->GetDimensions();
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  const int DataType = imageData->GetPointData()->GetScalars()->GetDataType();
+  const double blank = BlankValue(this, DataType);
+  void *ptr = imageData->GetScalarPointer();
+
+  // the noise is measured on two slabs of two slices (rows for 2D data)
+  // at both ends of the cube
+  const int naxis = StringToInt(this->GetAttribute("SlicerAstro.NAXIS"));
+  vtkIdType slice = 1, numberOfSlices = dims[0];
+  if (naxis == 3)
     {
-    case VTK_SHORT:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (ShortIsNaN(*(outSPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outSPixel + elemCnt);
-        }
-      sum /= cont;
-
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise2)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (ShortIsNaN(*(outSPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise2 += (*(outSPixel + elemCnt) - sum) * (*(outSPixel + elemCnt) - sum);
-        }
-      noise2 = sqrt(noise2 / cont);
-      break;
-    case VTK_FLOAT:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (FloatIsNaN(*(outFPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outFPixel + elemCnt);
-        }
-      sum /= cont;
+    slice = static_cast<vtkIdType>(dims[0]) * dims[1];
+    numberOfSlices = dims[2];
+    }
+  else if (naxis == 2)
+    {
+    slice = dims[0];
+    numberOfSlices = dims[1];
+    }
+  vtkIdType bounds[6] = {0,
+                         2 * slice, 4 * slice,
+                         (numberOfSlices - 4) * slice, (numberOfSlices - 2) * slice,
+                         numElements};
+  for (int ii = 1; ii < 6; ii++)
+    {
+    bounds[ii] = std::min(std::max(bounds[ii], bounds[ii - 1]), numElements);
+    }
 
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise2)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (FloatIsNaN(*(outFPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise2 += (*(outFPixel + elemCnt) - sum) * (*(outFPixel + elemCnt) - sum);
-        }
-      noise2 = sqrt(noise2 / cont);
-      break;
-    case VTK_DOUBLE:
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:sum)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (DoubleIsNaN(*(outDPixel + elemCnt)))
-           {
-           continue;
-           }
-        sum += *(outDPixel + elemCnt);
-        }
-      sum /= cont;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
 
-      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      #pragma omp parallel for schedule(static) reduction(+:noise2)
-      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
-      for (int elemCnt = lowBoundary; elemCnt <= highBoundary; elemCnt++)
-        {
-        if (DoubleIsNaN(*(outDPixel + elemCnt)))
-           {
-           continue;
-           }
-        noise2 += (*(outDPixel + elemCnt) - sum) * (*(outDPixel + elemCnt) - sum);
-        }
-      noise2 = sqrt(noise2 / cont);
-      break;
-    }
+  // segments 1 and 3 are the noise slabs
+  VoxelStatistics total, slabs[2];
+  for (int segment = 0; segment < 5; segment++)
+    {
+    const bool slab = segment == 1 || segment == 3;
+    if (noiseOnly && !slab)
+      {
+      continue;
+      }
 
-  noise = (noise1 + noise2) * 0.5;
+    VoxelStatistics segmentStatistics;
+    switch (DataType)
+      {
+      case VTK_SHORT:
+        segmentStatistics = AccumulateStatistics<short>
+          (static_cast<short*>(ptr), bounds[segment], bounds[segment + 1], blank);
+        break;
+      case VTK_FLOAT:
+        segmentStatistics = AccumulateStatistics<float>
+          (static_cast<float*>(ptr), bounds[segment], bounds[segment + 1], blank);
+        break;
+      case VTK_DOUBLE:
+        segmentStatistics = AccumulateStatistics<double>
+          (static_cast<double*>(ptr), bounds[segment], bounds[segment + 1], blank);
+        break;
+      default:
+        vtkErrorMacro("vtkMRMLAstroVolumeNode::ComputeStatistics : "
+                      "attempt to allocate scalars of type not allowed");
+        return false;
+      }
 
-  outSPixel = nullptr;
-  outFPixel = nullptr;
-  outDPixel = nullptr;
-  delete outSPixel;
-  delete outFPixel;
-  delete outDPixel;
+    if (slab)
+      {
+      slabs[segment / 2] = segmentStatistics;
+      }
+    total.Merge(segmentStatistics);
+    }
 
-  if (noise < 1.E-6)
+  this->StatisticsNoise = (slabs[0].StandardDeviation() + slabs[1].StandardDeviation()) * 0.5;
+  if (!noiseOnly)
     {
-    double MAX = StringToDouble(this->GetAttribute("SlicerAstro.DATAMAX"));
-    double MIN = StringToDouble(this->GetAttribute("SlicerAstro.DATAMIN"));
-    noise = (MAX - MIN) * 0.01;
+    this->StatisticsRange[0] = total.Count > 0 ? total.Min : 0.;
+    this->StatisticsRange[1] = total.Count > 0 ? total.Max : 0.;
+    this->StatisticsMean = total.Mean;
+    this->StatisticsStandardDeviation = total.StandardDeviation();
+    this->StatisticsNaNCount = total.NaNCount;
     }
 
-  this->SetDisplayThreshold(noise);
+  this->StatisticsImageData = imageData;
+  this->StatisticsMTime = mTime;
+  this->StatisticsNoiseOnly = noiseOnly;
 
   return true;
 }
@@ -593,7 +762,113 @@ void vtkMRMLAstroVolumeNode::SetDisplayThreshold(double DisplayThreshold)
 //----------------------------------------------------------------------------
 double vtkMRMLAstroVolumeNode::GetDisplayThreshold()
 {
-  return StringToDouble(this->GetAttribute("SlicerAstro.DisplayThreshold"));
+  return this->GetAstroMetadata().DisplayThreshold;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNode::GetNumberOfAxes()
+{
+  return this->GetAstroMetadata().NAXIS;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeNode::GetAxisLength(int axis)
+{
+  if (axis < 0 || axis > 2)
+    {
+    return 0;
+    }
+  return this->GetAstroMetadata().NAXISn[axis];
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetAxisIncrement(int axis)
+{
+  if (axis < 0 || axis > 2)
+    {
+    return 0.;
+    }
+  return this->GetAstroMetadata().CDELTn[axis];
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetDataMin()
+{
+  return this->GetAstroMetadata().DATAMIN;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetDataMax()
+{
+  return this->GetAstroMetadata().DATAMAX;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeNode::GetBeam(double beam[3])
+{
+  const AstroMetadataType& metadata = this->GetAstroMetadata();
+  for (int ii = 0; ii < 3; ii++)
+    {
+    beam[ii] = metadata.Beam[ii];
+    }
+  return metadata.BeamDefined;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLAstroVolumeNode::GetRestFrequency()
+{
+  return this->GetAstroMetadata().RESTFREQ;
+}
+
+//----------------------------------------------------------------------------
+const char *vtkMRMLAstroVolumeNode::GetDataUnit()
+{
+  return this->GetAstroMetadata().BUNIT.c_str();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLAstroVolumeNode::InvalidateAstroMetadata()
+{
+  this->AstroMetadataValid = false;
+}
+
+//----------------------------------------------------------------------------
+const vtkMRMLAstroVolumeNode::AstroMetadataType &vtkMRMLAstroVolumeNode::GetAstroMetadata()
+{
+  if (this->AstroMetadataValid && this->AstroMetadataMTime == this->GetMTime())
+    {
+    return this->AstroMetadata;
+    }
+
+  AstroMetadataType& metadata = this->AstroMetadata;
+  metadata.NAXIS = AttributeToNumber<int>(this, "SlicerAstro.NAXIS");
+  for (int ii = 0; ii < 3; ii++)
+    {
+    std::string axis = NumberToString<int>(ii + 1);
+    metadata.NAXISn[ii] = AttributeToNumber<int>(this, ("SlicerAstro.NAXIS" + axis).c_str());
+    metadata.CDELTn[ii] = AttributeToNumber<double>(this, ("SlicerAstro.CDELT" + axis).c_str());
+    }
+  metadata.DATAMIN = AttributeToNumber<double>(this, "SlicerAstro.DATAMIN");
+  metadata.DATAMAX = AttributeToNumber<double>(this, "SlicerAstro.DATAMAX");
+  metadata.DisplayThreshold = AttributeToNumber<double>(this, "SlicerAstro.DisplayThreshold");
+
+  const char* beamKeys[3] = {"SlicerAstro.BMAJ", "SlicerAstro.BMIN", "SlicerAstro.BPA"};
+  metadata.BeamDefined = true;
+  for (int ii = 0; ii < 3; ii++)
+    {
+    const char* value = this->GetAttribute(beamKeys[ii]);
+    metadata.BeamDefined = metadata.BeamDefined && value && strcmp(value, "UNDEFINED");
+    metadata.Beam[ii] = AttributeToNumber<double>(this, beamKeys[ii]);
+    }
+
+  metadata.RESTFREQ = AttributeToNumber<double>(this, "SlicerAstro.RESTFREQ");
+  const char* bunit = this->GetAttribute("SlicerAstro.BUNIT");
+  metadata.BUNIT = bunit ? bunit : "";
+
+  this->AstroMetadataMTime = this->GetMTime();
+  this->AstroMetadataValid = true;
+
+  return metadata;
 }
 
 //----------------------------------------------------------------------------
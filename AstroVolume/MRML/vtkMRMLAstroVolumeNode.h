@@ -29,9 +29,14 @@
 // VTK includes
 #include <vtkDoubleArray.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 #include <vtkSlicerAstroVolumeModuleMRMLExport.h>
 
+// STD includes
+#include <vector>
+
+class vtkImageData;
 class vtkMRMLAnnotationROINode;
 class vtkMRMLAstroVolumeDisplayNode;
 class vtkMRMLAstroLabelMapVolumeNode;
@@ -105,6 +110,50 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeNode : public vtkMRMLScalarVolumeN
   /// Update DisplayThreshold Attribute
    virtual bool UpdateDisplayThresholdAttributes();
 
+  /// Update DisplayThreshold Attribute with the given estimator
+  /// (see NoiseEstimators) instead of the NoiseEstimator of the node
+  bool UpdateDisplayThresholdAttributes(int noiseEstimator);
+
+  /// Compute, in a single pass over the voxels, the range, mean, standard
+  /// deviation and number of NaN voxels of the volume together with the noise
+  /// (standard deviation of the first and last slices). The results are cached
+  /// until the image data is modified: repeated calls are free.
+  bool UpdateStatistics();
+
+  /// Statistics computed by UpdateStatistics
+  vtkGetVector2Macro(StatisticsRange, double);
+  vtkGetMacro(StatisticsMean, double);
+  vtkGetMacro(StatisticsStandardDeviation, double);
+  vtkGetMacro(StatisticsNaNCount, vtkIdType);
+  vtkGetMacro(StatisticsNoise, double);
+
+  enum NoiseEstimators
+    {
+    /// standard deviation of the first and last slices (default)
+    SlabNoiseEstimator = 0,
+    /// median absolute deviation of a random sample of the whole cube
+    MADNoiseEstimator,
+    /// iterative 3 sigma-clipped rms of a random sample of the whole cube
+    SigmaClippedNoiseEstimator
+    };
+
+  /// Estimator used by UpdateDisplayThresholdAttributes for the noise
+  vtkSetClampMacro(NoiseEstimator, int, SlabNoiseEstimator, SigmaClippedNoiseEstimator);
+  vtkGetMacro(NoiseEstimator, int);
+
+  /// Maximum number of voxels sampled by the robust noise estimators.
+  /// The cube is split in as many strata and one voxel is drawn from each.
+  vtkSetMacro(NoiseSampleSize, vtkIdType);
+  vtkGetMacro(NoiseSampleSize, vtkIdType);
+
+  /// MAD or sigma-clipped (noiseEstimator) noise of a stratified
+  /// sample of the cube. NaN and BLANK voxels are not sampled.
+  bool EstimateRobustNoise(double& noise, int noiseEstimator);
+
+  /// MAD or sigma-clipped (noiseEstimator) noise of a sample of valid
+  /// voxel values, e.g. drawn from a cube which is not loaded.
+  static double GetRobustNoise(const std::vector<double>& sample, int noiseEstimator);
+
   enum
      {
      DisplayThresholdModifiedEvent = 71000,
@@ -116,6 +165,33 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeNode : public vtkMRMLScalarVolumeN
   /// Get the SlicerAstro.DisplayThreshold keyword
   double GetDisplayThreshold();
 
+  /// Typed values of the SlicerAstro keywords read by the kernels, the
+  /// widgets and the displayable managers. The attributes are parsed again
+  /// only when the node has been modified, so the getters are cheap enough
+  /// for hot paths.
+  /// NAXIS
+  int GetNumberOfAxes();
+  /// NAXISn and CDELTn of the axis (0 to 2)
+  int GetAxisLength(int axis);
+  double GetAxisIncrement(int axis);
+  /// DATAMIN and DATAMAX
+  double GetDataMin();
+  double GetDataMax();
+  /// BMAJ, BMIN and BPA. Return false if the beam is UNDEFINED.
+  bool GetBeam(double beam[3]);
+  /// RESTFREQ
+  double GetRestFrequency();
+  /// BUNIT
+  const char* GetDataUnit();
+
+  /// Parse the attributes again on the next typed access. SetAttribute
+  /// already calls it, also inside a StartModify/EndModify block; needed
+  /// only when the attributes are changed without SetAttribute.
+  void InvalidateAstroMetadata();
+
+  /// Set an attribute and invalidate the typed SlicerAstro keywords
+  virtual void SetAttribute(const char* name, const char* value) override;
+
   /// Set reference to a Preset Node
   void SetPresetNode(vtkMRMLVolumePropertyNode* node);
 
@@ -165,6 +241,45 @@ protected:
   static const char* ROI_ALIGNMENTTRANSFORM_REFERENCE_ROLE;
   const char *GetROIAlignmentTransformNodeReferenceRole();
 
+  /// Fused statistics pass. With noiseOnly only the slices used
+  /// for the noise are visited.
+  bool ComputeStatistics(bool noiseOnly);
+
+  double StatisticsRange[2];
+  double StatisticsMean;
+  double StatisticsStandardDeviation;
+  vtkIdType StatisticsNaNCount;
+  double StatisticsNoise;
+
+  // image data and modification time the statistics refer to
+  vtkWeakPointer<vtkImageData> StatisticsImageData;
+  vtkMTimeType StatisticsMTime;
+  bool StatisticsNoiseOnly;
+
+  int NoiseEstimator;
+  vtkIdType NoiseSampleSize;
+
+  // typed copy of the SlicerAstro attributes
+  struct AstroMetadataType
+    {
+    int NAXIS;
+    int NAXISn[3];
+    double CDELTn[3];
+    double DATAMIN;
+    double DATAMAX;
+    double DisplayThreshold;
+    bool BeamDefined;
+    double Beam[3];
+    double RESTFREQ;
+    std::string BUNIT;
+    };
+
+  const AstroMetadataType& GetAstroMetadata();
+
+  AstroMetadataType AstroMetadata;
+  vtkMTimeType AstroMetadataMTime;
+  bool AstroMetadataValid;
+
   vtkMRMLAstroVolumeNode(const vtkMRMLAstroVolumeNode&);
   void operator=(const vtkMRMLAstroVolumeNode&);
 };
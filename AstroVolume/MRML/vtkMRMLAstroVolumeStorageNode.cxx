@@ -26,17 +26,36 @@
 #include <vtkMRMLScene.h>
 #include <vtkMRMLVolumeNode.h>
 
+// AstroVolume includes
+#include <vtkSlicerAstroConfigure.h>
+
 //vtkFits includes
 #include <vtkFITSReader.h>
 #include <vtkFITSWriter.h>
 
 // VTK includes
+#include <vtkCallbackCommand.h>
 #include <vtkDataSetAttributes.h>
 #include <vtkImageChangeInformation.h>
 #include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkType.h>
+#include <vtksys/SystemInformation.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
 
 
 //----------------------------------------------------------------------------
@@ -46,6 +65,20 @@ vtkMRMLNodeNewMacro(vtkMRMLAstroVolumeStorageNode);
 vtkMRMLAstroVolumeStorageNode::vtkMRMLAstroVolumeStorageNode()
 {
   this->CenterImage = 2;
+  for (int ii = 0; ii < 3; ii++)
+    {
+    this->ReadExtent[2 * ii] = 0;
+    this->ReadExtent[2 * ii + 1] = -1;
+    }
+  this->ScalarTypePolicy = 0;
+  this->AbortReading = 0;
+  this->PyramidLevels = 0;
+  this->PreviewLevel = 0;
+  this->TileCompression = 0;
+  this->TileSize[0] = 0;
+  this->TileSize[1] = 0;
+  this->TileSize[2] = 1;
+  this->QuantizeLevel = 0.;
   this->DefaultWriteFileExtension = "fits";
   this->UseCompression = 0;
 }
@@ -87,6 +120,178 @@ double StringToDouble(const char* str)
 {
   return StringToNumber<double>(str);
 }
+
+//----------------------------------------------------------------------------
+std::string IntToString(int Value)
+{
+  return NumberToString<int>(Value);
+}
+
+//----------------------------------------------------------------------------
+void SetSubExtentAttributes(vtkMRMLNode* node, const int extent[6])
+{
+  int naxes = StringToNumber<int>(node->GetAttribute("SlicerAstro.NAXIS"));
+  for (int axii = 0; axii < naxes && axii < 3; axii++)
+    {
+    std::string naxisKey = "SlicerAstro.NAXIS" + IntToString(axii + 1);
+    std::string crpixKey = "SlicerAstro.CRPIX" + IntToString(axii + 1);
+    double crpix = StringToDouble(node->GetAttribute(crpixKey.c_str()));
+    node->SetAttribute(naxisKey.c_str(), IntToString(extent[2 * axii + 1] - extent[2 * axii] + 1).c_str());
+    node->SetAttribute(crpixKey.c_str(), DoubleToString(crpix - extent[2 * axii]).c_str());
+    }
+}
+
+//----------------------------------------------------------------------------
+// NaN-aware average of blocks of factors[0] x factors[1] x factors[2]
+// voxels (smaller on the borders)
+void BlockAverage(const float *in, const int inDims[3],
+                  float *out, const int outDims[3], const int factors[3])
+{
+  const vtkIdType inSlice = static_cast<vtkIdType>(inDims[0]) * inDims[1];
+  const int numRows = outDims[1] * outDims[2];
+
+  // rows rather than planes are shared: a slab of the cube gives one plane
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+  #pragma omp parallel for schedule(dynamic)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int row = 0; row < numRows; row++)
+    {
+    const int oz = row / outDims[1];
+    const int oy = row % outDims[1];
+    const int z1 = std::min((oz + 1) * factors[2], inDims[2]);
+    const int y1 = std::min((oy + 1) * factors[1], inDims[1]);
+    for (int ox = 0; ox < outDims[0]; ox++)
+      {
+      const int x1 = std::min((ox + 1) * factors[0], inDims[0]);
+      double sum = 0.;
+      vtkIdType count = 0;
+      for (int zz = oz * factors[2]; zz < z1; zz++)
+        {
+        for (int yy = oy * factors[1]; yy < y1; yy++)
+          {
+          const float *inRow = in + zz * inSlice + static_cast<vtkIdType>(yy) * inDims[0];
+          for (int xx = ox * factors[0]; xx < x1; xx++)
+            {
+            if (inRow[xx] != inRow[xx])
+              {
+              continue;
+              }
+            sum += inRow[xx];
+            count++;
+            }
+          }
+        }
+      out[static_cast<vtkIdType>(row) * outDims[0] + ox] =
+        count > 0 ? static_cast<float>(sum / count) : std::numeric_limits<float>::quiet_NaN();
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Block size of the pyramid level below a grid of dims voxels: the axes
+// are halved as long as they keep at least two voxels. Returns false if
+// no axis can be reduced.
+bool PyramidLevelFactors(const int dims[3], int factors[3], int outDims[3])
+{
+  bool reduced = false;
+  for (int ii = 0; ii < 3; ii++)
+    {
+    factors[ii] = dims[ii] >= 4 ? 2 : 1;
+    outDims[ii] = (dims[ii] + factors[ii] - 1) / factors[ii];
+    reduced = reduced || factors[ii] > 1;
+    }
+  return reduced;
+}
+
+//----------------------------------------------------------------------------
+// Appends a level of the pyramid to pyramidName: the physical float values
+// of the cube read by reader on a grid coarser by totalFactors per axis
+bool WritePyramidLevel(vtkImageData *levelData, vtkFITSReader *reader, int level,
+                       const int totalFactors[3], const std::string& pyramidName)
+{
+  vtkNew<vtkFITSWriter> writer;
+  writer->SetFileName(pyramidName.c_str());
+  writer->SetInputData(levelData);
+  writer->SetAppendImage(level > 1);
+
+  std::vector<std::string> keys = reader->GetHeaderKeysVector();
+  for (std::vector<std::string>::iterator kit = keys.begin(); kit != keys.end(); ++kit)
+    {
+    writer->SetAttribute((*kit), reader->GetHeaderValue((*kit).c_str()));
+    }
+
+  writer->SetAttribute("SlicerAstro.BITPIX", "-32");
+  writer->SetAttribute("SlicerAstro.BSCALE", "1.");
+  writer->SetAttribute("SlicerAstro.BZERO", "0.");
+  writer->SetAttribute("SlicerAstro.BLANK", "UNDEFINED");
+  writer->SetAttribute("SlicerAstro.PYRLEVEL", IntToString(level));
+  int *dims = levelData->GetDimensions();
+  const int naxes = StringToNumber<int>(reader->GetHeaderValue("SlicerAstro.NAXIS"));
+  for (int axii = 0; axii < naxes && axii < 3; axii++)
+    {
+    std::string axis = IntToString(axii + 1);
+    std::string crpixKey = "SlicerAstro.CRPIX" + axis;
+    std::string cdeltKey = "SlicerAstro.CDELT" + axis;
+    writer->SetAttribute("SlicerAstro.NAXIS" + axis, IntToString(dims[axii]));
+    if (reader->GetHeaderValue(crpixKey.c_str()))
+      {
+      double crpix = StringToDouble(reader->GetHeaderValue(crpixKey.c_str()));
+      writer->SetAttribute(crpixKey, DoubleToString((crpix - 0.5) / totalFactors[axii] + 0.5));
+      }
+    if (reader->GetHeaderValue(cdeltKey.c_str()))
+      {
+      double cdelt = StringToDouble(reader->GetHeaderValue(cdeltKey.c_str()));
+      writer->SetAttribute(cdeltKey, DoubleToString(cdelt * totalFactors[axii]));
+      }
+    for (int jj = 0; jj < naxes && jj < 3; jj++)
+      {
+      std::string cdKey = "SlicerAstro.CD" + IntToString(jj + 1) + "_" + axis;
+      if (reader->GetHeaderValue(cdKey.c_str()))
+        {
+        double cd = StringToDouble(reader->GetHeaderValue(cdKey.c_str()));
+        writer->SetAttribute(cdKey, DoubleToString(cd * totalFactors[axii]));
+        }
+      }
+    }
+
+  writer->Write();
+  return !writer->GetWriteError();
+}
+
+//----------------------------------------------------------------------------
+int NumberOfPyramidLevels(const std::string& pyramidName)
+{
+  fitsfile *fptr = nullptr;
+  int status = 0, numberOfHDUs = 0;
+  if (fits_open_file(&fptr, pyramidName.c_str(), READONLY, &status))
+    {
+    return 0;
+    }
+  fits_get_num_hdus(fptr, &numberOfHDUs, &status);
+  fits_close_file(fptr, &status);
+  return numberOfHDUs;
+}
+
+//----------------------------------------------------------------------------
+// Forwards the progress of the reader and passes on the abort requests
+void ReaderProgressCallback(vtkObject* caller, unsigned long vtkNotUsed(eid),
+                            void* clientData, void* callData)
+{
+  vtkFITSReader* reader = vtkFITSReader::SafeDownCast(caller);
+  vtkMRMLAstroVolumeStorageNode* storageNode =
+    reinterpret_cast<vtkMRMLAstroVolumeStorageNode*>(clientData);
+  if (!reader || !storageNode)
+    {
+    return;
+    }
+
+  storageNode->InvokeEvent(vtkCommand::ProgressEvent, callData);
+  if (storageNode->GetAbortReading())
+    {
+    reader->AbortExecuteOn();
+    }
+}
 }// end namespace
 
 
@@ -99,6 +304,21 @@ void vtkMRMLAstroVolumeStorageNode::WriteXML(ostream& of, int nIndent)
   std::stringstream ss;
   ss << this->CenterImage;
   of << indent << " centerImage=\"" << ss.str() << "\"";
+
+  of << indent << " readExtent=\"";
+  for (int ii = 0; ii < 6; ii++)
+    {
+    of << (ii > 0 ? " " : "") << this->ReadExtent[ii];
+    }
+  of << "\"";
+
+  of << indent << " scalarTypePolicy=\"" << this->ScalarTypePolicy << "\"";
+  of << indent << " pyramidLevels=\"" << this->PyramidLevels << "\"";
+  of << indent << " previewLevel=\"" << this->PreviewLevel << "\"";
+  of << indent << " tileCompression=\"" << this->TileCompression << "\"";
+  of << indent << " tileSize=\"" << this->TileSize[0] << " "
+     << this->TileSize[1] << " " << this->TileSize[2] << "\"";
+  of << indent << " quantizeLevel=\"" << this->QuantizeLevel << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -120,6 +340,54 @@ void vtkMRMLAstroVolumeStorageNode::ReadXMLAttributes(const char** atts)
       ss << attValue;
       ss >> this->CenterImage;
       }
+    else if (!strcmp(attName, "readExtent"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      for (int ii = 0; ii < 6; ii++)
+        {
+        ss >> this->ReadExtent[ii];
+        }
+      }
+    else if (!strcmp(attName, "scalarTypePolicy"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->ScalarTypePolicy;
+      }
+    else if (!strcmp(attName, "pyramidLevels"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->PyramidLevels;
+      }
+    else if (!strcmp(attName, "previewLevel"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->PreviewLevel;
+      }
+    else if (!strcmp(attName, "tileCompression"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->TileCompression;
+      }
+    else if (!strcmp(attName, "tileSize"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      for (int ii = 0; ii < 3; ii++)
+        {
+        ss >> this->TileSize[ii];
+        }
+      }
+    else if (!strcmp(attName, "quantizeLevel"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> this->QuantizeLevel;
+      }
     }
 
   this->EndModify(disabledModify);
@@ -141,6 +409,13 @@ void vtkMRMLAstroVolumeStorageNode::Copy(vtkMRMLNode *anode)
   vtkMRMLAstroVolumeStorageNode *node = (vtkMRMLAstroVolumeStorageNode *) anode;
 
   this->SetCenterImage(node->CenterImage);
+  this->SetReadExtent(node->ReadExtent);
+  this->SetScalarTypePolicy(node->ScalarTypePolicy);
+  this->SetPyramidLevels(node->PyramidLevels);
+  this->SetPreviewLevel(node->PreviewLevel);
+  this->SetTileCompression(node->TileCompression);
+  this->SetTileSize(node->TileSize);
+  this->SetQuantizeLevel(node->QuantizeLevel);
 
   this->EndModify(disabledModify);
 }
@@ -150,6 +425,16 @@ void vtkMRMLAstroVolumeStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   vtkMRMLStorageNode::PrintSelf(os,indent);
   os << indent << "CenterImage:   " << this->CenterImage << "\n";
+  os << indent << "ReadExtent:   " << this->ReadExtent[0] << " " << this->ReadExtent[1] << " "
+     << this->ReadExtent[2] << " " << this->ReadExtent[3] << " "
+     << this->ReadExtent[4] << " " << this->ReadExtent[5] << "\n";
+  os << indent << "ScalarTypePolicy:   " << this->ScalarTypePolicy << "\n";
+  os << indent << "PyramidLevels:   " << this->PyramidLevels << "\n";
+  os << indent << "PreviewLevel:   " << this->PreviewLevel << "\n";
+  os << indent << "TileCompression:   " << this->TileCompression << "\n";
+  os << indent << "TileSize:   " << this->TileSize[0] << " "
+     << this->TileSize[1] << " " << this->TileSize[2] << "\n";
+  os << indent << "QuantizeLevel:   " << this->QuantizeLevel << "\n";
 }
 
 //----------------------------------------------------------------------------
@@ -196,6 +481,16 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     reader->SetUseNativeOriginOn();
     }
 
+  this->AbortReading = 0;
+  vtkNew<vtkCallbackCommand> progressCallback;
+  progressCallback->SetCallback(ReaderProgressCallback);
+  progressCallback->SetClientData(this);
+  reader->AddObserver(vtkCommand::ProgressEvent, progressCallback.GetPointer());
+  if (refNode->IsA("vtkMRMLAstroVolumeNode"))
+    {
+    reader->SetScalarTypePolicy(this->ScalarTypePolicy);
+    }
+
   if (refNode->IsA("vtkMRMLAstroVolumeNode"))
     {
     if (volNode->GetImageData())
@@ -220,10 +515,23 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
-  reader->SetFileName(fullName.c_str());
+  // preview: a level of the multi-resolution pyramid replaces the cube
+  int previewLevel = 0;
+  std::string readName = fullName;
+  if (refNode->IsA("vtkMRMLAstroVolumeNode"))
+    {
+    previewLevel = this->GetPyramidLevelToRead(fullName);
+    }
+  if (previewLevel > 0)
+    {
+    readName = vtkMRMLAstroVolumeStorageNode::GetPyramidFileName(fullName);
+    reader->SetImageExtension(previewLevel - 1);
+    }
+
+  reader->SetFileName(readName.c_str());
 
   // Check if this is a FITS file that we can read
-  if (!reader->CanReadFile(fullName.c_str()))
+  if (!reader->CanReadFile(readName.c_str()))
     {
     vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
                   "this is not a fits file or corrupted header");
@@ -244,20 +552,77 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       }
     }
 
-  reader->Update();
+  // Read only the requested sub-cube (if any), clamped to the file extent
+  int wholeExtent[6], readExtent[6];
+  reader->GetDataExtent(wholeExtent);
+  bool subExtent = false;
+  for (int axii = 0; axii < 3; axii++)
+    {
+    readExtent[2 * axii] = wholeExtent[2 * axii];
+    readExtent[2 * axii + 1] = wholeExtent[2 * axii + 1];
+    if (previewLevel > 0 || this->ReadExtent[2 * axii + 1] < this->ReadExtent[2 * axii])
+      {
+      continue;
+      }
+    readExtent[2 * axii] = std::max(this->ReadExtent[2 * axii], wholeExtent[2 * axii]);
+    readExtent[2 * axii + 1] = std::min(this->ReadExtent[2 * axii + 1], wholeExtent[2 * axii + 1]);
+    if (readExtent[2 * axii + 1] < readExtent[2 * axii])
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
+                    "ReadExtent is outside the data extent.");
+      return 0;
+      }
+    if (readExtent[2 * axii] != wholeExtent[2 * axii] ||
+        readExtent[2 * axii + 1] != wholeExtent[2 * axii + 1])
+      {
+      subExtent = true;
+      }
+    }
+
+  if (subExtent)
+    {
+    reader->UpdateExtent(readExtent);
+    }
+  else
+    {
+    reader->Update();
+    }
 
-  if (reader->GetWCSStruct() == nullptr)
+  struct wcsprm* wcs = reader->GetWCSStruct();
+  if (wcs == nullptr)
     {
     vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
                   "WCS not allocated.");
     return 0;
     }
 
+  // The sub-cube starts at IJK = 0: shift the reference pixel and,
+  // if required, center the sub-cube instead of the whole cube.
+  vtkNew<vtkMatrix4x4> rasToIjk;
+  rasToIjk->DeepCopy(reader->GetRasToIjkMatrix());
+  if (subExtent)
+    {
+    if (reader->GetWCSStatus() == 0)
+      {
+      for (int axii = 0; axii < wcs->naxis && axii < 3; axii++)
+        {
+        wcs->crpix[axii] -= readExtent[2 * axii];
+        }
+      wcs->flag = 0;
+      }
+    if (this->CenterImage)
+      {
+      for (int ii = 0; ii < 3; ii++)
+        {
+        rasToIjk->SetElement(ii, 3, (readExtent[2 * ii + 1] - readExtent[2 * ii]) / 2.0);
+        }
+      }
+    }
+
   if (refNode->IsA("vtkMRMLAstroVolumeNode"))
     {
     // set volume attributes
-    vtkMatrix4x4* mat = reader->GetRasToIjkMatrix();
-    volNode->SetRASToIJKMatrix(mat);
+    volNode->SetRASToIJKMatrix(rasToIjk.GetPointer());
 
     // parse non-specific key-value pairs
     std::vector<std::string> keys = reader->GetHeaderKeysVector();
@@ -265,6 +630,10 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       {
       volNode->SetAttribute((*kit).c_str(), reader->GetHeaderValue((*kit).c_str()));
       }
+    if (subExtent)
+      {
+      SetSubExtentAttributes(volNode, readExtent);
+      }
     disNode->SetAttribute("SlicerAstro.NAXIS", reader->GetHeaderValue("SlicerAstro.NAXIS"));
 
     // parse WCS Status
@@ -276,7 +645,7 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       }
 
     // set WCSstruct
-    disNode->SetWCSStruct(reader->GetWCSStruct());
+    disNode->SetWCSStruct(wcs);
 
     if(!strcmp(disNode->GetVelocityDefinition().c_str() , "FREQ"))
       {
@@ -304,16 +673,16 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       int vtkType = reader->GetDataType();
       int *dims = imageData->GetDimensions();
       const int numComponents = imageData->GetNumberOfScalarComponents();
-      const int numElements = dims[0] * dims[1] * dims[2] * numComponents;
+      const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2] * numComponents;
       switch (vtkType)
         {
         case VTK_DOUBLE:
           double *dPixel;
-          dPixel = static_cast<double*>(imageData->GetScalarPointer(0,0,0));
+          dPixel = static_cast<double*>(imageData->GetScalarPointer());
 
           if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
             {
-            for( int elemCnt = 0; elemCnt < numElements; elemCnt++)
+            for( vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
               {
               *(dPixel+elemCnt) *= 0.005;
               }
@@ -321,10 +690,10 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
           break;
         case VTK_FLOAT:
           float *fPixel;
-          fPixel = static_cast<float*>(imageData->GetScalarPointer(0,0,0));
+          fPixel = static_cast<float*>(imageData->GetScalarPointer());
           if (!strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U."))
             {
-            for( int elemCnt = 0; elemCnt < numElements; elemCnt++)
+            for( vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
               {
               *(fPixel+elemCnt) *= 0.005;
               }
@@ -340,8 +709,7 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   else if (refNode->IsA("vtkMRMLAstroLabelMapVolumeNode"))
     {
     // set volume attributes
-    vtkMatrix4x4* mat = reader->GetRasToIjkMatrix();
-    labvolNode->SetRASToIJKMatrix(mat);
+    labvolNode->SetRASToIJKMatrix(rasToIjk.GetPointer());
 
     // parse non-specific key-value pairs
     std::vector<std::string> keys = reader->GetHeaderKeysVector();
@@ -349,6 +717,10 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       {
       labvolNode->SetAttribute((*kit).c_str(), reader->GetHeaderValue((*kit).c_str()));
       }
+    if (subExtent)
+      {
+      SetSubExtentAttributes(labvolNode, readExtent);
+      }
     labdisNode->SetAttribute("SlicerAstro.NAXIS", reader->GetHeaderValue("SlicerAstro.NAXIS"));
 
     // parse WCS Status
@@ -361,7 +733,7 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       }
 
     //set WCSstruct
-    labdisNode->SetWCSStruct(reader->GetWCSStruct());
+    labdisNode->SetWCSStruct(wcs);
 
     if(!strcmp(labdisNode->GetVelocityDefinition().c_str() , "FREQ"))
       {
@@ -375,24 +747,59 @@ int vtkMRMLAstroVolumeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     }
 
   vtkNew<vtkImageChangeInformation> ici;
-  ici->SetInputConnection(reader->GetOutputPort());
+  if (subExtent)
+    {
+    // do not connect the pipeline: a downstream update would request
+    // the whole extent and read the full cube from the file.
+    ici->SetInputData(reader->GetOutput());
+    }
+  else
+    {
+    ici->SetInputConnection(reader->GetOutputPort());
+    }
   ici->SetOutputSpacing( 1, 1, 1 );
   ici->SetOutputOrigin( 0, 0, 0 );
+  ici->SetOutputExtentStart( 0, 0, 0 );
   ici->Update();
 
+  if (reader->GetAbortExecute())
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
+                  "reading of "<<fullName<<" aborted.");
+    return 0;
+    }
+
   if (refNode->IsA("vtkMRMLAstroVolumeNode"))
     {
     volNode->SetImageDataConnection(ici->GetOutputPort());
+    // the file range is in W.U. when the flux has been rescaled to JY/BEAM
+    const double fluxScale =
+      !strcmp(reader->GetHeaderValue("SlicerAstro.BUNIT"), "W.U.") ? 0.005 : 1.;
     if(!strcmp(reader->GetHeaderValue("SlicerAstro.DATAMAX"), "0.") ||
        !strcmp(reader->GetHeaderValue("SlicerAstro.DATAMIN"), "0."))
-      {  
-      if (!volNode->UpdateRangeAttributes())
+      {
+      // the range computed while reading saves a pass over the data
+      if (reader->GetDataRangeValid())
+        {
+        volNode->SetAttribute("SlicerAstro.DATAMIN",
+          DoubleToString(reader->GetDataRange()[0] * fluxScale).c_str());
+        volNode->SetAttribute("SlicerAstro.DATAMAX",
+          DoubleToString(reader->GetDataRange()[1] * fluxScale).c_str());
+        }
+      else if (!volNode->UpdateRangeAttributes())
         {
         vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal :"
                       "could not calculate range attributes.");
         return 0;
         }
       }
+    else if (fluxScale != 1.)
+      {
+      volNode->SetAttribute("SlicerAstro.DATAMIN", DoubleToString
+        (StringToDouble(reader->GetHeaderValue("SlicerAstro.DATAMIN")) * fluxScale).c_str());
+      volNode->SetAttribute("SlicerAstro.DATAMAX", DoubleToString
+        (StringToDouble(reader->GetHeaderValue("SlicerAstro.DATAMAX")) * fluxScale).c_str());
+      }
     if (!strcmp(reader->GetHeaderValue("SlicerAstro.DisplayThreshold"), "0."))
       {
       if (!volNode->UpdateDisplayThresholdAttributes())
@@ -477,11 +884,28 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
+  if (volNode->GetAttribute("SlicerAstro.PYRLEVEL"))
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WriteDataInternal :"
+                  " the volume holds a level of the multi-resolution pyramid"
+                  " of the cube: load it at full resolution to save it.");
+    return 0;
+    }
+
   // Use here the FITS Writer
   vtkNew<vtkFITSWriter> writer;
   writer->SetFileName(fullName.c_str());
   writer->SetInputConnection(volNode->GetImageDataConnection());
   writer->SetUseCompression(this->GetUseCompression());
+  int tileCompression = this->TileCompression;
+  if (tileCompression == vtkFITSWriter::NoTileCompression &&
+      fullName.size() > 3 && !fullName.compare(fullName.size() - 3, 3, ".fz"))
+    {
+    tileCompression = vtkFITSWriter::RiceTileCompression;
+    }
+  writer->SetTileCompression(tileCompression);
+  writer->SetTileSize(this->TileSize);
+  writer->SetQuantizeLevel(this->QuantizeLevel);
 
   // pass down all MRML attributes
   std::vector<std::string> attributeNames = volNode->GetAttributeNames();
@@ -491,6 +915,31 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     writer->SetAttribute((*ait), volNode->GetAttribute((*ait).c_str()));
     }
 
+  // scaled int16 cubes are written as stored, BITPIX 16 with their
+  // BSCALE/BZERO and BLANK keywords, while the range keywords are
+  // physical values
+  if (refNode->IsA("vtkMRMLAstroVolumeNode") && volNode->GetImageData() &&
+      volNode->GetImageData()->GetScalarType() == VTK_SHORT)
+    {
+    double scale = 1., zero = 0.;
+    if (volNode->GetAttribute("SlicerAstro.BSCALE"))
+      {
+      scale = StringToDouble(volNode->GetAttribute("SlicerAstro.BSCALE"));
+      }
+    if (volNode->GetAttribute("SlicerAstro.BZERO"))
+      {
+      zero = StringToDouble(volNode->GetAttribute("SlicerAstro.BZERO"));
+      }
+    writer->SetAttribute("SlicerAstro.BITPIX", "16");
+    if (volNode->GetAttribute("SlicerAstro.DATAMIN") && volNode->GetAttribute("SlicerAstro.DATAMAX"))
+      {
+      double range[2] = {scale * StringToDouble(volNode->GetAttribute("SlicerAstro.DATAMIN")) + zero,
+                         scale * StringToDouble(volNode->GetAttribute("SlicerAstro.DATAMAX")) + zero};
+      writer->SetAttribute("SlicerAstro.DATAMIN", DoubleToString(std::min(range[0], range[1])));
+      writer->SetAttribute("SlicerAstro.DATAMAX", DoubleToString(std::max(range[0], range[1])));
+      }
+    }
+
   writer->Write();
   int writeFlag = 1;
   if (writer->GetWriteError())
@@ -501,16 +950,216 @@ int vtkMRMLAstroVolumeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     writeFlag = 0;
     }
 
+  if (writeFlag && this->PyramidLevels > 0 && refNode->IsA("vtkMRMLAstroVolumeNode") &&
+      !this->WritePyramid())
+    {
+    vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::WriteDataInternal : "
+                    "the multi-resolution pyramid of "<<fullName<<" could not be written.");
+    }
+
   this->StageWriteData(refNode);
 
   return writeFlag;
 }
 
+//----------------------------------------------------------------------------
+std::string vtkMRMLAstroVolumeStorageNode::GetPyramidFileName(const std::string& fileName)
+{
+  std::string baseName = fileName;
+  const char* extensions[3] = {".fits.gz", ".fits.fz", ".fits"};
+  for (int ii = 0; ii < 3; ii++)
+    {
+    const std::string extension = extensions[ii];
+    if (baseName.size() > extension.size() &&
+        !vtksys::SystemTools::LowerCase(baseName.substr(baseName.size() - extension.size())).compare(extension))
+      {
+      baseName.resize(baseName.size() - extension.size());
+      break;
+      }
+    }
+  return baseName + ".pyramid.fits";
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLAstroVolumeStorageNode::GetPyramidLevelToRead(const std::string& fileName)
+{
+  if (this->PreviewLevel == 0)
+    {
+    return 0;
+    }
+
+  // the pyramid must have been written after the cube
+  std::string pyramidName = vtkMRMLAstroVolumeStorageNode::GetPyramidFileName(fileName);
+  if (!vtksys::SystemTools::FileExists(pyramidName.c_str(), true) ||
+      vtksys::SystemTools::ModifiedTime(pyramidName) < vtksys::SystemTools::ModifiedTime(fileName))
+    {
+    vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::ReadDataInternal : "
+                    "no up to date pyramid for "<<fileName<<", loading the full resolution.");
+    return 0;
+    }
+
+  int numberOfLevels = NumberOfPyramidLevels(pyramidName);
+  if (this->PreviewLevel > 0)
+    {
+    return std::min(this->PreviewLevel, numberOfLevels);
+    }
+
+  // finest level fitting in half of the available memory
+  vtkNew<vtkFITSReader> headerReader;
+  headerReader->SetFileName(fileName.c_str());
+  if (!headerReader->ReadHeaderOnly())
+    {
+    return numberOfLevels;
+    }
+  double bytes = std::abs(StringToNumber<int>(headerReader->GetHeaderValue("SlicerAstro.BITPIX"))) > 32 &&
+                 this->ScalarTypePolicy == vtkFITSReader::NativeScalarType ? 8. : 4.;
+  if (this->ScalarTypePolicy == vtkFITSReader::ScaledInt16ScalarType)
+    {
+    bytes = 2.;
+    }
+  int naxes = StringToNumber<int>(headerReader->GetHeaderValue("SlicerAstro.NAXIS"));
+  for (int axii = 0; axii < naxes && axii < 3; axii++)
+    {
+    std::string naxisKey = "SlicerAstro.NAXIS" + IntToString(axii + 1);
+    bytes *= std::max(1, StringToNumber<int>(headerReader->GetHeaderValue(naxisKey.c_str())));
+    }
+
+  vtksys::SystemInformation systemInformation;
+  systemInformation.RunMemoryCheck();
+  const double budget = 0.5 * 1024. * 1024. * systemInformation.GetAvailablePhysicalMemory();
+  int level = 0;
+  while (bytes > budget && level < numberOfLevels)
+    {
+    bytes /= 8.;
+    level++;
+    }
+  return level;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLAstroVolumeStorageNode::WritePyramid()
+{
+  if (this->PyramidLevels < 1)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                  "no pyramid levels requested.");
+    return false;
+    }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty() || !vtksys::SystemTools::FileExists(fullName.c_str(), true))
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                  "file "<<fullName<<" not found.");
+    return false;
+    }
+
+  // the levels hold physical float values with NaN blanks
+  vtkNew<vtkFITSReader> reader;
+  reader->SetFileName(fullName.c_str());
+  reader->SetScalarTypePolicy(vtkFITSReader::Float32ScalarType);
+  if (!reader->CanReadFile(fullName.c_str()))
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                  "this is not a fits file or corrupted header");
+    return false;
+    }
+  reader->UpdateInformation();
+  if (reader->GetDataType() != VTK_FLOAT || reader->GetNumberOfComponents() != 1)
+    {
+    vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                  "the pyramid is written only for data cubes.");
+    return false;
+    }
+
+  std::string pyramidName = vtkMRMLAstroVolumeStorageNode::GetPyramidFileName(fullName);
+  remove(pyramidName.c_str());
+
+  int wholeExtent[6], dims[3], factors[3], outDims[3];
+  reader->GetDataExtent(wholeExtent);
+  for (int ii = 0; ii < 3; ii++)
+    {
+    dims[ii] = wholeExtent[2 * ii + 1] - wholeExtent[2 * ii] + 1;
+    }
+  if (!PyramidLevelFactors(dims, factors, outDims))
+    {
+    return true;
+    }
+
+  // first level: the cube is read one slab of factors[2] planes at a time
+  vtkSmartPointer<vtkImageData> levelData = vtkSmartPointer<vtkImageData>::New();
+  levelData->SetDimensions(outDims);
+  levelData->AllocateScalars(VTK_FLOAT, 1);
+  float *outPtr = static_cast<float*>(levelData->GetScalarPointer());
+  const vtkIdType outSlice = static_cast<vtkIdType>(outDims[0]) * outDims[1];
+  const int planeDims[3] = {outDims[0], outDims[1], 1};
+  this->AbortReading = 0;
+  for (int oz = 0; oz < outDims[2]; oz++)
+    {
+    int slabExtent[6] = {wholeExtent[0], wholeExtent[1], wholeExtent[2], wholeExtent[3],
+                         wholeExtent[4] + oz * factors[2],
+                         std::min(wholeExtent[4] + (oz + 1) * factors[2] - 1, wholeExtent[5])};
+    reader->UpdateExtent(slabExtent);
+    vtkImageData *slabData = reader->GetOutput();
+    if (!slabData || !slabData->GetPointData() || !slabData->GetPointData()->GetScalars())
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                    "ERROR reading "<<fullName);
+      return false;
+      }
+    const int slabDims[3] = {dims[0], dims[1], slabExtent[5] - slabExtent[4] + 1};
+    BlockAverage(static_cast<const float*>(slabData->GetScalarPointer()), slabDims,
+                 outPtr + oz * outSlice, planeDims, factors);
+
+    double progress = (oz + 1.) / outDims[2];
+    this->InvokeEvent(vtkCommand::ProgressEvent, &progress);
+    if (this->AbortReading)
+      {
+      vtkWarningMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                      "pyramid of "<<fullName<<" aborted.");
+      remove(pyramidName.c_str());
+      return false;
+      }
+    }
+
+  // each further level is averaged from the previous one
+  int totalFactors[3] = {factors[0], factors[1], factors[2]};
+  for (int level = 1; level <= this->PyramidLevels; level++)
+    {
+    if (!WritePyramidLevel(levelData, reader.GetPointer(), level, totalFactors, pyramidName))
+      {
+      vtkErrorMacro("vtkMRMLAstroVolumeStorageNode::WritePyramid : "
+                    "ERROR writing level "<<level<<" in "<<pyramidName);
+      return false;
+      }
+
+    int levelDims[3];
+    levelData->GetDimensions(levelDims);
+    if (level == this->PyramidLevels || !PyramidLevelFactors(levelDims, factors, outDims))
+      {
+      break;
+      }
+    vtkSmartPointer<vtkImageData> nextLevelData = vtkSmartPointer<vtkImageData>::New();
+    nextLevelData->SetDimensions(outDims);
+    nextLevelData->AllocateScalars(VTK_FLOAT, 1);
+    BlockAverage(static_cast<const float*>(levelData->GetScalarPointer()), levelDims,
+                 static_cast<float*>(nextLevelData->GetScalarPointer()), outDims, factors);
+    levelData = nextLevelData;
+    for (int ii = 0; ii < 3; ii++)
+      {
+      totalFactors[ii] *= factors[ii];
+      }
+    }
+
+  return true;
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLAstroVolumeStorageNode::InitializeSupportedReadFileTypes()
 {
   this->SupportedReadFileTypes->InsertNextValue("FITS (.fits)");
   this->SupportedReadFileTypes->InsertNextValue("FITS (.fits.gz)");
+  this->SupportedReadFileTypes->InsertNextValue("FITS (.fits.fz)");
 }
 
 //----------------------------------------------------------------------------
@@ -518,6 +1167,7 @@ void vtkMRMLAstroVolumeStorageNode::InitializeSupportedWriteFileTypes()
 {
   this->SupportedWriteFileTypes->InsertNextValue("FITS (.fits)");
   this->SupportedWriteFileTypes->InsertNextValue("FITS (.fits.gz)");
+  this->SupportedWriteFileTypes->InsertNextValue("FITS (.fits.fz)");
 }
 
 //----------------------------------------------------------------------------
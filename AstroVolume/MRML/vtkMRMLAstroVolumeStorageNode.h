@@ -56,6 +56,79 @@ class VTK_MRML_ASTRO_EXPORT vtkMRMLAstroVolumeStorageNode : public vtkMRMLStorag
   vtkGetMacro(CenterImage, int);
   vtkSetMacro(CenterImage, int);
 
+  /// Set/Get the extent (in voxels of the file) to read.
+  /// Only the requested sub-cube is loaded from the file,
+  /// and the NAXISi and CRPIXi keywords are updated accordingly.
+  /// An empty extent (default) reads the whole cube.
+  vtkSetVector6Macro(ReadExtent, int);
+  vtkGetVector6Macro(ReadExtent, int);
+
+  /// Set/Get the in-memory scalar type of the loaded data cubes
+  /// (see vtkFITSReader::ScalarTypePolicy): native, float32, or scaled
+  /// int16 with the BSCALE/BZERO stored in the volume attributes. Scaled
+  /// int16 volumes are saved as stored (BITPIX 16) with these keywords.
+  /// It is set by the scalarType property of the AstroVolume reader.
+  /// Default is 0 (native).
+  vtkGetMacro(ScalarTypePolicy, int);
+  vtkSetMacro(ScalarTypePolicy, int);
+
+  /// Set/Get the number of levels of the multi-resolution pyramid written
+  /// next to the cube on save or by WritePyramid (see GetPyramidFileName).
+  /// Level k holds the NaN-aware average of blocks of 2 voxels per axis
+  /// of level k-1 (level 0 is the cube).
+  /// Default is 0 (no pyramid).
+  vtkGetMacro(PyramidLevels, int);
+  vtkSetMacro(PyramidLevels, int);
+
+  /// Set/Get the pyramid level loaded on read (0 is the full resolution).
+  /// When the pyramid file is missing or older than the cube, the full
+  /// resolution is loaded. -1 selects the finest level that fits in half
+  /// of the available physical memory. ReadExtent applies only to the full
+  /// resolution. Volumes loaded from a pyramid level have the
+  /// SlicerAstro.PYRLEVEL attribute and can not be saved.
+  /// It is set by the previewLevel property of the AstroVolume reader.
+  /// Default is 0.
+  vtkGetMacro(PreviewLevel, int);
+  vtkSetMacro(PreviewLevel, int);
+
+  /// Name of the multi-resolution pyramid file of a cube:
+  /// cube.fits, cube.fits.gz and cube.fits.fz have cube.pyramid.fits.
+  static std::string GetPyramidFileName(const std::string& fileName);
+
+  /// Write the multi-resolution pyramid (PyramidLevels levels) of the cube
+  /// FileName without rewriting the cube. The cube is read a few planes at
+  /// a time, invoking ProgressEvent (AbortReading cancels the build), and
+  /// only the level being averaged and the previous one are in memory.
+  /// Return false on failure.
+  bool WritePyramid();
+
+  /// Set/Get AbortReading. The storage node invokes ProgressEvent
+  /// (with the progress in [0, 1] as call data) while the data are read:
+  /// observers can set AbortReading to cancel the load.
+  vtkGetMacro(AbortReading, int);
+  vtkSetMacro(AbortReading, int);
+
+  /// Set/Get the tile compression used on write
+  /// (see vtkFITSWriter::TileCompression). Files saved with
+  /// the .fits.fz extension are Rice compressed when this is not set
+  /// (GZIP for floating point cubes saved losslessly, see QuantizeLevel).
+  /// Default is 0 (no tile compression).
+  vtkGetMacro(TileCompression, int);
+  vtkSetMacro(TileCompression, int);
+
+  /// Set/Get the tile shape used on write, in voxels
+  /// (see vtkFITSWriter::TileSize). Default is (0, 0, 1): one tile
+  /// per spectral plane.
+  vtkGetVector3Macro(TileSize, int);
+  vtkSetVector3Macro(TileSize, int);
+
+  /// Set/Get the quantization level of floating point data
+  /// for tile compression (see vtkFITSWriter::QuantizeLevel).
+  /// Default is 0: floating point cubes are compressed losslessly
+  /// unless a positive level is set.
+  vtkGetMacro(QuantizeLevel, double);
+  vtkSetMacro(QuantizeLevel, double);
+
   /// Return true if the node can be read in.
   virtual bool CanReadInReferenceNode(vtkMRMLNode *refNode) override;
 
@@ -82,7 +155,18 @@ protected:
   /// Write data from a  referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode) override;
 
+  /// Pyramid level to load for the cube fileName (see PreviewLevel)
+  int GetPyramidLevelToRead(const std::string& fileName);
+
   int CenterImage;
+  int ReadExtent[6];
+  int ScalarTypePolicy;
+  int AbortReading;
+  int PyramidLevels;
+  int PreviewLevel;
+  int TileCompression;
+  int TileSize[3];
+  double QuantizeLevel;
 };
 
 #endif
@@ -87,25 +87,6 @@ public:
   vtkWeakPointer<vtkMRMLAstroBeamDisplayableManager> DisplayableManager;
 };
 
-namespace
-{
-//----------------------------------------------------------------------------
-template <typename T> T StringToNumber(const char* num)
-{
-  std::stringstream ss;
-  ss << num;
-  T result;
-  return ss >> result ? result : 0;
-}
-
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
-}
-
-}// end namespace
-
 //---------------------------------------------------------------------------
 vtkStandardNewMacro(vtkMRMLAstroBeamDisplayableManager);
 
@@ -336,9 +317,8 @@ void vtkMRMLAstroBeamDisplayableManager::vtkInternal::UpdateBeam()
       continue;
       }
 
-    if (!strcmp(volumeNode->GetAttribute("SlicerAstro.BMAJ"), "UNDEFINED") ||
-        !strcmp(volumeNode->GetAttribute("SlicerAstro.BMIN"), "UNDEFINED") ||
-        !strcmp(volumeNode->GetAttribute("SlicerAstro.BPA"), "UNDEFINED"))
+    double beam[3];
+    if (!volumeNode->GetBeam(beam))
       {
       continue;
       }
@@ -349,18 +329,18 @@ void vtkMRMLAstroBeamDisplayableManager::vtkInternal::UpdateBeam()
     sliceLayerLogic->UpdateTransforms();
 
     vtkNew<vtkTransform> transform;
-    double BPA = StringToDouble(volumeNode->GetAttribute("SlicerAstro.BPA"));
+    double BPA = beam[2];
     transform->RotateZ(BPA);
     const double degtorad = atan(1.) / 45.;
     vtkNew<vtkGeneralTransform> ijkToXY;
     ijkToXY->DeepCopy(sliceLayerLogic->GetXYToIJKTransform());
     ijkToXY->Inverse();
 
-    double BMAJ = StringToDouble(volumeNode->GetAttribute("SlicerAstro.BMAJ"));
-    double BMIN = StringToDouble(volumeNode->GetAttribute("SlicerAstro.BMIN"));
-    double CDELT1 = StringToDouble(volumeNode->GetAttribute("SlicerAstro.CDELT1"));
-    double CDELT2 = StringToDouble(volumeNode->GetAttribute("SlicerAstro.CDELT2"));
-    double NAXIS1 = StringToDouble(volumeNode->GetAttribute("SlicerAstro.NAXIS1"));
+    double BMAJ = beam[0];
+    double BMIN = beam[1];
+    double CDELT1 = volumeNode->GetAxisIncrement(0);
+    double CDELT2 = volumeNode->GetAxisIncrement(1);
+    double NAXIS1 = volumeNode->GetAxisLength(0);
 
     double aCosPixel = BMIN * cos(BPA * degtorad) / CDELT1;
     double aSinPixel = BMIN * sin(BPA * degtorad) / CDELT2;
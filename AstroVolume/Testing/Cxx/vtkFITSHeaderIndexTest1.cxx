@@ -0,0 +1,168 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// vtkFits includes
+#include <vtkFITSHeaderIndex.h>
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool CheckUpdate(const std::string& directory, int expectedFiles, int expectedScanned,
+                 const std::string& cacheDirectory = std::string())
+{
+  // a new index each time: the entries must come from the index file
+  vtkNew<vtkFITSHeaderIndex> index;
+  index->SetDirectory(directory.c_str());
+  index->SetCacheDirectory(cacheDirectory.c_str());
+  if (!index->Update())
+    {
+    std::cerr << "Update failed on " << directory << std::endl;
+    return false;
+    }
+  if (index->GetNumberOfFiles() != expectedFiles ||
+      index->GetNumberOfScannedFiles() != expectedScanned)
+    {
+    std::cerr << "Expected " << expectedFiles << " files and " << expectedScanned
+              << " scanned, got " << index->GetNumberOfFiles() << " and "
+              << index->GetNumberOfScannedFiles() << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int FileReadable(const std::string& directory, const char* fileName)
+{
+  vtkNew<vtkFITSHeaderIndex> index;
+  index->SetDirectory(directory.c_str());
+  index->Update();
+  int fileIndex = index->GetFileIndex(fileName);
+  if (fileIndex < 0)
+    {
+    return -1;
+    }
+  return index->GetFileReadable(fileIndex) &&
+         index->GetHeaderValue(fileIndex, "NAXIS1") != nullptr ? 1 : 0;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// Only new and modified files are scanned, unreadable headers are indexed
+// (and not scanned again) and removed files are dropped from the index.
+// The index of a read-only directory is kept in the cache directory.
+int vtkFITSHeaderIndexTest1(int argc, char * argv[])
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: vtkFITSHeaderIndexTest1 cube.fits temporaryDirectory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string directory = std::string(argv[2]) + "/vtkFITSHeaderIndexTest1";
+  vtksys::SystemTools::RemoveADirectory(directory);
+  vtksys::SystemTools::MakeDirectory(directory);
+  std::string cube = directory + "/cube.fits";
+  std::string broken = directory + "/broken.fits";
+  vtksys::SystemTools::CopyAFile(argv[1], cube);
+
+  if (!CheckUpdate(directory, 1, 1) ||
+      !CheckUpdate(directory, 1, 0) ||
+      FileReadable(directory, "cube.fits") != 1)
+    {
+    return EXIT_FAILURE;
+    }
+
+  {
+  std::ofstream out(broken.c_str());
+  out << "not a FITS file";
+  }
+  TESTING_OUTPUT_ASSERT_WARNINGS_ERRORS_BEGIN();
+  if (!CheckUpdate(directory, 2, 1))
+    {
+    return EXIT_FAILURE;
+    }
+  TESTING_OUTPUT_ASSERT_WARNINGS_ERRORS_END();
+
+  // the failure is kept: the unchanged file is not read again
+  if (!CheckUpdate(directory, 2, 0) ||
+      FileReadable(directory, "broken.fits") != 0)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // a modified file is scanned again
+  vtksys::SystemTools::CopyAFile(argv[1], broken);
+  if (!CheckUpdate(directory, 2, 1) ||
+      FileReadable(directory, "broken.fits") != 1)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // removed files are dropped
+  vtksys::SystemTools::RemoveFile(cube);
+  if (!CheckUpdate(directory, 1, 0) ||
+      FileReadable(directory, "cube.fits") != -1)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // read-only directory: the index is written in the cache directory
+  std::string readOnly = std::string(argv[2]) + "/vtkFITSHeaderIndexTest1ReadOnly";
+  std::string cache = std::string(argv[2]) + "/vtkFITSHeaderIndexTest1Cache";
+  vtksys::SystemTools::RemoveADirectory(readOnly);
+  vtksys::SystemTools::RemoveADirectory(cache);
+  vtksys::SystemTools::MakeDirectory(readOnly);
+  vtksys::SystemTools::CopyAFile(argv[1], readOnly + "/cube.fits");
+  mode_t mode = 0;
+  vtksys::SystemTools::GetPermissions(readOnly, mode);
+  vtksys::SystemTools::SetPermissions(readOnly, mode & ~0222);
+  // (skipped when permissions are not enforced, e.g. as root)
+  if (!vtksys::SystemTools::TestFileAccess(readOnly, vtksys::TEST_FILE_WRITE))
+    {
+    bool cached = CheckUpdate(readOnly, 1, 1, cache) &&
+                  CheckUpdate(readOnly, 1, 0, cache) &&
+                  !vtksys::SystemTools::FileExists(readOnly + "/.SlicerAstroHeaderIndex");
+    vtksys::SystemTools::SetPermissions(readOnly, mode);
+    if (!cached)
+      {
+      std::cerr << "The index of the read-only directory is not cached in " << cache << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  vtksys::SystemTools::SetPermissions(readOnly, mode);
+  vtksys::SystemTools::RemoveADirectory(readOnly);
+  vtksys::SystemTools::RemoveADirectory(cache);
+
+  vtksys::SystemTools::RemoveADirectory(directory);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkShortArray.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Regression test for cubes with more than 2^31 voxels: the range scan must
+// reach voxels whose linear index does not fit in an int.
+int vtkMRMLAstroVolumeNodeLargeIndexTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+#if defined(_WIN32) || !defined(MAP_NORESERVE)
+  std::cout << "Sparse anonymous mappings not available, test skipped." << std::endl;
+  return EXIT_SUCCESS;
+#else
+  if (sizeof(vtkIdType) < 8)
+    {
+    std::cout << "vtkIdType is 32 bit, test skipped." << std::endl;
+    return EXIT_SUCCESS;
+    }
+
+  // 2048 x 1024 x 1025 voxels = 2^31 + 2^21.
+  const int dims[3] = {2048, 1024, 1025};
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  const size_t length = static_cast<size_t>(numElements) * sizeof(short);
+
+  // The untouched pages are never committed: they all read back as zero.
+  void *data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (data == MAP_FAILED)
+    {
+    std::cout << "Could not reserve " << length << " bytes, test skipped." << std::endl;
+    return EXIT_SUCCESS;
+    }
+
+  short *pixels = static_cast<short*>(data);
+  const vtkIdType maxIndex = (static_cast<vtkIdType>(1) << 31) + 5;
+  pixels[maxIndex] = 7;
+  pixels[numElements - 1] = -3;
+
+  vtkNew<vtkShortArray> array;
+  array->SetArray(pixels, numElements, 1);
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->GetPointData()->SetScalars(array.GetPointer());
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  int result = EXIT_SUCCESS;
+  if (!volumeNode->UpdateRangeAttributes())
+    {
+    std::cerr << "UpdateRangeAttributes failed" << std::endl;
+    result = EXIT_FAILURE;
+    }
+  else
+    {
+    double max = atof(volumeNode->GetAttribute("SlicerAstro.DATAMAX"));
+    double min = atof(volumeNode->GetAttribute("SlicerAstro.DATAMIN"));
+    if (max != 7. || min != -3.)
+      {
+      std::cerr << "Wrong range: expected [-3, 7], got ["
+                << min << ", " << max << "]" << std::endl;
+      result = EXIT_FAILURE;
+      }
+    }
+
+  volumeNode->SetAndObserveImageData(nullptr);
+  imageData->GetPointData()->SetScalars(nullptr);
+  munmap(data, length);
+
+  return result;
+#endif
+}
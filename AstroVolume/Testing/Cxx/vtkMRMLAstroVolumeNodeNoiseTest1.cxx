@@ -0,0 +1,150 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool CheckNoise(const char* name, double value, double expected, double tolerance)
+{
+  if (fabs(value - expected) > tolerance * expected)
+    {
+    std::cerr << "Wrong " << name << ": expected " << expected
+              << " within " << tolerance * 100. << "%, got " << value << std::endl;
+    return false;
+    }
+  return true;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The robust noise estimators, on the stratified sample of a cube of
+// Gaussian noise of known sigma, must recover the sigma also with NaN
+// voxels and bright sources in the cube.
+int vtkMRMLAstroVolumeNodeNoiseTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const double sigma = 2.5, offset = 0.3;
+  const int dims[3] = {64, 64, 64};
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+
+  float *pixels = static_cast<float*>(imageData->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  std::mt19937 generator(12345);
+  std::normal_distribution<double> gaussian(offset, sigma);
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    pixels[elemCnt] = static_cast<float>(gaussian(generator));
+    }
+  // 10% of blanked voxels
+  for (vtkIdType elemCnt = 3; elemCnt < numElements; elemCnt += 10)
+    {
+    pixels[elemCnt] = vtkMath::Nan();
+    }
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  volumeNode->SetNoiseSampleSize(1 << 16);
+
+  double madNoise = 0., clippedNoise = 0.;
+  if (!volumeNode->EstimateRobustNoise(madNoise, vtkMRMLAstroVolumeNode::MADNoiseEstimator) ||
+      !volumeNode->EstimateRobustNoise(clippedNoise, vtkMRMLAstroVolumeNode::SigmaClippedNoiseEstimator))
+    {
+    std::cerr << "EstimateRobustNoise failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  bool success = true;
+  success &= CheckNoise("MAD noise", madNoise, sigma, 0.03);
+  // the 3 sigma clipping converges to 0.985 sigma for Gaussian noise
+  success &= CheckNoise("sigma-clipped noise", clippedNoise, sigma, 0.03);
+  if (!success)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // the stratified sample depends only on the data
+  double noise = 0.;
+  volumeNode->EstimateRobustNoise(noise, vtkMRMLAstroVolumeNode::MADNoiseEstimator);
+  if (noise != madNoise)
+    {
+    std::cerr << "The stratified sample is not reproducible: "
+              << madNoise << " and " << noise << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // a sample size larger than the cube samples every voxel
+  volumeNode->SetNoiseSampleSize(numElements * 4);
+  if (!volumeNode->EstimateRobustNoise(noise, vtkMRMLAstroVolumeNode::MADNoiseEstimator) ||
+      !CheckNoise("MAD noise of the whole cube", noise, sigma, 0.02))
+    {
+    return EXIT_FAILURE;
+    }
+  volumeNode->SetNoiseSampleSize(1 << 16);
+
+  // 2% of bright sources: the robust estimators ignore them
+  for (vtkIdType elemCnt = 7; elemCnt < numElements; elemCnt += 50)
+    {
+    pixels[elemCnt] = static_cast<float>(offset + 40. * sigma);
+    }
+  imageData->Modified();
+  if (!volumeNode->EstimateRobustNoise(madNoise, vtkMRMLAstroVolumeNode::MADNoiseEstimator) ||
+      !volumeNode->EstimateRobustNoise(clippedNoise, vtkMRMLAstroVolumeNode::SigmaClippedNoiseEstimator))
+    {
+    std::cerr << "EstimateRobustNoise failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  success &= CheckNoise("MAD noise with sources", madNoise, sigma, 0.05);
+  success &= CheckNoise("sigma-clipped noise with sources", clippedNoise, sigma, 0.05);
+  if (!success)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // the estimator of a single calculation does not change the node one
+  if (!volumeNode->UpdateDisplayThresholdAttributes(vtkMRMLAstroVolumeNode::SigmaClippedNoiseEstimator) ||
+      !CheckNoise("display threshold", volumeNode->GetDisplayThreshold(), sigma, 0.05))
+    {
+    return EXIT_FAILURE;
+    }
+  if (volumeNode->GetNoiseEstimator() != vtkMRMLAstroVolumeNode::SlabNoiseEstimator)
+    {
+    std::cerr << "The noise estimator of the node has been changed to "
+              << volumeNode->GetNoiseEstimator() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
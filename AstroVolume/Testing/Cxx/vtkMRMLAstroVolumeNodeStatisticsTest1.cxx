@@ -0,0 +1,134 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool CheckValue(const char* name, double value, double expected)
+{
+  if (fabs(value - expected) > 1.E-9 * (1. + fabs(expected)))
+    {
+    std::cerr << "Wrong " << name << ": expected " << expected
+              << ", got " << value << std::endl;
+    return false;
+    }
+  return true;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The fused statistics pass must match the two-pass reference values and
+// be refreshed only when the image data is modified.
+int vtkMRMLAstroVolumeNodeStatisticsTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const int dims[3] = {37, 21, 50};
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(dims[0], dims[1], dims[2]);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+
+  float *pixels = static_cast<float*>(imageData->GetScalarPointer());
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    pixels[elemCnt] = 1000.f + static_cast<float>((elemCnt * 7919) % 1013) * 0.01f;
+    }
+  pixels[5] = vtkMath::Nan();
+  pixels[numElements / 2] = vtkMath::Nan();
+
+  double sum = 0., min = VTK_DOUBLE_MAX, max = VTK_DOUBLE_MIN;
+  vtkIdType count = 0;
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    if (pixels[elemCnt] != pixels[elemCnt])
+      {
+      continue;
+      }
+    sum += pixels[elemCnt];
+    min = std::min(min, static_cast<double>(pixels[elemCnt]));
+    max = std::max(max, static_cast<double>(pixels[elemCnt]));
+    count++;
+    }
+  const double mean = sum / count;
+  double m2 = 0.;
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    if (pixels[elemCnt] == pixels[elemCnt])
+      {
+      m2 += (pixels[elemCnt] - mean) * (pixels[elemCnt] - mean);
+      }
+    }
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  if (!volumeNode->UpdateStatistics())
+    {
+    std::cerr << "UpdateStatistics failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  bool success = true;
+  success &= CheckValue("minimum", volumeNode->GetStatisticsRange()[0], min);
+  success &= CheckValue("maximum", volumeNode->GetStatisticsRange()[1], max);
+  success &= CheckValue("mean", volumeNode->GetStatisticsMean(), mean);
+  success &= CheckValue("standard deviation",
+                        volumeNode->GetStatisticsStandardDeviation(), sqrt(m2 / count));
+  success &= CheckValue("NaN count", volumeNode->GetStatisticsNaNCount(), 2);
+  if (!success)
+    {
+    return EXIT_FAILURE;
+    }
+
+  // cached until the data is modified, also by UpdateRangeAttributes
+  pixels[7] = 5000.f;
+  volumeNode->UpdateStatistics();
+  if (!CheckValue("cached maximum", volumeNode->GetStatisticsRange()[1], max))
+    {
+    return EXIT_FAILURE;
+    }
+  volumeNode->UpdateRangeAttributes();
+  if (!CheckValue("cached DATAMAX", volumeNode->GetDataMax(), max))
+    {
+    return EXIT_FAILURE;
+    }
+  imageData->Modified();
+  volumeNode->UpdateStatistics();
+  if (!CheckValue("updated maximum", volumeNode->GetStatisticsRange()[1], 5000.))
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
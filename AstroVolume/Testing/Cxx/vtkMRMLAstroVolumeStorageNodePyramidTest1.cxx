@@ -0,0 +1,185 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkMRMLAstroVolumeNode* ReadVolume(vtkMRMLScene *scene, const std::string& fileName,
+                                   int previewLevel)
+{
+  vtkNew<vtkMRMLAstroVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  scene->AddNode(volumeNode.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  vtkNew<vtkMRMLAstroVolumeStorageNode> storageNode;
+  scene->AddNode(storageNode.GetPointer());
+  volumeNode->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  storageNode->SetFileName(fileName.c_str());
+  storageNode->SetPreviewLevel(previewLevel);
+  if (!storageNode->ReadData(volumeNode.GetPointer()) || !volumeNode->GetImageData())
+    {
+    std::cerr << "Could not read level " << previewLevel << " of " << fileName << std::endl;
+    return nullptr;
+    }
+  return volumeNode.GetPointer();
+}
+
+//-----------------------------------------------------------------------------
+// Each voxel of level must be the NaN-aware average of the 2x2x2 block
+// (smaller on the borders) of the finer level
+bool CheckLevel(vtkImageData *finer, vtkImageData *level)
+{
+  int finerDims[3], dims[3];
+  finer->GetDimensions(finerDims);
+  level->GetDimensions(dims);
+  for (int ii = 0; ii < 3; ii++)
+    {
+    if (dims[ii] != (finerDims[ii] + 1) / 2)
+      {
+      std::cerr << "Wrong dimension " << ii << " of the level: " << dims[ii] << std::endl;
+      return false;
+      }
+    }
+
+  const float *finerPtr = static_cast<float*>(finer->GetScalarPointer());
+  const float *levelPtr = static_cast<float*>(level->GetScalarPointer());
+  for (int kk = 0; kk < dims[2]; kk++)
+    {
+    for (int jj = 0; jj < dims[1]; jj++)
+      {
+      for (int ii = 0; ii < dims[0]; ii++)
+        {
+        double sum = 0.;
+        int count = 0;
+        for (int zz = 2 * kk; zz < 2 * kk + 2 && zz < finerDims[2]; zz++)
+          {
+          for (int yy = 2 * jj; yy < 2 * jj + 2 && yy < finerDims[1]; yy++)
+            {
+            for (int xx = 2 * ii; xx < 2 * ii + 2 && xx < finerDims[0]; xx++)
+              {
+              float value = finerPtr[(static_cast<vtkIdType>(zz) * finerDims[1] + yy) * finerDims[0] + xx];
+              if (!std::isnan(value))
+                {
+                sum += value;
+                count++;
+                }
+              }
+            }
+          }
+        float value = levelPtr[(static_cast<vtkIdType>(kk) * dims[1] + jj) * dims[0] + ii];
+        if (count == 0 ? !std::isnan(value) : fabs(value - sum / count) > 1.E-5 * (1. + fabs(sum / count)))
+          {
+          std::cerr << "Wrong value of voxel (" << ii << ", " << jj << ", " << kk << "): "
+                    << value << " instead of " << (count ? sum / count : 0.) << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The pyramid of a cube on disk is built without rewriting the cube, each
+// level averaging the previous one.
+int vtkMRMLAstroVolumeStorageNodePyramidTest1(int argc, char * argv[])
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: vtkMRMLAstroVolumeStorageNodePyramidTest1 cube.fits temporaryDirectory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string fileName = std::string(argv[2]) + "/vtkMRMLAstroVolumeStorageNodePyramidTest1.fits";
+  std::string pyramidName = vtkMRMLAstroVolumeStorageNode::GetPyramidFileName(fileName);
+  vtksys::SystemTools::RemoveFile(pyramidName);
+  if (!vtksys::SystemTools::CopyFileAlways(argv[1], fileName))
+    {
+    std::cerr << "Could not copy " << argv[1] << " in " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  const long int cubeTime = vtksys::SystemTools::ModifiedTime(fileName);
+
+  vtkNew<vtkMRMLAstroVolumeStorageNode> pyramidStorageNode;
+  pyramidStorageNode->SetFileName(fileName.c_str());
+  pyramidStorageNode->SetPyramidLevels(2);
+  if (!pyramidStorageNode->WritePyramid() ||
+      !vtksys::SystemTools::FileExists(pyramidName.c_str(), true))
+    {
+    std::cerr << "Could not write the pyramid " << pyramidName << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (vtksys::SystemTools::ModifiedTime(fileName) != cubeTime)
+    {
+    std::cerr << "The cube has been rewritten" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLAstroVolumeNode *cubeVolume = ReadVolume(scene.GetPointer(), fileName, 0);
+  vtkMRMLAstroVolumeNode *level1Volume = ReadVolume(scene.GetPointer(), fileName, 1);
+  vtkMRMLAstroVolumeNode *level2Volume = ReadVolume(scene.GetPointer(), fileName, 2);
+  if (!cubeVolume || !level1Volume || !level2Volume)
+    {
+    return EXIT_FAILURE;
+    }
+  if (cubeVolume->GetImageData()->GetScalarType() != VTK_FLOAT ||
+      level1Volume->GetImageData()->GetScalarType() != VTK_FLOAT ||
+      level2Volume->GetImageData()->GetScalarType() != VTK_FLOAT ||
+      !level1Volume->GetAttribute("SlicerAstro.PYRLEVEL") ||
+      strcmp(level1Volume->GetAttribute("SlicerAstro.PYRLEVEL"), "1") ||
+      !level2Volume->GetAttribute("SlicerAstro.PYRLEVEL") ||
+      strcmp(level2Volume->GetAttribute("SlicerAstro.PYRLEVEL"), "2"))
+    {
+    std::cerr << "The pyramid levels are not float levels tagged with PYRLEVEL" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (!CheckLevel(cubeVolume->GetImageData(), level1Volume->GetImageData()) ||
+      !CheckLevel(level1Volume->GetImageData(), level2Volume->GetImageData()))
+    {
+    return EXIT_FAILURE;
+    }
+
+  vtksys::SystemTools::RemoveFile(pyramidName);
+  vtksys::SystemTools::RemoveFile(fileName);
+  return EXIT_SUCCESS;
+}
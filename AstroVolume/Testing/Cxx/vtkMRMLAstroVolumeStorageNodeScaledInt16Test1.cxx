@@ -0,0 +1,162 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLScene.h>
+
+// vtkFits includes
+#include <vtkFITSReader.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkMRMLAstroVolumeNode* ReadVolume(vtkMRMLScene *scene, const std::string& fileName,
+                                   int scalarTypePolicy)
+{
+  vtkNew<vtkMRMLAstroVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  scene->AddNode(volumeNode.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  vtkNew<vtkMRMLAstroVolumeStorageNode> storageNode;
+  scene->AddNode(storageNode.GetPointer());
+  volumeNode->SetAndObserveStorageNodeID(storageNode->GetID());
+
+  storageNode->SetFileName(fileName.c_str());
+  storageNode->SetScalarTypePolicy(scalarTypePolicy);
+  if (!storageNode->ReadData(volumeNode.GetPointer()) || !volumeNode->GetImageData())
+    {
+    std::cerr << "Could not read " << fileName << std::endl;
+    return nullptr;
+    }
+  return volumeNode.GetPointer();
+}
+
+//-----------------------------------------------------------------------------
+double AttributeToDouble(vtkMRMLAstroVolumeNode *volumeNode, const char *name, double defaultValue)
+{
+  const char *value = volumeNode->GetAttribute(name);
+  return value && strcmp(value, "UNDEFINED") ? atof(value) : defaultValue;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// A cube loaded as scaled int16 is saved as stored, with its BSCALE/BZERO
+// and BLANK keywords: read back, its physical values are the ones of the
+// int16 volume, within the quantization step of the original cube.
+int vtkMRMLAstroVolumeStorageNodeScaledInt16Test1(int argc, char * argv[])
+{
+  if (argc < 3)
+    {
+    std::cerr << "Usage: vtkMRMLAstroVolumeStorageNodeScaledInt16Test1 cube.fits temporaryDirectory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkMRMLAstroVolumeNode *originalVolume =
+    ReadVolume(scene.GetPointer(), argv[1], vtkFITSReader::NativeScalarType);
+  vtkMRMLAstroVolumeNode *int16Volume =
+    ReadVolume(scene.GetPointer(), argv[1], vtkFITSReader::ScaledInt16ScalarType);
+  if (!originalVolume || !int16Volume)
+    {
+    return EXIT_FAILURE;
+    }
+  if (originalVolume->GetImageData()->GetScalarType() != VTK_FLOAT ||
+      int16Volume->GetImageData()->GetScalarType() != VTK_SHORT)
+    {
+    std::cerr << "Wrong scalar types of the native and scaled int16 volumes" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string fileName = std::string(argv[2]) + "/vtkMRMLAstroVolumeStorageNodeScaledInt16Test1.fits";
+  vtksys::SystemTools::RemoveFile(fileName);
+  vtkMRMLStorageNode *storageNode = int16Volume->GetStorageNode();
+  storageNode->SetFileName(fileName.c_str());
+  if (!storageNode->WriteData(int16Volume))
+    {
+    std::cerr << "Could not save the scaled int16 volume in " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkMRMLAstroVolumeNode *savedVolume =
+    ReadVolume(scene.GetPointer(), fileName, vtkFITSReader::NativeScalarType);
+  if (!savedVolume)
+    {
+    return EXIT_FAILURE;
+    }
+  if (savedVolume->GetImageData()->GetScalarType() != VTK_FLOAT ||
+      strcmp(savedVolume->GetAttribute("SlicerAstro.BITPIX"), "16"))
+    {
+    std::cerr << "The scaled int16 volume has not been saved with BITPIX 16" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double bscale = AttributeToDouble(int16Volume, "SlicerAstro.BSCALE", 1.);
+  const double bzero = AttributeToDouble(int16Volume, "SlicerAstro.BZERO", 0.);
+  const double blank = AttributeToDouble(int16Volume, "SlicerAstro.BLANK", vtkMath::Nan());
+  const vtkIdType numElements = originalVolume->GetImageData()->GetNumberOfPoints();
+  if (savedVolume->GetImageData()->GetNumberOfPoints() != numElements)
+    {
+    std::cerr << "The saved volume has not the size of the original one" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const float *original = static_cast<float*>(originalVolume->GetImageData()->GetScalarPointer());
+  const short *stored = static_cast<short*>(int16Volume->GetImageData()->GetScalarPointer());
+  const float *saved = static_cast<float*>(savedVolume->GetImageData()->GetScalarPointer());
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    if (stored[elemCnt] == blank)
+      {
+      if (!std::isnan(saved[elemCnt]) || !std::isnan(original[elemCnt]))
+        {
+        std::cerr << "Voxel " << elemCnt << " is not blanked" << std::endl;
+        return EXIT_FAILURE;
+        }
+      continue;
+      }
+    const double physical = bscale * stored[elemCnt] + bzero;
+    if (fabs(saved[elemCnt] - physical) > 1.E-6 * (1. + fabs(physical)) ||
+        fabs(saved[elemCnt] - original[elemCnt]) > 0.5 * fabs(bscale) + 1.E-6 * (1. + fabs(physical)))
+      {
+      std::cerr << "Wrong value of voxel " << elemCnt << ": " << saved[elemCnt]
+                << ", stored " << physical << ", original " << original[elemCnt] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  vtksys::SystemTools::RemoveFile(fileName);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+
+// Logic includes
+#include <vtkSlicerAstroVolumeLogic.h>
+
+// VTK includes
+#include <vtkCollection.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Every voxel at the center of bin (voxel * 37) % numberOfBins, every
+// 101st voxel NaN. Return the expected counts.
+std::vector<int> FillCube(vtkImageData *imageData, double minimum, double maximum,
+                          int numberOfBins, bool logScale)
+{
+  std::vector<int> expected(numberOfBins, 0);
+  double *pixels = static_cast<double*>(imageData->GetScalarPointer());
+  int *dims = imageData->GetDimensions();
+  const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    if (elemCnt % 101 == 0)
+      {
+      pixels[elemCnt] = vtkMath::Nan();
+      continue;
+      }
+    const int bin = static_cast<int>((elemCnt * 37) % numberOfBins);
+    pixels[elemCnt] = 0.5 *
+      (vtkSlicerAstroVolumeLogic::GetHistogramBinEdge(minimum, maximum, numberOfBins, bin, logScale) +
+       vtkSlicerAstroVolumeLogic::GetHistogramBinEdge(minimum, maximum, numberOfBins, bin + 1, logScale));
+    expected[bin]++;
+    }
+  imageData->Modified();
+  return expected;
+}
+
+//-----------------------------------------------------------------------------
+bool CheckCounts(const char* name, vtkIntArray *histoArray, const std::vector<int>& expected)
+{
+  for (vtkIdType binCnt = 0; binCnt < histoArray->GetNumberOfValues(); binCnt++)
+    {
+    if (histoArray->GetValue(binCnt) != expected[binCnt])
+      {
+      std::cerr << "Wrong " << name << " count in bin " << binCnt << ": expected "
+                << expected[binCnt] << ", got " << histoArray->GetValue(binCnt) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The histograms filled together in one pass must match the counts of
+// each resolution, with linear and logarithmic bins.
+int vtkSlicerAstroVolumeLogicHistogramTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const double minimum = -1., maximum = 3.;
+  const int numberOfBins = 100;
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(31, 17, 23);
+  imageData->AllocateScalars(VTK_DOUBLE, 1);
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  vtkNew<vtkSlicerAstroVolumeLogic> logic;
+
+  // linear bins: 100 and 50 bins in the same pass
+  std::vector<int> expected = FillCube(imageData.GetPointer(), minimum, maximum, numberOfBins, false);
+  std::vector<int> expectedCoarse(numberOfBins / 2, 0);
+  for (int binCnt = 0; binCnt < numberOfBins; binCnt++)
+    {
+    expectedCoarse[binCnt / 2] += expected[binCnt];
+    }
+
+  vtkNew<vtkIntArray> histoArray;
+  histoArray->SetNumberOfValues(numberOfBins);
+  vtkNew<vtkIntArray> coarseHistoArray;
+  coarseHistoArray->SetNumberOfValues(numberOfBins / 2);
+  vtkNew<vtkCollection> histoArrays;
+  histoArrays->AddItem(histoArray.GetPointer());
+  histoArrays->AddItem(coarseHistoArray.GetPointer());
+  if (!logic->CalculateHistograms(volumeNode.GetPointer(), histoArrays.GetPointer(),
+                                  minimum, maximum) ||
+      !CheckCounts("linear", histoArray.GetPointer(), expected) ||
+      !CheckCounts("coarse linear", coarseHistoArray.GetPointer(), expectedCoarse))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // logarithmic bins, on new data
+  expected = FillCube(imageData.GetPointer(), minimum, maximum, numberOfBins, true);
+  vtkNew<vtkCollection> logHistoArrays;
+  logHistoArrays->AddItem(histoArray.GetPointer());
+  if (!logic->CalculateHistograms(volumeNode.GetPointer(), logHistoArrays.GetPointer(),
+                                  minimum, maximum, true) ||
+      !CheckCounts("logarithmic", histoArray.GetPointer(), expected))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // the bin edges span the range
+  if (vtkSlicerAstroVolumeLogic::GetHistogramBinEdge(minimum, maximum, numberOfBins, 0, true) != minimum ||
+      fabs(vtkSlicerAstroVolumeLogic::GetHistogramBinEdge
+        (minimum, maximum, numberOfBins, numberOfBins, true) - maximum) > 1.E-9)
+    {
+    std::cerr << "The logarithmic bin edges do not span [minimum, maximum]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroVolumeNode.h>
+
+// Logic includes
+#include <vtkSlicerAstroVolumeLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// The processing modules see a scaled int16 cube as its float physical
+// values (BSCALE * value + BZERO, NaN for BLANK) and convert the outputs
+// cloned from it to float.
+int vtkSlicerAstroVolumeLogicPhysicalValuesTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  const double bscale = 0.5, bzero = -3.;
+  const short blank = -32768;
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(7, 5, 3);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short *pixels = static_cast<short*>(imageData->GetScalarPointer());
+  const vtkIdType numElements = imageData->GetNumberOfPoints();
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    pixels[elemCnt] = elemCnt % 11 == 0 ? blank : static_cast<short>(elemCnt - 50);
+    }
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAttribute("SlicerAstro.BITPIX", "16");
+  volumeNode->SetAttribute("SlicerAstro.BSCALE", "0.5");
+  volumeNode->SetAttribute("SlicerAstro.BZERO", "-3.");
+  volumeNode->SetAttribute("SlicerAstro.BLANK", "-32768");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+
+  vtkSmartPointer<vtkImageData> physicalImageData =
+    vtkSlicerAstroVolumeLogic::GetPhysicalImageData(volumeNode.GetPointer());
+  if (!physicalImageData || physicalImageData->GetScalarType() != VTK_FLOAT ||
+      physicalImageData->GetNumberOfPoints() != numElements)
+    {
+    std::cerr << "The physical values of a scaled int16 cube are not a float cube" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const float *values = static_cast<float*>(physicalImageData->GetScalarPointer());
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    const bool blanked = elemCnt % 11 == 0;
+    if (blanked != std::isnan(values[elemCnt]) ||
+        (!blanked && fabs(values[elemCnt] - (bscale * (elemCnt - 50) + bzero)) > 1.E-6))
+      {
+      std::cerr << "Wrong physical value of voxel " << elemCnt << ": " << values[elemCnt] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // the float cubes are used as they are
+  vtkNew<vtkImageData> floatImageData;
+  floatImageData->SetDimensions(7, 5, 3);
+  floatImageData->AllocateScalars(VTK_FLOAT, 1);
+  vtkNew<vtkMRMLAstroVolumeNode> floatVolumeNode;
+  floatVolumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  floatVolumeNode->SetAndObserveImageData(floatImageData.GetPointer());
+  if (vtkSlicerAstroVolumeLogic::GetPhysicalImageData(floatVolumeNode.GetPointer()).GetPointer() !=
+      floatImageData.GetPointer())
+    {
+    std::cerr << "The physical values of a float cube are copied" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // an output cloned from the scaled int16 cube becomes a float cube
+  vtkNew<vtkImageData> outputImageData;
+  outputImageData->DeepCopy(imageData.GetPointer());
+  vtkNew<vtkMRMLAstroVolumeNode> outputVolumeNode;
+  const char *attributes[] = {"SlicerAstro.NAXIS", "SlicerAstro.BITPIX", "SlicerAstro.BSCALE",
+                              "SlicerAstro.BZERO", "SlicerAstro.BLANK"};
+  for (int attributeCnt = 0; attributeCnt < 5; attributeCnt++)
+    {
+    outputVolumeNode->SetAttribute(attributes[attributeCnt],
+                                   volumeNode->GetAttribute(attributes[attributeCnt]));
+    }
+  outputVolumeNode->SetAndObserveImageData(outputImageData.GetPointer());
+  if (!vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(outputVolumeNode.GetPointer(), VTK_FLOAT) ||
+      outputImageData->GetScalarType() != VTK_FLOAT ||
+      outputImageData->GetNumberOfPoints() != numElements ||
+      strcmp(outputVolumeNode->GetAttribute("SlicerAstro.BITPIX"), "-32") ||
+      strcmp(outputVolumeNode->GetAttribute("SlicerAstro.BLANK"), "UNDEFINED"))
+    {
+    std::cerr << "The output of a scaled int16 cube is not converted to float" << std::endl;
+    return EXIT_FAILURE;
+    }
+  double outputBscale = 0., outputBzero = 0.;
+  vtkSlicerAstroVolumeLogic::GetPhysicalScaling(outputVolumeNode.GetPointer(), outputBscale, outputBzero);
+  if (outputBscale != 1. || outputBzero != 0.)
+    {
+    std::cerr << "The output of a scaled int16 cube is still scaled" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // an output of another floating point type is refused
+  if (vtkSlicerAstroVolumeLogic::SetPhysicalScalarType(outputVolumeNode.GetPointer(), VTK_DOUBLE))
+    {
+    std::cerr << "A float output has been accepted as double" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+// MRML includes
+#include <vtkMRMLAstroLabelMapVolumeNode.h>
+#include <vtkMRMLAstroVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// Logic includes
+#include <vtkSlicerAstroVolumeLogic.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool CheckEntry(vtkSlicerAstroVolumeLogic *logic, vtkMRMLAstroVolumeNode *volume,
+                const char *key, vtkMRMLNode *regionNode, bool expectedHit,
+                double expectedValue = 0.)
+{
+  vtkNew<vtkDoubleArray> values;
+  bool hit = logic->GetCachedStatistics(volume, key, values.GetPointer(), regionNode);
+  if (hit != expectedHit)
+    {
+    std::cerr << "Entry " << key << (regionNode ? " of the region" : "")
+              << ": expected a " << (expectedHit ? "hit" : "miss")
+              << ", got a " << (hit ? "hit" : "miss") << std::endl;
+    return false;
+    }
+  if (hit && (values->GetNumberOfValues() != 1 || values->GetValue(0) != expectedValue))
+    {
+    std::cerr << "Entry " << key << ": wrong cached value" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SetEntry(vtkSlicerAstroVolumeLogic *logic, vtkMRMLAstroVolumeNode *volume,
+              const char *key, vtkMRMLNode *regionNode, double value)
+{
+  vtkNew<vtkDoubleArray> values;
+  values->InsertNextValue(value);
+  logic->SetCachedStatistics(volume, key, values.GetPointer(), regionNode);
+}
+
+}// end namespace
+
+//-----------------------------------------------------------------------------
+// The statistics cache returns the stored entries until the image data, or
+// the region they refer to, is modified, and evicts the entries of the
+// same statistics when their parameters change.
+int vtkSlicerAstroVolumeLogicStatisticsCacheTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv)[])
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(16, 16, 16);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+  float *pixels = static_cast<float*>(imageData->GetScalarPointer());
+  const vtkIdType numElements = 16 * 16 * 16;
+  for (vtkIdType elemCnt = 0; elemCnt < numElements; elemCnt++)
+    {
+    pixels[elemCnt] = static_cast<float>(elemCnt % 7) - 3.f;
+    }
+
+  vtkNew<vtkMRMLAstroVolumeNode> volumeNode;
+  volumeNode->SetAttribute("SlicerAstro.NAXIS", "3");
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(volumeNode.GetPointer());
+
+  vtkNew<vtkImageData> maskData;
+  maskData->SetDimensions(16, 16, 16);
+  maskData->AllocateScalars(VTK_SHORT, 1);
+  maskData->GetPointData()->GetScalars()->FillComponent(0, 1.);
+  vtkNew<vtkMRMLAstroLabelMapVolumeNode> maskNode;
+  maskNode->SetAndObserveImageData(maskData.GetPointer());
+  scene->AddNode(maskNode.GetPointer());
+
+  vtkNew<vtkSlicerAstroVolumeLogic> logic;
+
+  // hits until the data is modified
+  SetEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", nullptr, 1.5);
+  SetEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", maskNode.GetPointer(), 2.5);
+  if (!CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", nullptr, true, 1.5) ||
+      !CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", maskNode.GetPointer(), true, 2.5) ||
+      !CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Median", nullptr, false))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // painting the mask invalidates only the entries of the region
+  maskData->Modified();
+  if (!CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", maskNode.GetPointer(), false) ||
+      !CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", nullptr, true, 1.5))
+    {
+    return EXIT_FAILURE;
+    }
+
+  imageData->Modified();
+  if (!CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Noise", nullptr, false))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // new parameters of the same statistics replace the entry, while the
+  // histograms at other resolutions are kept
+  SetEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram100 -3 3 0", nullptr, 1.);
+  SetEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram50 -3 3 0", nullptr, 2.);
+  SetEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram100 -3 4 0", nullptr, 3.);
+  if (!CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram100 -3 3 0", nullptr, false) ||
+      !CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram100 -3 4 0", nullptr, true, 3.) ||
+      !CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram50 -3 3 0", nullptr, true, 2.))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // removing the volume drops its entries
+  logic->ClearStatisticsCache(volumeNode.GetPointer());
+  if (!CheckEntry(logic.GetPointer(), volumeNode.GetPointer(), "Histogram50 -3 3 0", nullptr, false))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // the range and noise attributes come from the cache until the data is
+  // modified: a voxel changed without Modified is not seen
+  if (!logic->UpdateStatisticsAttributes(volumeNode.GetPointer()) ||
+      volumeNode->GetDataMin() != -3. || volumeNode->GetDataMax() != 3.)
+    {
+    std::cerr << "Wrong range attributes: " << volumeNode->GetDataMin()
+              << " " << volumeNode->GetDataMax() << std::endl;
+    return EXIT_FAILURE;
+    }
+  pixels[5] = 10.f;
+  volumeNode->SetAttribute("SlicerAstro.DATAMAX", "0");
+  if (!logic->UpdateStatisticsAttributes(volumeNode.GetPointer()) ||
+      volumeNode->GetDataMax() != 3.)
+    {
+    std::cerr << "The range attributes have not been restored from the cache: "
+              << volumeNode->GetDataMax() << std::endl;
+    return EXIT_FAILURE;
+    }
+  imageData->Modified();
+  if (!logic->UpdateStatisticsAttributes(volumeNode.GetPointer()) ||
+      volumeNode->GetDataMax() != 10.)
+    {
+    std::cerr << "The range attributes have not been updated: "
+              << volumeNode->GetDataMax() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // the percentiles of the cached histogram
+  double median = logic->CalculatePercentile(volumeNode.GetPointer(), 0.5);
+  if (median < -3. || median > 3.)
+    {
+    std::cerr << "Wrong median: " << median << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -49,6 +49,9 @@
 #include <vtkMRMLScalarVolumeDisplayNode.h>
 #include <vtkMRMLStorageNode.h>
 
+// AstroVolume includes
+#include <vtkMRMLAstroVolumeStorageNode.h>
+
 // VTK includes
 #include <vtkDataArray.h>
 #include <vtkImageAlgorithm.h>
@@ -87,6 +90,9 @@ public:
   QLineEdit *FileNameLineEdit;
   QLabel *LabelMapLabel;
   QCheckBox *LabelMapCheckBox;
+  QLabel *PyramidLevelsLabel;
+  QSpinBox *PyramidLevelsSpinBox;
+  QPushButton *BuildPyramidPushButton;
 };
 
 //------------------------------------------------------------------------------
@@ -199,6 +205,30 @@ void qMRMLAstroVolumeInfoWidgetPrivate::init()
 
   this->formLayout->setWidget(10, QFormLayout::FieldRole, LabelMapCheckBox);
 
+  this->PyramidLevelsLabel = new QLabel(q);
+  this->PyramidLevelsLabel->setObjectName(QLatin1String("PyramidLevelsLabel"));
+
+  this->formLayout->setWidget(11, QFormLayout::LabelRole, PyramidLevelsLabel);
+
+  this->PyramidLevelsSpinBox = new QSpinBox(q);
+  this->PyramidLevelsSpinBox->setObjectName(QLatin1String("PyramidLevelsSpinBox"));
+  this->PyramidLevelsSpinBox->setMinimum(0);
+  this->PyramidLevelsSpinBox->setMaximum(14);
+  this->PyramidLevelsSpinBox->setValue(0);
+  this->PyramidLevelsSpinBox->setToolTip("Number of levels of the multi-resolution pyramid "
+                                         "written next to the cube on save (each level halves "
+                                         "the resolution along every axis). The levels can be "
+                                         "loaded as a preview of the cube.");
+
+  this->formLayout->setWidget(11, QFormLayout::FieldRole, PyramidLevelsSpinBox);
+
+  this->BuildPyramidPushButton = new QPushButton(q);
+  this->BuildPyramidPushButton->setObjectName(QLatin1String("BuildPyramidPushButton"));
+  this->BuildPyramidPushButton->setToolTip("Write the multi-resolution pyramid of the saved "
+                                           "cube now, without saving the cube again.");
+
+  this->formLayout->setWidget(12, QFormLayout::FieldRole, BuildPyramidPushButton);
+
   QMetaObject::connectSlotsByName(q);
 
   q->setWindowTitle("Volume Information");
@@ -212,6 +242,8 @@ void qMRMLAstroVolumeInfoWidgetPrivate::init()
   this->FileNameLabel->setText("File Name:");
   this->LabelMapLabel->setText("LabelMap:");
   this->LabelMapCheckBox->setText(QString());
+  this->PyramidLevelsLabel->setText("Pyramid Levels:");
+  this->BuildPyramidPushButton->setText("Build Pyramid");
 
   QObject::connect(q, SIGNAL(mrmlSceneChanged(vtkMRMLScene*)),
                    this->ImageDimensionsWidget, SLOT(setMRMLScene(vtkMRMLScene*)));
@@ -228,6 +260,10 @@ void qMRMLAstroVolumeInfoWidgetPrivate::init()
                    q, SLOT(setImageOrigin(double*)));
   QObject::connect(this->CenterVolumePushButton, SIGNAL(clicked()),
                    q, SLOT(center()));
+  QObject::connect(this->PyramidLevelsSpinBox, SIGNAL(valueChanged(int)),
+                   q, SLOT(setPyramidLevels(int)));
+  QObject::connect(this->BuildPyramidPushButton, SIGNAL(clicked()),
+                   q, SLOT(buildPyramid()));
 
   q->setEnabled(this->VolumeNode != 0);
 }
@@ -327,6 +363,10 @@ void qMRMLAstroVolumeInfoWidget::updateWidgetFromMRML()
 
     d->LabelMapCheckBox->setChecked(false);
 
+    d->PyramidLevelsSpinBox->setValue(0);
+
+    d->BuildPyramidPushButton->setEnabled(false);
+
     return;
     }
   vtkImageData* image = d->VolumeNode->GetImageData();
@@ -378,6 +418,17 @@ void qMRMLAstroVolumeInfoWidget::updateWidgetFromMRML()
 
   vtkMRMLLabelMapVolumeNode *labelMapNode = vtkMRMLLabelMapVolumeNode::SafeDownCast( d->VolumeNode );
   d->LabelMapCheckBox->setChecked(labelMapNode!=0);
+
+  // the pyramid is written for data cubes only
+  vtkMRMLAstroVolumeStorageNode* astroStorageNode =
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(storageNode);
+  d->PyramidLevelsSpinBox->setEnabled(astroStorageNode && !labelMapNode);
+  state = d->PyramidLevelsSpinBox->blockSignals(true);
+  d->PyramidLevelsSpinBox->setValue(astroStorageNode ? astroStorageNode->GetPyramidLevels() : 0);
+  d->PyramidLevelsSpinBox->blockSignals(state);
+  d->BuildPyramidPushButton->setEnabled(astroStorageNode && !labelMapNode &&
+                                        astroStorageNode->GetFileName() &&
+                                        astroStorageNode->GetPyramidLevels() > 0);
 }
 
 //------------------------------------------------------------------------------
@@ -419,6 +470,37 @@ void qMRMLAstroVolumeInfoWidget::setImageOrigin(double* IJKOrigin)
   d->VolumeNode->SetOrigin(RASOrigin);
 }
 
+//------------------------------------------------------------------------------
+void qMRMLAstroVolumeInfoWidget::setPyramidLevels(int levels)
+{
+  Q_D(qMRMLAstroVolumeInfoWidget);
+  vtkMRMLAstroVolumeStorageNode* storageNode = d->VolumeNode ?
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(d->VolumeNode->GetStorageNode()) : 0;
+  if (storageNode == 0)
+    {
+    return;
+    }
+  storageNode->SetPyramidLevels(levels);
+  d->BuildPyramidPushButton->setEnabled(storageNode->GetFileName() && levels > 0);
+}
+
+//------------------------------------------------------------------------------
+void qMRMLAstroVolumeInfoWidget::buildPyramid()
+{
+  Q_D(qMRMLAstroVolumeInfoWidget);
+  vtkMRMLAstroVolumeStorageNode* storageNode = d->VolumeNode ?
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(d->VolumeNode->GetStorageNode()) : 0;
+  if (storageNode == 0)
+    {
+    return;
+    }
+  if (!storageNode->WritePyramid())
+    {
+    qWarning() << Q_FUNC_INFO << ": the multi-resolution pyramid of "
+               << storageNode->GetFileName() << " could not be written.";
+    }
+}
+
 //------------------------------------------------------------------------------
 bool qMRMLAstroVolumeInfoWidget::isCentered()const
 {
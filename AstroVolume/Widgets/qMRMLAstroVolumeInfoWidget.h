@@ -72,6 +72,12 @@ public slots:
   /// Set the number of scalar component
   void setNumberOfScalars(int);
 
+  /// Set the number of multi-resolution pyramid levels written on save
+  void setPyramidLevels(int);
+
+  /// Write the multi-resolution pyramid of the saved cube
+  void buildPyramid();
+
 protected slots:
   /// Update widget GUI from MRML AstroVolume node
   void updateWidgetFromMRML();
@@ -333,7 +333,7 @@ void qMRMLSliceAstroControllerWidget::setWCSDisplay()
     if (astroVolume && displayNode)
       {
 
-      if (StringToInt(astroVolume->GetAttribute("SlicerAstro.NAXIS")) < 3)
+      if (astroVolume->GetNumberOfAxes() < 3)
         {
         hasDisplay = false;
         break;
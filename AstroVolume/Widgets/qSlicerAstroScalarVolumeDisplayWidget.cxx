@@ -130,12 +130,6 @@ double StringToDouble(const char* str)
   return StringToNumber<double>(str);
 }
 
-//----------------------------------------------------------------------------
-int StringToInt(const char* str)
-{
-  return StringToNumber<int>(str);
-}
-
 //----------------------------------------------------------------------------
 template <typename T> std::string NumberToString(T V)
 {
@@ -790,9 +784,9 @@ void qSlicerAstroScalarVolumeDisplayWidget::onCreateContours()
   std::stringstream ss(LevelsStdString);
 
   double value;
-  double MIN = StringToDouble(masterVolume->GetAttribute("SlicerAstro.DATAMIN"));
-  double MAX = StringToDouble(masterVolume->GetAttribute("SlicerAstro.DATAMAX"));
-  double DisplayThreshold = StringToDouble(masterVolume->GetAttribute("SlicerAstro.DisplayThreshold"));
+  double MIN = masterVolume->GetDataMin();
+  double MAX = masterVolume->GetDataMax();
+  double DisplayThreshold = masterVolume->GetDisplayThreshold();
   if (DisplayThreshold < 1.E-6)
     {
     DisplayThreshold = (MAX - MIN) * 0.01;
@@ -1005,7 +999,7 @@ void qSlicerAstroScalarVolumeDisplayWidget::onCreateContours()
     }
 
   // Create empty segment in current segmentation
-  int LevelDim = 0;
+  vtkIdType LevelDim = 0;
 
   for (int ii = 0; ii < Levels->GetNumberOfValues(); ii++)
     {
@@ -1086,9 +1080,10 @@ void qSlicerAstroScalarVolumeDisplayWidget::onCreateContours()
 
     int dims[3];
     modifierLabelmap->GetDimensions(dims);
-    if (LevelDim < dims[0] * dims[1] * dims[2])
+    const vtkIdType numElements = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
+    if (LevelDim < numElements)
       {
-      LevelDim = dims[0] * dims[1] * dims[2];
+      LevelDim = numElements;
       }
     }
 
@@ -1724,8 +1719,8 @@ if (!d->contoursVolumeNode->GetAstroVolumeDisplayNode())
 
   if (d->contoursVolumeNode != astroVolume)
     {
-    int ActiveDataN = StringToInt(astroVolume->GetAttribute("SlicerAstro.NAXIS"));
-    int ContoursDataN = StringToInt(d->contoursVolumeNode->GetAttribute("SlicerAstro.NAXIS"));
+    int ActiveDataN = astroVolume->GetNumberOfAxes();
+    int ContoursDataN = d->contoursVolumeNode->GetNumberOfAxes();
     if (ActiveDataN == 2 && ContoursDataN == 3)
       {
       d->Contours2DSliderWidget->show();
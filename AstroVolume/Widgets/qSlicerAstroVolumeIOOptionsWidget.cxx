@@ -18,7 +18,10 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QDir>
 #include <QFileInfo>
+#include <QHash>
+#include <QStandardPaths>
 
 // CTK includes
 #include <ctkFlowLayout.h>
@@ -26,6 +29,10 @@
 
 // VTK includes
 #include <vtkNew.h>
+#include <vtkSmartPointer.h>
+
+// vtkFits includes
+#include <vtkFITSHeaderIndex.h>
 
 // AstroVolume includes
 #include <qSlicerIOOptions_p.h>
@@ -47,8 +54,41 @@ class qSlicerAstroVolumeIOOptionsWidgetPrivate
   , public Ui_qSlicerAstroVolumeIOOptionsWidget
 {
 public:
+  QString indexedDataModel(const QFileInfo& fileInfo);
+
+  /// header indexes of the directories of the selected files,
+  /// updated once per directory for the lifetime of the dialog
+  QHash<QString, vtkSmartPointer<vtkFITSHeaderIndex> > HeaderIndexes;
 };
 
+//-----------------------------------------------------------------------------
+// DATAMODEL of a file from the header index of its directory
+// (see vtkFITSHeaderIndex), without loading the file.
+QString qSlicerAstroVolumeIOOptionsWidgetPrivate::indexedDataModel(const QFileInfo& fileInfo)
+{
+  QString directory = fileInfo.absolutePath();
+  vtkSmartPointer<vtkFITSHeaderIndex> index = this->HeaderIndexes.value(directory);
+  if (!index)
+    {
+    index = vtkSmartPointer<vtkFITSHeaderIndex>::New();
+    index->SetDirectory(directory.toLatin1());
+    // the index of read-only directories is kept in the user cache
+    QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheDirectory.isEmpty())
+      {
+      index->SetCacheDirectory(QDir(cacheDirectory).filePath("SlicerAstroHeaderIndex").toLatin1());
+      }
+    this->HeaderIndexes.insert(directory, index);
+    if (!index->Update())
+      {
+      return QString();
+      }
+    }
+  int fileIndex = index->GetFileIndex(fileInfo.fileName().toLatin1());
+  const char* dataModel = index->GetHeaderValue(fileIndex, "DATAMODEL");
+  return dataModel ? QString(dataModel) : QString();
+}
+
 //-----------------------------------------------------------------------------
 qSlicerAstroVolumeIOOptionsWidget::qSlicerAstroVolumeIOOptionsWidget(QWidget* parentWidget)
   : qSlicerIOOptionsWidget(new qSlicerAstroVolumeIOOptionsWidgetPrivate, parentWidget)
@@ -87,6 +127,10 @@ qSlicerAstroVolumeIOOptionsWidget::qSlicerAstroVolumeIOOptionsWidget(QWidget* pa
           this, SLOT(updateProperties()));
   connect(d->SingleFileCheckBox, SIGNAL(toggled(bool)),
           this, SLOT(updateProperties()));
+  connect(d->ScalarTypeComboBox, SIGNAL(currentIndexChanged(int)),
+          this, SLOT(updateProperties()));
+  connect(d->PreviewLevelSpinBox, SIGNAL(valueChanged(int)),
+          this, SLOT(updateProperties()));
   connect(d->ColorTableComboBox, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
           this, SLOT(updateProperties()));
 
@@ -95,6 +139,12 @@ qSlicerAstroVolumeIOOptionsWidget::qSlicerAstroVolumeIOOptionsWidget(QWidget* pa
     connect(d->LabelMapCheckBox, SIGNAL(toggled(bool)),
             this, SLOT(updateColorSelector()));
 
+  // the scalar type applies to data cubes only
+  connect(d->LabelMapCheckBox, SIGNAL(toggled(bool)),
+          d->ScalarTypeComboBox, SLOT(setDisabled(bool)));
+  connect(d->LabelMapCheckBox, SIGNAL(toggled(bool)),
+          d->PreviewLevelSpinBox, SLOT(setDisabled(bool)));
+
   // Single file by default
   d->SingleFileCheckBox->setChecked(true);
   d->CenteredCheckBox->setChecked(true);
@@ -125,6 +175,8 @@ void qSlicerAstroVolumeIOOptionsWidget::updateProperties()
   d->Properties["labelmap"] = d->LabelMapCheckBox->isChecked();
   d->Properties["center"] = d->CenteredCheckBox->isChecked();
   d->Properties["singleFile"] = d->SingleFileCheckBox->isChecked();
+  d->Properties["scalarType"] = d->ScalarTypeComboBox->currentIndex();
+  d->Properties["previewLevel"] = d->PreviewLevelSpinBox->value();
   d->Properties["colorNodeID"] = d->ColorTableComboBox->currentNodeID();
 }
 
@@ -159,6 +211,11 @@ void qSlicerAstroVolumeIOOptionsWidget::setFileNames(const QStringList& fileName
       // slice from a 3D volume, so uncheck Single File.
       onlyNumberInName = QRegExp("[0-9\\.\\-\\_\\@\\(\\)\\~]+").exactMatch(fileBaseName);
       fileInfo.suffix().toInt(&onlyNumberInExtension);
+      // masks saved with a DATAMODEL keyword, whatever their name
+      if (d->indexedDataModel(fileInfo) == "MASK")
+        {
+        hasLabelMapName = true;
+        }
       }
       // Because '_' is considered as a word character (\w), \b
       // doesn't consider '_' as a word boundary.
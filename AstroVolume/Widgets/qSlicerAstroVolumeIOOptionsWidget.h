@@ -46,7 +46,7 @@ public slots:
 
 protected slots:
   /// Update the name, labelmap, center, singleFile, discardOrientation,
-  /// colorNodeID properties
+  /// scalarType, colorNodeID properties
   void updateProperties();
   /// Update the color node selection to the default label map
   /// or volume color node depending on the label map checkbox state.
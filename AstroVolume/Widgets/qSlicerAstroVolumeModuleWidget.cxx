@@ -125,6 +125,17 @@ public:
   virtual void setupUi(qSlicerAstroVolumeModuleWidget*);
   void cleanPointers();
 
+  /// Histogram table of the active volume, nullptr if not created yet
+  vtkMRMLTableNode* histogramTableNode();
+
+  /// Fill the histogram table with the binning set in the widgets
+  bool fillHistogramTable(vtkSlicerAstroVolumeLogic* logic,
+                          vtkMRMLTableNode* tableNode,
+                          double& histoMaxValue);
+
+  /// Update the range and threshold lines drawn over the histogram
+  void updateHistogramLines(double histoMaxValue);
+
   qSlicerVolumeRenderingModuleWidget* volumeRenderingWidget;
   qMRMLAstroVolumeInfoWidget *MRMLAstroVolumeInfoWidget;
   vtkSlicerSegmentationsModuleLogic* segmentationsLogic;
@@ -233,6 +244,170 @@ bool DoubleIsInf(double Value)
 
 } // end namespace
 
+//-----------------------------------------------------------------------------
+vtkMRMLTableNode* qSlicerAstroVolumeModuleWidgetPrivate::histogramTableNode()
+{
+  Q_Q(qSlicerAstroVolumeModuleWidget);
+
+  if (!this->astroVolumeNode || !q->mrmlScene())
+    {
+    return nullptr;
+    }
+
+  std::string name = this->astroVolumeNode->GetName();
+  name += "_HistogramTable";
+  vtkSmartPointer<vtkCollection> tableNodes = vtkSmartPointer<vtkCollection>::Take
+    (q->mrmlScene()->GetNodesByClassByName("vtkMRMLTableNode", name.c_str()));
+  return vtkMRMLTableNode::SafeDownCast(tableNodes->GetItemAsObject(0));
+}
+
+//-----------------------------------------------------------------------------
+bool qSlicerAstroVolumeModuleWidgetPrivate::fillHistogramTable(vtkSlicerAstroVolumeLogic* logic,
+                                                                vtkMRMLTableNode* tableNode,
+                                                                double& histoMaxValue)
+{
+  if (!logic || !tableNode || !this->astroVolumeNode)
+    {
+    return false;
+    }
+
+  const double dataMin = this->astroVolumeNode->GetDataMin();
+  const double dataMax = this->astroVolumeNode->GetDataMax();
+  const int nBins = static_cast<int>(this->BinSliderWidget->value());
+  const bool logScale = this->LogBinsCheckBox->isChecked();
+
+  // the histograms at every resolution of the slider are filled in a
+  // single pass and cached: moving the slider afterwards is instantaneous
+  vtkNew<vtkCollection> histoArrays;
+  vtkIntArray *histoArray = nullptr;
+  const int step = std::max(1, static_cast<int>(this->BinSliderWidget->singleStep()));
+  for (int bins = static_cast<int>(this->BinSliderWidget->minimum());
+       bins <= static_cast<int>(this->BinSliderWidget->maximum()); bins += step)
+    {
+    vtkNew<vtkIntArray> levelArray;
+    levelArray->SetNumberOfValues(bins);
+    histoArrays->AddItem(levelArray.GetPointer());
+    if (bins == nBins)
+      {
+      histoArray = levelArray.GetPointer();
+      }
+    }
+  if (!histoArray)
+    {
+    vtkNew<vtkIntArray> levelArray;
+    levelArray->SetNumberOfValues(nBins);
+    histoArrays->AddItem(levelArray.GetPointer());
+    histoArray = levelArray.GetPointer();
+    }
+
+  if (!logic->CalculateHistograms(this->astroVolumeNode, histoArrays.GetPointer(),
+                                  dataMin, dataMax, logScale))
+    {
+    qCritical() <<"qSlicerAstroVolumeModuleWidget::fillHistogramTable : "
+                  "Unable to calculate the histogram.";
+    return false;
+    }
+
+  vtkNew<vtkTable> table;
+  int wasModifying = tableNode->StartModify();
+  tableNode->SetAndObserveTable(table.GetPointer());
+  tableNode->RemoveAllColumns();
+  tableNode->SetUseColumnNameAsColumnHeader(true);
+  tableNode->SetDefaultColumnType("double");
+
+  vtkDoubleArray* Intensity = vtkDoubleArray::SafeDownCast(tableNode->AddColumn());
+  if (!Intensity)
+    {
+    qCritical() <<"qSlicerAstroVolumeModuleWidget::fillHistogramTable : "
+                  "Unable to find the Intensity Column.";
+    tableNode->EndModify(wasModifying);
+    return false;
+    }
+  Intensity->SetName("Intensity");
+  tableNode->SetColumnUnitLabel("Intensity", this->astroVolumeNode->GetDataUnit());
+  tableNode->SetColumnLongName("Intensity", "Intensity axes");
+
+  std::string name = this->astroVolumeNode->GetName();
+  name += "_Histogram";
+  vtkDoubleArray* Counts = vtkDoubleArray::SafeDownCast(tableNode->AddColumn());
+  if (!Counts)
+    {
+    qCritical() <<"qSlicerAstroVolumeModuleWidget::fillHistogramTable : "
+                  "Unable to find the Counts Column.";
+    tableNode->EndModify(wasModifying);
+    return false;
+    }
+  Counts->SetName(name.c_str());
+  tableNode->SetColumnUnitLabel(name.c_str(), "Log10(#)");
+  tableNode->SetColumnLongName(name.c_str(), "Counts");
+
+  table->SetNumberOfRows(nBins);
+  histoMaxValue = 0.;
+  for (int ii = 0; ii < nBins; ii++)
+     {
+     table->SetValue(ii, 0, vtkSlicerAstroVolumeLogic::GetHistogramBinEdge
+       (dataMin, dataMax, nBins, ii, logScale));
+     double histoValue = 0;
+     if (histoArray->GetValue(ii) >= 1)
+       {
+       histoValue = log10(histoArray->GetValue(ii));
+       }
+
+     if (DoubleIsInf(histoValue))
+       {
+       table->SetValue(ii, 1, 0.);
+       }
+     else
+       {
+       table->SetValue(ii, 1, histoValue);
+       if (histoValue > histoMaxValue)
+         {
+         histoMaxValue = histoValue;
+         }
+       }
+     }
+
+  tableNode->EndModify(wasModifying);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerAstroVolumeModuleWidgetPrivate::updateHistogramLines(double histoMaxValue)
+{
+  if (!this->astroVolumeNode)
+    {
+    return;
+    }
+
+  const double dataMin = this->astroVolumeNode->GetDataMin();
+  const double dataMax = this->astroVolumeNode->GetDataMax();
+  const double displayThreshold = this->astroVolumeNode->GetDisplayThreshold();
+
+  if (this->TableMinNode && this->TableMaxNode && this->TableThresholdNode)
+    {
+    this->TableMinNode->GetTable()->SetValue(0, 0, dataMin);
+    this->TableMinNode->GetTable()->SetValue(0, 1, 0.);
+    this->TableMinNode->GetTable()->SetValue(1, 0, dataMin);
+    this->TableMinNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
+    this->TableMinNode->GetTable()->SetValue(2, 0, dataMin);
+    this->TableMinNode->GetTable()->SetValue(2, 1, histoMaxValue);
+
+    this->TableMaxNode->GetTable()->SetValue(0, 0, dataMax);
+    this->TableMaxNode->GetTable()->SetValue(0, 1, 0.);
+    this->TableMaxNode->GetTable()->SetValue(1, 0, dataMax);
+    this->TableMaxNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
+    this->TableMaxNode->GetTable()->SetValue(2, 0, dataMax);
+    this->TableMaxNode->GetTable()->SetValue(2, 1, histoMaxValue);
+
+    this->TableThresholdNode->GetTable()->SetValue(0, 0, displayThreshold);
+    this->TableThresholdNode->GetTable()->SetValue(0, 1, 0.);
+    this->TableThresholdNode->GetTable()->SetValue(1, 0, displayThreshold);
+    this->TableThresholdNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
+    this->TableThresholdNode->GetTable()->SetValue(2, 0, displayThreshold);
+    this->TableThresholdNode->GetTable()->SetValue(2, 1, histoMaxValue);
+    }
+}
+
 //-----------------------------------------------------------------------------
 void qSlicerAstroVolumeModuleWidgetPrivate::setupUi(qSlicerAstroVolumeModuleWidget* q)
 {
@@ -322,6 +497,12 @@ void qSlicerAstroVolumeModuleWidgetPrivate::setupUi(qSlicerAstroVolumeModuleWidg
   QObject::connect(this->CreateHistoPushButton, SIGNAL(clicked()),
                    q, SLOT(onCreateHistogram()));
 
+  QObject::connect(this->BinSliderWidget, SIGNAL(valueChanged(double)),
+                   q, SLOT(onHistogramBinningChanged()));
+
+  QObject::connect(this->LogBinsCheckBox, SIGNAL(toggled(bool)),
+                   q, SLOT(onHistogramBinningChanged()));
+
   // 2D Display widget connections
   QObject::connect(this->ActiveVolumeNodeSelector, SIGNAL(currentNodeChanged(vtkMRMLNode*)),
                    this->AstroVolumeDisplayWidget, SLOT(setMRMLVolumeNode(vtkMRMLNode*)));
@@ -1445,7 +1626,7 @@ void qSlicerAstroVolumeModuleWidget::onInputVolumeChanged(vtkMRMLNode *node)
 
   if (astroVolumeNode)
     {
-    int n = StringToInt(astroVolumeNode->GetAttribute("SlicerAstro.NAXIS"));
+    int n = astroVolumeNode->GetNumberOfAxes();
     // Check Input volume dimensionality
     if (n == 3)
       {
@@ -1564,8 +1745,8 @@ void qSlicerAstroVolumeModuleWidget::resetOffset(vtkMRMLNode* node)
   volumeDisplay->SetOldPresetOffset(0.);
   volumeDisplay->EndModify(wasModifying);
 
-  double width = StringToDouble(volume->GetAttribute("SlicerAstro.DATAMAX")) -
-                 StringToDouble(volume->GetAttribute("SlicerAstro.DATAMIN"));
+  double width = volume->GetDataMax() -
+                 volume->GetDataMin();
   bool wasBlocking = d->PresetOffsetSlider->blockSignals(true);
   d->PresetOffsetSlider->setSingleStep(
     width ? ctk::closestPowerOfTen(width) / 100. : 0.1);
@@ -1592,8 +1773,8 @@ void qSlicerAstroVolumeModuleWidget::resetOffsetStep(vtkMRMLNode *node)
     return;
     }
 
-  double width = StringToDouble(volume->GetAttribute("SlicerAstro.DATAMAX")) -
-                 StringToDouble(volume->GetAttribute("SlicerAstro.DATAMIN"));
+  double width = volume->GetDataMax() -
+                 volume->GetDataMin();
   d->PresetOffsetSlider->setSingleStep(
     width ? ctk::closestPowerOfTen(width) / 100. : 0.1);
   d->PresetOffsetSlider->setPageStep(d->PresetOffsetSlider->singleStep());
@@ -1995,8 +2176,8 @@ void qSlicerAstroVolumeModuleWidget::resetStretch(vtkMRMLNode *node)
   volumeDisplay->SetOldPresetStretch(0.);
   volumeDisplay->EndModify(wasModifying);
 
-  double width = StringToDouble(volume->GetAttribute("SlicerAstro.DATAMAX")) -
-                 StringToDouble(volume->GetAttribute("SlicerAstro.DATAMIN"));
+  double width = volume->GetDataMax() -
+                 volume->GetDataMin();
   bool wasBlocking = d->PresetStretchSlider->blockSignals(true);
   d->PresetStretchSlider->setSingleStep(
     width ? ctk::closestPowerOfTen(width) / 100. : 0.1);
@@ -2023,8 +2204,8 @@ void qSlicerAstroVolumeModuleWidget::resetStretchStep(vtkMRMLNode *node)
     return;
     }
 
-  double width = StringToDouble(volume->GetAttribute("SlicerAstro.DATAMAX")) -
-                 StringToDouble(volume->GetAttribute("SlicerAstro.DATAMIN"));
+  double width = volume->GetDataMax() -
+                 volume->GetDataMin();
   d->PresetStretchSlider->setSingleStep(
     width ? ctk::closestPowerOfTen(width) / 100. : 0.1);
   d->PresetStretchSlider->setPageStep(d->PresetStretchSlider->singleStep());
@@ -2701,8 +2882,8 @@ void qSlicerAstroVolumeModuleWidget::setComparative3DViews(const char* volumeNod
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeOne->GetImageData());
     double min, max;
-    min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold")) * 3.;
-    max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeOne->GetDisplayThreshold() * 3.;
+    max = volumeOne->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -2737,8 +2918,8 @@ void qSlicerAstroVolumeModuleWidget::setComparative3DViews(const char* volumeNod
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeTwo->GetImageData());
     double min, max;
-    min = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DisplayThreshold")) * 3.;
-    max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeTwo->GetDisplayThreshold() * 3.;
+    max = volumeTwo->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -3256,8 +3437,8 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeOne->GetImageData());
     double min, max;
-    min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold")) * ContourLevel;
-    max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeOne->GetDisplayThreshold() * ContourLevel;
+    max = volumeOne->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -3292,8 +3473,8 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeTwo->GetImageData());
     double min, max;
-    min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold")) * ContourLevel;
-    max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeOne->GetDisplayThreshold() * ContourLevel;
+    max = volumeTwo->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -3328,7 +3509,7 @@ void qSlicerAstroVolumeModuleWidget::setQuantitative3DView(const char *volumeNod
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeTwo->GetImageData());
     double max;
-    max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
+    max = volumeTwo->GetDataMax();
     imageThreshold->ThresholdBetween(1.E-6 , max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -3571,7 +3752,7 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     return;
     }
 
-  double rms = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold"));
+  double rms = volumeOne->GetDisplayThreshold();
   if (d->PresetOffsetSlider)
     {
     d->PresetOffsetSlider->setValue((rms * ContourLevel) - (rms * 3.));
@@ -3635,8 +3816,8 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeOne->GetImageData());
     double min, max;
-    min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold")) * ContourLevel;
-    max = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeOne->GetDisplayThreshold() * ContourLevel;
+    max = volumeOne->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -3671,8 +3852,8 @@ void qSlicerAstroVolumeModuleWidget::updateQuantitative3DView(const char *volume
     vtkNew<vtkImageThreshold> imageThreshold;
     imageThreshold->SetInputData(volumeTwo->GetImageData());
     double min, max;
-    min = StringToDouble(volumeOne->GetAttribute("SlicerAstro.DisplayThreshold")) * ContourLevel;
-    max = StringToDouble(volumeTwo->GetAttribute("SlicerAstro.DATAMAX"));
+    min = volumeOne->GetDisplayThreshold() * ContourLevel;
+    max = volumeTwo->GetDataMax();
     imageThreshold->ThresholdBetween(min, max);
     imageThreshold->SetInValue(1);
     imageThreshold->SetOutValue(0);
@@ -4001,6 +4182,10 @@ void qSlicerAstroVolumeModuleWidget::onCalculateRMS()
   vtkMRMLAnnotationROINode *roiNode = nullptr;
   if (!roiNode)
     {
+    // without a ROI, estimate the noise on a sample of the whole cube
+    // (the NoiseEstimator of the node, used on load, is left unchanged)
+    d->astroVolumeNode->UpdateDisplayThresholdAttributes
+      (vtkMRMLAstroVolumeNode::SigmaClippedNoiseEstimator);
     return;
     }
 
@@ -4027,12 +4212,6 @@ void qSlicerAstroVolumeModuleWidget::onCreateHistogram()
     return;
     }
 
-  double DATAMAX = StringToDouble(d->astroVolumeNode->GetAttribute("SlicerAstro.DATAMAX"));
-  double DATAMIN = StringToDouble(d->astroVolumeNode->GetAttribute("SlicerAstro.DATAMIN"));
-  double DisplayThreshold = StringToDouble(d->astroVolumeNode->GetAttribute("SlicerAstro.DisplayThreshold"));
-  double nBins = d->BinSliderWidget->value();
-  double binFlux = (DATAMAX - DATAMIN) / (nBins - 1);
-
   vtkSlicerAstroVolumeLogic* astroVolumeLogic =
     vtkSlicerAstroVolumeLogic::SafeDownCast(this->logic());
 
@@ -4041,77 +4220,24 @@ void qSlicerAstroVolumeModuleWidget::onCreateHistogram()
     return;
     }
 
-  vtkNew<vtkIntArray> histoArray;
-  astroVolumeLogic->CalculateHistogram(d->astroVolumeNode, histoArray, binFlux, nBins);
-
-  vtkNew<vtkTable> table;
-  vtkNew<vtkMRMLTableNode> tableNode;
-
-  int wasModifying = tableNode->StartModify();
-  tableNode->SetAndObserveTable(table.GetPointer());
-  tableNode->RemoveAllColumns();
-  tableNode->SetUseColumnNameAsColumnHeader(true);
-  tableNode->SetDefaultColumnType("double");
-
-  vtkDoubleArray* Intensity = vtkDoubleArray::SafeDownCast(tableNode->AddColumn());
-  if (!Intensity)
-    {
-    qCritical() <<"qSlicerAstroVolumeModuleWidget::onCreateHistogram : "
-                  "Unable to find the Intensity Column.";
-    return;
-    }
-  Intensity->SetName("Intensity");
-  tableNode->SetColumnUnitLabel("Intensity", d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT"));
-  tableNode->SetColumnLongName("Intensity", "Intensity axes");
-
+  // one table per volume, updated when the binning changes
   std::string name = d->astroVolumeNode->GetName();
   name += "_Histogram";
-  vtkDoubleArray* Counts = vtkDoubleArray::SafeDownCast(tableNode->AddColumn());
-  if (!Counts)
+  vtkMRMLTableNode *tableNode = d->histogramTableNode();
+  if (!tableNode)
     {
-    qCritical() <<"qSlicerAstroVolumeModuleWidget::onCreateHistogram : "
-                  "Unable to find the Counts Column.";
-    return;
+    vtkNew<vtkMRMLTableNode> newTableNode;
+    newTableNode->SetName((name + "Table").c_str());
+    scene->AddNode(newTableNode.GetPointer());
+    tableNode = newTableNode.GetPointer();
     }
-  Counts->SetName(name.c_str());
-  tableNode->SetColumnUnitLabel(name.c_str(), "Log10(#)");
-  tableNode->SetColumnLongName(name.c_str(), "Counts");
 
-  table->SetNumberOfRows(nBins);
-  if (!histoArray)
+  double histoMaxValue = 0.;
+  if (!d->fillHistogramTable(astroVolumeLogic, tableNode, histoMaxValue))
     {
-    qCritical() <<"qSlicerAstroVolumeModuleWidget::onCreateHistogram : "
-                  "Unable to find the Histogram Array.";
     return;
     }
 
-  double histoMaxValue = 0;
-  for (int ii = 0; ii < nBins; ii++)
-     {
-     table->SetValue(ii, 0, DATAMIN + ii * binFlux);
-     double histoValue = 0;
-     if (histoArray->GetValue(ii) >= 1)
-       {
-       histoValue = log10(histoArray->GetValue(ii));
-       }
-
-     if (DoubleIsInf(histoValue))
-       {
-       table->SetValue(ii, 1, 0.);
-       }
-     else
-       {
-       table->SetValue(ii, 1, histoValue);
-       if (histoValue > histoMaxValue)
-         {
-         histoMaxValue = histoValue;
-         }
-       }
-     }
-
-  tableNode->EndModify(wasModifying);
-  scene->AddNode(tableNode.GetPointer());
-
   if (d->selectionNode)
     {
     d->selectionNode->SetActiveTableID(tableNode->GetID());
@@ -4197,36 +4323,14 @@ void qSlicerAstroVolumeModuleWidget::onCreateHistogram()
   QObject::connect(plotView, SIGNAL(dataSelected(vtkStringArray*, vtkCollection*)),
                    this, SLOT(onPlotSelectionChanged(vtkStringArray*, vtkCollection*)));
 
-  if (d->TableMinNode && d->TableMaxNode && d->TableThresholdNode)
-    {
-    d->TableMinNode->GetTable()->SetValue(0, 0, DATAMIN);
-    d->TableMinNode->GetTable()->SetValue(0, 1, 0.);
-    d->TableMinNode->GetTable()->SetValue(1, 0, DATAMIN);
-    d->TableMinNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
-    d->TableMinNode->GetTable()->SetValue(2, 0, DATAMIN);
-    d->TableMinNode->GetTable()->SetValue(2, 1, histoMaxValue);
-
-    d->TableMaxNode->GetTable()->SetValue(0, 0, DATAMAX);
-    d->TableMaxNode->GetTable()->SetValue(0, 1, 0.);
-    d->TableMaxNode->GetTable()->SetValue(1, 0, DATAMAX);
-    d->TableMaxNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
-    d->TableMaxNode->GetTable()->SetValue(2, 0, DATAMAX);
-    d->TableMaxNode->GetTable()->SetValue(2, 1, histoMaxValue);
-
-    d->TableThresholdNode->GetTable()->SetValue(0, 0, DisplayThreshold);
-    d->TableThresholdNode->GetTable()->SetValue(0, 1, 0.);
-    d->TableThresholdNode->GetTable()->SetValue(1, 0, DisplayThreshold);
-    d->TableThresholdNode->GetTable()->SetValue(1, 1, histoMaxValue * 0.5);
-    d->TableThresholdNode->GetTable()->SetValue(2, 0, DisplayThreshold);
-    d->TableThresholdNode->GetTable()->SetValue(2, 1, histoMaxValue);
-    }
+  d->updateHistogramLines(histoMaxValue);
 
   if (d->plotChartNodeHistogram)
     {
     d->plotChartNodeHistogram->RemoveAllPlotSeriesNodeIDs();
     d->plotChartNodeHistogram->AddAndObservePlotSeriesNodeID(PlotSeriesNode->GetID());
     std::string xunit = "Intensity (";
-    xunit += d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT");
+    xunit += d->astroVolumeNode->GetDataUnit();
     xunit += ")";
     d->plotChartNodeHistogram->SetXAxisTitle(xunit.c_str());
     }
@@ -4261,6 +4365,27 @@ void qSlicerAstroVolumeModuleWidget::onCreateHistogram()
     }
 }
 
+//---------------------------------------------------------------------------
+void qSlicerAstroVolumeModuleWidget::onHistogramBinningChanged()
+{
+  Q_D(qSlicerAstroVolumeModuleWidget);
+
+  // only an histogram already plotted follows the binning
+  vtkMRMLTableNode *tableNode = d->histogramTableNode();
+  vtkSlicerAstroVolumeLogic* astroVolumeLogic =
+    vtkSlicerAstroVolumeLogic::SafeDownCast(this->logic());
+  if (!tableNode || !astroVolumeLogic || !d->astroVolumeNode->GetImageData())
+    {
+    return;
+    }
+
+  double histoMaxValue = 0.;
+  if (d->fillHistogramTable(astroVolumeLogic, tableNode, histoMaxValue))
+    {
+    d->updateHistogramLines(histoMaxValue);
+    }
+}
+
 //---------------------------------------------------------------------------
 void qSlicerAstroVolumeModuleWidget::startRockView()
 {
@@ -4885,93 +5010,32 @@ void qSlicerAstroVolumeModuleWidget::onHistoClippingChanged(double percentage)
 {
   Q_D(qSlicerAstroVolumeModuleWidget);
 
-  if (!d->plotChartNodeHistogram ||
-      !d->TableMaxNode || !d->TableMinNode)
-    {
-    return;
-    }
-
-  vtkTable *histoTable = nullptr;
-  for (int ii = 0; ii < d->plotChartNodeHistogram->GetNumberOfPlotSeriesNodes(); ii++)
-    {
-    vtkMRMLPlotSeriesNode *PlotSeriesNode = d->plotChartNodeHistogram->GetNthPlotSeriesNode(ii);
-    if (!PlotSeriesNode)
-      {
-      continue;
-      }
-    std::string name = PlotSeriesNode->GetName();
-    if (name.find("_Histogram") != std::string::npos &&
-        PlotSeriesNode->GetTableNode())
-      {
-      histoTable = PlotSeriesNode->GetTableNode()->GetTable();
-      break;
-      }
-    }
-
-  if (!histoTable)
+  if (!d->astroVolumeNode || !d->TableMaxNode || !d->TableMinNode)
     {
-    qCritical() <<"qSlicerAstroVolumeModuleWidget::onHistoClippingChanged : "
-                  "Unable to find the Histogram.";
     return;
     }
 
-  vtkDoubleArray *fluxArray = vtkDoubleArray::SafeDownCast(histoTable->GetColumn(0));
-  if (!fluxArray)
+  vtkSlicerAstroVolumeLogic* logic =
+    vtkSlicerAstroVolumeLogic::SafeDownCast(this->logic());
+  if (!logic)
     {
     qCritical() <<"qSlicerAstroVolumeModuleWidget::onHistoClippingChanged : "
-                  "Unable to find the flux Histogram Array.";
+                  "vtkSlicerAstroVolumeLogic not found.";
     return;
     }
 
-  vtkDoubleArray *histoArray = vtkDoubleArray::SafeDownCast(histoTable->GetColumn(1));
-  if (!histoArray)
-    {
-    qCritical() <<"qSlicerAstroVolumeModuleWidget::onHistoClippingChanged : "
-                  "Unable to find the Histogram Array.";
-    return;
-    }
-
-  double totContsLeft = 0;
-  int iiLeft = 0;
-  while (fluxArray->GetValue(iiLeft) < 0.)
-    {
-    totContsLeft += pow(10,histoArray->GetValue(iiLeft));
-    iiLeft++;
-    }
-
-  double parContsLeft = 0;
-  iiLeft = 0;
-  while (parContsLeft / totContsLeft < (1 - percentage))
-    {
-    parContsLeft += pow(10,histoArray->GetValue(iiLeft));
-    iiLeft++;
-    }
-
-  double totContsRight = 0;
-  int iiRight = histoArray->GetNumberOfValues() - 1;
-  while (fluxArray->GetValue(iiRight) > 0.)
-    {
-    totContsRight += pow(10,histoArray->GetValue(iiRight));
-    iiRight--;
-    }
-
-  double parContsRight = 0;
-  iiRight = histoArray->GetNumberOfValues() - 1;
-  while (parContsRight / totContsRight < (1 - percentage))
-    {
-    parContsRight += pow(10,histoArray->GetValue(iiRight));
-    iiRight--;
-    }
-
-  double TwoDColorFunctionMax = fluxArray->GetValue(iiRight);
-  double TwoDColorFunctionMin = fluxArray->GetValue(iiLeft);
+  // keep the given percentage of the voxels, clipping the same fraction
+  // from both tails. The percentiles come from the cached histogram of the
+  // logic, at a finer resolution than the plotted one.
+  double tail = (1. - percentage) * 0.5;
+  double TwoDColorFunctionMin = logic->CalculatePercentile(d->astroVolumeNode, tail);
+  double TwoDColorFunctionMax = logic->CalculatePercentile(d->astroVolumeNode, 1. - tail);
 
   d->TableMaxNode->GetTable()->SetValue(1, 0, TwoDColorFunctionMax);
   d->TableMaxNode->GetTable()->Modified();
 
   d->TableMinNode->GetTable()->SetValue(1, 0, TwoDColorFunctionMin);
   d->TableMinNode->GetTable()->Modified();
-
 }
 
 //---------------------------------------------------------------------------
@@ -5460,10 +5524,10 @@ void qSlicerAstroVolumeModuleWidget::onMRMLVolumeNodeModified()
   DataMinString += "  ";
   std::string DataMaxString = DoubleToString(DataMax);
   DataMaxString += "  ";
-  if (strcmp(d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT"), "UNDEFINED"))
+  if (strcmp(d->astroVolumeNode->GetDataUnit(), "UNDEFINED"))
     {
-    DataMinString += d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT");
-    DataMaxString += d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT");
+    DataMinString += d->astroVolumeNode->GetDataUnit();
+    DataMaxString += d->astroVolumeNode->GetDataUnit();
     }
   d->DataMinDisplay->setText(DataMinString.c_str());
   d->DataMaxDisplay->setText(DataMaxString.c_str());
@@ -5614,7 +5678,7 @@ void qSlicerAstroVolumeModuleWidget::onMRMLVolumeNodeDisplayThresholdModified(bo
   d->DisplayThresholdSliderWidget->setMinimum(min);
   d->DisplayThresholdSliderWidget->setSingleStep((max - min) / 10000.);
   QString DisplayThresholdUnit = "  ";
-  DisplayThresholdUnit += d->astroVolumeNode->GetAttribute("SlicerAstro.BUNIT");
+  DisplayThresholdUnit += d->astroVolumeNode->GetDataUnit();
   d->DisplayThresholdSliderWidget->setSuffix(DisplayThresholdUnit);
   d->DisplayThresholdSliderWidget->blockSignals(status);
 
@@ -140,6 +140,7 @@ protected slots:
   void onHistoClippingChanged3();
   void onHistoClippingChanged4();
   void onHistoClippingChanged5();
+  void onHistogramBinningChanged();
   void onInputVolumeChanged(vtkMRMLNode *node);
   void onLockToggled(bool toggled);
   void onMRMLDisplayROINodeModified(vtkObject*);
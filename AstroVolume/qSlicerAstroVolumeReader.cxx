@@ -18,7 +18,9 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QApplication>
 #include <QFileInfo>
+#include <QProgressDialog>
 
 // SlicerQt includes
 #include "qSlicerAstroVolumeIOOptionsWidget.h"
@@ -32,11 +34,86 @@
 #include <vtkMRMLAstroVolumeNode.h>
 #include <vtkMRMLAstroLabelMapVolumeNode.h>
 #include <vtkMRMLAstroVolumeDisplayNode.h>
+#include <vtkMRMLAstroVolumeStorageNode.h>
+#include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
 
+// vtkFits includes
+#include <vtkFITSReader.h>
+
 // VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Settings of the storage nodes added while loading, which are given as
+// IO properties, and progress dialog of the load fed by these nodes
+struct LoadProgress
+{
+  LoadProgress() : ScalarTypePolicy(vtkFITSReader::NativeScalarType), PreviewLevel(0),
+                   ShowProgress(false) {}
+
+  int ScalarTypePolicy;
+  int PreviewLevel;
+  bool ShowProgress;
+  vtkNew<vtkCallbackCommand> ProgressCallback;
+  std::vector<std::pair<vtkWeakPointer<vtkMRMLAstroVolumeStorageNode>, unsigned long> > Observations;
+};
+
+//-----------------------------------------------------------------------------
+void StorageNodeProgressCallback(vtkObject* caller, unsigned long vtkNotUsed(eid),
+                                 void* clientData, void* callData)
+{
+  vtkMRMLAstroVolumeStorageNode* storageNode =
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(caller);
+  QProgressDialog* dialog = reinterpret_cast<QProgressDialog*>(clientData);
+  if (!storageNode || !dialog || !callData)
+    {
+    return;
+    }
+
+  dialog->setValue(static_cast<int>(*reinterpret_cast<double*>(callData) * 100.));
+  QCoreApplication::processEvents();
+  if (dialog->wasCanceled())
+    {
+    storageNode->SetAbortReading(1);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void NodeAddedCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid),
+                       void* clientData, void* callData)
+{
+  vtkMRMLAstroVolumeStorageNode* storageNode =
+    vtkMRMLAstroVolumeStorageNode::SafeDownCast(reinterpret_cast<vtkObject*>(callData));
+  LoadProgress* progress = reinterpret_cast<LoadProgress*>(clientData);
+  if (!storageNode || !progress)
+    {
+    return;
+    }
+
+  // the node is added before the logic reads the file with it
+  storageNode->SetScalarTypePolicy(progress->ScalarTypePolicy);
+  storageNode->SetPreviewLevel(progress->PreviewLevel);
+  if (!progress->ShowProgress)
+    {
+    return;
+    }
+
+  unsigned long tag = storageNode->AddObserver(vtkCommand::ProgressEvent,
+                                               progress->ProgressCallback.GetPointer());
+  progress->Observations.push_back(std::make_pair(
+    vtkWeakPointer<vtkMRMLAstroVolumeStorageNode>(storageNode), tag));
+}
+}// end namespace
 
 //-----------------------------------------------------------------------------
 class qSlicerAstroVolumeReaderPrivate
@@ -97,8 +174,10 @@ QStringList qSlicerAstroVolumeReader::extensions()const
   return QStringList()
     << "Volume (*.fits)"
     << "Volume (*.fits.gz)"
+    << "Volume (*.fits.fz)"
     << "Image (*.fits)"
     << "Image (*.fits.gz)"
+    << "Image (*.fits.fz)"
     << "All Files (*)";
 }
 
@@ -153,11 +232,60 @@ bool qSlicerAstroVolumeReader::load(const IOProperties& properties)
 
   Q_ASSERT(d->Logic);
 
+  // Settings, progress (and cancel) of the read of the data: the storage
+  // node is created by the logic, it is set up and observed as soon as
+  // it is added.
+  QScopedPointer<QProgressDialog> progressDialog;
+  LoadProgress progress;
+  if (properties.contains("scalarType"))
+    {
+    progress.ScalarTypePolicy = properties["scalarType"].toInt();
+    }
+  if (properties.contains("previewLevel"))
+    {
+    progress.PreviewLevel = properties["previewLevel"].toInt();
+    }
+  vtkNew<vtkCallbackCommand> nodeAddedCallback;
+  unsigned long nodeAddedTag = 0;
+  if (this->mrmlScene())
+    {
+    if (qobject_cast<QApplication*>(QCoreApplication::instance()))
+      {
+      progressDialog.reset(new QProgressDialog(
+        tr("Loading %1...").arg(QFileInfo(fileName).fileName()), tr("Cancel"), 0, 100));
+      progressDialog->setWindowModality(Qt::ApplicationModal);
+      progressDialog->setMinimumDuration(1000);
+      progress.ShowProgress = true;
+      progress.ProgressCallback->SetCallback(StorageNodeProgressCallback);
+      progress.ProgressCallback->SetClientData(progressDialog.data());
+      }
+    nodeAddedCallback->SetCallback(NodeAddedCallback);
+    nodeAddedCallback->SetClientData(&progress);
+    nodeAddedTag = this->mrmlScene()->AddObserver(vtkMRMLScene::NodeAddedEvent,
+                                                  nodeAddedCallback.GetPointer());
+    }
+
   vtkMRMLVolumeNode* node = d->Logic->AddArchetypeVolume(
     fileName.toLatin1(),
     name.toLatin1(),
     options,
     fileList.GetPointer());
+
+  if (nodeAddedTag)
+    {
+    this->mrmlScene()->RemoveObserver(nodeAddedTag);
+    for (size_t ii = 0; ii < progress.Observations.size(); ii++)
+      {
+      if (progress.Observations[ii].first)
+        {
+        progress.Observations[ii].first->RemoveObserver(progress.Observations[ii].second);
+        }
+      }
+    if (progressDialog)
+      {
+      progressDialog->reset();
+      }
+    }
   if (node)
     {
     if (properties.contains("colorNodeID"))
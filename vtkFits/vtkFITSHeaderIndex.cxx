@@ -0,0 +1,463 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// vtkASTRO includes
+#include <vtkFITSHeaderIndex.h>
+#include <vtkFITSReader.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <sstream>
+
+//----------------------------------------------------------------------------
+struct vtkFITSHeaderIndexEntry
+{
+  std::string FileName;
+  long int MTime;
+  unsigned long Size;
+  bool Readable;
+  std::map<std::string, std::string> Values;
+};
+
+class vtkFITSHeaderIndexEntries: public std::vector<vtkFITSHeaderIndexEntry>
+{
+public:
+  // directory of the entries, to reuse them when there is no index file
+  std::string Directory;
+};
+
+vtkStandardNewMacro(vtkFITSHeaderIndex);
+
+namespace
+{
+//----------------------------------------------------------------------------
+// field of the index file marking the files whose header could not be read
+const char* UnreadableField = "UNREADABLE";
+
+//----------------------------------------------------------------------------
+const char* IndexedKeys[] =
+{
+  "BITPIX", "NAXIS", "CTYPE", "CRVAL", "CDELT", "CRPIX", "CUNIT",
+  "BMAJ", "BMIN", "BPA", "BUNIT", "OBJECT", "RESTFREQ", "RESTFRQ",
+  "SPECSYS", "TELESCOP", "EQUINOX", "EPOCH", "DATAMODEL", "DATAMIN", "DATAMAX",
+  nullptr
+};
+
+//----------------------------------------------------------------------------
+bool IsIndexedKey(const std::string& key)
+{
+  for (int ii = 0; IndexedKeys[ii] != nullptr; ii++)
+    {
+    if (!key.compare(0, strlen(IndexedKeys[ii]), IndexedKeys[ii]))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool IsFITSFileName(const std::string& fileName)
+{
+  std::string name = vtksys::SystemTools::LowerCase(fileName);
+  const char* extensions[] = {".fits", ".fits.gz", ".fits.fz"};
+  for (int ii = 0; ii < 3; ii++)
+    {
+    size_t length = strlen(extensions[ii]);
+    if (name.size() > length && !name.compare(name.size() - length, length, extensions[ii]))
+      {
+      return true;
+      }
+    }
+  return false;
+}
+}// end namespace
+
+//----------------------------------------------------------------------------
+vtkFITSHeaderIndex::vtkFITSHeaderIndex()
+{
+  this->Directory = nullptr;
+  this->IndexFileName = nullptr;
+  this->SetIndexFileName(".SlicerAstroHeaderIndex");
+  this->CacheDirectory = nullptr;
+  this->NumberOfScannedFiles = 0;
+  this->Entries = new vtkFITSHeaderIndexEntries;
+}
+
+//----------------------------------------------------------------------------
+vtkFITSHeaderIndex::~vtkFITSHeaderIndex()
+{
+  this->SetDirectory(nullptr);
+  this->SetIndexFileName(nullptr);
+  this->SetCacheDirectory(nullptr);
+
+  if (this->Entries)
+    {
+    delete this->Entries;
+    }
+}
+
+//----------------------------------------------------------------------------
+std::string vtkFITSHeaderIndex::GetIndexFilePath()
+{
+  if (this->Directory == nullptr || this->IndexFileName == nullptr)
+    {
+    return std::string();
+    }
+
+  if (vtksys::SystemTools::TestFileAccess(this->Directory, vtksys::TEST_FILE_WRITE))
+    {
+    return std::string(this->Directory) + "/" + this->IndexFileName;
+    }
+
+  if (this->CacheDirectory == nullptr || !strcmp(this->CacheDirectory, ""))
+    {
+    return std::string();
+    }
+
+  // one index per directory in the cache, named after the full path
+  std::string directory = vtksys::SystemTools::CollapseFullPath(this->Directory);
+  std::stringstream name;
+  name << this->IndexFileName << "-" << std::hex << std::hash<std::string>()(directory);
+  return std::string(this->CacheDirectory) + "/" + name.str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHeaderIndex::ReadIndexFile()
+{
+  std::string indexPath = this->GetIndexFilePath();
+  std::string directoryIndexPath = std::string(this->Directory) + "/" + this->IndexFileName;
+  if ((indexPath.empty() || !vtksys::SystemTools::FileExists(indexPath)) &&
+      vtksys::SystemTools::FileExists(directoryIndexPath))
+    {
+    // index shipped with a read-only directory
+    indexPath = directoryIndexPath;
+    }
+
+  std::ifstream in;
+  if (!indexPath.empty())
+    {
+    in.open(indexPath.c_str());
+    }
+  if (!in.is_open())
+    {
+    // no index file: keep the entries of the previous Update of the directory
+    if (this->Entries->Directory.compare(this->Directory))
+      {
+      this->Entries->clear();
+      }
+    this->Entries->Directory = this->Directory;
+    return false;
+    }
+
+  this->Entries->clear();
+  this->Entries->Directory = this->Directory;
+
+  // one line per file: name, mtime, size and KEY=VALUE fields, tab separated
+  // (or the UNREADABLE field)
+  std::string line;
+  while (std::getline(in, line))
+    {
+    if (line.empty() || line[0] == '#')
+      {
+      continue;
+      }
+
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, '\t'))
+      {
+      fields.push_back(field);
+      }
+    if (fields.size() < 3)
+      {
+      continue;
+      }
+
+    vtkFITSHeaderIndexEntry entry;
+    entry.FileName = fields[0];
+    entry.MTime = strtol(fields[1].c_str(), nullptr, 10);
+    entry.Size = strtoul(fields[2].c_str(), nullptr, 10);
+    entry.Readable = true;
+    for (size_t ii = 3; ii < fields.size(); ii++)
+      {
+      if (!fields[ii].compare(UnreadableField))
+        {
+        entry.Readable = false;
+        continue;
+        }
+      size_t pos = fields[ii].find('=');
+      if (pos == std::string::npos)
+        {
+        continue;
+        }
+      entry.Values[fields[ii].substr(0, pos)] = fields[ii].substr(pos + 1);
+      }
+    this->Entries->push_back(entry);
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHeaderIndex::WriteIndexFile()
+{
+  std::string indexPath = this->GetIndexFilePath();
+  if (indexPath.empty())
+    {
+    return false;
+    }
+  if (!vtksys::SystemTools::TestFileAccess(this->Directory, vtksys::TEST_FILE_WRITE) &&
+      !vtksys::SystemTools::MakeDirectory(this->CacheDirectory))
+    {
+    return false;
+    }
+  std::string tmpPath = indexPath + ".tmp";
+
+  {
+  std::ofstream out(tmpPath.c_str());
+  if (!out.is_open())
+    {
+    return false;
+    }
+
+  out << "# SlicerAstro FITS header index\n";
+  vtkFITSHeaderIndexEntries::iterator it;
+  for (it = this->Entries->begin(); it != this->Entries->end(); ++it)
+    {
+    out << it->FileName << "\t" << it->MTime << "\t" << it->Size;
+    if (!it->Readable)
+      {
+      out << "\t" << UnreadableField;
+      }
+    std::map<std::string, std::string>::iterator vit;
+    for (vit = it->Values.begin(); vit != it->Values.end(); ++vit)
+      {
+      out << "\t" << vit->first << "=" << vit->second;
+      }
+    out << "\n";
+    }
+
+  if (!out.good())
+    {
+    return false;
+    }
+  }
+
+  // replace the index only once completely written
+  return rename(tmpPath.c_str(), indexPath.c_str()) == 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHeaderIndex::Update()
+{
+  this->NumberOfScannedFiles = 0;
+
+  if (this->Directory == nullptr || this->IndexFileName == nullptr)
+    {
+    vtkErrorMacro("vtkFITSHeaderIndex::Update : Directory not specified.");
+    return false;
+    }
+
+  vtksys::Directory directory;
+  if (!directory.Load(this->Directory))
+    {
+    vtkErrorMacro("vtkFITSHeaderIndex::Update : could not read "<<this->Directory);
+    return false;
+    }
+
+  this->ReadIndexFile();
+
+  std::map<std::string, vtkFITSHeaderIndexEntry> previous;
+  vtkFITSHeaderIndexEntries::iterator it;
+  for (it = this->Entries->begin(); it != this->Entries->end(); ++it)
+    {
+    previous[it->FileName] = *it;
+    }
+
+  bool modified = false;
+  vtkFITSHeaderIndexEntries entries;
+  vtkNew<vtkFITSReader> reader;
+
+  for (unsigned long ii = 0; ii < directory.GetNumberOfFiles(); ii++)
+    {
+    std::string fileName = directory.GetFile(ii);
+    if (!IsFITSFileName(fileName))
+      {
+      continue;
+      }
+
+    std::string fullName = std::string(this->Directory) + "/" + fileName;
+    long int mtime = vtksys::SystemTools::ModifiedTime(fullName);
+    unsigned long size = vtksys::SystemTools::FileLength(fullName);
+
+    std::map<std::string, vtkFITSHeaderIndexEntry>::iterator pit = previous.find(fileName);
+    if (pit != previous.end() && pit->second.MTime == mtime && pit->second.Size == size)
+      {
+      entries.push_back(pit->second);
+      previous.erase(pit);
+      continue;
+      }
+
+    modified = true;
+    this->NumberOfScannedFiles++;
+
+    vtkFITSHeaderIndexEntry entry;
+    entry.FileName = fileName;
+    entry.MTime = mtime;
+    entry.Size = size;
+    entry.Readable = true;
+
+    reader->SetFileName(fullName.c_str());
+    if (!reader->ReadHeaderOnly())
+      {
+      // keep the failure, so that the file is not read again until it changes
+      vtkWarningMacro("vtkFITSHeaderIndex::Update : could not read the header of "<<fullName);
+      entry.Readable = false;
+      entries.push_back(entry);
+      continue;
+      }
+
+    std::vector<std::string> keys = reader->GetHeaderKeysVector();
+    std::vector<std::string>::iterator kit;
+    for (kit = keys.begin(); kit != keys.end(); ++kit)
+      {
+      std::size_t pos = kit->find("SlicerAstro.");
+      if (pos == std::string::npos)
+        {
+        continue;
+        }
+      std::string key = kit->substr(pos + 12);
+      if (!IsIndexedKey(key))
+        {
+        continue;
+        }
+      std::string value = reader->GetHeaderValue(kit->c_str());
+      if (value.find_first_of("\t\n") != std::string::npos)
+        {
+        continue;
+        }
+      entry.Values[key] = value;
+      }
+    entries.push_back(entry);
+    }
+
+  // removed files
+  if (!previous.empty())
+    {
+    modified = true;
+    }
+
+  this->Entries->swap(entries);
+
+  // without a writable location the index is only kept in memory
+  std::string indexPath = this->GetIndexFilePath();
+  if (modified && !indexPath.empty() && !this->WriteIndexFile())
+    {
+    vtkWarningMacro("vtkFITSHeaderIndex::Update : could not save the index in "<<indexPath);
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSHeaderIndex::GetNumberOfFiles()
+{
+  return static_cast<int>(this->Entries->size());
+}
+
+//----------------------------------------------------------------------------
+const char* vtkFITSHeaderIndex::GetFileName(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfFiles())
+    {
+    return nullptr;
+    }
+  return (*this->Entries)[index].FileName.c_str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSHeaderIndex::GetFileReadable(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfFiles())
+    {
+    return false;
+    }
+  return (*this->Entries)[index].Readable;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkFITSHeaderIndex::GetHeaderValue(int index, const char* key)
+{
+  if (index < 0 || index >= this->GetNumberOfFiles() || key == nullptr)
+    {
+    return nullptr;
+    }
+
+  std::map<std::string, std::string>& values = (*this->Entries)[index].Values;
+  std::map<std::string, std::string>::iterator it = values.find(key);
+  if (it == values.end())
+    {
+    return nullptr;
+    }
+  return it->second.c_str();
+}
+
+//----------------------------------------------------------------------------
+int vtkFITSHeaderIndex::GetFileIndex(const char* fileName)
+{
+  if (fileName == nullptr)
+    {
+    return -1;
+    }
+
+  for (int ii = 0; ii < this->GetNumberOfFiles(); ii++)
+    {
+    if (!(*this->Entries)[ii].FileName.compare(fileName))
+      {
+      return ii;
+      }
+    }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSHeaderIndex::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os,indent);
+  os << indent << "Directory: " << (this->Directory ? this->Directory : "(none)") << "\n";
+  os << indent << "IndexFileName: " << (this->IndexFileName ? this->IndexFileName : "(none)") << "\n";
+  os << indent << "CacheDirectory: " << (this->CacheDirectory ? this->CacheDirectory : "(none)") << "\n";
+  os << indent << "NumberOfFiles: " << this->GetNumberOfFiles() << "\n";
+  os << indent << "NumberOfScannedFiles: " << this->NumberOfScannedFiles << "\n";
+}
@@ -0,0 +1,124 @@
+/*==============================================================================
+
+  Copyright (c) Kapteyn Astronomical Institute
+  University of Groningen, Groningen, Netherlands. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  This file was originally developed by Davide Punzo, Kapteyn Astronomical Institute,
+  and was supported through the European Research Council grant nr. 291531.
+
+==============================================================================*/
+
+#ifndef __vtkFITSHeaderIndex_h
+#define __vtkFITSHeaderIndex_h
+
+// VTK includes
+#include "vtkObject.h"
+
+class vtkFITSHeaderIndexEntries;
+
+#include "vtkFitsWin32Header.h"
+
+// STD includes
+#include <string>
+
+/// \brief Index of the primary headers of the FITS files in a directory.
+///
+/// vtkFITSHeaderIndex scans the .fits, .fits.gz and .fits.fz files of a
+/// directory with vtkFITSReader::ReadHeaderOnly and keeps the main keywords
+/// (NAXISn, CTYPEn, CRVALn, CDELTn, BMAJ, BMIN, BUNIT, ...) in an index file
+/// stored in the same directory, or in CacheDirectory when the directory is
+/// not writable (e.g. read-only archives). On Update only the files added or modified
+/// (mtime or size) since the last scan are read again, so that selecting
+/// or filtering cubes of large archives does not require loading them.
+/// Files whose header can not be read are indexed as unreadable, and are
+/// not read again until they are modified.
+///
+/// \sa vtkFITSReader
+class VTK_FITS_EXPORT vtkFITSHeaderIndex : public vtkObject
+{
+public:
+  static vtkFITSHeaderIndex *New();
+  vtkTypeMacro(vtkFITSHeaderIndex,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  ///
+  /// Directory of the FITS files
+  vtkSetStringMacro(Directory);
+  vtkGetStringMacro(Directory);
+
+  ///
+  /// Name of the index file (in Directory).
+  /// Default is ".SlicerAstroHeaderIndex".
+  vtkSetStringMacro(IndexFileName);
+  vtkGetStringMacro(IndexFileName);
+
+  ///
+  /// Directory of the index file when Directory is not writable
+  /// (e.g. the user cache location). The file name is IndexFileName
+  /// followed by a hash of Directory. Default is none: the index of
+  /// a read-only directory is then kept only in memory.
+  vtkSetStringMacro(CacheDirectory);
+  vtkGetStringMacro(CacheDirectory);
+
+  ///
+  /// Path of the index file of Directory: in Directory if it is
+  /// writable, otherwise in CacheDirectory. Empty if none is available.
+  std::string GetIndexFilePath();
+
+  ///
+  /// Load the index file, scan the new and modified files,
+  /// drop the removed ones and save the index if it changed.
+  bool Update();
+
+  ///
+  /// Number of headers read from the files by the last Update
+  vtkGetMacro(NumberOfScannedFiles,int);
+
+  ///
+  /// Indexed files (names relative to Directory)
+  int GetNumberOfFiles();
+  const char* GetFileName(int index);
+
+  ///
+  /// False if the header of an indexed file could not be read
+  bool GetFileReadable(int index);
+
+  ///
+  /// Value of a keyword (e.g. "NAXIS3", "BMAJ") of an indexed file.
+  /// Returns nullptr if the keyword is not in the index.
+  const char* GetHeaderValue(int index, const char* key);
+
+  ///
+  /// Index of a file name (relative to Directory), -1 if not indexed
+  int GetFileIndex(const char* fileName);
+
+protected:
+  vtkFITSHeaderIndex();
+  ~vtkFITSHeaderIndex();
+
+  bool ReadIndexFile();
+  bool WriteIndexFile();
+
+  char *Directory;
+  char *IndexFileName;
+  char *CacheDirectory;
+  int NumberOfScannedFiles;
+
+  vtkFITSHeaderIndexEntries *Entries;
+
+private:
+  vtkFITSHeaderIndex(const vtkFITSHeaderIndex&);  /// Not implemented.
+  void operator=(const vtkFITSHeaderIndex&);  /// Not implemented.
+
+};
+
+#endif
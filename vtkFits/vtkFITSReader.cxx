@@ -18,12 +18,20 @@
 ==============================================================================*/
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <stdio.h>
 #include <string>
 #include <zlib.h>
 
+// POSIX includes (plane-chunked reads)
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // vtkASTRO includes
 #include <vtkFITSReader.h>
 
@@ -32,6 +40,7 @@
 #include <QRegExp>
 
 // VTK includes
+#include <vtkByteSwap.h>
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
 #include <vtkImageData.h>
@@ -47,8 +56,17 @@
 // Slicer includes
 #include "vtkMRMLVolumeArchetypeStorageNode.h"
 
+// AstroVolume includes
+#include <vtkSlicerAstroConfigure.h>
+
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
+
 // STD includes
 #include <sstream>
+#include <sys/time.h>
 
 vtkStandardNewMacro(vtkFITSReader);
 
@@ -60,8 +78,19 @@ vtkFITSReader::vtkFITSReader()
   this->CurrentFileName = nullptr;
   this->UseNativeOrigin = true;
   this->Compression = false;
+  this->ParallelRead = true;
+  this->ScalarTypePolicy = NativeScalarType;
+  this->ImageExtension = -1;
+  this->ReadScaledInt16 = false;
+  this->QuantizeInt16 = false;
+  this->DataRange[0] = 0.;
+  this->DataRange[1] = 0.;
+  this->DataRangeValid = false;
   this->fptr = nullptr;
   this->ReadStatus = 0;
+  this->MemoryBuffer = nullptr;
+  this->MemoryBufferSize = 0;
+  this->DecompressionThroughput = 0.;
   this->WCS = new struct wcsprm;
   this->WCS->flag = -1;
   wcserr_enable(1);
@@ -107,6 +136,9 @@ vtkFITSReader::~vtkFITSReader()
     this->CurrentFileName = nullptr;
     }
 
+  this->CloseFITSFile();
+  this->ReleaseMemoryBuffer();
+
   if(this->WCS)
     {
     if((this->WCSStatus = wcsvfree(&this->NWCS, &this->WCS)))
@@ -141,151 +173,1166 @@ template <typename T> T StringToNumber(const char* num)
   return ss >> result ? result : 0;
 }
 
-//----------------------------------------------------------------------------
-int StringToInt(const char* str)
-{
-  return StringToNumber<int>(str);
-}
+//----------------------------------------------------------------------------
+int StringToInt(const char* str)
+{
+  return StringToNumber<int>(str);
+}
+
+//----------------------------------------------------------------------------
+double StringToDouble(const char* str)
+{
+  return StringToNumber<double>(str);
+}
+
+//----------------------------------------------------------------------------
+template <typename T> std::string NumberToString(T V)
+{
+  std::string stringValue;
+  std::stringstream strstream;
+
+  strstream << V;
+  strstream >> stringValue;
+  return stringValue;
+}
+
+//----------------------------------------------------------------------------
+std::string IntToString(int Value)
+{
+  return NumberToString<int>(Value);
+}
+
+//----------------------------------------------------------------------------
+std::string DoubleToString(double Value)
+{
+  return NumberToString<double>(Value);
+}
+
+//----------------------------------------------------------------------------
+std::string ZeroPadNumber(int num)
+{
+  std::stringstream ss;
+
+  // the number is converted to string with the help of stringstream
+  ss << num;
+  std::string ret;
+  ss >> ret;
+
+  // Append zero chars
+  int str_length = ret.length();
+  for (int ii = 0; ii < 7 - str_length; ii++)
+    ret = "0" + ret;
+  return ret;
+}
+
+//----------------------------------------------------------------------------
+template <typename FileType, typename OutType>
+void ConvertFITSValues(const char *raw, OutType *out, vtkIdType numberOfValues,
+                       bool scaled, double bscale, double bzero,
+                       bool checkBlank, long long blank)
+{
+  const FileType *in = reinterpret_cast<const FileType*>(raw);
+  if (!scaled && !checkBlank)
+    {
+    for (vtkIdType ii = 0; ii < numberOfValues; ii++)
+      {
+      out[ii] = static_cast<OutType>(in[ii]);
+      }
+    return;
+    }
+
+  for (vtkIdType ii = 0; ii < numberOfValues; ii++)
+    {
+    if (checkBlank && static_cast<long long>(in[ii]) == blank)
+      {
+      out[ii] = std::numeric_limits<OutType>::quiet_NaN();
+      continue;
+      }
+    out[ii] = static_cast<OutType>(in[ii] * bscale + bzero);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <typename OutType>
+void ConvertFITSValues(int bitpix, const char *raw, OutType *out, vtkIdType numberOfValues,
+                       bool scaled, double bscale, double bzero,
+                       bool checkBlank, long long blank)
+{
+  switch (bitpix)
+    {
+    case BYTE_IMG:
+      ConvertFITSValues<unsigned char, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, checkBlank, blank);
+      break;
+    case SHORT_IMG:
+      ConvertFITSValues<short, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, checkBlank, blank);
+      break;
+    case LONG_IMG:
+      ConvertFITSValues<int, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, checkBlank, blank);
+      break;
+    case LONGLONG_IMG:
+      ConvertFITSValues<long long, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, checkBlank, blank);
+      break;
+    case FLOAT_IMG:
+      ConvertFITSValues<float, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, false, blank);
+      break;
+    case DOUBLE_IMG:
+      ConvertFITSValues<double, OutType>(raw, out, numberOfValues, scaled, bscale, bzero, false, blank);
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+// Range of the (non NaN) values, merged in minimum/maximum
+template <typename T>
+void UpdateValuesRange(const char *values, vtkIdType numberOfValues,
+                       double &minimum, double &maximum)
+{
+  const T *in = reinterpret_cast<const T*>(values);
+  for (vtkIdType ii = 0; ii < numberOfValues; ii++)
+    {
+    if (in[ii] != in[ii])
+      {
+      continue;
+      }
+    if (in[ii] < minimum)
+      {
+      minimum = in[ii];
+      }
+    if (in[ii] > maximum)
+      {
+      maximum = in[ii];
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Progress and abort requests are handled by the calling thread only
+// (observers of the progress events are not thread safe).
+bool IsMasterThread()
+{
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  return omp_get_thread_num() == 0;
+  #else
+  return true;
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+}
+
+//----------------------------------------------------------------------------
+// FITS data are stored big-endian
+void SwapFITSValues(char *raw, int bytesPerValue, size_t numberOfValues)
+{
+  switch (bytesPerValue)
+    {
+    case 2:
+      vtkByteSwap::Swap2BERange(raw, numberOfValues);
+      break;
+    case 4:
+      vtkByteSwap::Swap4BERange(raw, numberOfValues);
+      break;
+    case 8:
+      vtkByteSwap::Swap8BERange(raw, numberOfValues);
+      break;
+    }
+}
+
+#ifndef _WIN32
+//----------------------------------------------------------------------------
+bool PReadAll(int fd, char *buffer, size_t numberOfBytes, off_t offset)
+{
+  while (numberOfBytes > 0)
+    {
+    ssize_t numRead = pread(fd, buffer, numberOfBytes, offset);
+    if (numRead <= 0)
+      {
+      return false;
+      }
+    buffer += numRead;
+    offset += numRead;
+    numberOfBytes -= static_cast<size_t>(numRead);
+    }
+  return true;
+}
+
+#endif // _WIN32
+
+}// end namespace
+
+//----------------------------------------------------------------------------
+vtkMatrix4x4* vtkFITSReader::GetRasToIjkMatrix()
+{
+  this->ExecuteInformation();
+  return this->RasToIjkMatrix;
+}
+
+//----------------------------------------------------------------------------
+char* vtkFITSReader::GetHeaderKeys()
+{
+  std::string keys;
+  for (std::map<std::string,std::string>::iterator i = HeaderKeyValue.begin();
+       i != this->HeaderKeyValue.end(); i++)
+    {
+    std::string s = static_cast<std::string> (i->first);
+    if (i != this->HeaderKeyValue.begin())
+      {
+      keys = keys + " ";
+      }
+    keys = keys + s;
+    }
+  if (this->HeaderKeys)
+    {
+    delete [] this->HeaderKeys;
+    }
+  this->HeaderKeys = nullptr;
+
+  if (keys.size() > 0)
+    {
+    this->HeaderKeys = new char[keys.size()+1];
+    strcpy(this->HeaderKeys, keys.c_str());
+    }
+  return this->HeaderKeys;
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> vtkFITSReader::GetHeaderKeysVector()
+{
+  std::vector<std::string> keys;
+
+  for (std::map<std::string,std::string>::iterator i = this->HeaderKeyValue.begin();
+       i != this->HeaderKeyValue.end(); i++)
+    {
+    keys.push_back( i->first );
+    }
+  return keys;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkFITSReader::GetHeaderValue(const char *key)
+{
+  std::map<std::string,std::string>::iterator i = this->HeaderKeyValue.find(key);
+  if (i != HeaderKeyValue.end())
+    {
+    return (i->second.c_str());
+    }
+  else
+    {
+    return nullptr;
+    }
+}
+
+//----------------------------------------------------------------------------
+struct wcsprm* vtkFITSReader::GetWCSStruct()
+{
+  this->ExecuteInformation();
+  return this->WCS;
+}
+
+// Utility function to decompress files with zlib.
+// The whole archive is inflated in memory with large reads,
+// avoiding the temporary decompressed copy on disk.
+//----------------------------------------------------------------------------
+bool vtkFITSReader::DecompressToMemory(const char *infilename)
+{
+  if (this->MemoryBuffer && !this->MemoryBufferFileName.compare(infilename))
+    {
+    return true;
+    }
+
+  this->ReleaseMemoryBuffer();
+
+  FILE *sizefile = fopen(infilename, "rb");
+  if (!sizefile)
+    {
+    return false;
+    }
+
+  // the gzip trailer stores the uncompressed size modulo 2^32:
+  // use it as first guess and grow the buffer if it is not enough.
+  size_t compressedSize = 0;
+  unsigned char isize[4] = {0, 0, 0, 0};
+  if (fseek(sizefile, 0, SEEK_END) == 0)
+    {
+    compressedSize = static_cast<size_t>(ftell(sizefile));
+    if (compressedSize > 4 && fseek(sizefile, -4, SEEK_END) == 0)
+      {
+      if (fread(isize, 1, 4, sizefile) != 4)
+        {
+        isize[0] = isize[1] = isize[2] = isize[3] = 0;
+        }
+      }
+    }
+  fclose(sizefile);
+
+  size_t capacity = static_cast<size_t>(isize[0]) |
+                    (static_cast<size_t>(isize[1]) << 8) |
+                    (static_cast<size_t>(isize[2]) << 16) |
+                    (static_cast<size_t>(isize[3]) << 24);
+  if (capacity < compressedSize)
+    {
+    capacity = 4 * compressedSize;
+    }
+  // multiple of the FITS block size and one spare block, so that
+  // a correct guess does not trigger a reallocation at the end of the stream.
+  capacity = (capacity / 2880 + 2) * 2880;
+
+  gzFile infile = gzopen(infilename, "rb");
+  if (!infile)
+    {
+    return false;
+    }
+  gzbuffer(infile, 1 << 20);
+
+  char *buffer = static_cast<char*>(malloc(capacity));
+  if (!buffer)
+    {
+    gzclose(infile);
+    return false;
+    }
+
+  struct timeval start, end;
+  gettimeofday(&start, nullptr);
+
+  const size_t chunkSize = 1 << 24;
+  size_t totalRead = 0;
+  int numRead = 0;
+  for(;;)
+    {
+    if (capacity - totalRead < chunkSize)
+      {
+      size_t newCapacity = capacity + std::max(capacity / 2, chunkSize);
+      char *newBuffer = static_cast<char*>(realloc(buffer, newCapacity));
+      if (!newBuffer)
+        {
+        free(buffer);
+        gzclose(infile);
+        return false;
+        }
+      buffer = newBuffer;
+      capacity = newCapacity;
+      }
+
+    numRead = gzread(infile, buffer + totalRead, static_cast<unsigned int>(chunkSize));
+    if (numRead <= 0)
+      {
+      break;
+      }
+    totalRead += static_cast<size_t>(numRead);
+    }
+
+  gzclose(infile);
+
+  if (numRead < 0 || totalRead == 0)
+    {
+    free(buffer);
+    return false;
+    }
+
+  gettimeofday(&end, nullptr);
+  double elapsedTime = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1.E-6;
+  double megaBytes = static_cast<double>(totalRead) / (1024. * 1024.);
+  this->DecompressionThroughput = elapsedTime > 0. ? megaBytes / elapsedTime : 0.;
+
+  vtkDebugMacro(<<"vtkFITSReader::DecompressToMemory: inflated "<<megaBytes<<" MB from "
+                <<infilename<<" in "<<elapsedTime<<" s ("<<this->DecompressionThroughput<<" MB/s).");
+
+  this->MemoryBuffer = buffer;
+  this->MemoryBufferSize = totalRead;
+  this->MemoryBufferFileName = infilename;
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::ReleaseMemoryBuffer()
+{
+  if (this->MemoryBuffer)
+    {
+    free(this->MemoryBuffer);
+    this->MemoryBuffer = nullptr;
+    }
+  this->MemoryBufferSize = 0;
+  this->MemoryBufferFileName.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::OpenFITSFile()
+{
+  if (this->GetFileName() == nullptr)
+    {
+    return false;
+    }
+
+  if (this->fptr && !this->OpenFileName.compare(this->GetFileName()))
+    {
+    return true;
+    }
+
+  this->CloseFITSFile();
+  this->ReadStatus = 0;
+
+  if (!this->GetCompression())
+    {
+    if (fits_open_data(&this->fptr, this->GetFileName(), READONLY, &this->ReadStatus))
+      {
+      this->fptr = nullptr;
+      return false;
+      }
+    if (this->ImageExtension >= 0 &&
+        fits_movabs_hdu(this->fptr, this->ImageExtension + 1, nullptr, &this->ReadStatus))
+      {
+      this->CloseFITSFile();
+      return false;
+      }
+    this->OpenFileName = this->GetFileName();
+    return true;
+    }
+
+  if (!this->DecompressToMemory(this->GetFileName()))
+    {
+    vtkErrorMacro(<<"vtkFITSReader::OpenFITSFile: Decompression failed.");
+    return false;
+    }
+
+  if (fits_open_memfile(&this->fptr, this->GetFileName(), READONLY,
+                        &this->MemoryBuffer, &this->MemoryBufferSize,
+                        0, nullptr, &this->ReadStatus))
+    {
+    this->fptr = nullptr;
+    return false;
+    }
+
+  // move to the first HDU containing data, as fits_open_data does.
+  int naxis = 0, hduType = 0;
+  if (this->ImageExtension >= 0)
+    {
+    fits_movabs_hdu(this->fptr, this->ImageExtension + 1, &hduType, &this->ReadStatus);
+    }
+  fits_get_img_dim(this->fptr, &naxis, &this->ReadStatus);
+  while (!this->ReadStatus && naxis == 0 && this->ImageExtension < 0)
+    {
+    if (fits_movrel_hdu(this->fptr, 1, &hduType, &this->ReadStatus))
+      {
+      break;
+      }
+    fits_get_img_dim(this->fptr, &naxis, &this->ReadStatus);
+    }
+
+  if (this->ReadStatus)
+    {
+    this->CloseFITSFile();
+    return false;
+    }
+
+  this->OpenFileName = this->GetFileName();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkFITSReader::CloseFITSFile()
+{
+  if (!this->fptr)
+    {
+    return;
+    }
+
+  int status = 0;
+  if (fits_close_file(this->fptr, &status))
+    {
+    vtkErrorMacro("vtkFITSReader::CloseFITSFile: ERROR IN CFITSIO! Error closing "
+                  << this->OpenFileName << ":\n");
+    fits_report_error(stderr, status);
+    }
+  this->fptr = nullptr;
+  this->OpenFileName.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::ReadDataParallel(void *outPtr, const int extent[6])
+{
+#ifdef _WIN32
+  (void)outPtr;
+  (void)extent;
+  return false;
+#else
+  if (!this->fptr || this->GetCompression())
+    {
+    return false;
+    }
+
+  int status = 0;
+  // tile-compressed images are stored in a binary table
+  if (fits_is_compressed_image(this->fptr, &status))
+    {
+    return false;
+    }
+  int bitpix = 0, fileNaxes = 0;
+  LONGLONG fileNaxe[9] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+  if (fits_get_img_paramll(this->fptr, 9, &bitpix, &fileNaxes, fileNaxe, &status) ||
+      fileNaxes < 1)
+    {
+    return false;
+    }
+
+  LONGLONG headStart = 0, dataStart = 0, dataEnd = 0;
+  if (fits_get_hduaddrll(this->fptr, &headStart, &dataStart, &dataEnd, &status))
+    {
+    return false;
+    }
+
+  // Scaling and blank values as cfitsio would apply them
+  double bscale = 1., bzero = 0.;
+  long long blank = 0;
+  bool checkBlank = false;
+  if (fits_read_key(this->fptr, TDOUBLE, "BSCALE", &bscale, nullptr, &status))
+    {
+    bscale = 1.;
+    status = 0;
+    }
+  if (fits_read_key(this->fptr, TDOUBLE, "BZERO", &bzero, nullptr, &status))
+    {
+    bzero = 0.;
+    status = 0;
+    }
+  if (bitpix > 0)
+    {
+    checkBlank = !fits_read_key(this->fptr, TLONGLONG, "BLANK", &blank, nullptr, &status);
+    status = 0;
+    }
+  bool scaled = (bscale != 1. || bzero != 0.);
+
+  int bytesPerValue = abs(bitpix) / 8;
+  int outBytesPerValue = 0;
+  switch (this->DataType)
+    {
+    case VTK_DOUBLE:
+      outBytesPerValue = sizeof(double);
+      break;
+    case VTK_FLOAT:
+      outBytesPerValue = sizeof(float);
+      break;
+    case VTK_SHORT:
+      // masks: only plain 16 bits integers (no NaN for blank values)
+      if (bitpix != SHORT_IMG || scaled)
+        {
+        return false;
+        }
+      checkBlank = false;
+      outBytesPerValue = sizeof(short);
+      break;
+    default:
+      return false;
+    }
+
+  int fd = open(this->GetFileName(), O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+
+  const vtkIdType fileNx = fileNaxe[0];
+  const vtkIdType fileNy = fileNaxes > 1 ? fileNaxe[1] : 1;
+  const vtkIdType outNx = extent[1] - extent[0] + 1;
+  const vtkIdType outNy = extent[3] - extent[2] + 1;
+  const vtkIdType outNz = extent[5] - extent[4] + 1;
+  const size_t fileRowBytes = static_cast<size_t>(fileNx) * bytesPerValue;
+
+  // the raw values can be read directly in the output
+  // and byte-swapped in place when no conversion is needed.
+  bool direct = (outNx == fileNx && !scaled && !checkBlank &&
+                 bytesPerValue == outBytesPerValue &&
+                 (bitpix < 0 || this->DataType == VTK_SHORT));
+
+  // each work chunk is a block of rows of one spectral plane of
+  // at most ~8 MB; planes are split only when they are larger.
+  const size_t maxChunkBytes = 8 << 20;
+  vtkIdType rowsPerChunk = static_cast<vtkIdType>(std::max<size_t>(1, maxChunkBytes / fileRowBytes));
+  rowsPerChunk = std::min(rowsPerChunk, outNy);
+  const vtkIdType chunksPerPlane = (outNy + rowsPerChunk - 1) / rowsPerChunk;
+  const vtkIdType numberOfChunks = chunksPerPlane * outNz;
+
+  char *out = static_cast<char*>(outPtr);
+  // written and read by all the threads
+  std::atomic<bool> readError(false);
+
+  // the range of the data is computed on the chunks just read
+  const bool computeRange = (this->DataType == VTK_FLOAT || this->DataType == VTK_DOUBLE);
+  double minimum = std::numeric_limits<double>::max();
+  double maximum = -std::numeric_limits<double>::max();
+  std::atomic<vtkIdType> chunksDone(0);
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+  #pragma omp parallel shared(readError, chunksDone)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  {
+  std::vector<char> raw;
+  if (!direct)
+    {
+    raw.resize(static_cast<size_t>(rowsPerChunk) * fileRowBytes);
+    }
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp for schedule(dynamic) reduction(min : minimum), reduction(max : maximum)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (vtkIdType chunk = 0; chunk < numberOfChunks; chunk++)
+    {
+    if (readError)
+      {
+      continue;
+      }
+
+    const vtkIdType zz = chunk / chunksPerPlane;
+    const vtkIdType firstRow = (chunk % chunksPerPlane) * rowsPerChunk;
+    const vtkIdType numberOfRows = std::min(rowsPerChunk, outNy - firstRow);
+
+    const vtkIdType fileY = extent[2] + firstRow;
+    const vtkIdType fileZ = extent[4] + zz;
+    const off_t fileOffset = static_cast<off_t>(dataStart) +
+      static_cast<off_t>((fileZ * fileNy + fileY) * fileNx) * bytesPerValue;
+    const size_t numberOfBytes = static_cast<size_t>(numberOfRows) * fileRowBytes;
+    char *outChunk = out + ((zz * outNy + firstRow) * outNx) * outBytesPerValue;
+
+    if (direct)
+      {
+      if (!PReadAll(fd, outChunk, numberOfBytes, fileOffset))
+        {
+        readError = true;
+        continue;
+        }
+      SwapFITSValues(outChunk, bytesPerValue, static_cast<size_t>(numberOfRows * fileNx));
+      }
+    else
+      {
+      if (!PReadAll(fd, &raw[0], numberOfBytes, fileOffset))
+        {
+        readError = true;
+        continue;
+        }
+      SwapFITSValues(&raw[0], bytesPerValue, static_cast<size_t>(numberOfRows * fileNx));
+
+      for (vtkIdType row = 0; row < numberOfRows; row++)
+        {
+        const char *rawRow = &raw[0] + row * fileRowBytes + extent[0] * bytesPerValue;
+        char *outRow = outChunk + row * outNx * outBytesPerValue;
+        switch (this->DataType)
+          {
+          case VTK_DOUBLE:
+            ConvertFITSValues<double>(bitpix, rawRow, reinterpret_cast<double*>(outRow), outNx,
+                                      scaled, bscale, bzero, checkBlank, blank);
+            break;
+          case VTK_FLOAT:
+            ConvertFITSValues<float>(bitpix, rawRow, reinterpret_cast<float*>(outRow), outNx,
+                                     scaled, bscale, bzero, checkBlank, blank);
+            break;
+          case VTK_SHORT:
+            ConvertFITSValues<short>(bitpix, rawRow, reinterpret_cast<short*>(outRow), outNx,
+                                     false, 1., 0., false, 0);
+            break;
+          }
+        }
+      }
+
+    if (computeRange)
+      {
+      if (this->DataType == VTK_DOUBLE)
+        {
+        UpdateValuesRange<double>(outChunk, numberOfRows * outNx, minimum, maximum);
+        }
+      else
+        {
+        UpdateValuesRange<float>(outChunk, numberOfRows * outNx, minimum, maximum);
+        }
+      }
+
+    chunksDone++;
+
+    if (IsMasterThread())
+      {
+      this->UpdateProgress(static_cast<double>(chunksDone.load()) / numberOfChunks);
+      if (this->GetAbortExecute())
+        {
+        readError = true;
+        }
+      }
+    }
+  }
+
+  close(fd);
+
+  if (this->GetAbortExecute())
+    {
+    return false;
+    }
+
+  if (readError)
+    {
+    vtkWarningMacro("vtkFITSReader::ReadDataParallel: error reading "<<this->GetFileName()<<
+                    ". Falling back to cfitsio.");
+    return false;
+    }
+
+  if (computeRange && minimum <= maximum)
+    {
+    this->DataRange[0] = minimum;
+    this->DataRange[1] = maximum;
+    this->DataRangeValid = true;
+    }
+
+  return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::ReadTilesParallel(void *outPtr, const int extent[6],
+                                      int fitsDataType, void *nullval)
+{
+  int status = 0;
+  if (!this->fptr || this->GetCompression() ||
+      !fits_is_compressed_image(this->fptr, &status) || !fits_is_reentrant())
+    {
+    return false;
+    }
+
+  int fileNaxes = 0, hduNumber = 0;
+  fits_get_img_dim(this->fptr, &fileNaxes, &status);
+  fits_get_hdu_num(this->fptr, &hduNumber);
+  if (status || fileNaxes < 3)
+    {
+    return false;
+    }
+
+  // chunks of planes aligned to the tiles along the spectral axis
+  // (one plane per tile by default), so that each tile is decoded once.
+  long planesPerTile = 1;
+  if (fits_read_key(this->fptr, TLONG, "ZTILE3", &planesPerTile, nullptr, &status) ||
+      planesPerTile < 1)
+    {
+    planesPerTile = 1;
+    status = 0;
+    }
+
+  int bytesPerValue = 0;
+  switch (this->DataType)
+    {
+    case VTK_DOUBLE:
+      bytesPerValue = sizeof(double);
+      break;
+    case VTK_FLOAT:
+      bytesPerValue = sizeof(float);
+      break;
+    case VTK_SHORT:
+      bytesPerValue = sizeof(short);
+      break;
+    default:
+      return false;
+    }
+
+  const vtkIdType planeBytes = static_cast<vtkIdType>(extent[1] - extent[0] + 1) *
+                               (extent[3] - extent[2] + 1) * bytesPerValue;
+  const int firstTile = extent[4] / planesPerTile;
+  const int numberOfTiles = extent[5] / planesPerTile - firstTile + 1;
+
+  char *out = static_cast<char*>(outPtr);
+  // written and read by all the threads
+  std::atomic<bool> readError(false);
+  std::atomic<int> tilesDone(0);
+
+  // cfitsio handles can not be shared between threads:
+  // each thread opens its own (cfitsio must be built reentrant).
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+  #pragma omp parallel shared(readError, tilesDone)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  {
+  fitsfile *tfptr = nullptr;
+  int tstatus = 0;
+  if (fits_open_file(&tfptr, this->GetFileName(), READONLY, &tstatus) ||
+      fits_movabs_hdu(tfptr, hduNumber, nullptr, &tstatus))
+    {
+    readError = true;
+    }
+
+  std::vector<long> fpixel(fileNaxes, 1), lpixel(fileNaxes, 1), inc(fileNaxes, 1);
+  fpixel[0] = extent[0] + 1;
+  lpixel[0] = extent[1] + 1;
+  fpixel[1] = extent[2] + 1;
+  lpixel[1] = extent[3] + 1;
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  #pragma omp for schedule(dynamic)
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  for (int tile = 0; tile < numberOfTiles; tile++)
+    {
+    if (readError)
+      {
+      continue;
+      }
+
+    const int z0 = std::max(extent[4], static_cast<int>((firstTile + tile) * planesPerTile));
+    const int z1 = std::min(extent[5], static_cast<int>((firstTile + tile + 1) * planesPerTile - 1));
+    fpixel[2] = z0 + 1;
+    lpixel[2] = z1 + 1;
+
+    int anynull = 0;
+    if (fits_read_subset(tfptr, fitsDataType, &fpixel[0], &lpixel[0], &inc[0], nullval,
+                         out + (z0 - extent[4]) * planeBytes, &anynull, &tstatus))
+      {
+      readError = true;
+      }
+
+    tilesDone++;
+
+    if (IsMasterThread())
+      {
+      this->UpdateProgress(static_cast<double>(tilesDone.load()) / numberOfTiles);
+      if (this->GetAbortExecute())
+        {
+        readError = true;
+        }
+      }
+    }
+
+  if (tfptr)
+    {
+    tstatus = 0;
+    fits_close_file(tfptr, &tstatus);
+    }
+  }
+
+  if (this->GetAbortExecute())
+    {
+    return false;
+    }
+
+  if (readError)
+    {
+    vtkWarningMacro("vtkFITSReader::ReadTilesParallel: error decoding the tiles of "<<
+                    this->GetFileName()<<". Falling back to the serial read.");
+    return false;
+    }
 
-//----------------------------------------------------------------------------
-double StringToDouble(const char* str)
-{
-  return StringToNumber<double>(str);
+  return true;
 }
 
 //----------------------------------------------------------------------------
-template <typename T> std::string NumberToString(T V)
+void vtkFITSReader::ApplyScalarTypePolicy()
 {
-  std::string stringValue;
-  std::stringstream strstream;
+  this->ReadScaledInt16 = false;
+  this->QuantizeInt16 = false;
 
-  strstream << V;
-  strstream >> stringValue;
-  return stringValue;
-}
+  std::string dataModel = this->GetHeaderValue("SlicerAstro.DATAMODEL");
+  if (!dataModel.compare("MASK") || this->ScalarTypePolicy == NativeScalarType)
+    {
+    return;
+    }
 
-//----------------------------------------------------------------------------
-std::string IntToString(int Value)
-{
-  return NumberToString<int>(Value);
-}
+  if (this->ScalarTypePolicy == Float32ScalarType)
+    {
+    if (this->DataType == VTK_DOUBLE)
+      {
+      this->SetDataType( VTK_FLOAT );
+      this->SetDataScalarType( VTK_FLOAT );
+      }
+    return;
+    }
 
-//----------------------------------------------------------------------------
-std::string DoubleToString(double Value)
-{
-  return NumberToString<double>(Value);
+  // 8 and 16 bits integers are kept as stored, the others are quantized
+  int bitpix = StringToInt(this->GetHeaderValue("SlicerAstro.BITPIX"));
+  this->ReadScaledInt16 = true;
+  this->QuantizeInt16 = (bitpix != BYTE_IMG && bitpix != SHORT_IMG);
+  this->HeaderKeyValue["SlicerAstro.BITPIX"] = "16";
+
+  // the BLANK = 0 assumed by AllocateHeader would flag valid stored values
+  long long blank = 0;
+  int status = 0;
+  if (!this->QuantizeInt16 && this->fptr &&
+      fits_read_key(this->fptr, TLONGLONG, "BLANK", &blank, nullptr, &status))
+    {
+    this->HeaderKeyValue["SlicerAstro.BLANK"] = "UNDEFINED";
+    }
+  this->SetDataType( VTK_SHORT );
+  this->SetDataScalarType( VTK_SHORT );
 }
 
 //----------------------------------------------------------------------------
-std::string ZeroPadNumber(int num)
+bool vtkFITSReader::ReadFloatData(float *outPtr, const int extent[6])
 {
-  std::stringstream ss;
+  int dataType = this->DataType;
+  this->DataType = VTK_FLOAT;
 
-  // the number is converted to string with the help of stringstream
-  ss << num;
-  std::string ret;
-  ss >> ret;
+  float nullval = NAN;
+  bool read = (this->ParallelRead && this->ReadDataParallel(outPtr, extent)) ||
+              (this->ParallelRead && this->ReadTilesParallel(outPtr, extent, TFLOAT, &nullval));
 
-  // Append zero chars
-  int str_length = ret.length();
-  for (int ii = 0; ii < 7 - str_length; ii++)
-    ret = "0" + ret;
-  return ret;
-}
+  this->DataType = dataType;
+  if (read)
+    {
+    return true;
+    }
+  if (this->GetAbortExecute())
+    {
+    return false;
+    }
 
-}// end namespace
+  int status = 0, fileNaxes = 0;
+  fits_get_img_dim(this->fptr, &fileNaxes, &status);
+  if (status || fileNaxes < 1)
+    {
+    return false;
+    }
+  std::vector<long> fpixel(fileNaxes, 1), lpixel(fileNaxes, 1), inc(fileNaxes, 1);
+  for (int axii = 0; axii < fileNaxes && axii < 3; axii++)
+    {
+    fpixel[axii] = extent[2 * axii] + 1;
+    lpixel[axii] = extent[2 * axii + 1] + 1;
+    }
 
-//----------------------------------------------------------------------------
-vtkMatrix4x4* vtkFITSReader::GetRasToIjkMatrix()
-{
-  this->ExecuteInformation();
-  return this->RasToIjkMatrix;
+  int anynull = 0;
+  if (fits_read_subset(this->fptr, TFLOAT, &fpixel[0], &lpixel[0], &inc[0],
+                       &nullval, outPtr, &anynull, &status))
+    {
+    fits_report_error(stderr, status);
+    return false;
+    }
+
+  return true;
 }
 
 //----------------------------------------------------------------------------
-char* vtkFITSReader::GetHeaderKeys()
+bool vtkFITSReader::QuantizeData(short *outPtr, const int extent[6])
 {
-  std::string keys;
-  for (std::map<std::string,std::string>::iterator i = HeaderKeyValue.begin();
-       i != this->HeaderKeyValue.end(); i++)
+  const vtkIdType planeSize = static_cast<vtkIdType>(extent[1] - extent[0] + 1) *
+                              (extent[3] - extent[2] + 1);
+  const int numberOfPlanes = extent[5] - extent[4] + 1;
+
+  // batches of whole planes of at most ~256 MB of floats
+  const size_t maxBatchBytes = static_cast<size_t>(256) << 20;
+  int planesPerBatch = static_cast<int>(std::max<size_t>(1, maxBatchBytes /
+                                        (static_cast<size_t>(planeSize) * sizeof(float))));
+  planesPerBatch = std::min(planesPerBatch, numberOfPlanes);
+
+  std::vector<float> buffer(static_cast<size_t>(planesPerBatch) * planeSize);
+  float *values = &buffer[0];
+
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+
+  const short blank = std::numeric_limits<short>::min();
+  const double maxStored = std::numeric_limits<short>::max();
+  double minimum = std::numeric_limits<double>::max();
+  double maximum = -std::numeric_limits<double>::max();
+  double bscale = 1., bzero = 0.;
+
+  // first pass: data range; second pass: quantization
+  for (int pass = 0; pass < 2; pass++)
     {
-    std::string s = static_cast<std::string> (i->first);
-    if (i != this->HeaderKeyValue.begin())
+    for (int firstPlane = 0; firstPlane < numberOfPlanes; firstPlane += planesPerBatch)
       {
-      keys = keys + " ";
+      const int batchPlanes = std::min(planesPerBatch, numberOfPlanes - firstPlane);
+      int batchExtent[6] = {extent[0], extent[1], extent[2], extent[3],
+                            extent[4] + firstPlane, extent[4] + firstPlane + batchPlanes - 1};
+      if (!this->ReadFloatData(values, batchExtent))
+        {
+        if (!this->GetAbortExecute())
+          {
+          vtkErrorMacro("vtkFITSReader::QuantizeData: error reading "<<this->GetFileName());
+          }
+        return false;
+        }
+      this->UpdateProgress((pass * numberOfPlanes + firstPlane + batchPlanes) /
+                           (2. * numberOfPlanes));
+
+      const vtkIdType numberOfValues = planeSize * batchPlanes;
+      if (pass == 0)
+        {
+        double batchMin = minimum, batchMax = maximum;
+        #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+        #pragma omp parallel for schedule(static) reduction(min : batchMin), reduction(max : batchMax)
+        #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+        for (vtkIdType elemCnt = 0; elemCnt < numberOfValues; elemCnt++)
+          {
+          const float value = values[elemCnt];
+          if (value != value)
+            {
+            continue;
+            }
+          if (value < batchMin)
+            {
+            batchMin = value;
+            }
+          if (value > batchMax)
+            {
+            batchMax = value;
+            }
+          }
+        minimum = batchMin;
+        maximum = batchMax;
+        continue;
+        }
+
+      short *out = outPtr + planeSize * firstPlane;
+      #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      #pragma omp parallel for schedule(static)
+      #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+      for (vtkIdType elemCnt = 0; elemCnt < numberOfValues; elemCnt++)
+        {
+        const float value = values[elemCnt];
+        if (value != value)
+          {
+          out[elemCnt] = blank;
+          continue;
+          }
+        double stored = floor((value - bzero) / bscale + 0.5);
+        stored = std::min(std::max(stored, -maxStored), maxStored);
+        out[elemCnt] = static_cast<short>(stored);
+        }
+      }
+
+    if (pass == 0)
+      {
+      // stored values in [-32767, 32767]: -32768 is left for BLANK
+      if (maximum < minimum)
+        {
+        minimum = maximum = 0.;
+        }
+      bzero = 0.5 * (maximum + minimum);
+      bscale = maximum > minimum ? (maximum - minimum) / (2. * maxStored) : 1.;
       }
-    keys = keys + s;
     }
-  if (this->HeaderKeys)
+
+  // the range of the batches is not the one of the volume
+  this->DataRangeValid = false;
+
+  std::ostringstream bscaleString, bzeroString;
+  bscaleString.precision(17);
+  bzeroString.precision(17);
+  bscaleString << bscale;
+  bzeroString << bzero;
+  this->HeaderKeyValue["SlicerAstro.BSCALE"] = bscaleString.str();
+  this->HeaderKeyValue["SlicerAstro.BZERO"] = bzeroString.str();
+  this->HeaderKeyValue["SlicerAstro.BLANK"] = IntToString(blank);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSReader::ReadHeaderCards()
+{
+  if (!this->fptr)
     {
-    delete [] this->HeaderKeys;
+    vtkErrorMacro("vtkFITSReader::ReadHeaderCards :"
+                  " fptr file pointer not found.");
+    return false;
     }
-  this->HeaderKeys = nullptr;
 
-  if (keys.size() > 0)
+  // one scan of the header: the cards are then parsed
+  // from memory by both AllocateHeader and AllocateWCS.
+  char *header = nullptr;
+  int nkeyrec = 0;
+  // tile-compressed images: the cards of the uncompressed image
+  int status = 0;
+  int failed = fits_is_compressed_image(this->fptr, &status) ?
+    fits_convert_hdr2str(this->fptr, 0, nullptr, 0, &header, &nkeyrec, &this->ReadStatus) :
+    fits_hdr2str(this->fptr, 0, nullptr, 0, &header, &nkeyrec, &this->ReadStatus);
+  if (failed)
     {
-    this->HeaderKeys = new char[keys.size()+1];
-    strcpy(this->HeaderKeys, keys.c_str());
+    fits_report_error(stderr, this->ReadStatus);
+    if (header)
+      {
+      free(header);
+      }
+    return false;
     }
-  return this->HeaderKeys;
+
+  this->HeaderCards.assign(header, static_cast<size_t>(nkeyrec) * 80);
+  free(header);
+  return true;
 }
 
 //----------------------------------------------------------------------------
-std::vector<std::string> vtkFITSReader::GetHeaderKeysVector()
+bool vtkFITSReader::ReadHeaderOnly()
 {
-  std::vector<std::string> keys;
+  if (this->GetFileName() == nullptr)
+    {
+    vtkErrorMacro("vtkFITSReader::ReadHeaderOnly : file name not specified.");
+    return false;
+    }
 
-  for (std::map<std::string,std::string>::iterator i = this->HeaderKeyValue.begin();
-       i != this->HeaderKeyValue.end(); i++)
+  this->HeaderKeyValue.clear();
+  this->HeaderCards.clear();
+  this->HeaderFileName.clear();
+
+  std::string extension = vtksys::SystemTools::LowerCase(
+    vtksys::SystemTools::GetFilenameLastExtension(this->GetFileName()));
+
+  if (extension == ".fz")
     {
-    keys.push_back( i->first );
+    // the image header of tile-compressed files is converted by cfitsio
+    this->SetCompression(false);
+    bool success = this->OpenFITSFile() && this->ReadHeaderCards();
+    this->CloseFITSFile();
+    return success && this->AllocateHeader();
     }
-  return keys;
-}
 
-//----------------------------------------------------------------------------
-const char* vtkFITSReader::GetHeaderValue(const char *key)
-{
-  std::map<std::string,std::string>::iterator i = this->HeaderKeyValue.find(key);
-  if (i != HeaderKeyValue.end())
+  // read the primary header 2880 bytes blocks up to the END card
+  gzFile file = gzopen(this->GetFileName(), "rb");
+  if (!file)
     {
-    return (i->second.c_str());
+    vtkErrorMacro("vtkFITSReader::ReadHeaderOnly : could not open "<<this->GetFileName());
+    return false;
     }
-  else
+
+  char block[2880];
+  bool end = false;
+  while (!end && gzread(file, block, sizeof(block)) == static_cast<int>(sizeof(block)))
     {
-    return nullptr;
+    for (int ii = 0; ii < 36; ii++)
+      {
+      const char *card = block + ii * 80;
+      if (!strncmp(card, "END", 3) && (card[3] == ' ' || card[3] == '\0'))
+        {
+        end = true;
+        break;
+        }
+      this->HeaderCards.append(card, 80);
+      }
     }
-}
+  gzclose(file);
 
-//----------------------------------------------------------------------------
-struct wcsprm* vtkFITSReader::GetWCSStruct()
-{
-  this->ExecuteInformation();
-  return this->WCS;
+  if (!end || this->HeaderCards.compare(0, 6, "SIMPLE"))
+    {
+    vtkErrorMacro("vtkFITSReader::ReadHeaderOnly : "<<this->GetFileName()<<
+                  " does not have a valid FITS primary header.");
+    this->HeaderCards.clear();
+    return false;
+    }
+
+  this->ReadStatus = 0;
+  return this->AllocateHeader();
 }
 
-// Utility function to decompress files with zlib
 //----------------------------------------------------------------------------
-bool vtkFITSReader::decompress_one_file(const char *infilename, const char *outfilename)
+bool vtkFITSReader::ParseHeader()
 {
-  gzFile infile = gzopen(infilename, "rb");
-  FILE *outfile = fopen(outfilename, "wb");
-
-  if (!infile || !outfile)
+  if (this->GetFileName() == nullptr)
     {
     return false;
     }
 
-  char buffer[128];
-  int num_read = 0;
-  while ((num_read = gzread(infile, buffer, sizeof(buffer))) > 0)
+  if (!this->HeaderFileName.compare(this->GetFileName()))
     {
-    fwrite(buffer, 1, num_read, outfile);
+    return true;
     }
 
-  gzclose(infile);
-  fclose(outfile);
+  this->HeaderKeyValue.clear();
+  this->HeaderFileName.clear();
+
+  if (!this->ReadHeaderCards() || !this->AllocateHeader())
+    {
+    return false;
+    }
 
+  this->HeaderFileName = this->GetFileName();
   return true;
 }
 
@@ -304,26 +1351,14 @@ int vtkFITSReader::CanReadFile(const char* filename)
     }
 
   std::string extension = vtksys::SystemTools::LowerCase( vtksys::SystemTools::GetFilenameLastExtension(fname) );
-  if (extension != ".fits" && extension != ".gz")
+  if (extension != ".fits" && extension != ".gz" && extension != ".fz")
     {
     vtkDebugMacro(<<"vtkFITSReader::CanReadFile: The filename extension is not recognized.");
     return false;
     }
 
-  std::string FileName = filename;
-  std::string gz = ".gz";
-  std::size_t found =  FileName.find(gz);
-  if (found != std::string::npos)
-    {
-    FileName.replace(FileName.find(gz),gz.length(),"");
-    if (!vtkFITSReader::decompress_one_file(filename, FileName.c_str()))
-      {
-      vtkErrorMacro(<<"vtkFITSReader::CanReadFile: Decompression failed.");
-      return false;
-      }
-    this->SetFileName(FileName.c_str());
-    this->SetCompression(true);
-    }
+  this->SetFileName(filename);
+  this->SetCompression(extension == ".gz");
 
   if (this->AstroExecuteInformation())
     {
@@ -336,7 +1371,7 @@ int vtkFITSReader::CanReadFile(const char* filename)
 //----------------------------------------------------------------------------
 bool vtkFITSReader::AstroExecuteInformation()
 {
-  if(fits_open_data(&this->fptr, this->GetFileName(), READONLY, &ReadStatus))
+  if(!this->OpenFITSFile())
     {
     vtkErrorMacro("vtkFITSReader::AstroExecuteInformation: ERROR IN CFITSIO! Error reading"
                   " "<< this->GetFileName() << ": \n");
@@ -345,7 +1380,7 @@ bool vtkFITSReader::AstroExecuteInformation()
     }
 
   // Push FITS header key/value pair data into std::map
-  if(!this->AllocateHeader())
+  if(!this->ParseHeader())
     {
     vtkErrorMacro("vtkFITSReader::AstroExecuteInformation: "
                   "Failed to allocateFitsHeader. The data will not be loaded.");
@@ -405,11 +1440,10 @@ bool vtkFITSReader::AstroExecuteInformation()
     return false;
     }
 
-  if (fits_close_file(this->fptr, &this->ReadStatus))
-    {
-    fits_report_error(stderr, this->ReadStatus);
-    }
+  this->ApplyScalarTypePolicy();
 
+  // the file is left open: the information and data
+  // passes of this load reuse the same handle and header.
   return true;
 }
 
@@ -420,6 +1454,12 @@ void vtkFITSReader::ExecuteInformation()
   if (this->CurrentFileName != nullptr &&
       !strcmp (this->CurrentFileName, this->GetFileName()))
     {
+    // header and WCS already parsed: only refresh the pipeline information
+    this->vtkImageReader2::ExecuteInformation();
+    if (this->GetOutputInformation(0))
+      {
+      this->GetOutputInformation(0)->Set(vtkAlgorithm::CAN_PRODUCE_SUB_EXTENT(), 1);
+      }
     return;
     }
 
@@ -431,7 +1471,11 @@ void vtkFITSReader::ExecuteInformation()
   this->CurrentFileName = new char[1 + strlen(this->GetFileName())];
   strcpy (this->CurrentFileName, this->GetFileName());
 
-  if(fits_open_data(&this->fptr, this->GetFileName(), READONLY, &ReadStatus))
+  std::string extension = vtksys::SystemTools::LowerCase(
+    vtksys::SystemTools::GetFilenameLastExtension(this->GetFileName()));
+  this->SetCompression(extension == ".gz");
+
+  if(!this->OpenFITSFile())
     {
     vtkErrorMacro("vtkFITSReader::ExecuteInformation: ERROR IN CFITSIO! Error reading"
                   " "<< this->GetFileName() << ": \n");
@@ -439,8 +1483,6 @@ void vtkFITSReader::ExecuteInformation()
     return;
     }
 
-  this->HeaderKeyValue.clear();
-
   if (this->RasToIjkMatrix)
     {
     this->RasToIjkMatrix->Delete();
@@ -452,7 +1494,7 @@ void vtkFITSReader::ExecuteInformation()
   this->SetNumberOfComponents(1);
 
   // Push FITS header key/value pair data into std::map
-  if(!this->AllocateHeader())
+  if(!this->ParseHeader())
     {
     vtkErrorMacro("vtkFITSReader::ExecuteInformation: Failed to allocateFitsHeader.");
     return;
@@ -525,6 +1567,8 @@ void vtkFITSReader::ExecuteInformation()
     return;
     }
 
+  this->ApplyScalarTypePolicy();
+
   // Set axis information
   int dataExtent[6]={0};
   double spacings[3]={0.};
@@ -607,9 +1651,11 @@ void vtkFITSReader::ExecuteInformation()
 
   this->vtkImageReader2::ExecuteInformation();
 
-  if (fits_close_file(this->fptr, &this->ReadStatus))
+  // sub-extents are read with fits_read_subset: let the
+  // pipeline stream only the requested UPDATE_EXTENT.
+  if (this->GetOutputInformation(0))
     {
-    fits_report_error(stderr, this->ReadStatus);
+    this->GetOutputInformation(0)->Set(vtkAlgorithm::CAN_PRODUCE_SUB_EXTENT(), 1);
     }
 }
 
@@ -624,24 +1670,22 @@ bool vtkFITSReader::AllocateHeader()
 
    int nkeys, ii;
 
-   if (!this->fptr)
+   if (this->HeaderCards.empty())
      {
      vtkErrorMacro("vtkFITSReader::AllocateHeader :"
-                   " fptr file pointer not found.");
+                   " header cards not found.");
      return false;
      }
 
-   fits_get_hdrspace(this->fptr, &nkeys, nullptr, &this->ReadStatus); /* get # of keywords */
+   nkeys = static_cast<int>(this->HeaderCards.size() / 80); /* get # of keywords */
 
    /* Read and print each keywords */
    int histCont = 0, commCont = 0;
    this->HeaderKeyValue["SlicerAstro.DSS"] = "0";
    for (ii = 1; ii <= nkeys; ii++)
      {
-     if (fits_read_record(this->fptr, ii, card, &this->ReadStatus))
-       {
-       continue;
-       }
+     strncpy(card, this->HeaderCards.c_str() + (ii - 1) * 80, 80);
+     card[80] = '\0';
      if (fits_get_keyname(card, key, &keylen, &this->ReadStatus))
        {
        continue;
@@ -2019,13 +3063,19 @@ bool vtkFITSReader::AllocateWCS()
   char *header;
   int  i, nkeyrec, nreject, stat[NWCSFIX];
 
-  // read header from fits file
-  if ((this->WCSStatus = fits_hdr2str(this->fptr, 1, nullptr, 0, &header, &nkeyrec, &this->WCSStatus)))
+  // header cards without COMMENT, HISTORY and blank keywords
+  std::string stdHeader;
+  stdHeader.reserve(this->HeaderCards.size());
+  for (size_t pos = 0; pos + 80 <= this->HeaderCards.size(); pos += 80)
     {
-    fits_report_error(stderr, this->WCSStatus);
+    if (!this->HeaderCards.compare(pos, 8, "COMMENT ") ||
+        !this->HeaderCards.compare(pos, 8, "HISTORY ") ||
+        !this->HeaderCards.compare(pos, 8, "        "))
+      {
+      continue;
+      }
+    stdHeader.append(this->HeaderCards, pos, 80);
     }
-
-  std::string stdHeader(header);
   size_t found;
 
   // fix gipsy keywords in wcs
@@ -2136,6 +3186,7 @@ bool vtkFITSReader::AllocateWCS()
     }
 
   // update wcs from fits header
+  nkeyrec = static_cast<int>(stdHeader.size() / 80);
   header = (char *)malloc(((int)(stdHeader.size())+1)*sizeof(char));
   std::strcpy(header, stdHeader.c_str());
 
@@ -2811,7 +3862,9 @@ vtkImageData *vtkFITSReader::AllocateOutputData(vtkDataObject *out, vtkInformati
 
   this->ExecuteInformation();
 
-  res->SetExtent(this->GetUpdateExtent());
+  int *updateExtent = outInfo ?
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT()) : nullptr;
+  res->SetExtent(updateExtent ? updateExtent : this->GetUpdateExtent());
 
   if (!this->AllocatePointData(res, outInfo))
     {
@@ -2891,13 +3944,6 @@ bool vtkFITSReader::AllocatePointData(vtkImageData *out, vtkInformation* outInfo
 // are assumed to be the same as the file extent/order.
 void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInformation* outInfo)
 {
-  if (this->GetOutputInformation(0))
-    {
-    this->GetOutputInformation(0)->Set(
-      vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
-    this->GetOutputInformation(0)->Get(
-      vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
-    }
   vtkImageData *data = this->AllocateOutputData(output, outInfo);
 
   if (data == nullptr)
@@ -2914,9 +3960,9 @@ void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
     return;
     }
 
-  // Open the fits.  Yes, this means that the file is being opened
-  // twice: once by ExecuteInformation, and once here
-  if(fits_open_data(&this->fptr, this->GetFileName(), READONLY, &this->ReadStatus))
+  // Reuse the handle opened by CanReadFile/ExecuteInformation
+  // (the file is opened again only if it has been closed in the meantime).
+  if(!this->OpenFITSFile())
     {
     vtkErrorMacro("vtkFITSReader::ExecuteDataWithInformation: "
                   "ERROR IN CFITSIO! Error reading "<< this->GetFileName() << ":\n");
@@ -2929,67 +3975,139 @@ void vtkFITSReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
   void *ptr = nullptr;
   ptr = data->GetPointData()->GetScalars()->GetVoidPointer(0);
   this->ComputeDataIncrements();
-  unsigned int naxes = data->GetDataDimension();
-  int naxe[naxes];
-  data->GetDimensions(naxe);
-  int dim = 1;
-  for (unsigned int axii=0; axii < naxes; axii++)
+
+  // Only the requested extent is allocated and read. The file can have
+  // more axes than the header after AllocateHeader (degenerate NAXIS3/NAXIS4):
+  // those are read at their first (and only) pixel.
+  int extent[6];
+  data->GetExtent(extent);
+  int fileNaxes = 0;
+  fits_get_img_dim(this->fptr, &fileNaxes, &this->ReadStatus);
+  if (fileNaxes < 1)
+    {
+    vtkErrorMacro("vtkFITSReader::ExecuteDataWithInformation: Could not load data");
+    this->CloseFITSFile();
+    return;
+    }
+
+  std::vector<long> fpixel(fileNaxes, 1), lpixel(fileNaxes, 1), inc(fileNaxes, 1);
+  LONGLONG numberOfPixels = 1;
+  for (int axii = 0; axii < fileNaxes && axii < 3; axii++)
     {
-    dim *= naxe[axii];
+    fpixel[axii] = extent[2 * axii] + 1;
+    lpixel[axii] = extent[2 * axii + 1] + 1;
+    numberOfPixels *= lpixel[axii] - fpixel[axii] + 1;
     }
-  float nullptrval = NAN;
-  int anynullptr;
-  // load the data
+
+  bool subExtent = false;
+  for (int ii = 0; ii < 6; ii++)
+    {
+    if (extent[ii] != this->DataExtent[ii])
+      {
+      subExtent = true;
+      break;
+      }
+    }
+
+  int fitsDataType;
+  double dnullval = NAN;
+  float fnullval = NAN;
+  short snullval = 0;
+  void *nullval = nullptr;
   switch (this->DataType)
     {
     case VTK_DOUBLE:
-      if(fits_read_img(this->fptr, TDOUBLE, 1, dim, &nullptrval, ptr, &anynullptr, &this->ReadStatus))
-        {
-        fits_report_error(stderr, this->ReadStatus);
-        vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
-        return;
-        }
+      fitsDataType = TDOUBLE;
+      nullval = &dnullval;
       break;
     case VTK_FLOAT:
-      if(fits_read_img(this->fptr, TFLOAT, 1, dim, &nullptrval, ptr, &anynullptr, &this->ReadStatus))
-        {
-        fits_report_error(stderr, this->ReadStatus);
-        vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
-        return;
-        }
+      fitsDataType = TFLOAT;
+      nullval = &fnullval;
+      break;
+    case VTK_SHORT:
+      fitsDataType = TSHORT;
+      nullval = &snullval;
       break;
-  case VTK_SHORT:
-    if(fits_read_img(this->fptr, TSHORT, 1, dim, &nullptrval, ptr, &anynullptr, &this->ReadStatus))
-      {
-      fits_report_error(stderr, this->ReadStatus);
-      vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
-      return;
-      }
-    break;
     default:
       vtkErrorMacro("vtkFITSReader::ExecuteDataWithInformation: Could not load data");
+      this->CloseFITSFile();
       return;
     }
 
-  if (fits_close_file(this->fptr, &this->ReadStatus))
+  // load the data (status left by the header parsing is not relevant here)
+  this->ReadStatus = 0;
+  this->DataRangeValid = false;
+  int anynullptr;
+  if (this->ReadScaledInt16 && !this->QuantizeInt16)
     {
-    vtkErrorMacro("vtkFITSReader::ExecuteDataWithInformation: ERROR IN CFITSIO! Error closing "
-                  << this->GetFileName() << ":\n");
-    fits_report_error(stderr, this->ReadStatus);
+    // the stored integers are read without BSCALE/BZERO and BLANK conversion
+    fits_set_bscale(this->fptr, 1., 0., &this->ReadStatus);
     }
 
-  if (this->GetCompression())
+  if (this->QuantizeInt16)
+    {
+    if (!this->QuantizeData(static_cast<short*>(ptr), extent))
+      {
+      vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
+      this->CloseFITSFile();
+      return;
+      }
+    vtkDebugMacro("vtkFITSReader::ExecuteDataWithInformation: "
+                  "data quantized to 16 bits integers.");
+    }
+  else if (this->ParallelRead && this->ReadDataParallel(ptr, extent))
+    {
+    vtkDebugMacro("vtkFITSReader::ExecuteDataWithInformation: "
+                  "data read with the parallel plane-chunked reader.");
+    }
+  else if (this->ParallelRead && !this->ReadScaledInt16 &&
+           this->ReadTilesParallel(ptr, extent, fitsDataType, nullval))
+    {
+    vtkDebugMacro("vtkFITSReader::ExecuteDataWithInformation: "
+                  "tiles decoded in parallel.");
+    }
+  else if (this->GetAbortExecute())
+    {
+    vtkWarningMacro("vtkFITSReader::ExecuteDataWithInformation: "
+                    "reading of "<<this->GetFileName()<<" aborted.");
+    this->CloseFITSFile();
+    this->ReleaseMemoryBuffer();
+    return;
+    }
+  else if (subExtent)
+    {
+    if (fits_read_subset(this->fptr, fitsDataType, &fpixel[0], &lpixel[0], &inc[0],
+                         nullval, ptr, &anynullptr, &this->ReadStatus))
+      {
+      fits_report_error(stderr, this->ReadStatus);
+      vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
+      this->CloseFITSFile();
+      return;
+      }
+    }
+  else
     {
-    if (remove(this->GetFileName()) != 0)
+    if (fits_read_img(this->fptr, fitsDataType, 1, numberOfPixels,
+                      nullval, ptr, &anynullptr, &this->ReadStatus))
       {
-      vtkErrorMacro("vtkFITSReader::ExecuteDataWithInformation: "
-                    "Error deleting the decompressed file: "<< this->GetFileName() << ":\n");
+      fits_report_error(stderr, this->ReadStatus);
+      vtkErrorMacro(<< "vtkFITSReader::ExecuteDataWithInformation: data is nullptr.");
+      this->CloseFITSFile();
+      return;
       }
     }
+
+  // the data has been copied in the output: close the file
+  // and free the decompressed content (if any)
+  this->CloseFITSFile();
+  this->ReleaseMemoryBuffer();
 }
 
 //----------------------------------------------------------------------------
 void vtkFITSReader::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "ParallelRead: " << (this->ParallelRead ? "true" : "false") << "\n";
+  os << indent << "ScalarTypePolicy: " << this->ScalarTypePolicy << "\n";
+  os << indent << "ImageExtension: " << this->ImageExtension << "\n";
 }
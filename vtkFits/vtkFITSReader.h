@@ -22,6 +22,7 @@
 
 // std includes
 #include <map>
+#include <string>
 #include <vector>
 
 // VTK includes
@@ -70,6 +71,13 @@ public:
   /// Get a value given a key in the header
   const char* GetHeaderValue(const char *key);
 
+  ///
+  /// Read only the primary header cards of FileName (no data, no WCS,
+  /// no cfitsio handle: .fits.gz files are inflated only up to the END card)
+  /// and parse them with AllocateHeader. The values are then
+  /// available with GetHeaderValue. Used to scan archives quickly.
+  bool ReadHeaderOnly();
+
   ///
   /// Get WCSstruct
   ///
@@ -84,7 +92,7 @@ public:
   /// Valid extentsions
   virtual const char* GetFileExtensions() override
     {
-    return ".fits .fits.gz";
+    return ".fits .fits.gz .fits.fz";
     }
 
   ///
@@ -125,6 +133,56 @@ public:
   vtkSetMacro(Compression,bool);
   vtkGetMacro(Compression,bool);
 
+  ///
+  /// Read uncompressed data in parallel: the cube is split in chunks of
+  /// spectral planes which are read with pread and byte-swapped/converted
+  /// concurrently into the output buffer. The tiles of tile-compressed
+  /// (fpack) images are decoded concurrently. Default is on.
+  vtkSetMacro(ParallelRead,bool);
+  vtkGetMacro(ParallelRead,bool);
+  vtkBooleanMacro(ParallelRead,bool);
+
+  ///
+  /// In-memory scalar type of DATA/MODEL/moment map cubes (masks are
+  /// always read as short):
+  /// - NativeScalarType: float, or double for BITPIX 64/-64 (default);
+  /// - Float32ScalarType: float also for BITPIX 64/-64 (half the memory);
+  /// - ScaledInt16ScalarType: short holding the stored values, with the
+  ///   physical value = BSCALE * value + BZERO. BITPIX 8/16 data are kept
+  ///   as stored in the file; the other types are quantized on the data
+  ///   range, with BLANK = -32768 for the NaNs. The SlicerAstro.BITPIX,
+  ///   BSCALE, BZERO and BLANK header values are updated accordingly
+  ///   (BLANK is UNDEFINED when the file has none). The processing modules
+  ///   work on a float copy of the physical values and write float outputs;
+  ///   vtkFITSWriter saves the stored values with these keywords.
+  enum ScalarTypePolicies
+  {
+    NativeScalarType = 0,
+    Float32ScalarType,
+    ScaledInt16ScalarType
+  };
+  vtkSetClampMacro(ScalarTypePolicy, int, NativeScalarType, ScaledInt16ScalarType);
+  vtkGetMacro(ScalarTypePolicy, int);
+
+  ///
+  /// HDU (0 is the primary one) holding the image to read, e.g. a level
+  /// of a multi-resolution pyramid file. The default (-1) selects the
+  /// first HDU containing data.
+  vtkSetMacro(ImageExtension,int);
+  vtkGetMacro(ImageExtension,int);
+
+  ///
+  /// Range of the data read by the last update, computed on the chunks
+  /// of the parallel read while they are loaded. Valid only when
+  /// DataRangeValid is true (float and double data read in parallel).
+  vtkGetVector2Macro(DataRange, double);
+  vtkGetMacro(DataRangeValid, bool);
+
+  ///
+  /// Throughput (MB/s of decompressed data) of the last
+  /// in-memory decompression of a .fits.gz file
+  vtkGetMacro(DecompressionThroughput,double);
+
   ///
   /// Use image origin from the file
   void SetUseNativeOriginOn()
@@ -160,9 +218,29 @@ protected:
   int NumberOfComponents;
   bool Compression;
   bool UseNativeOrigin;
-
+  bool ParallelRead;
+  int ScalarTypePolicy;
+  int ImageExtension;
+  // set by ApplyScalarTypePolicy: the data are read as stored
+  // (scaled) 16 bits integers, quantized if BITPIX is not 8 or 16.
+  bool ReadScaledInt16;
+  bool QuantizeInt16;
+  double DataRange[2];
+  bool DataRangeValid;
+
+  // cfitsio handle, kept open from CanReadFile to the end of
+  // ExecuteDataWithInformation, and the header cards read once.
   fitsfile *fptr;
   int ReadStatus;
+  std::string OpenFileName;
+  std::string HeaderCards;
+  std::string HeaderFileName;
+
+  // decompressed .fits.gz content, opened with the cfitsio memory driver
+  void *MemoryBuffer;
+  size_t MemoryBufferSize;
+  std::string MemoryBufferFileName;
+  double DecompressionThroughput;
 
   struct wcsprm *WCS;
   struct wcsprm *ReadWCS;
@@ -176,6 +254,11 @@ protected:
   virtual bool AstroExecuteInformation();
   virtual void ExecuteDataWithInformation(vtkDataObject *output, vtkInformation* outInfo) override;
 
+  // Read the header cards (once per file) and
+  // parse them in the key/value map.
+  bool ParseHeader();
+  bool ReadHeaderCards();
+
   // SlicerAstro can read up to NAXIS = 3 and it assumes
   // the first 2 axes are the spatial (celestial) and
   // the third axis is the spectral one.
@@ -186,7 +269,29 @@ protected:
 
   bool FixGipsyHeaderOn;
 
-  static bool decompress_one_file(const char *infilename, const char *outfilename);
+  // Open the current file with cfitsio. Compressed files are inflated
+  // in memory and opened with the cfitsio memory driver.
+  bool OpenFITSFile();
+  void CloseFITSFile();
+
+  // Parallel plane-chunked read of the extent in the output buffer.
+  // Returns false when the file layout is not supported (e.g. compressed
+  // or scaled integer data read as short): the caller falls back to cfitsio.
+  bool ReadDataParallel(void *outPtr, const int extent[6]);
+  // Decodes the tiles of a tile-compressed image concurrently, with one
+  // cfitsio handle per thread. Returns false when the image is not
+  // tile-compressed or cfitsio is not reentrant.
+  bool ReadTilesParallel(void *outPtr, const int extent[6],
+                         int fitsDataType, void *nullval);
+  // Sets the DataType of DATA cubes from the ScalarTypePolicy.
+  void ApplyScalarTypePolicy();
+  // Reads the extent as float, with the fastest available path.
+  bool ReadFloatData(float *outPtr, const int extent[6]);
+  // Quantizes the extent to 16 bits integers in two passes (range, then
+  // conversion) over batches of planes read as float.
+  bool QuantizeData(short *outPtr, const int extent[6]);
+  bool DecompressToMemory(const char *infilename);
+  void ReleaseMemoryBuffer();
 
 private:
   vtkFITSReader(const vtkFITSReader&);  /// Not implemented.
@@ -17,8 +17,13 @@
 
 ==============================================================================*/
 
+#include <algorithm>
 #include <map>
 #include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
 #include <zlib.h>
 #include <stdio.h>
 
@@ -26,6 +31,7 @@
 #include <vtkFITSWriter.h>
 
 // VTK includes
+#include <vtkByteSwap.h>
 #include <vtkDoubleArray.h>
 #include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
@@ -33,6 +39,15 @@
 #include <vtkObjectFactory.h>
 #include <vtkInformation.h>
 #include <vtkVersion.h>
+#include <vtksys/SystemTools.hxx>
+
+// AstroVolume includes
+#include <vtkSlicerAstroConfigure.h>
+
+// OpenMP includes
+#ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+#include <omp.h>
+#endif
 
 // STD includes
 #include <sstream>
@@ -47,9 +62,18 @@ vtkFITSWriter::vtkFITSWriter()
   this->FileName = nullptr;
   this->UseCompression = 0;
   this->FileType = VTK_BINARY;
+  this->TileCompression = NoTileCompression;
+  this->TileSize[0] = 0;
+  this->TileSize[1] = 0;
+  this->TileSize[2] = 1;
+  this->QuantizeLevel = 0.;
+  this->AppendImage = 0;
   this->WriteErrorOff();
   this->Attributes = new AttributeMapType;
+  this->fptr = nullptr;
   this->WriteStatus = 0;
+  this->SlabDataType = 0;
+  this->SlabPlaneSize = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -65,6 +89,12 @@ vtkFITSWriter::~vtkFITSWriter()
     delete this->Attributes;
     }
 
+  // slab write not ended
+  if (this->SlabDataType != 0)
+    {
+    int status = 0;
+    fits_close_file(this->fptr, &status);
+    }
 }
 
 namespace
@@ -105,6 +135,50 @@ std::string IntToString(int Value)
 {
     return NumberToString<int>(Value);
 }
+
+//----------------------------------------------------------------------------
+template <typename T> void UnscaleValues(char *values, size_t numberOfValues,
+                                         double bscale, double bzero)
+{
+  T *typedValues = reinterpret_cast<T*>(values);
+  for (size_t ii = 0; ii < numberOfValues; ii++)
+    {
+    double value = (typedValues[ii] - bzero) / bscale;
+    if (std::numeric_limits<T>::is_integer)
+      {
+      value = floor(value + 0.5);
+      }
+    typedValues[ii] = static_cast<T>(value);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Deflates a block as raw deflate data ending on a byte boundary (sync flush):
+// independently compressed blocks concatenate into a single valid deflate
+// stream, which is closed by the last block.
+bool DeflateBlock(const void *in, size_t numberOfBytes, bool last,
+                  std::vector<unsigned char> &out)
+{
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+    return false;
+    }
+
+  out.resize(deflateBound(&strm, numberOfBytes) + 16);
+  strm.next_in = static_cast<Bytef*>(const_cast<void*>(in));
+  strm.avail_in = static_cast<uInt>(numberOfBytes);
+  strm.next_out = &out[0];
+  strm.avail_out = static_cast<uInt>(out.size());
+
+  int ret = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+  bool done = last ? ret == Z_STREAM_END : (ret == Z_OK && strm.avail_in == 0);
+  out.resize(out.size() - strm.avail_out);
+  deflateEnd(&strm);
+
+  return done;
+}
 }// end namespace
 
 
@@ -129,75 +203,9 @@ int vtkFITSWriter::FillInputPortInformation(
 
 }
 
-// Utility function for compressing files
 //----------------------------------------------------------------------------
-bool vtkFITSWriter::compress_one_file(const char *infilename, const char *outfilename)
+void vtkFITSWriter::WriteHeaderKeys()
 {
-  FILE *infile = fopen(infilename, "rb");
-  gzFile outfile = gzopen(outfilename, "wb");
-  if (!infile || !outfile)
-    {
-    return false;
-    }
-
-  char inbuffer[128];
-  int num_read = 0;
-  unsigned long total_read = 0;
-  while ((num_read = fread(inbuffer, 1, sizeof(inbuffer), infile)) > 0)
-    {
-    total_read += num_read;
-    gzwrite(outfile, inbuffer, num_read);
-    }
-  fclose(infile);
-  gzclose(outfile);
-
-  return true;
-}
-
-
-//----------------------------------------------------------------------------
-// Writes all the data from the input.
-void vtkFITSWriter::WriteData()
-{
-
-  this->WriteErrorOff();
-  if (this->GetFileName() == nullptr)
-    {
-    vtkErrorMacro("FileName has not been set. Cannot save file");
-    this->WriteErrorOn();
-    return;
-    }
-
-  // Fill in image information.
-  vtkImageData *input = this->GetInput();
-  vtkDataArray *array;
-  array = static_cast<vtkDataArray *> (input->GetPointData()->GetScalars());
-  int vtkType = array->GetDataType();
-  void *buffer = array->GetVoidPointer(0);
-  unsigned int naxes = input->GetDataDimension();
-  long int naxe[naxes];
-  int dim = 1;
-
-  //allocate FITS struct
-  remove(this->GetFileName());
-
-  fits_create_file(&fptr, this->GetFileName(), &WriteStatus);
-
-  switch (vtkType){
-    case  VTK_DOUBLE:
-      fits_create_img(fptr, DOUBLE_IMG, naxes, naxe, &WriteStatus);
-      break;
-    case VTK_FLOAT:
-      fits_create_img(fptr, FLOAT_IMG, naxes, naxe, &WriteStatus);
-      break;
-    case  VTK_SHORT:
-      fits_create_img(fptr, SHORT_IMG, naxes, naxe, &WriteStatus);
-      break;
-    default:
-      vtkErrorMacro("Could not write data type");
-      return;
-  }
-
   // write the header.
   fits_write_comment(fptr, "processed by SlicerAstro (https://github.com/Punzo/SlicerAstro)", &WriteStatus);
 
@@ -293,14 +301,346 @@ void vtkFITSWriter::WriteData()
       continue;
       }
     }
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::WriteGZipStream(const void *buffer, int vtkType,
+                                    unsigned int naxes, long int *naxe)
+{
+  // Header: the cards are generated by cfitsio on an in-memory file
+  // which never holds the data.
+  size_t memSize = 2880;
+  void *memBuffer = malloc(memSize);
+  if (fits_create_memfile(&fptr, &memBuffer, &memSize, 2880, realloc, &WriteStatus))
+    {
+    fits_report_error(stderr, WriteStatus);
+    free(memBuffer);
+    return false;
+    }
+
+  int bitpix = 0, bytesPerValue = 0;
+  switch (vtkType)
+    {
+    case VTK_DOUBLE:
+      bitpix = DOUBLE_IMG;
+      bytesPerValue = sizeof(double);
+      break;
+    case VTK_FLOAT:
+      bitpix = FLOAT_IMG;
+      bytesPerValue = sizeof(float);
+      break;
+    case VTK_SHORT:
+      bitpix = SHORT_IMG;
+      bytesPerValue = sizeof(short);
+      break;
+    default:
+      vtkErrorMacro("Could not write data type");
+      fits_close_file(fptr, &WriteStatus);
+      free(memBuffer);
+      return false;
+    }
+
+  fits_create_img(fptr, bitpix, naxes, naxe, &WriteStatus);
+  this->WriteHeaderKeys();
+
+  char *cards = nullptr;
+  int nkeys = 0;
+  fits_hdr2str(fptr, 0, nullptr, 0, &cards, &nkeys, &WriteStatus);
+  std::string header;
+  if (cards)
+    {
+    header.assign(cards, static_cast<size_t>(nkeys) * 80);
+    free(cards);
+    }
+
+  // fits_write_img would store (value - BZERO) / BSCALE
+  // (short volumes already hold the stored values)
+  double bscale = 1., bzero = 0.;
+  int keyStatus = 0;
+  if (fits_read_key(fptr, TDOUBLE, "BSCALE", &bscale, nullptr, &keyStatus))
+    {
+    bscale = 1.;
+    }
+  keyStatus = 0;
+  if (fits_read_key(fptr, TDOUBLE, "BZERO", &bzero, nullptr, &keyStatus))
+    {
+    bzero = 0.;
+    }
+  const bool scaled = vtkType != VTK_SHORT && (bscale != 1. || bzero != 0.) && bscale != 0.;
+
+  // drop the data unit before closing, so that cfitsio does not fill it
+  long int emptyAxes[1] = {0};
+  fits_resize_img(fptr, bitpix, 0, emptyAxes, &WriteStatus);
+  int headerStatus = WriteStatus;
+  fits_close_file(fptr, &WriteStatus);
+  free(memBuffer);
+  if (headerStatus || header.empty())
+    {
+    fits_report_error(stderr, headerStatus);
+    return false;
+    }
+
+  // fits_hdr2str already ends the cards with END
+  if (header.compare(header.size() - 80, 3, "END"))
+    {
+    header += "END";
+    header.resize(header.size() + 77, ' ');
+    }
+  header.resize(((header.size() + 2879) / 2880) * 2880, ' ');
+
+  size_t numberOfValues = 1;
+  for (unsigned int axii = 0; axii < naxes; axii++)
+    {
+    numberOfValues *= static_cast<size_t>(naxe[axii]);
+    }
+  const size_t dataBytes = numberOfValues * bytesPerValue;
+  const size_t paddingBytes = (2880 - dataBytes % 2880) % 2880;
+
+  std::string FileName = this->GetFileName();
+  std::string compressedName = FileName + ".gz";
+  FILE *outfile = fopen(compressedName.c_str(), "wb");
+  if (!outfile)
+    {
+    vtkErrorMacro("vtkFITSWriter::WriteGZipStream Error: could not open "<<compressedName);
+    return false;
+    }
+
+  // gzip member header (no name, no mtime, unix)
+  const unsigned char gzipHeader[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+  bool written = fwrite(gzipHeader, 1, sizeof(gzipHeader), outfile) == sizeof(gzipHeader);
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  std::vector<unsigned char> compressed;
+
+  // FITS header
+  written = written && DeflateBlock(header.data(), header.size(), false, compressed);
+  written = written && fwrite(compressed.data(), 1, compressed.size(), outfile) == compressed.size();
+  crc = crc32(crc, reinterpret_cast<const Bytef*>(header.data()), header.size());
+
+  // data: 1 MB blocks (whole values) converted to big-endian and deflated
+  // concurrently; a batch of blocks is written in order before the next one.
+  const size_t blockBytes = (1 << 20) - ((1 << 20) % bytesPerValue);
+  const vtkIdType numberOfBlocks = static_cast<vtkIdType>((dataBytes + blockBytes - 1) / blockBytes);
+  int numProcs = 1;
+  #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  numProcs = omp_get_num_procs();
+  omp_set_num_threads(numProcs);
+  #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+  const vtkIdType blocksPerBatch = 4 * numProcs;
+  std::vector<std::vector<unsigned char> > batch(blocksPerBatch);
+  std::vector<uLong> batchCrc(blocksPerBatch);
+  std::vector<size_t> batchBytes(blocksPerBatch);
+  const char *data = static_cast<const char*>(buffer);
+
+  for (vtkIdType first = 0; written && first < numberOfBlocks; first += blocksPerBatch)
+    {
+    const vtkIdType last = std::min(first + blocksPerBatch, numberOfBlocks);
+    bool deflated = true;
+
+    #ifdef VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(&&:deflated)
+    #endif // VTK_SLICER_ASTRO_SUPPORT_OPENMP
+    for (vtkIdType block = first; block < last; block++)
+      {
+      const size_t offset = static_cast<size_t>(block) * blockBytes;
+      const size_t numberOfBytes = std::min(blockBytes, dataBytes - offset);
+      std::vector<char> bigEndian(data + offset, data + offset + numberOfBytes);
+      if (scaled)
+        {
+        switch (vtkType)
+          {
+          case VTK_DOUBLE:
+            UnscaleValues<double>(&bigEndian[0], numberOfBytes / bytesPerValue, bscale, bzero);
+            break;
+          case VTK_FLOAT:
+            UnscaleValues<float>(&bigEndian[0], numberOfBytes / bytesPerValue, bscale, bzero);
+            break;
+          case VTK_SHORT:
+            UnscaleValues<short>(&bigEndian[0], numberOfBytes / bytesPerValue, bscale, bzero);
+            break;
+          }
+        }
+      switch (bytesPerValue)
+        {
+        case 2:
+          vtkByteSwap::Swap2BERange(&bigEndian[0], numberOfBytes / 2);
+          break;
+        case 4:
+          vtkByteSwap::Swap4BERange(&bigEndian[0], numberOfBytes / 4);
+          break;
+        case 8:
+          vtkByteSwap::Swap8BERange(&bigEndian[0], numberOfBytes / 8);
+          break;
+        }
+      const vtkIdType index = block - first;
+      batchCrc[index] = crc32(0L, reinterpret_cast<const Bytef*>(&bigEndian[0]), numberOfBytes);
+      batchBytes[index] = numberOfBytes;
+      deflated = DeflateBlock(&bigEndian[0], numberOfBytes, false, batch[index]) && deflated;
+      }
+
+    written = deflated;
+    for (vtkIdType index = 0; written && index < last - first; index++)
+      {
+      written = fwrite(batch[index].data(), 1, batch[index].size(), outfile) == batch[index].size();
+      crc = crc32_combine(crc, batchCrc[index], batchBytes[index]);
+      }
+    }
+
+  // FITS padding closes the deflate stream
+  std::vector<char> padding(paddingBytes, 0);
+  written = written && DeflateBlock(padding.data(), paddingBytes, true, compressed);
+  written = written && fwrite(compressed.data(), 1, compressed.size(), outfile) == compressed.size();
+  crc = crc32(crc, reinterpret_cast<const Bytef*>(padding.data()), paddingBytes);
+
+  // gzip trailer: CRC32 and size modulo 2^32, little-endian
+  const unsigned long long totalBytes = header.size() + dataBytes + paddingBytes;
+  unsigned char trailer[8];
+  for (int ii = 0; ii < 4; ii++)
+    {
+    trailer[ii] = static_cast<unsigned char>((crc >> (8 * ii)) & 0xff);
+    trailer[4 + ii] = static_cast<unsigned char>((totalBytes >> (8 * ii)) & 0xff);
+    }
+  written = written && fwrite(trailer, 1, sizeof(trailer), outfile) == sizeof(trailer);
+
+  if (fclose(outfile) != 0)
+    {
+    written = false;
+    }
+
+  if (!written)
+    {
+    vtkErrorMacro("vtkFITSWriter::WriteGZipStream Error: error writing "<<compressedName);
+    remove(compressedName.c_str());
+    }
+
+  return written;
+}
+
+//----------------------------------------------------------------------------
+// Writes all the data from the input.
+void vtkFITSWriter::WriteData()
+{
+
+  this->WriteErrorOff();
+  if (this->GetFileName() == nullptr)
+    {
+    vtkErrorMacro("FileName has not been set. Cannot save file");
+    this->WriteErrorOn();
+    return;
+    }
+
+  // Fill in image information.
+  vtkImageData *input = this->GetInput();
+  vtkDataArray *array;
+  array = static_cast<vtkDataArray *> (input->GetPointData()->GetScalars());
+  int vtkType = array->GetDataType();
+  void *buffer = array->GetVoidPointer(0);
+  unsigned int naxes = input->GetDataDimension();
+  long int naxe[naxes];
+  LONGLONG dim = 1;
 
-  // Write the FITS to file.
   for (unsigned int axii=0; axii < naxes; axii++)
     {
     naxe[axii] = StringToInt(this->GetAttribute(("SlicerAstro.NAXIS"+IntToString(axii+1))));
     dim *= naxe[axii];
     }
 
+  // gzip: the FITS stream is compressed in parallel blocks
+  // straight into the .gz file (no uncompressed copy is written).
+  if (this->GetUseCompression() && this->TileCompression == NoTileCompression &&
+      this->GetFileType() == VTK_BINARY)
+    {
+    if (!this->WriteGZipStream(buffer, vtkType, naxes, naxe))
+      {
+      vtkErrorMacro(<<"vtkFITSWriter::WriteData Error: Compression failed.");
+      this->WriteErrorOn();
+      }
+    return;
+    }
+
+  //allocate FITS struct
+  if (this->AppendImage && this->TileCompression == NoTileCompression &&
+      vtksys::SystemTools::FileExists(this->GetFileName(), true))
+    {
+    // fits_create_img appends the image after the last HDU
+    fits_open_file(&fptr, this->GetFileName(), READWRITE, &WriteStatus);
+    }
+  else
+    {
+    remove(this->GetFileName());
+    fits_create_file(&fptr, this->GetFileName(), &WriteStatus);
+    }
+
+  // the compressed image is created in a binary table extension
+  // by fits_create_img once the compression parameters are set.
+  if (this->TileCompression != NoTileCompression)
+    {
+    int compressionType = RICE_1;
+    if (this->TileCompression == GZipTileCompression)
+      {
+      compressionType = GZIP_1;
+      }
+    else if (this->TileCompression == HCompressTileCompression)
+      {
+      compressionType = HCOMPRESS_1;
+      }
+
+    long tileDim[3];
+    for (unsigned int axii=0; axii < naxes && axii < 3; axii++)
+      {
+      tileDim[axii] = this->TileSize[axii] > 0 ?
+        std::min<long>(this->TileSize[axii], naxe[axii]) : naxe[axii];
+      }
+
+    // floating point data are compressed losslessly only by GZIP
+    bool floatingPoint = (vtkType == VTK_FLOAT || vtkType == VTK_DOUBLE);
+    if (floatingPoint && this->QuantizeLevel <= 0.)
+      {
+      compressionType = GZIP_1;
+      }
+
+    fits_set_compression_type(fptr, compressionType, &WriteStatus);
+    fits_set_tile_dim(fptr, std::min<int>(naxes, 3), tileDim, &WriteStatus);
+    if (floatingPoint)
+      {
+      fits_set_quantize_level(fptr, this->QuantizeLevel > 0. ? this->QuantizeLevel : 0., &WriteStatus);
+      }
+    if (WriteStatus)
+      {
+      fits_report_error(stderr, WriteStatus);
+      vtkErrorMacro("Write: Error setting the tile compression of "<< this->GetFileName() << "\n");
+      this->WriteErrorOn();
+      WriteStatus = 0;
+      fits_close_file(fptr, &WriteStatus);
+      return;
+      }
+    }
+
+  switch (vtkType){
+    case  VTK_DOUBLE:
+      fits_create_img(fptr, DOUBLE_IMG, naxes, naxe, &WriteStatus);
+      break;
+    case VTK_FLOAT:
+      fits_create_img(fptr, FLOAT_IMG, naxes, naxe, &WriteStatus);
+      break;
+    case  VTK_SHORT:
+      fits_create_img(fptr, SHORT_IMG, naxes, naxe, &WriteStatus);
+      break;
+    default:
+      vtkErrorMacro("Could not write data type");
+      return;
+  }
+
+  this->WriteHeaderKeys();
+
+  // short volumes hold the stored values (masks, or data read
+  // as scaled 16 bits integers): no BSCALE/BZERO conversion.
+  if (vtkType == VTK_SHORT)
+    {
+    fits_set_bscale(fptr, 1., 0., &WriteStatus);
+    }
+
+  // Write the FITS to file.
   int fileType = this->GetFileType();
 
   switch (fileType)
@@ -343,31 +683,169 @@ void vtkFITSWriter::WriteData()
   fits_close_file(fptr, &WriteStatus);
   fits_report_error(stderr, WriteStatus);
 
-  if (!this->GetUseCompression())
+  return;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::BeginSlabWrite(int vtkType)
+{
+  this->WriteErrorOff();
+  if (this->GetFileName() == nullptr)
     {
-    return;
+    vtkErrorMacro("FileName has not been set. Cannot save file");
+    this->WriteErrorOn();
+    return false;
     }
 
-  // Compress file
-  std::string FileName = this->GetFileName();
-  std::string compressedName = FileName + ".gz";
+  if (this->SlabDataType != 0)
+    {
+    vtkErrorMacro("vtkFITSWriter::BeginSlabWrite Error: "
+                  "a slab write is already in progress.");
+    this->WriteErrorOn();
+    return false;
+    }
 
-  if(!vtkFITSWriter::compress_one_file(FileName.c_str(), compressedName.c_str()))
+  if (this->GetUseCompression() || this->TileCompression != NoTileCompression)
     {
-    vtkErrorMacro(<<"vtkFITSWriter::WriteData Error: Compression failed.");
+    vtkErrorMacro("vtkFITSWriter::BeginSlabWrite Error: "
+                  "compressed files can not be written by slabs.");
+    this->WriteErrorOn();
+    return false;
     }
 
-  if (remove(this->GetFileName()) != 0)
+  const char *naxis = this->GetAttribute("SlicerAstro.NAXIS");
+  unsigned int naxes = naxis ? StringToInt(naxis) : 0;
+  if (naxes < 1 || naxes > 3)
     {
-    vtkErrorMacro("vtkFITSWriter::WriteData Error: Error deleting the decompressed file: "<< this->GetFileName() << ":\n");
+    vtkErrorMacro("vtkFITSWriter::BeginSlabWrite Error: "
+                  "SlicerAstro.NAXIS not valid.");
+    this->WriteErrorOn();
+    return false;
     }
 
-  return;
+  long int naxe[3] = {1, 1, 1};
+  for (unsigned int axii = 0; axii < naxes; axii++)
+    {
+    const char *value = this->GetAttribute("SlicerAstro.NAXIS" + IntToString(axii+1));
+    naxe[axii] = value ? StringToInt(value) : 0;
+    }
+
+  int bitpix = 0;
+  switch (vtkType)
+    {
+    case VTK_DOUBLE:
+      bitpix = DOUBLE_IMG;
+      this->SlabDataType = TDOUBLE;
+      break;
+    case VTK_FLOAT:
+      bitpix = FLOAT_IMG;
+      this->SlabDataType = TFLOAT;
+      break;
+    case VTK_SHORT:
+      bitpix = SHORT_IMG;
+      this->SlabDataType = TSHORT;
+      break;
+    default:
+      vtkErrorMacro("Could not write data type");
+      this->WriteErrorOn();
+      return false;
+    }
+  this->SlabPlaneSize = static_cast<LONGLONG>(naxe[0]) * naxe[1];
+
+  this->WriteStatus = 0;
+  remove(this->GetFileName());
+  fits_create_file(&this->fptr, this->GetFileName(), &this->WriteStatus);
+  fits_create_img(this->fptr, bitpix, naxes, naxe, &this->WriteStatus);
+  this->WriteHeaderKeys();
+
+  // as in WriteData: short data hold the stored values
+  if (vtkType == VTK_SHORT)
+    {
+    fits_set_bscale(this->fptr, 1., 0., &this->WriteStatus);
+    }
+
+  if (this->WriteStatus)
+    {
+    fits_report_error(stderr, this->WriteStatus);
+    vtkErrorMacro("Write: Error creating "<< this->GetFileName() << "\n");
+    this->WriteErrorOn();
+    this->WriteStatus = 0;
+    fits_close_file(this->fptr, &this->WriteStatus);
+    this->fptr = nullptr;
+    this->SlabDataType = 0;
+    return false;
+    }
+
+  return true;
 }
 
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::WriteSlab(const void *buffer, int firstPlane, int numberOfPlanes)
+{
+  if (this->SlabDataType == 0)
+    {
+    vtkErrorMacro("vtkFITSWriter::WriteSlab Error: BeginSlabWrite has not been called.");
+    this->WriteErrorOn();
+    return false;
+    }
+
+  if (fits_write_img(this->fptr, this->SlabDataType, 1 + firstPlane * this->SlabPlaneSize,
+                     numberOfPlanes * this->SlabPlaneSize, const_cast<void*>(buffer),
+                     &this->WriteStatus))
+    {
+    fits_report_error(stderr, this->WriteStatus);
+    vtkErrorMacro("Write: Error writing "<< this->GetFileName() << "\n");
+    this->WriteErrorOn();
+    this->WriteStatus = 0;
+    return false;
+    }
+
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkFITSWriter::EndSlabWrite()
+{
+  if (this->SlabDataType == 0)
+    {
+    return false;
+    }
+
+  const char *keys[2] = {"DATAMIN", "DATAMAX"};
+  for (int ii = 0; ii < 2; ii++)
+    {
+    const char *value = this->GetAttribute(std::string("SlicerAstro.") + keys[ii]);
+    if (value && strcmp(value, "UNDEFINED"))
+      {
+      double td = StringToDouble(value);
+      fits_update_key(this->fptr, TDOUBLE, keys[ii], &td, "", &this->WriteStatus);
+      }
+    }
+
+  fits_close_file(this->fptr, &this->WriteStatus);
+  this->fptr = nullptr;
+  this->SlabDataType = 0;
+  if (this->WriteStatus)
+    {
+    fits_report_error(stderr, this->WriteStatus);
+    vtkErrorMacro("Write: Error closing "<< this->GetFileName() << "\n");
+    this->WriteErrorOn();
+    this->WriteStatus = 0;
+    return false;
+    }
+
+  return !this->GetWriteError();
+}
+
+//----------------------------------------------------------------------------
 void vtkFITSWriter::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "TileCompression: " << this->TileCompression << "\n";
+  os << indent << "TileSize: " << this->TileSize[0] << " "
+     << this->TileSize[1] << " " << this->TileSize[2] << "\n";
+  os << indent << "QuantizeLevel: " << this->QuantizeLevel << "\n";
+  os << indent << "AppendImage: " << this->AppendImage << "\n";
 }
 
 void vtkFITSWriter::SetAttribute(const std::string& name, const std::string& value)
@@ -67,6 +67,45 @@ public:
   void SetFileTypeToASCII() {this->SetFileType(VTK_ASCII);};
   void SetFileTypeToBinary() {this->SetFileType(VTK_BINARY);};
 
+  ///
+  /// Tile compression (FITS tiled image compression convention,
+  /// as written by fpack). Default is NoTileCompression.
+  enum
+    {
+    NoTileCompression = 0,
+    RiceTileCompression,
+    GZipTileCompression,
+    HCompressTileCompression
+    };
+  vtkSetClampMacro(TileCompression,int,NoTileCompression,HCompressTileCompression);
+  vtkGetMacro(TileCompression,int);
+  void SetTileCompressionToRice() {this->SetTileCompression(RiceTileCompression);};
+  void SetTileCompressionToGZip() {this->SetTileCompression(GZipTileCompression);};
+  void SetTileCompressionToHCompress() {this->SetTileCompression(HCompressTileCompression);};
+
+  ///
+  /// Tile shape in voxels. A zero size spans the whole axis:
+  /// the default (0, 0, 1) compresses each spectral plane in its own tile.
+  vtkSetVector3Macro(TileSize,int);
+  vtkGetVector3Macro(TileSize,int);
+
+  ///
+  /// Quantization level of floating point data for tile compression
+  /// (noise sigma / quantization step). Zero or negative values
+  /// disable the quantization: the data are then compressed losslessly,
+  /// with GZIP whatever the TileCompression. Default is 0 (lossless).
+  vtkSetMacro(QuantizeLevel,double);
+  vtkGetMacro(QuantizeLevel,double);
+
+  ///
+  /// Append the image as a new extension HDU when FileName already
+  /// exists (e.g. the levels of a multi-resolution pyramid file),
+  /// instead of replacing the file. Not used for compressed files.
+  /// Default is 0.
+  vtkSetMacro(AppendImage,int);
+  vtkGetMacro(AppendImage,int);
+  vtkBooleanMacro(AppendImage,int);
+
   vtkBooleanMacro(WriteError, int);
   vtkSetMacro(WriteError, int);
   vtkGetMacro(WriteError, int);
@@ -76,6 +115,19 @@ public:
   void SetAttribute(const std::string& name, const std::string& value);
   const char* GetAttribute(const std::string& key);
 
+  ///
+  /// Write a cube which is not held in memory as a whole, by slabs of
+  /// spectral planes, without an input. BeginSlabWrite creates FileName
+  /// with the header of the attributes (SlicerAstro.NAXIS and NAXISn give
+  /// the size of the image) for data of vtkType; WriteSlab writes
+  /// numberOfPlanes consecutive planes from firstPlane (0 based); and
+  /// EndSlabWrite updates the DATAMIN and DATAMAX keys from the attributes,
+  /// which can be set once all the slabs are written, and closes the file.
+  /// The file can not be compressed. Return false on error.
+  bool BeginSlabWrite(int vtkType);
+  bool WriteSlab(const void *buffer, int firstPlane, int numberOfPlanes);
+  bool EndSlabWrite();
+
 protected:
   vtkFITSWriter();
   ~vtkFITSWriter();
@@ -94,13 +146,30 @@ protected:
 
   int UseCompression;
   int FileType;
+  int TileCompression;
+  int TileSize[3];
+  double QuantizeLevel;
+  int AppendImage;
 
   AttributeMapType *Attributes;
 
   fitsfile *fptr;
   int WriteStatus;
 
-  static bool compress_one_file(const char *infilename, const char *outfilename);
+  // cfitsio data type and plane size of the slabs written
+  // between BeginSlabWrite and EndSlabWrite
+  int SlabDataType;
+  LONGLONG SlabPlaneSize;
+
+  ///
+  /// Write the header keywords, comments and history from the attributes
+  void WriteHeaderKeys();
+
+  ///
+  /// Write FileName.gz directly: the FITS stream is split in blocks
+  /// which are deflated concurrently and concatenated in a single gzip member.
+  bool WriteGZipStream(const void *buffer, int vtkType,
+                       unsigned int naxes, long int *naxe);
 
 private:
   vtkFITSWriter(const vtkFITSWriter&);  /// Not implemented.
@@ -271,6 +271,13 @@ void vtkAstroOpenGLImageAlgorithmHelper::Execute(
   outputTex->SetContext(this->RenderWindow);
   outputTex->Create3D(outDims[0], outDims[1], outDims[2], 1, VTK_FLOAT, false);
 
+  // the passes ping-pong between the output and this texture, since a
+  // pass can not read the texture it renders into:
+  // X input -> output, Y output -> temp, Z temp -> output
+  vtkNew<vtkTextureObject> tempTex;
+  tempTex->SetContext(this->RenderWindow);
+  tempTex->Create3D(outDims[0], outDims[1], outDims[2], 1, VTK_FLOAT, false);
+
   // Create the Framebuffer for the output
   vtkNew<vtkOpenGLFramebufferObject> fbo;
   fbo->SetContext(this->RenderWindow);
@@ -292,6 +299,7 @@ void vtkAstroOpenGLImageAlgorithmHelper::Execute(
 
   inputTex->Activate();
   outputTex->Activate();
+  tempTex->Activate();
 
   int inputTexId = inputTex->GetTextureUnit();
   this->Quad.Program->SetUniformi("inputTex1", inputTexId);
@@ -341,10 +349,10 @@ void vtkAstroOpenGLImageAlgorithmHelper::Execute(
     int slice = i - outExt[4];
     #if VTK_MAJOR_VERSION >= 9
     fbo->RemoveColorAttachment(0);
-    fbo->AddColorAttachment(0, outputTex.GetPointer(), slice);
+    fbo->AddColorAttachment(0, tempTex.GetPointer(), slice);
     #else
     fbo->RemoveColorAttachment(fbo->GetDrawMode(), 0);
-    fbo->AddColorAttachment(fbo->GetDrawMode(), 0, outputTex.GetPointer(), slice);
+    fbo->AddColorAttachment(fbo->GetDrawMode(), 0, tempTex.GetPointer(), slice);
     #endif
     fbo->ActivateDrawBuffer(0);
     fbo->StartNonOrtho(outDims[0], outDims[1]);
@@ -367,7 +375,7 @@ void vtkAstroOpenGLImageAlgorithmHelper::Execute(
     }
   cb->InitializeShaderUniforms(prog);
 
-  inputTexId = inputTex->GetTextureUnit();
+  inputTexId = tempTex->GetTextureUnit();
   this->Quad.Program->SetUniformi("inputTex1", inputTexId);
 
   // for each zslice in the output
@@ -413,6 +421,7 @@ void vtkAstroOpenGLImageAlgorithmHelper::Execute(
   #endif
   inputTex->Deactivate();
   outputTex->Deactivate();
+  tempTex->Deactivate();
 
   vtkNew<vtkImageCast> castFilter;
   castFilter->SetInputData(outImage);
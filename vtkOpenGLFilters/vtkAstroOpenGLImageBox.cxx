@@ -138,54 +138,34 @@ void vtkAstroOpenGLImageBox::ThreadedRequestData(
     return;
     }
 
+  // the offsets are in texture coordinates, one texel per voxel
   vtkOpenGLBoxCB cb;
-  cb.Spacing = inData[0][0]->GetSpacing();
-  int * extent = inData[0][0]->GetExtent();
-  cb.Spacing[0] /= extent[1] - extent[0];
-  cb.Spacing[1] /= extent[3] - extent[2];
-  cb.Spacing[2] /= extent[5] - extent[4];
-
+  double spacing[3];
+  int * dims = inData[0][0]->GetDimensions();
+  spacing[0] = 1. / dims[0];
+  spacing[1] = 1. / dims[1];
+  spacing[2] = 1. / dims[2];
+  cb.Spacing = spacing;
+
+  // odd kernel lengths and their half widths, without changing the
+  // KernelLength of the filter, which may be updated again
+  int kernelLength[3], radius[3];
   cb.cont = 1;
-  if (this->KernelLength[0] < 0.999)
-    {
-    this->KernelLength[0]++;
-    }
-  if (this->KernelLength[0] % 2 < 0.001)
-    {
-    this->KernelLength[0]++;
-    }
-  cb.cont *= this->KernelLength[0];
-  this->KernelLength[0] = (int) (this->KernelLength[0] - 1.) / 2.;
-
-  if (this->KernelLength[1] < 0.999)
-    {
-    this->KernelLength[1]++;
-    }
-  if (this->KernelLength[1] % 2 < 0.001)
-    {
-    this->KernelLength[1]++;
-    }
-  cb.cont *= this->KernelLength[1];
-  int norm1 = this->KernelLength[1];
-  this->KernelLength[1] = (int) (this->KernelLength[1] - 1.) / 2.;
-
-  if (this->KernelLength[2] < 0.999)
+  for (int axis = 0; axis < 3; axis++)
     {
-    this->KernelLength[2]++;
+    kernelLength[axis] = std::max(this->KernelLength[axis], 1);
+    if (kernelLength[axis] % 2 == 0)
+      {
+      kernelLength[axis]++;
+      }
+    cb.cont *= kernelLength[axis];
+    radius[axis] = (kernelLength[axis] - 1) / 2;
     }
-  if (this->KernelLength[2] % 2 < 0.001)
-    {
-    this->KernelLength[2]++;
-    }
-  cb.cont *= this->KernelLength[2];
-  int norm2 = this->KernelLength[2];
-  this->KernelLength[2] = (int) (this->KernelLength[2] - 1.) / 2.;
-
-  cb.KernelLength = this->KernelLength;
+  int norm1 = kernelLength[1];
+  int norm2 = kernelLength[2];
+  cb.KernelLength = radius;
 
-  if (fabs(this->KernelLength[0] - this->KernelLength[1]) < 0.001 &&
-      fabs(this->KernelLength[1] - this->KernelLength[2]) < 0.001 &&
-      this->Iterative)
+  if (radius[0] == radius[1] && radius[1] == radius[2] && this->Iterative)
     {
     cb.cont /= norm1 * norm2;
     std::string fragShaderBegin =
@@ -208,20 +188,26 @@ void vtkAstroOpenGLImageBox::ThreadedRequestData(
 
     std::string fragShaderX =
     "  for (int offsetX = -kernelLengthX; offsetX <= kernelLengthX; offsetX++){ \n"
-    "        vec3 offset = vec3(offsetX, 0., 0.) * spacing; \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(offsetX, 0., 0.) * spacing; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r; \n"
+    "        } \n"
     "  } \n";
 
     std::string fragShaderY =
     "  for (int offsetY = -kernelLengthY; offsetY <= kernelLengthY; offsetY++){ \n"
-    "        vec3 offset = vec3(0., offsetY, 0.) * spacing; \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(0., offsetY, 0.) * spacing; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r; \n"
+    "        } \n"
     "  } \n";
 
     std::string fragShaderZ =
     "  for (int offsetZ = -kernelLengthZ; offsetZ <= kernelLengthZ; offsetZ++){ \n"
-    "        vec3 offset = vec3(0., 0., offsetZ) * spacing; \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(0., 0., offsetZ) * spacing; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r; \n"
+    "        } \n"
     "  } \n";
 
     fragShaderX = fragShaderBegin + fragShaderX + fragShaderEnd;
@@ -266,8 +252,10 @@ void vtkAstroOpenGLImageBox::ThreadedRequestData(
     "  for (int offsetX = -kernelLengthX; offsetX <= kernelLengthX; offsetX++){ \n"
     "    for (int offsetY = -kernelLengthY; offsetY <= kernelLengthY; offsetY++){ \n"
     "      for (int offsetZ = -kernelLengthZ; offsetZ <= kernelLengthZ; offsetZ++){ \n"
-    "        vec3 offset = vec3(offsetX, offsetY, offsetZ) * spacing; \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(offsetX, offsetY, offsetZ) * spacing; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r; \n"
+    "        } \n"
     "      } \n"
     "    } \n"
     "  } \n"
@@ -18,6 +18,11 @@
 ==============================================================================*/
 
 // .NAME vtkAstroOpenGLImageBox - Compute Box using the GPU
+// .SECTION Description
+// The output is the sum over the box divided by the box size, the voxels
+// outside the image not contributing. NaN voxels are not handled here: the
+// filter is run on the data with the NaN set to zero and on the mask of the
+// valid voxels, whose ratio is the mean of the valid voxels of the box.
 
 #ifndef vtkAstroOpenGLImageBox_h
 #define vtkAstroOpenGLImageBox_h
@@ -157,32 +157,31 @@ void vtkAstroOpenGLImageGaussian::ThreadedRequestData(
     return;
     }
 
+  // the offsets are in texture coordinates, one texel per voxel
   vtkOpenGLGaussianCB cb;
-  cb.Spacing = inData[0][0]->GetSpacing();
-  int * extent = inData[0][0]->GetExtent();
-  cb.Spacing[0] /= extent[1] - extent[0];
-  cb.Spacing[1] /= extent[3] - extent[2];
-  cb.Spacing[2] /= extent[5] - extent[4];
-
-  this->KernelLength[0] = (int) (this->KernelLength[0] - 1.) / 2.;
-  this->KernelLength[1] = (int) (this->KernelLength[1] - 1.) / 2.;
-  this->KernelLength[2] = (int) (this->KernelLength[2] - 1.) / 2.;
-  cb.KernelLength = this->KernelLength;
-
-
-  this->FWHM[0] /= SigmatoFWHM;
-  this->FWHM[0] = 2. * this->FWHM[0] * this->FWHM[0];
-  this->FWHM[1] /= SigmatoFWHM;
-  this->FWHM[1] = 2. * this->FWHM[1] * this->FWHM[1];
-  this->FWHM[2] /= SigmatoFWHM;
-  this->FWHM[2] = 2. * this->FWHM[2] * this->FWHM[2];
-  cb.StandardDev = this->FWHM;
+  double spacing[3];
+  int * dims = inData[0][0]->GetDimensions();
+  spacing[0] = 1. / dims[0];
+  spacing[1] = 1. / dims[1];
+  spacing[2] = 1. / dims[2];
+  cb.Spacing = spacing;
+
+  // half widths of the kernel and 2 sigma^2, without changing the
+  // KernelLength and FWHM of the filter, which may be updated again
+  int radius[3];
+  double standardDev[3];
+  for (int axis = 0; axis < 3; axis++)
+    {
+    radius[axis] = (int) ((this->KernelLength[axis] - 1.) / 2.);
+    const double sigma = this->FWHM[axis] / SigmatoFWHM;
+    standardDev[axis] = 2. * sigma * sigma;
+    }
+  cb.KernelLength = radius;
+  cb.StandardDev = standardDev;
 
   std::string fragShader;
 
-  if (fabs(KernelLength[0] - KernelLength[1]) < 0.001 &&
-      fabs(KernelLength[1] - KernelLength[2]) < 0.001 &&
-      this->Iterative)
+  if (radius[0] == radius[1] && radius[1] == radius[2] && this->Iterative)
     {
     std::string fragShaderBegin =
     "//VTK::System::Dec\n"
@@ -205,29 +204,35 @@ void vtkAstroOpenGLImageGaussian::ThreadedRequestData(
 
     std::string fragShaderX =
     "  for (int offsetX = -kernelLengthX; offsetX <= kernelLengthX; offsetX++){ \n"
-    "        vec3 offset = vec3(offsetX, 0., 0.) * spacing; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(offsetX, 0., 0.) * spacing; \n"
     "        float expA = offsetX * offsetX / StandardDev.x; \n"
     "        float kernel = exp(-(expA)); \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r * kernel; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r * kernel; \n"
+    "        } \n"
     "        sum = sum + kernel; \n"
     "  } \n";
 
     std::string fragShaderY =
     "  for (int offsetY = -kernelLengthY; offsetY <= kernelLengthY; offsetY++){ \n"
-    "        vec3 offset = vec3(0., offsetY, 0.) * spacing; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(0., offsetY, 0.) * spacing; \n"
     "        float expA = offsetY * offsetY / StandardDev.y; \n"
     "        float kernel = exp(-(expA)); \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r * kernel; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r * kernel; \n"
+    "        } \n"
     "        sum = sum + kernel; \n"
     "  } \n";
 
 
     std::string fragShaderZ =
     "  for (int offsetZ = -kernelLengthZ; offsetZ <= kernelLengthZ; offsetZ++){ \n"
-    "        vec3 offset = vec3(0., 0., offsetZ) * spacing; \n"
+    "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(0., 0., offsetZ) * spacing; \n"
     "        float expA = offsetZ * offsetZ / StandardDev.z; \n"
     "        float kernel = exp(-(expA)); \n"
-    "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r * kernel; \n"
+    "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+    "          data = data + texture3D(inputTex1, pos).r * kernel; \n"
+    "        } \n"
     "        sum = sum + kernel; \n"
     "  } \n";
 
@@ -279,12 +284,14 @@ void vtkAstroOpenGLImageGaussian::ThreadedRequestData(
       "  for (int offsetX = -kernelLengthX; offsetX <= kernelLengthX; offsetX++){ \n"
       "    for (int offsetY = -kernelLengthY; offsetY <= kernelLengthY; offsetY++){ \n"
       "      for (int offsetZ = -kernelLengthZ; offsetZ <= kernelLengthZ; offsetZ++){ \n"
-      "        vec3 offset = vec3(offsetX, offsetY, offsetZ) * spacing; \n"
+      "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(offsetX, offsetY, offsetZ) * spacing; \n"
       "        float expA = offsetX * offsetX / StandardDev.x; \n"
       "        float expB = offsetY * offsetY / StandardDev.y; \n"
       "        float expC = offsetZ * offsetZ / StandardDev.z; \n"
       "        float kernel = exp(-(expA + expB + expC)); \n"
-      "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r * kernel; \n"
+      "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+      "          data = data + texture3D(inputTex1, pos).r * kernel; \n"
+      "        } \n"
       "        sum = sum + kernel; \n"
       "      } \n"
       "    } \n"
@@ -328,7 +335,7 @@ void vtkAstroOpenGLImageGaussian::ThreadedRequestData(
       "  for (int offsetX = -kernelLengthX; offsetX <= kernelLengthX; offsetX++){ \n"
       "    for (int offsetY = -kernelLengthY; offsetY <= kernelLengthY; offsetY++){ \n"
       "      for (int offsetZ = -kernelLengthZ; offsetZ <= kernelLengthZ; offsetZ++){ \n"
-      "        vec3 offset = vec3(offsetX, offsetY, offsetZ) * spacing; \n"
+      "        vec3 pos = vec3(tcoordVSOutput, zPos) + vec3(offsetX, offsetY, offsetZ) * spacing; \n"
       "        float x = offsetX * cy * cz - (offsetY * cy * sz) + offsetZ * sy; \n"
       "        float y = offsetX * (cz * sx * sy + cx * sz) + offsetY * (cx * cz - (sx * sy * sz)) - (offsetZ * cy * sx); \n"
       "        float z = offsetX * (-(cx * cz * sy) + sx * sz) + offsetY * (cz * sx + cx * sy * sz) + offsetZ * cx * cy; \n"
@@ -336,7 +343,9 @@ void vtkAstroOpenGLImageGaussian::ThreadedRequestData(
       "        float expB = y * y / StandardDev.y; \n"
       "        float expC = z * z / StandardDev.z; \n"
       "        float kernel = exp(-(expA + expB + expC)); \n"
-      "        data = data + texture3D(inputTex1, vec3(tcoordVSOutput, zPos) + offset).r * kernel; \n"
+      "        if (all(greaterThanEqual(pos, vec3(0.))) && all(lessThanEqual(pos, vec3(1.)))){ \n"
+      "          data = data + texture3D(inputTex1, pos).r * kernel; \n"
+      "        } \n"
       "        sum = sum + kernel; \n"
       "      } \n"
       "    } \n"
@@ -17,7 +17,12 @@
 
 ==============================================================================*/
 
-// .NAME vtkAstroOpenGLImageGaussian - Compute Box using the GPU
+// .NAME vtkAstroOpenGLImageGaussian - Compute Gaussian using the GPU
+// .SECTION Description
+// The output is the sum over the kernel divided by the sum of the kernel,
+// the voxels outside the image not contributing. As for
+// vtkAstroOpenGLImageBox, NaN voxels are handled by running the filter on
+// the data with the NaN set to zero and on the mask of the valid voxels.
 
 #ifndef vtkAstroOpenGLImageGaussian_h
 #define vtkAstroOpenGLImageGaussian_h
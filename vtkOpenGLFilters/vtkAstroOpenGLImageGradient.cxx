@@ -139,6 +139,8 @@ void vtkAstroOpenGLImageGradient::ThreadedRequestData(
     return;
     }
 
+  // as on the CPU, the voxels with a NaN among them and their neighbours
+  // keep their value, so that the NaN voxels stay blanked
   vtkOpenGLGradientCB cb;
   cb.Spacing = inData[0][0]->GetSpacing();
   int * extent = inData[0][0]->GetExtent();
@@ -180,7 +182,9 @@ void vtkAstroOpenGLImageGradient::ThreadedRequestData(
   "float sampleA3 = texture3D(inputTex1, samplePoint + offsetA3).r;\n"
   "float sampleB3 = texture3D(inputTex1, samplePoint + offsetB3).r;\n"
   "float diffZ = ((sampleA3 - sample) + (sampleB3 - sample)) * Cl.z;\n"
-  "float data = sample + (TimeStep * (diffX + diffY + diffZ) / Norm);\n"
+  "bool blank = isnan(sample) || isnan(sampleA1) || isnan(sampleB1) ||\n"
+  "              isnan(sampleA2) || isnan(sampleB2) || isnan(sampleA3) || isnan(sampleB3);\n"
+  "float data = blank ? sample : sample + (TimeStep * (diffX + diffY + diffZ) / Norm);\n"
   "gl_FragData[0] = vec4(data, 1., 1., 1.); \n"
   "}\n";
 